@@ -0,0 +1,218 @@
+/**
+ * @file
+ * @brief Measure speed of framebuffer drawing and pixel format conversion
+ *
+ * @date 18.10.2026
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <drivers/video/fb.h>
+#include <util/array.h>
+
+#define GLYPH_WIDTH  8
+#define GLYPH_HEIGHT 16
+
+static const char glyph[GLYPH_HEIGHT] = {
+	0x00, 0x00, 0x10, 0x38, 0x6c, 0xc6, 0xc6, 0xfe,
+	0xc6, 0xc6, 0xc6, 0xc6, 0x00, 0x00, 0x00, 0x00,
+};
+
+static const enum pix_fmt conv_fmts[] = {
+	RGB565, RGB888, BGR888, BGRA8888,
+};
+
+static const char *fmt_name(enum pix_fmt fmt) {
+	switch (fmt) {
+	case RGB888:   return "RGB888";
+	case BGR888:   return "BGR888";
+	case RGBA8888: return "RGBA8888";
+	case BGRA8888: return "BGRA8888";
+	case RGB565:   return "RGB565";
+	case BGR565:   return "BGR565";
+	default:       return "?";
+	}
+}
+
+static void print_help(char **argv) {
+	printf("Usage: %s [-h] [-r REPEAT] [-w WIDTH] [-l LINES]\n", argv[0]);
+}
+
+static uint64_t time_us(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void print_speed(const char *name, uint64_t pixels, uint64_t us) {
+	if (us == 0) {
+		us = 1;
+	}
+	/* Pixels per microsecond are megapixels per second */
+	printf("%-24s %6u.%02u Mpix/s\n", name, (unsigned) (pixels / us),
+			(unsigned) (pixels * 100 / us % 100));
+}
+
+static void bench_fb(struct fb_info *fb, int repeat) {
+	struct fb_fillrect rect;
+	struct fb_copyarea area;
+	struct fb_image image;
+	uint32_t x, y, xres, yres;
+	uint64_t start, pixels;
+	int i;
+
+	xres = fb->var.xres;
+	yres = fb->var.yres;
+
+	printf("fb%d: %ux%u, %u bpp\n", fb->id, xres, yres,
+			fb->var.bits_per_pixel);
+
+	rect.dx = rect.dy = 0;
+	rect.width = xres;
+	rect.height = yres;
+	rect.rop = ROP_COPY;
+
+	start = time_us();
+	for (i = 0; i < repeat; i++) {
+		rect.color = i * 0x01020304;
+		fb_fillrect(fb, &rect);
+	}
+	print_speed("fillrect", (uint64_t) xres * yres * repeat, time_us() - start);
+
+	rect.rop = ROP_XOR;
+	start = time_us();
+	for (i = 0; i < repeat; i++) {
+		fb_fillrect(fb, &rect);
+	}
+	print_speed("fillrect xor", (uint64_t) xres * yres * repeat,
+			time_us() - start);
+
+	/* Scroll by a line of text */
+	area.sx = area.dx = 0;
+	area.sy = GLYPH_HEIGHT;
+	area.dy = 0;
+	area.width = xres;
+	area.height = yres - GLYPH_HEIGHT;
+
+	start = time_us();
+	for (i = 0; i < repeat; i++) {
+		fb_copyarea(fb, &area);
+	}
+	print_speed("copyarea", (uint64_t) area.width * area.height * repeat,
+			time_us() - start);
+
+	image.width = GLYPH_WIDTH;
+	image.height = GLYPH_HEIGHT;
+	image.depth = 1;
+	image.fg_color = 0xffffffff;
+	image.bg_color = 0;
+	image.data = glyph;
+
+	pixels = 0;
+	start = time_us();
+	for (i = 0; i < repeat; i++) {
+		for (y = 0; y + GLYPH_HEIGHT <= yres; y += GLYPH_HEIGHT) {
+			for (x = 0; x + GLYPH_WIDTH <= xres; x += GLYPH_WIDTH) {
+				image.dx = x;
+				image.dy = y;
+				fb_imageblit(fb, &image);
+				pixels += GLYPH_WIDTH * GLYPH_HEIGHT;
+			}
+		}
+	}
+	print_speed("imageblit 8x16", pixels, time_us() - start);
+}
+
+static int bench_convert(int width, int lines, int repeat) {
+	char name[32];
+	uint64_t start;
+	size_t row, off;
+	char *src, *dst;
+	int i, j, k, l;
+
+	row = width * sizeof(uint32_t);
+	src = malloc(row * lines);
+	dst = malloc(row * lines);
+	if (!src || !dst) {
+		printf("Failed to allocate %zu bytes\n", 2 * row * lines);
+		free(src);
+		free(dst);
+		return -1;
+	}
+
+	for (off = 0; off < row * lines; off++) {
+		src[off] = off * 7;
+	}
+
+	printf("pix_fmt_convert: %dx%d\n", width, lines);
+
+	for (i = 0; i < ARRAY_SIZE(conv_fmts); i++) {
+		for (j = 0; j < ARRAY_SIZE(conv_fmts); j++) {
+			start = time_us();
+			for (k = 0; k < repeat; k++) {
+				/* Row by row as UI toolkits do */
+				for (l = 0; l < lines; l++) {
+					pix_fmt_convert(src + l * row, dst + l * row, width,
+							conv_fmts[i], conv_fmts[j]);
+				}
+			}
+			snprintf(name, sizeof(name), "%s -> %s",
+					fmt_name(conv_fmts[i]), fmt_name(conv_fmts[j]));
+			print_speed(name, (uint64_t) width * lines * repeat,
+					time_us() - start);
+		}
+	}
+
+	free(src);
+	free(dst);
+
+	return 0;
+}
+
+int main(int argc, char **argv) {
+	struct fb_info *fb;
+	int opt, repeat, width, lines;
+
+	repeat = 16;
+	width = 640;
+	lines = 480;
+
+	while (-1 != (opt = getopt(argc, argv, "hr:w:l:"))) {
+		switch (opt) {
+		case 'r':
+			repeat = strtol(optarg, NULL, 0);
+			break;
+		case 'w':
+			width = strtol(optarg, NULL, 0);
+			break;
+		case 'l':
+			lines = strtol(optarg, NULL, 0);
+			break;
+		case 'h':
+		default:
+			print_help(argv);
+			return 0;
+		}
+	}
+
+	if ((repeat <= 0) || (width <= 0) || (lines <= 0)) {
+		print_help(argv);
+		return -1;
+	}
+
+	fb = fb_lookup(0);
+	if (fb != NULL) {
+		bench_fb(fb, repeat);
+	} else {
+		printf("No framebuffer, drawing is skipped\n");
+	}
+
+	return bench_convert(width, lines, repeat);
+}
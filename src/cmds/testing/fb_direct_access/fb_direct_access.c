@@ -42,5 +42,7 @@ int main() {
 		scr_pos += screen_info.width;
 	}
 
+	fb_draw_flush(&screen_info);
+
 	return 0;
 }
@@ -40,6 +40,7 @@ static int draw_image(struct screen *screen_info, uint8_t *img, uint32_t height,
 		}
 		scr_pos += screen_info->width;
 	}
+	fb_draw_flush(screen_info);
 	return 0;
 }
 
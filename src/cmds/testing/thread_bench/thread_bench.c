@@ -0,0 +1,104 @@
+/**
+ * @file
+ * @brief Measure time of thread creation and join
+ *
+ * @date 18.10.2026
+ */
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+static void print_help(char **argv) {
+	printf("Usage: %s [-h] [-n COUNT] [-p PARALLEL]\n", argv[0]);
+}
+
+static uint64_t time_us(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void *thread_run(void *arg) {
+	return arg;
+}
+
+int main(int argc, char **argv) {
+	pthread_t *threads;
+	uint64_t start, create_us, join_us;
+	int opt, count, parallel, done, batch, i, ret;
+
+	count = 1000;
+	parallel = 1;
+
+	while (-1 != (opt = getopt(argc, argv, "hn:p:"))) {
+		switch (opt) {
+		case 'n':
+			count = strtol(optarg, NULL, 0);
+			break;
+		case 'p':
+			parallel = strtol(optarg, NULL, 0);
+			break;
+		case 'h':
+		default:
+			print_help(argv);
+			return 0;
+		}
+	}
+
+	if ((count <= 0) || (parallel <= 0)) {
+		print_help(argv);
+		return -1;
+	}
+
+	threads = malloc(parallel * sizeof(*threads));
+	if (threads == NULL) {
+		printf("Can't allocate %d threads\n", parallel);
+		return -1;
+	}
+
+	create_us = join_us = 0;
+	ret = 0;
+
+	for (done = 0; done < count; done += batch) {
+		batch = count - done < parallel ? count - done : parallel;
+
+		start = time_us();
+		for (i = 0; i < batch; i++) {
+			if (0 != pthread_create(&threads[i], NULL, thread_run, NULL)) {
+				printf("Failed to create thread %d of batch\n", i);
+				batch = i;
+				ret = -1;
+				break;
+			}
+		}
+		create_us += time_us() - start;
+
+		start = time_us();
+		for (i = 0; i < batch; i++) {
+			pthread_join(threads[i], NULL);
+		}
+		join_us += time_us() - start;
+
+		if (ret != 0) {
+			done += batch;
+			break;
+		}
+	}
+
+	free(threads);
+
+	if (done > 0) {
+		printf("%d threads, %d at once\n", done, parallel);
+		/* Nanoseconds are printed to see fast paths */
+		printf("create %8u ns\n", (unsigned) (create_us * 1000 / done));
+		printf("join   %8u ns\n", (unsigned) (join_us * 1000 / done));
+	}
+
+	return ret;
+}
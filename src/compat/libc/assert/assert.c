@@ -52,6 +52,10 @@ void __assertion_handle_failure(const struct __assertion_point *point) {
 
 	spin_lock_ipl_disable(&assert_lock);
 
+	if (logging_flush) {
+		logging_flush();
+	}
+
 #if BANNER_PRINT
 	print_oops();
 #endif
@@ -75,7 +75,12 @@ int rename(const char *src_name, const char *dst_name) {
 
 	if (dst_parent->d_sb == from->d_sb && dst_parent->d_sb->sb_iops->rename) {
 		/* Same FS with rename support*/
-		return dst_parent->d_sb->sb_iops->rename(from->d_inode, dst_parent->d_inode, basename((char *)dst_name));
+		err = dst_parent->d_sb->sb_iops->rename(from->d_inode, dst_parent->d_inode, basename((char *)dst_name));
+		if (!err) {
+			/* Name was looked up above and may be cached as absent */
+			dvfs_cache_del_negative(dst_parent, basename((char *)dst_name));
+		}
+		return err;
 	} else {
 		/* Different FS or same FS without rename support */
 		assert(from);
@@ -15,5 +15,6 @@
 #define FBIOGET_VSCREENINFO	0x4600
 #define FBIOPUT_VSCREENINFO	0x4601
 #define FBIOGET_FSCREENINFO	0x4602
+#define FBIOPAN_DISPLAY		0x4606
 
 #endif /* SRC_COMPAT_LINUX_INCLUDE_LINUX_FB_H_ */
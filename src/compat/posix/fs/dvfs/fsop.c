@@ -10,7 +10,9 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <string.h>
+#include <unistd.h>
 
+#include <fs/bcache.h>
 #include <fs/dvfs.h>
 
 int mkdir(const char *pathname, mode_t mode) {
@@ -81,3 +83,7 @@ int flock(int fd, int operation) {
 	return 0;
 }
 
+void sync(void) {
+	/* Delayed writes are kept by buffer cache only */
+	bcache_flush(NULL);
+}
@@ -12,6 +12,9 @@
 #include <stdio.h>
 #include <sys/types.h>
 
+#include <unistd.h>
+
+#include <fs/bcache.h>
 #include <fs/kfsop.h>
 #include <fs/vfs.h>
 #include <fs/perm.h>
@@ -55,3 +58,8 @@ int rmdir(const char *pathname) {
 int flock(int fd, int operation) {
 	return kflock(fd, operation);
 }
+
+void sync(void) {
+	/* Delayed writes are kept by buffer cache only */
+	bcache_flush(NULL);
+}
@@ -0,0 +1,54 @@
+/**
+ * @file
+ * @brief Scalable I/O event notification.
+ *
+ * @date 17.10.26
+ */
+
+#ifndef SYS_EPOLL_H_
+#define SYS_EPOLL_H_
+
+#include <stdint.h>
+#include <fcntl.h>
+#include <sys/cdefs.h>
+#include <sys/poll.h>
+
+#define EPOLLIN      POLLIN
+#define EPOLLPRI     POLLPRI
+#define EPOLLOUT     POLLOUT
+#define EPOLLERR     POLLERR
+#define EPOLLHUP     POLLHUP
+#define EPOLLRDNORM  POLLRDNORM
+#define EPOLLWRNORM  POLLWRNORM
+#define EPOLLONESHOT (1U << 30)
+#define EPOLLET      (1U << 31)
+
+#define EPOLL_CTL_ADD 1
+#define EPOLL_CTL_DEL 2
+#define EPOLL_CTL_MOD 3
+
+#define EPOLL_CLOEXEC O_CLOEXEC
+
+typedef union epoll_data {
+	void *ptr;
+	int fd;
+	uint32_t u32;
+	uint64_t u64;
+} epoll_data_t;
+
+struct epoll_event {
+	uint32_t events;
+	epoll_data_t data;
+};
+
+__BEGIN_DECLS
+
+extern int epoll_create(int size);
+extern int epoll_create1(int flags);
+extern int epoll_ctl(int epfd, int op, int fd, struct epoll_event *event);
+extern int epoll_wait(int epfd, struct epoll_event *events, int maxevents,
+		int timeout);
+
+__END_DECLS
+
+#endif /* SYS_EPOLL_H_ */
@@ -163,6 +163,7 @@ extern off_t lseek(int fd, off_t offset, int origin);
 extern int close(int fd);
 
 extern int fsync(int);
+extern void sync(void);
 
 extern pid_t fork(void);
 extern pid_t vfork(void);
@@ -272,9 +273,6 @@ extern int chown(const char *path, uid_t owner, gid_t group);
 /*******************************************
  * stubs
  *******************************************/
-static inline void sync(void) {
-}
-
 
 extern unsigned alarm(unsigned seconds);
 
@@ -0,0 +1,443 @@
+/**
+ * @file
+ * @brief Scalable I/O event notification.
+ * @details Interest set of an epoll instance is persistent: every watched
+ *   descriptor gets an idesc_watch once at EPOLL_CTL_ADD and idesc_notify()
+ *   puts it to the ready list of the instance. So epoll_wait() only looks
+ *   at descriptors which had some events since the previous call.
+ *
+ * @date 17.10.26
+ */
+
+#include <sys/epoll.h>
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stddef.h>
+
+#include <util/dlist.h>
+#include <util/math.h>
+#include <util/member.h>
+
+#include <fs/idesc.h>
+#include <fs/idesc_event.h>
+#include <fs/index_descriptor.h>
+#include <hal/clock.h>
+#include <kernel/spinlock.h>
+#include <kernel/task.h>
+#include <kernel/task/resource/idesc_table.h>
+#include <kernel/thread/sync/mutex.h>
+#include <kernel/thread/thread_sched_wait.h>
+#include <kernel/sched.h>
+#include <kernel/time/time.h>
+#include <mem/misc/pool.h>
+
+#include <framework/mod/options.h>
+
+#define EPOLL_INSTANCES_MAX OPTION_GET(NUMBER, instances_max)
+#define EPOLL_ITEMS_MAX     OPTION_GET(NUMBER, items_max)
+
+struct eventpoll {
+	struct idesc idesc;          /* Descriptor of instance (MUST BE FIRST) */
+	struct mutex mutex;          /* Protects interest set */
+	spinlock_t lock;             /* Protects ready list */
+	struct dlist_head items;     /* Interest set */
+	struct dlist_head ready;     /* Items which have got some events */
+};
+
+struct epitem {
+	struct idesc_watch watch;
+	struct eventpoll *ep;
+	struct idesc *idesc;         /* NULL after descriptor was closed, used
+	                                between idesc_watch_use_begin/end() */
+	int fd;
+	struct epoll_event event;
+	struct dlist_head itm_lnk;   /* Link for interest set */
+	struct dlist_head rdy_lnk;   /* Link for ready list */
+};
+
+POOL_DEF(eventpoll_pool, struct eventpoll, EPOLL_INSTANCES_MAX);
+POOL_DEF(epitem_pool, struct epitem, EPOLL_ITEMS_MAX);
+
+static const struct idesc_ops idesc_epoll_ops;
+
+static int epoll_find_by_fd(int epfd, struct eventpoll **out_ep) {
+	struct idesc *idesc;
+
+	if (!idesc_index_valid(epfd)
+			|| (NULL == (idesc = index_descriptor_get(epfd)))) {
+		return EBADF;
+	}
+	if (idesc->idesc_ops != &idesc_epoll_ops) {
+		return EINVAL;
+	}
+
+	*out_ep = (struct eventpoll *)idesc;
+
+	return 0;
+}
+
+static void epoll_ready_add(struct eventpoll *ep, struct epitem *epi) {
+	ipl_t ipl;
+
+	ipl = spin_lock_ipl(&ep->lock);
+	if (dlist_empty(&epi->rdy_lnk)) {
+		dlist_add_prev(&epi->rdy_lnk, &ep->ready);
+	}
+	spin_unlock_ipl(&ep->lock, ipl);
+}
+
+static void epoll_ready_del(struct eventpoll *ep, struct epitem *epi) {
+	ipl_t ipl;
+
+	ipl = spin_lock_ipl(&ep->lock);
+	if (!dlist_empty(&epi->rdy_lnk)) {
+		dlist_del_init(&epi->rdy_lnk);
+	}
+	spin_unlock_ipl(&ep->lock, ipl);
+}
+
+/* Called from idesc_notify() of watched descriptor */
+static void epoll_item_notify(struct idesc_watch *watch, int mask) {
+	struct epitem *epi;
+
+	epi = member_cast_out(watch, struct epitem, watch);
+
+	if (mask & POLLNVAL) {
+		/* descriptor is being closed, item is freed by the owner */
+		epi->idesc = NULL;
+	}
+	else if (!(epi->event.events & ~(EPOLLET | EPOLLONESHOT))) {
+		return; /* disabled by EPOLLONESHOT */
+	}
+
+	epoll_ready_add(epi->ep, epi);
+	idesc_notify(&epi->ep->idesc, POLLIN);
+}
+
+static struct epitem *epoll_item_find(struct eventpoll *ep, int fd,
+		struct idesc *idesc) {
+	struct epitem *epi;
+
+	dlist_foreach_entry(epi, &ep->items, itm_lnk) {
+		if ((epi->fd == fd) && (epi->idesc == idesc)) {
+			return epi;
+		}
+	}
+
+	return NULL;
+}
+
+static void epoll_item_free(struct eventpoll *ep, struct epitem *epi) {
+	if (epi->idesc != NULL) {
+		idesc_watch_del(epi->idesc, &epi->watch);
+	}
+	epoll_ready_del(ep, epi);
+	dlist_del(&epi->itm_lnk);
+	pool_free(&epitem_pool, epi);
+}
+
+static int epoll_item_events(struct epitem *epi) {
+	const struct idesc_ops *ops;
+	int mask, revents;
+
+	ops = epi->idesc->idesc_ops;
+	assert(ops != NULL);
+	if (ops->status == NULL) {
+		return 0;
+	}
+
+	mask = (epi->event.events & (EPOLLIN | EPOLLOUT)) | POLLERR;
+	revents = 0;
+
+	if ((mask & POLLIN) && ops->status(epi->idesc, POLLIN)) {
+		revents |= EPOLLIN;
+	}
+	if ((mask & POLLOUT) && ops->status(epi->idesc, POLLOUT)) {
+		revents |= EPOLLOUT;
+	}
+	if (ops->status(epi->idesc, POLLERR)) {
+		revents |= EPOLLERR;
+	}
+
+	return revents;
+}
+
+/**
+ * Take ready items one by one and report their current status. The item is
+ * off the ready list while its status is checked, so an event which comes at
+ * this moment queues it again. Level-triggered items that still have events
+ * are kept ready until the next call.
+ */
+static int epoll_collect(struct eventpoll *ep, struct epoll_event *events,
+		int maxevents) {
+	struct epitem *epi;
+	int revents, cnt;
+	ipl_t ipl;
+	DLIST_DEFINE(still_ready);
+
+	cnt = 0;
+
+	while (cnt < maxevents) {
+		ipl = spin_lock_ipl(&ep->lock);
+		if (dlist_empty(&ep->ready)) {
+			spin_unlock_ipl(&ep->lock, ipl);
+			break;
+		}
+		epi = dlist_next_entry(&ep->ready, struct epitem, rdy_lnk);
+		dlist_del_init(&epi->rdy_lnk);
+		spin_unlock_ipl(&ep->lock, ipl);
+
+		if (epi->idesc == NULL) {
+			epoll_item_free(ep, epi);
+			continue;
+		}
+
+		revents = epoll_item_events(epi);
+		if (revents == 0) {
+			continue;
+		}
+
+		events[cnt].events = revents;
+		events[cnt].data = epi->event.data;
+		cnt++;
+
+		if (epi->event.events & EPOLLONESHOT) {
+			epi->event.events &= EPOLLET | EPOLLONESHOT;
+		}
+		else if (!(epi->event.events & EPOLLET)) {
+			ipl = spin_lock_ipl(&ep->lock);
+			if (dlist_empty(&epi->rdy_lnk)) {
+				dlist_add_prev(&epi->rdy_lnk, &still_ready);
+			}
+			spin_unlock_ipl(&ep->lock, ipl);
+		}
+	}
+
+	ipl = spin_lock_ipl(&ep->lock);
+	while (!dlist_empty(&still_ready)) {
+		epi = dlist_next_entry(&still_ready, struct epitem, rdy_lnk);
+		dlist_del_init(&epi->rdy_lnk);
+		dlist_add_prev(&epi->rdy_lnk, &ep->ready);
+	}
+	spin_unlock_ipl(&ep->lock, ipl);
+
+	return cnt;
+}
+
+static void epoll_close(struct idesc *idesc) {
+	struct eventpoll *ep;
+	struct epitem *epi;
+
+	assert(idesc->idesc_ops == &idesc_epoll_ops);
+	ep = (struct eventpoll *)idesc;
+
+	mutex_lock(&ep->mutex);
+	idesc_watch_use_begin();
+	{
+		dlist_foreach_entry(epi, &ep->items, itm_lnk) {
+			epoll_item_free(ep, epi);
+		}
+	}
+	idesc_watch_use_end();
+	mutex_unlock(&ep->mutex);
+
+	pool_free(&eventpoll_pool, ep);
+}
+
+static int epoll_status(struct idesc *idesc, int mask) {
+	struct eventpoll *ep;
+
+	assert(idesc->idesc_ops == &idesc_epoll_ops);
+	ep = (struct eventpoll *)idesc;
+
+	return (mask & POLLIN) && !dlist_empty(&ep->ready);
+}
+
+static const struct idesc_ops idesc_epoll_ops = {
+	.close  = epoll_close,
+	.status = epoll_status,
+};
+
+int epoll_create1(int flags) {
+	struct idesc_table *it;
+	struct eventpoll *ep;
+	int fd;
+
+	if (flags & ~EPOLL_CLOEXEC) {
+		return SET_ERRNO(EINVAL);
+	}
+
+	it = task_resource_idesc_table(task_self());
+	assert(it);
+
+	ep = pool_alloc(&eventpoll_pool);
+	if (ep == NULL) {
+		return SET_ERRNO(ENOMEM);
+	}
+
+	idesc_init(&ep->idesc, &idesc_epoll_ops, O_RDONLY);
+	mutex_init(&ep->mutex);
+	ep->lock = SPIN_UNLOCKED;
+	dlist_init(&ep->items);
+	dlist_init(&ep->ready);
+
+	fd = idesc_table_add(it, &ep->idesc, flags & EPOLL_CLOEXEC);
+	if (fd < 0) {
+		pool_free(&eventpoll_pool, ep);
+		return SET_ERRNO(EMFILE);
+	}
+
+	return fd;
+}
+
+int epoll_create(int size) {
+	if (size <= 0) {
+		return SET_ERRNO(EINVAL);
+	}
+
+	return epoll_create1(0);
+}
+
+int epoll_ctl(int epfd, int op, int fd, struct epoll_event *event) {
+	struct eventpoll *ep;
+	struct epitem *epi;
+	struct idesc *idesc;
+	int ret;
+
+	ret = epoll_find_by_fd(epfd, &ep);
+	if (ret != 0) {
+		return SET_ERRNO(ret);
+	}
+
+	if (!idesc_index_valid(fd)
+			|| (NULL == (idesc = index_descriptor_get(fd)))) {
+		return SET_ERRNO(EBADF);
+	}
+	if (idesc->idesc_ops == &idesc_epoll_ops) {
+		return SET_ERRNO(EINVAL); /* nested instances aren't supported */
+	}
+	if ((op != EPOLL_CTL_DEL) && (event == NULL)) {
+		return SET_ERRNO(EFAULT);
+	}
+
+	ret = 0;
+
+	mutex_lock(&ep->mutex);
+	idesc_watch_use_begin();
+	{
+		epi = epoll_item_find(ep, fd, idesc);
+
+		switch (op) {
+		case EPOLL_CTL_ADD:
+			if (epi != NULL) {
+				ret = EEXIST;
+				break;
+			}
+			epi = pool_alloc(&epitem_pool);
+			if (epi == NULL) {
+				ret = ENOMEM;
+				break;
+			}
+			epi->watch.next = NULL;
+			epi->watch.notify = epoll_item_notify;
+			epi->ep = ep;
+			epi->idesc = idesc;
+			epi->fd = fd;
+			epi->event = *event;
+			dlist_head_init(&epi->rdy_lnk);
+			dlist_add_prev(dlist_head_init(&epi->itm_lnk), &ep->items);
+			idesc_watch_add(idesc, &epi->watch);
+			/* Check the current state at the next epoll_wait() */
+			epoll_item_notify(&epi->watch, 0);
+			break;
+		case EPOLL_CTL_MOD:
+			if (epi == NULL) {
+				ret = ENOENT;
+				break;
+			}
+			epi->event = *event;
+			epoll_item_notify(&epi->watch, 0);
+			break;
+		case EPOLL_CTL_DEL:
+			if (epi == NULL) {
+				ret = ENOENT;
+				break;
+			}
+			epoll_item_free(ep, epi);
+			break;
+		default:
+			ret = EINVAL;
+			break;
+		}
+	}
+	idesc_watch_use_end();
+	mutex_unlock(&ep->mutex);
+
+	return ret ? SET_ERRNO(ret) : 0;
+}
+
+int epoll_wait(int epfd, struct epoll_event *events, int maxevents,
+		int timeout) {
+	struct eventpoll *ep;
+	struct idesc_wait_link wl;
+	clock_t deadline, now;
+	int cnt, ret, wait;
+
+	if ((events == NULL) || (maxevents <= 0)) {
+		return SET_ERRNO(EINVAL);
+	}
+
+	ret = epoll_find_by_fd(epfd, &ep);
+	if (ret != 0) {
+		return SET_ERRNO(ret);
+	}
+
+	deadline = clock_sys_ticks() + ms2jiffies(max(timeout, 0));
+
+	do {
+		/* Watched descriptors aren't closed while their status is checked */
+		mutex_lock(&ep->mutex);
+		idesc_watch_use_begin();
+		{
+			cnt = epoll_collect(ep, events, maxevents);
+		}
+		idesc_watch_use_end();
+		mutex_unlock(&ep->mutex);
+
+		if ((cnt != 0) || (timeout == 0)) {
+			return cnt;
+		}
+
+		wait = SCHED_TIMEOUT_INFINITE;
+		if (timeout > 0) {
+			now = clock_sys_ticks();
+			if ((long) (deadline - now) <= 0) {
+				return 0;
+			}
+			wait = jiffies2ms(deadline - now);
+		}
+
+		threadsig_lock();
+		{
+			idesc_wait_init(&wl, POLLIN);
+			idesc_wait_prepare(&ep->idesc, &wl);
+
+			ret = SCHED_WAIT_TIMEOUT(!dlist_empty(&ep->ready), wait);
+
+			idesc_wait_cleanup(&ep->idesc, &wl);
+		}
+		threadsig_unlock();
+
+		/* Ready items may have no events left, so wait again for the rest
+		 * of the timeout */
+	} while (ret == 0);
+
+	if (ret == -ETIMEDOUT) {
+		return 0;
+	}
+
+	return SET_ERRNO(-ret);
+}
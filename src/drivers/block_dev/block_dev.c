@@ -21,9 +21,18 @@
 #include <util/indexator.h>
 #include <util/math.h>
 
+#include <module/embox/fs/buffer_crypt_api.h>
+
 extern struct idesc_ops idesc_bdev_ops;
 
 #define DEFAULT_BDEV_BLOCK_SIZE OPTION_GET(NUMBER, default_block_size)
+#define BDEV_READAHEAD          OPTION_GET(NUMBER, readahead)
+/* Direct transfers don't pass buffer_crypt_api */
+#ifdef __MODULE__embox__fs__buffer_no_crypt__H_
+#define BDEV_DIRECT_IO_MIN      OPTION_GET(NUMBER, direct_io_min)
+#else
+#define BDEV_DIRECT_IO_MIN      0
+#endif
 
 ARRAY_SPREAD_DEF(const struct block_dev_module, __block_dev_registry);
 POOL_DEF(cache_pool, struct block_dev_cache, MAX_BDEV_QUANTITY);
@@ -31,6 +40,8 @@ POOL_DEF(blockdev_pool, struct block_dev, MAX_BDEV_QUANTITY);
 INDEX_DEF(block_dev_idx, 0, MAX_BDEV_QUANTITY);
 
 static struct block_dev *devtab[MAX_BDEV_QUANTITY];
+/* Block expected to be read next if the device is read sequentially */
+static int bdev_ra_next[MAX_BDEV_QUANTITY];
 
 struct block_dev **get_bdev_tab(void) {
 	return &devtab[0];
@@ -120,9 +131,16 @@ struct block_dev *block_dev(void *dev) {
 	return (struct block_dev *)dev;
 }
 
+/* Check if transfer is large enough to bypass buffer cache */
+static inline int block_dev_direct(size_t blksize, size_t count, size_t offset) {
+	return (BDEV_DIRECT_IO_MIN > 0)
+		&& (offset % blksize == 0) && (count % blksize == 0)
+		&& (count / blksize >= BDEV_DIRECT_IO_MIN);
+}
+
 int block_dev_read_buffered(struct block_dev *bdev, char *buffer, size_t count, size_t offset) {
 	size_t blksize;
-	int blkno, cplen, cursor, res, i;
+	int blkno, cplen, cursor, res, i, ra;
 	struct buffer_head *bh;
 
 	assert(bdev);
@@ -139,6 +157,15 @@ int block_dev_read_buffered(struct block_dev *bdev, char *buffer, size_t count,
 		return blksize;
 	}
 	blkno = offset / blksize;
+
+	if (block_dev_direct(blksize, count, offset)) {
+		res = bcache_direct_io(bdev, buffer, blkno, count / blksize, blksize, 0);
+		if (res != -EAGAIN) {
+			bdev_ra_next[bdev->id] = blkno + count / blksize;
+			return res == 0 ? count : res;
+		}
+	}
+
 	cplen = min(count, blksize - offset % blksize);
 
 	for (cursor = 0, i = 0; count != 0;
@@ -146,18 +173,24 @@ int block_dev_read_buffered(struct block_dev *bdev, char *buffer, size_t count,
 		bh = bcache_getblk_locked(bdev, blkno + i, blksize);
 		{
 			if (buffer_new(bh)) {
-				if (blksize != (res = bdev->driver->read(bdev, bh->data, blksize, blkno + i))
-						|| 0 != (res = buffer_decrypt(bh))) {
+				/* Read the rest of request at once, and some more blocks
+				 * if the device is read sequentially */
+				ra = (count + blksize - 1) / blksize;
+				if (blkno + i == bdev_ra_next[bdev->id]) {
+					ra += BDEV_READAHEAD;
+				}
+				if (0 != (res = bcache_buffer_read(bh, ra))) {
 					bcache_buffer_unlock(bh);
 					return res;
 				}
-				buffer_clear_flag(bh, BH_NEW);
 			}
 			memcpy(buffer + cursor, bh->data + (i == 0 ? offset % blksize : 0), cplen);
 		}
 		bcache_buffer_unlock(bh);
 	}
 
+	bdev_ra_next[bdev->id] = blkno + i;
+
 	return cursor;
 }
 
@@ -181,35 +214,34 @@ int block_dev_write_buffered(struct block_dev *bdev, const char *buffer, size_t
 	}
 
 	blkno = offset / blksize;
+
+	if (block_dev_direct(blksize, count, offset)) {
+		res = bcache_direct_io(bdev, (char *) buffer, blkno, count / blksize,
+				blksize, 1);
+		if (res != -EAGAIN) {
+			return res == 0 ? count : res;
+		}
+	}
+
 	cplen = min(count, blksize - offset % blksize);
 
 	for (cursor = 0, i = 0; count != 0;
 			i++, count -= cplen, cursor += cplen, cplen = min(count, blksize)) {
 		bh = bcache_getblk_locked(bdev, blkno + i, blksize);
 		{
-			if (buffer_new(bh)) {
-				if (cplen < blksize) {
-					if (blksize != (res = bdev->driver->read(bdev, bh->data, blksize, blkno + i))
-							|| 0 != (res = buffer_decrypt(bh))) {
-						bcache_buffer_unlock(bh);
-						return res;
-					}
+			if (buffer_new(bh) && (cplen < blksize)) {
+				if (0 != (res = bcache_buffer_read(bh, 1))) {
+					bcache_buffer_unlock(bh);
+					return res;
 				}
-				buffer_clear_flag(bh, BH_NEW);
 			}
 			memcpy(bh->data + (i == 0 ? offset % blksize : 0), buffer + cursor, cplen);
-			/**
-			 * Blocks are stored in the buffer cache in a decrypted state.
-			 * Therefore first we encrypt block, then write it onto disk and then decrypt block.
-			 */
-			buffer_encrypt(bh);
-			if (blksize != (res = bdev->driver->write(bdev, bh->data,
-					blksize, blkno + i))) {
-				buffer_decrypt(bh);
+			/* Blocks are stored in the buffer cache in a decrypted state,
+			 * bcache encrypts them on the way to disk */
+			if (0 != (res = bcache_buffer_write(bh))) {
 				bcache_buffer_unlock(bh);
 				return res;
 			}
-			buffer_decrypt(bh);
 		}
 		bcache_buffer_unlock(bh);
 	}
@@ -415,6 +447,7 @@ struct block_dev *block_dev_create(const char *path, const struct block_dev_driv
 		.privdata = privdata,
 		.block_size = DEFAULT_BDEV_BLOCK_SIZE,
 	};
+	block_req_queue_init(&bdev->queue);
 
 	strncpy(bdev->name, basename((char *)path), sizeof(bdev->name) - 1);
 	bdev->name[sizeof(bdev->name) - 1]  = '\0';
@@ -434,6 +467,9 @@ int block_dev_destroy(void *dev) {
 		}
 	}
 
+	/* Don't lose delayed writes */
+	bcache_flush(devmod->dev_priv);
+
 	block_dev_free(devmod->dev_priv);
 
 	return dev_module_destroy(dev);
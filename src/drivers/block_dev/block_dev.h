@@ -15,6 +15,8 @@
 #include <framework/mod/options.h>
 #include <config/embox/driver/block_dev.h>
 
+#include <drivers/block_req.h>
+
 #define MAX_BDEV_QUANTITY \
 	OPTION_MODULE_GET(embox__driver__block_dev, NUMBER, dev_quantity)
 
@@ -45,6 +47,9 @@ struct block_dev {
 	/* partitions */
 	uint64_t start_offset;
 	struct block_dev *parent_bdev;
+
+	/* requests waiting for driver with submit operation */
+	struct block_req_queue queue;
 };
 
 struct block_dev_driver {
@@ -55,6 +60,10 @@ struct block_dev_driver {
 	int (*write)(struct block_dev *bdev, char *buffer, size_t count, blkno_t blkno);
 
 	int (*probe)(void *args);
+
+	/* Optional, start request and call block_req_done() when it's done.
+	 * Returns -EBUSY if driver can't take more requests for now */
+	int (*submit)(struct block_dev *bdev, struct block_req *req);
 };
 
 struct block_dev_module {
@@ -0,0 +1,274 @@
+/**
+ * @file
+ * @brief Asynchronous block device requests
+ *
+ * @date 18.10.2026
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <stddef.h>
+
+#include <drivers/block_dev.h>
+#include <drivers/block_req.h>
+#include <hal/ipl.h>
+#include <kernel/thread/waitq.h>
+
+/* Requests go to the whole disk, partition only shifts blocks */
+static struct block_dev *block_req_root(struct block_dev *bdev,
+		blkno_t *blkno) {
+	while (bdev->parent_bdev != NULL) {
+		if (blkno) {
+			*blkno += bdev->start_offset;
+		}
+		bdev = bdev->parent_bdev;
+	}
+
+	return bdev;
+}
+
+void block_req_queue_init(struct block_req_queue *q) {
+	spin_init(&q->lock, __SPIN_UNLOCKED);
+	dlist_init(&q->pending);
+	q->inflight = 0;
+	q->completed = 0;
+	q->plugged = 0;
+	q->max_segs = 1;
+	waitq_init(&q->wq);
+}
+
+void block_req_init(struct block_req *req, struct block_dev *bdev,
+		int write, blkno_t blkno, char *buf, size_t len) {
+	assert(req);
+	assert(bdev);
+
+	req->bdev = bdev;
+	req->write = write;
+	req->blkno = blkno;
+	req->buf = buf;
+	req->len = len;
+	req->callback = NULL;
+	req->priv = NULL;
+	req->res = 0;
+	req->done = 0;
+	req->next_seg = NULL;
+	req->last_seg = req;
+	req->nr_segs = 1;
+	dlist_head_init(&req->lnk);
+}
+
+int block_req_is_async(struct block_dev *bdev) {
+	return block_req_root(bdev, NULL)->driver->submit != NULL;
+}
+
+static blkno_t block_req_end(struct block_req *req) {
+	blkno_t end;
+	struct block_req *seg;
+
+	end = req->blkno;
+	for (seg = req; seg != NULL; seg = seg->next_seg) {
+		end += seg->len / req->bdev->block_size;
+	}
+
+	return end;
+}
+
+/* Append @a req to the queued request which ends where @a req starts */
+static int block_req_merge(struct block_req_queue *q, struct block_req *req) {
+	struct block_req *prev;
+
+	dlist_foreach_entry(prev, &q->pending, lnk) {
+		if ((prev->write != req->write)
+				|| (prev->nr_segs + req->nr_segs > q->max_segs)
+				|| (block_req_end(prev) != req->blkno)) {
+			continue;
+		}
+
+		prev->last_seg->next_seg = req;
+		prev->last_seg = req->last_seg;
+		prev->nr_segs += req->nr_segs;
+		return 1;
+	}
+
+	return 0;
+}
+
+static void block_req_dispatch(struct block_dev *bdev) {
+	struct block_req_queue *q;
+	struct block_req *req;
+	unsigned int completed;
+	ipl_t ipl;
+	int res;
+
+	q = &bdev->queue;
+
+	ipl = spin_lock_ipl(&q->lock);
+	while (!q->plugged && !dlist_empty(&q->pending)) {
+		req = dlist_next_entry(&q->pending, struct block_req, lnk);
+		dlist_del_init(&req->lnk);
+		q->inflight++;
+		completed = q->completed;
+		spin_unlock_ipl(&q->lock, ipl);
+
+		/* Driver may complete the request before it returns */
+		res = bdev->driver->submit(bdev, req);
+
+		ipl = spin_lock_ipl(&q->lock);
+		if (res == 0) {
+			continue;
+		}
+
+		if (res == -EBUSY) {
+			q->inflight--;
+			dlist_add_next(&req->lnk, &q->pending);
+			if (completed == q->completed) {
+				/* Next completion dispatches it again */
+				break;
+			}
+			continue;
+		}
+
+		spin_unlock_ipl(&q->lock, ipl);
+		block_req_done(req, res);
+		ipl = spin_lock_ipl(&q->lock);
+	}
+	spin_unlock_ipl(&q->lock, ipl);
+}
+
+static int block_req_do_sync(struct block_dev *bdev, struct block_req *req) {
+	int res;
+
+	if (req->write) {
+		if (bdev->driver->write == NULL) {
+			return -ENOSYS;
+		}
+		res = bdev->driver->write(bdev, req->buf, req->len, req->blkno);
+	} else {
+		if (bdev->driver->read == NULL) {
+			return -ENOSYS;
+		}
+		res = bdev->driver->read(bdev, req->buf, req->len, req->blkno);
+	}
+
+	if (res < 0) {
+		return res;
+	}
+
+	return res == req->len ? 0 : -EIO;
+}
+
+int block_req_submit(struct block_req *req) {
+	struct block_dev *bdev;
+	struct block_req_queue *q;
+	ipl_t ipl;
+
+	assert(req);
+	assert(req->len % req->bdev->block_size == 0);
+
+	bdev = block_req_root(req->bdev, &req->blkno);
+	req->bdev = bdev;
+
+	if (bdev->driver->submit == NULL) {
+		block_req_done(req, block_req_do_sync(bdev, req));
+		return 0;
+	}
+
+	q = &bdev->queue;
+
+	ipl = spin_lock_ipl(&q->lock);
+	if (!block_req_merge(q, req)) {
+		dlist_add_prev(&req->lnk, &q->pending);
+	}
+	spin_unlock_ipl(&q->lock, ipl);
+
+	block_req_dispatch(bdev);
+
+	return 0;
+}
+
+int block_req_wait(struct block_req *req) {
+	assert(req);
+
+	WAITQ_WAIT(&req->bdev->queue.wq, req->done);
+
+	return req->res;
+}
+
+void block_req_done(struct block_req *req, int res) {
+	struct block_dev *bdev;
+	struct block_req_queue *q;
+	struct block_req *next;
+	block_req_cb_t callback;
+	ipl_t ipl;
+
+	bdev = req->bdev;
+	q = &bdev->queue;
+
+	for (; req != NULL; req = next) {
+		/* Request may be released as soon as it's done */
+		next = req->next_seg;
+		callback = req->callback;
+
+		req->res = res;
+		req->done = 1;
+		if (callback) {
+			callback(req);
+		}
+	}
+
+	if (bdev->driver->submit == NULL) {
+		return;
+	}
+
+	ipl = spin_lock_ipl(&q->lock);
+	{
+		q->completed++;
+		q->inflight--;
+	}
+	spin_unlock_ipl(&q->lock, ipl);
+
+	waitq_wakeup_all(&q->wq);
+
+	block_req_dispatch(bdev);
+}
+
+void block_req_plug(struct block_dev *bdev) {
+	struct block_req_queue *q;
+	ipl_t ipl;
+
+	q = &block_req_root(bdev, NULL)->queue;
+
+	ipl = spin_lock_ipl(&q->lock);
+	q->plugged++;
+	spin_unlock_ipl(&q->lock, ipl);
+}
+
+void block_req_unplug(struct block_dev *bdev) {
+	struct block_req_queue *q;
+	ipl_t ipl;
+
+	bdev = block_req_root(bdev, NULL);
+	q = &bdev->queue;
+
+	ipl = spin_lock_ipl(&q->lock);
+	assert(q->plugged > 0);
+	q->plugged--;
+	spin_unlock_ipl(&q->lock, ipl);
+
+	block_req_dispatch(bdev);
+}
+
+int block_req_rw(struct block_dev *bdev, int write, char *buf,
+		size_t len, blkno_t blkno) {
+	struct block_req req;
+	int res;
+
+	block_req_init(&req, bdev, write, blkno, buf, len);
+
+	res = block_req_submit(&req);
+	if (res == 0) {
+		res = block_req_wait(&req);
+	}
+
+	return res == 0 ? len : res;
+}
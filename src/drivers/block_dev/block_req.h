@@ -0,0 +1,105 @@
+/**
+ * @file
+ * @brief Asynchronous block device requests
+ * @details Driver with @a submit operation starts a request and reports its
+ *          completion with block_req_done(), so a few requests may be in
+ *          flight at once. Requests waiting for the driver are kept in the
+ *          device queue, where a request for blocks which follow the blocks
+ *          of a queued one is merged to it as one more data segment.
+ *
+ * @date 18.10.2026
+ */
+
+#ifndef BLOCK_REQ_H_
+#define BLOCK_REQ_H_
+
+#include <stddef.h>
+#include <sys/types.h>
+
+#include <kernel/sched/waitq.h>
+#include <kernel/spinlock.h>
+#include <util/dlist.h>
+
+struct block_dev;
+struct block_req;
+
+typedef void (*block_req_cb_t)(struct block_req *req);
+
+struct block_req {
+	struct block_dev *bdev;
+	int write;
+	blkno_t blkno;
+	char *buf;
+	size_t len;                /* bytes, multiple of block size */
+
+	block_req_cb_t callback;   /* called on completion, may be in IRQ */
+	void *priv;
+
+	int res;                   /* 0 or negative error code */
+	volatile int done;
+
+	/* Requests merged to this one follow it in the chain */
+	struct block_req *next_seg;
+	struct block_req *last_seg;
+	unsigned int nr_segs;
+
+	struct dlist_head lnk;
+};
+
+struct block_req_queue {
+	spinlock_t lock;
+	struct dlist_head pending;
+	unsigned int inflight;
+	unsigned int completed;    /* detects completions while submitting */
+	int plugged;
+	unsigned int max_segs;     /* set by driver, 1 disables merging */
+	struct waitq wq;
+};
+
+extern void block_req_queue_init(struct block_req_queue *q);
+
+extern void block_req_init(struct block_req *req, struct block_dev *bdev,
+		int write, blkno_t blkno, char *buf, size_t len);
+
+/**
+ * Queue request. For devices without @a submit operation the request is
+ * done synchronously before return.
+ *
+ * @return 0 or negative error code if the request can't be queued
+ */
+extern int block_req_submit(struct block_req *req);
+
+/**
+ * Wait until the request is done
+ *
+ * @return Result of the request
+ */
+extern int block_req_wait(struct block_req *req);
+
+/**
+ * Called by driver when the request and all requests merged to it are done
+ */
+extern void block_req_done(struct block_req *req, int res);
+
+/**
+ * While the device is plugged requests are only queued, so a batch of them
+ * is merged before the driver sees it
+ */
+extern void block_req_plug(struct block_dev *bdev);
+extern void block_req_unplug(struct block_dev *bdev);
+
+/**
+ * Synchronous read or write through the request queue. Drivers with only
+ * @a submit operation may use it for @a read and @a write.
+ *
+ * @return @a len or negative error code
+ */
+extern int block_req_rw(struct block_dev *bdev, int write, char *buf,
+		size_t len, blkno_t blkno);
+
+/**
+ * Check if requests to @a bdev are done asynchronously
+ */
+extern int block_req_is_async(struct block_dev *bdev);
+
+#endif /* BLOCK_REQ_H_ */
@@ -0,0 +1,326 @@
+/**
+ * @file
+ * @brief Virtual block device
+ * @details Requests are passed to the device as chains of descriptors
+ *          (header, data segments, status), so requests for adjacent blocks
+ *          merged by the request queue make a single device request, and
+ *          as many requests as the ring holds are processed concurrently.
+ *          Completions are reported from the interrupt handler.
+ *
+ * @date 18.10.2026
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include <limits.h>
+
+#include <drivers/block_dev.h>
+#include <drivers/block_dev/partition.h>
+#include <drivers/block_dev/virtio_blk/virtio_blk.h>
+#include <drivers/pci/pci.h>
+#include <drivers/pci/pci_id.h>
+#include <drivers/pci/pci_driver.h>
+#include <drivers/virtio/virtio.h>
+#include <drivers/virtio/virtio_ring.h>
+#include <drivers/virtio/virtio_queue.h>
+#include <framework/mod/options.h>
+#include <hal/ipl.h>
+#include <kernel/irq.h>
+#include <kernel/spinlock.h>
+#include <mem/misc/pool.h>
+#include <mem/sysmalloc.h>
+#include <util/indexator.h>
+#include <util/log.h>
+#include <util/math.h>
+
+PCI_DRIVER("virtio_blk", virtio_blk_init, PCI_VENDOR_ID_VIRTIO,
+		PCI_DEV_ID_VIRTIO_BLK);
+
+#define MODOPS_DEV_QUANTITY OPTION_GET(NUMBER, dev_quantity)
+#define MODOPS_SEG_MAX      OPTION_GET(NUMBER, seg_max)
+
+/* Request in flight, indexed by its head descriptor */
+struct virtio_blk_slot {
+	struct virtio_blk_req_hdr hdr;
+	volatile uint8_t status;
+	struct block_req *req;
+};
+
+struct virtio_blk {
+	unsigned long base_addr;
+	unsigned int irq;
+	struct virtqueue vq;
+	struct virtio_blk_slot *slots;
+	spinlock_t lock;
+	int read_only;
+	struct block_dev *bdev;
+};
+
+POOL_DEF(virtio_blk_pool, struct virtio_blk, MODOPS_DEV_QUANTITY);
+INDEX_DEF(virtio_blk_idx, 0, MODOPS_DEV_QUANTITY);
+
+/* Check if @a cnt descriptors from the next free one are unused */
+static int virtio_blk_desc_avail(struct virtqueue *vq, unsigned int cnt) {
+	unsigned int i;
+
+	if (cnt > vq->ring.num) {
+		return 0;
+	}
+
+	for (i = 0; i < cnt; i++) {
+		if (vq->ring.desc[(vq->next_free_desc + i) % vq->ring.num].addr != 0) {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+static int virtio_blk_submit(struct block_dev *bdev, struct block_req *req) {
+	struct virtio_blk *vb;
+	struct virtqueue *vq;
+	struct virtio_blk_slot *slot;
+	struct vring_desc *desc;
+	struct block_req *seg;
+	uint16_t head;
+	ipl_t ipl;
+
+	vb = bdev->privdata;
+	vq = &vb->vq;
+
+	if (req->write && vb->read_only) {
+		return -EROFS;
+	}
+
+	ipl = spin_lock_ipl(&vb->lock);
+	{
+		if (!virtio_blk_desc_avail(vq, req->nr_segs + 2)) {
+			spin_unlock_ipl(&vb->lock, ipl);
+			return -EBUSY;
+		}
+
+		head = vq->next_free_desc;
+		slot = &vb->slots[head];
+		slot->hdr.type = req->write ? VIRTIO_BLK_T_OUT : VIRTIO_BLK_T_IN;
+		slot->hdr.ioprio = 0;
+		slot->hdr.sector = (uint64_t)req->blkno
+			* (bdev->block_size / VIRTIO_BLK_SECTOR_SIZE);
+		slot->status = 0xFF;
+		slot->req = req;
+
+		desc = virtqueue_alloc_desc(vq);
+		vring_desc_init(desc, &slot->hdr, sizeof slot->hdr,
+				VRING_DESC_F_NEXT);
+		desc->next = vq->next_free_desc;
+
+		/* Device reads or writes data right in the buffers of segments */
+		for (seg = req; seg != NULL; seg = seg->next_seg) {
+			desc = virtqueue_alloc_desc(vq);
+			vring_desc_init(desc, seg->buf, seg->len, VRING_DESC_F_NEXT
+					| (req->write ? 0 : VRING_DESC_F_WRITE));
+			desc->next = vq->next_free_desc;
+		}
+
+		desc = virtqueue_alloc_desc(vq);
+		vring_desc_init(desc, (void *)&slot->status, sizeof slot->status,
+				VRING_DESC_F_WRITE);
+
+		vring_push_desc(head, &vq->ring);
+
+		if (virtqueue_notify_needed(vq)) {
+			virtio_notify_queue(vq->id, vb->base_addr);
+		}
+	}
+	spin_unlock_ipl(&vb->lock, ipl);
+
+	return 0;
+}
+
+static irq_return_t virtio_blk_interrupt(unsigned int irq_num, void *dev_id) {
+	struct virtio_blk *vb;
+	struct virtqueue *vq;
+	struct vring_used_elem *used_elem;
+	struct vring_desc *desc;
+	struct block_req *req;
+	uint16_t id;
+	uint8_t status;
+
+	vb = dev_id;
+	vq = &vb->vq;
+
+	if (~virtio_get_isr_status(vb->base_addr) & 1) {
+		return IRQ_NONE;
+	}
+
+	spin_lock(&vb->lock);
+	while (vq->last_seen_used != vq->ring.used->idx) {
+		used_elem = &vq->ring.used->ring[vq->last_seen_used % vq->ring.num];
+		vq->last_seen_used++;
+
+		req = vb->slots[used_elem->id].req;
+		status = vb->slots[used_elem->id].status;
+
+		/* release the chain */
+		id = used_elem->id;
+		do {
+			desc = &vq->ring.desc[id];
+			desc->addr = 0;
+			id = desc->next;
+		} while (desc->flags & VRING_DESC_F_NEXT);
+
+		/* Completion may submit the next request */
+		spin_unlock(&vb->lock);
+		if (status != VIRTIO_BLK_S_OK) {
+			log_error("request for block %u failed (%d)", req->blkno, status);
+		}
+		block_req_done(req, status == VIRTIO_BLK_S_OK ? 0 : -EIO);
+		spin_lock(&vb->lock);
+	}
+	spin_unlock(&vb->lock);
+
+	return IRQ_HANDLED;
+}
+
+static int virtio_blk_read(struct block_dev *bdev, char *buffer,
+		size_t count, blkno_t blkno) {
+	return block_req_rw(bdev, 0, buffer, count, blkno);
+}
+
+static int virtio_blk_write(struct block_dev *bdev, char *buffer,
+		size_t count, blkno_t blkno) {
+	return block_req_rw(bdev, 1, buffer, count, blkno);
+}
+
+static int virtio_blk_ioctl(struct block_dev *bdev, int cmd, void *args,
+		size_t size) {
+	switch (cmd) {
+	case IOCTL_GETDEVSIZE:
+		return bdev->size / bdev->block_size;
+	case IOCTL_GETBLKSIZE:
+		return bdev->block_size;
+	}
+	return -ENOSYS;
+}
+
+static const struct block_dev_driver virtio_blk_driver = {
+	.name = "virtio_blk_drv",
+	.ioctl = virtio_blk_ioctl,
+	.read = virtio_blk_read,
+	.write = virtio_blk_write,
+	.submit = virtio_blk_submit,
+};
+
+static int virtio_blk_config(struct virtio_blk *vb) {
+	uint32_t guest_features;
+	unsigned int seg_max;
+	size_t block_size;
+	int ret;
+
+	virtio_reset(vb->base_addr);
+	virtio_add_status(VIRTIO_CONFIG_S_ACKNOWLEDGE
+			| VIRTIO_CONFIG_S_DRIVER, vb->base_addr);
+
+	guest_features = 0;
+
+	seg_max = MODOPS_SEG_MAX;
+	if (virtio_has_feature(VIRTIO_BLK_F_SEG_MAX, vb->base_addr)) {
+		seg_max = min(seg_max, virtio_blk_get_seg_max(vb->base_addr));
+		guest_features |= VIRTIO_BLK_F_SEG_MAX;
+	}
+
+	block_size = VIRTIO_BLK_SECTOR_SIZE;
+	if (virtio_has_feature(VIRTIO_BLK_F_BLK_SIZE, vb->base_addr)) {
+		block_size = virtio_blk_get_blk_size(vb->base_addr);
+		guest_features |= VIRTIO_BLK_F_BLK_SIZE;
+	}
+
+	vb->read_only = 0;
+	if (virtio_has_feature(VIRTIO_BLK_F_RO, vb->base_addr)) {
+		vb->read_only = 1;
+		guest_features |= VIRTIO_BLK_F_RO;
+	}
+
+	virtio_set_feature(guest_features, vb->base_addr);
+
+	ret = virtqueue_create(&vb->vq, 0, vb->base_addr);
+	if (ret != 0) {
+		return ret;
+	}
+
+	vb->slots = sysmalloc(vb->vq.ring.num * sizeof *vb->slots);
+	if (vb->slots == NULL) {
+		virtqueue_destroy(&vb->vq, vb->base_addr);
+		return -ENOMEM;
+	}
+
+	/* header and status take two descriptors */
+	seg_max = min(seg_max, vb->vq.ring.num - 2);
+
+	vb->bdev->block_size = block_size;
+	vb->bdev->size = virtio_blk_get_capacity(vb->base_addr)
+		* VIRTIO_BLK_SECTOR_SIZE;
+	vb->bdev->queue.max_segs = max(seg_max, 1);
+
+	return 0;
+}
+
+static int virtio_blk_init(struct pci_slot_dev *pci_dev) {
+	struct virtio_blk *vb;
+	char path[PATH_MAX];
+	int idx, ret;
+
+	vb = pool_alloc(&virtio_blk_pool);
+	if (vb == NULL) {
+		return -ENOMEM;
+	}
+	vb->base_addr = pci_dev->bar[0] & PCI_BASE_ADDR_IO_MASK;
+	vb->irq = pci_dev->irq;
+	spin_init(&vb->lock, __SPIN_UNLOCKED);
+
+	strcpy(path, "/dev/vd*");
+	idx = block_dev_named(path, &virtio_blk_idx);
+	if (idx < 0) {
+		ret = idx;
+		goto out_free;
+	}
+
+	vb->bdev = block_dev_create(path, &virtio_blk_driver, vb);
+	if (vb->bdev == NULL) {
+		ret = -ENOMEM;
+		goto out_index;
+	}
+
+	ret = virtio_blk_config(vb);
+	if (ret != 0) {
+		goto out_bdev;
+	}
+
+	ret = irq_attach(vb->irq, virtio_blk_interrupt, IF_SHARESUP, vb,
+			"virtio_blk");
+	if (ret != 0) {
+		goto out_vq;
+	}
+
+	virtio_add_status(VIRTIO_CONFIG_S_DRIVER_OK, vb->base_addr);
+
+	log_debug("%s: %llu bytes, block %u, %u segments", path,
+			vb->bdev->size, vb->bdev->block_size, vb->bdev->queue.max_segs);
+
+	create_partitions(vb->bdev);
+
+	return 0;
+
+out_vq:
+	sysfree(vb->slots);
+	virtqueue_destroy(&vb->vq, vb->base_addr);
+out_bdev:
+	virtio_add_status(VIRTIO_CONFIG_S_FAILED, vb->base_addr);
+	block_dev_free(vb->bdev);
+out_index:
+	index_free(&virtio_blk_idx, idx);
+out_free:
+	pool_free(&virtio_blk_pool, vb);
+	return ret;
+}
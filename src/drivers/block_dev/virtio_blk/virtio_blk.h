@@ -0,0 +1,67 @@
+/**
+ * @file
+ * @brief
+ *
+ * @date 18.10.2026
+ */
+
+#ifndef DRIVERS_BLOCK_DEV_VIRTIO_BLK_H_
+#define DRIVERS_BLOCK_DEV_VIRTIO_BLK_H_
+
+#include <drivers/virtio/virtio.h>
+#include <drivers/virtio/virtio_io.h>
+#include <stdint.h>
+
+/**
+ * VirtIO Block Device Registers
+ */
+#define VIRTIO_REG_BLK_CAPACITY 0x14 /* Size in 512-byte sectors (8 bytes) */
+#define VIRTIO_REG_BLK_SIZE_MAX 0x1C /* Maximum segment size (4 bytes) */
+#define VIRTIO_REG_BLK_SEG_MAX  0x20 /* Maximum segments in request (4 bytes) */
+#define VIRTIO_REG_BLK_BLK_SIZE 0x28 /* Block size (4 bytes) */
+
+/**
+ * VirtIO Block Device Feature Bits
+ */
+#define VIRTIO_BLK_F_SIZE_MAX 0x0002 /* Maximum size of any single segment is
+										in size_max */
+#define VIRTIO_BLK_F_SEG_MAX  0x0004 /* Maximum number of segments in a
+										request is in seg_max */
+#define VIRTIO_BLK_F_RO       0x0020 /* Device is read-only */
+#define VIRTIO_BLK_F_BLK_SIZE 0x0040 /* Block size of disk is in blk_size */
+
+/**
+ * VirtIO Block Device Request
+ */
+struct virtio_blk_req_hdr {
+	uint32_t type;
+#define VIRTIO_BLK_T_IN  0 /* Read */
+#define VIRTIO_BLK_T_OUT 1 /* Write */
+	uint32_t ioprio;
+	uint64_t sector;
+} __attribute__((packed));
+
+#define VIRTIO_BLK_S_OK     0
+#define VIRTIO_BLK_S_IOERR  1
+#define VIRTIO_BLK_S_UNSUPP 2
+
+#define VIRTIO_BLK_SECTOR_SIZE 512
+
+/**
+ * VirtIO Block Device Options
+ */
+static inline uint64_t virtio_blk_get_capacity(unsigned long base_addr) {
+	return virtio_load32(VIRTIO_REG_BLK_CAPACITY, base_addr)
+		| ((uint64_t)virtio_load32(VIRTIO_REG_BLK_CAPACITY + 4, base_addr)
+				<< 32);
+}
+
+static inline uint32_t virtio_blk_get_seg_max(unsigned long base_addr) {
+	return virtio_load32(VIRTIO_REG_BLK_SEG_MAX, base_addr);
+}
+
+static inline uint32_t virtio_blk_get_blk_size(unsigned long base_addr) {
+	return virtio_load32(VIRTIO_REG_BLK_BLK_SIZE, base_addr);
+}
+
+#endif /* DRIVERS_BLOCK_DEV_VIRTIO_BLK_H_ */
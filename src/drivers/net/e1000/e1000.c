@@ -26,6 +26,7 @@
 
 #include <net/l0/net_entry.h>
 
+#include <hal/ipl.h>
 #include <hal/reg.h>
 
 #include <mem/misc/pool.h>
@@ -174,64 +175,94 @@ static void txed_skb_clean(struct net_device *dev) {
 	irq_unlock();
 }
 
-static void e1000_rx(struct net_device *dev) {
+static int e1000_rx_pending(struct net_device *dev) {
+	struct e1000_priv *nic_priv = e1000_get_priv(dev);
+	uint16_t tail;
+
+	tail = REG32_LOAD(e1000_reg(dev, E1000_REG_RDT));
+
+	return nic_priv->rx_descs[(1 + tail) % E1000_RXDESC_NR].status != 0;
+}
+
+/* RX interrupts are disabled while device is polled, so RX ring is
+ * touched only here */
+static int e1000_poll(struct net_device *dev, int budget) {
 	/*net_device_stats_t stat = get_eth_stat(dev);*/
 	struct e1000_priv *nic_priv = e1000_get_priv(dev);
 	struct sk_buff *skb, *new_skb;
 	uint16_t head;
 	uint16_t tail;
 	uint16_t cur;
+	int work;
+	ipl_t ipl;
 
-	/* nested irq locked to prevent already handled packets handled once more
-	 * as tail updated at exit
-	 */
-	irq_lock();
-	{
-		head = REG32_LOAD(e1000_reg(dev, E1000_REG_RDH));
-		tail = REG32_LOAD(e1000_reg(dev, E1000_REG_RDT));
-		cur = (1 + tail) % E1000_RXDESC_NR;
+	head = REG32_LOAD(e1000_reg(dev, E1000_REG_RDH));
+	tail = REG32_LOAD(e1000_reg(dev, E1000_REG_RDT));
+	cur = (1 + tail) % E1000_RXDESC_NR;
 
-		while (cur != head) {
-			int len;
+	for (work = 0; (work < budget) && (cur != head); work++) {
+		int len;
 
-			if (!(nic_priv->rx_descs[cur].status)) {
-				break;
-			}
+		if (!(nic_priv->rx_descs[cur].status)) {
+			break;
+		}
 
-			len = nic_priv->rx_descs[cur].length - E1000_RX_CHECKSUM_LEN;
+		len = nic_priv->rx_descs[cur].length - E1000_RX_CHECKSUM_LEN;
+		skb = NULL;
 
-			if (0 != nf_test_raw(NF_CHAIN_INPUT,
-						NF_TARGET_ACCEPT,
-						(char *) (uintptr_t) nic_priv->rx_descs[cur].buffer_address,
-						ETH_ALEN + (char *) (uintptr_t) nic_priv->rx_descs[cur].buffer_address,
-						ETH_ALEN)) {
-				goto drop_pack;
-			}
+		if (0 != nf_test_raw(NF_CHAIN_INPUT,
+					NF_TARGET_ACCEPT,
+					(char *) (uintptr_t) nic_priv->rx_descs[cur].buffer_address,
+					ETH_ALEN + (char *) (uintptr_t) nic_priv->rx_descs[cur].buffer_address,
+					ETH_ALEN)) {
+			goto drop_pack;
+		}
 
-			new_skb = skb_alloc(E1000_MAX_RX_LEN);
-			if (!new_skb) {
-				goto drop_pack;
-			}
+		new_skb = skb_alloc(E1000_MAX_RX_LEN);
+		if (!new_skb) {
+			goto drop_pack;
+		}
 
-			skb = nic_priv->rx_skbs[cur];
-			nic_priv->rx_skbs[cur] = new_skb;
-			nic_priv->rx_descs[cur].buffer_address = (uint32_t) (uintptr_t) new_skb->mac.raw;
-			assert(skb);
+		skb = nic_priv->rx_skbs[cur];
+		nic_priv->rx_skbs[cur] = new_skb;
+		nic_priv->rx_descs[cur].buffer_address = (uint32_t) (uintptr_t) new_skb->mac.raw;
+		assert(skb);
 
-			skb = skb_realloc(len, skb);
-			if (!skb) {
-				goto drop_pack;
-			}
-			skb->dev = dev;
-			netif_rx(skb);
+		skb = skb_realloc(len, skb);
 drop_pack:
-			tail = cur;
+		nic_priv->rx_descs[cur].status = 0;
+		tail = cur;
+		cur = (1 + tail) % E1000_RXDESC_NR;
 
-			cur = (1 + tail) % E1000_RXDESC_NR;
+		if (skb) {
+			skb->dev = dev;
+			netif_receive_skb(skb);
 		}
+	}
+
+	if (work != 0) {
+		/* Return all processed descriptors to the card at once */
 		REG32_STORE(e1000_reg(dev, E1000_REG_RDT), tail);
 	}
-	irq_unlock();
+
+	if (work < budget) {
+		ipl = ipl_save();
+		{
+			netif_rx_complete(dev);
+			REG32_STORE(e1000_reg(dev, E1000_REG_IMS),
+					E1000_REG_IMS_RXO | E1000_REG_IMS_RXT);
+
+			/* Cause could be cleared by ICR read in TX interrupt */
+			if (e1000_rx_pending(dev)) {
+				REG32_STORE(e1000_reg(dev, E1000_REG_IMC),
+						E1000_REG_IMS_RXO | E1000_REG_IMS_RXT);
+				netif_rx_schedule(dev);
+			}
+		}
+		ipl_restore(ipl);
+	}
+
+	return work;
 }
 
 static irq_return_t e1000_interrupt(unsigned int irq_num, void *dev_id) {
@@ -240,7 +271,10 @@ static irq_return_t e1000_interrupt(unsigned int irq_num, void *dev_id) {
 	irq_return_t ret = IRQ_NONE;
 
 	if (cause & (E1000_REG_ICR_RXO | E1000_REG_ICR_RXT)) {
-		e1000_rx(dev_id);
+		/* Packets are received by e1000_poll() */
+		REG32_STORE(e1000_reg(dev_id, E1000_REG_IMC),
+				E1000_REG_IMS_RXO | E1000_REG_IMS_RXT);
+		netif_rx_schedule(dev_id);
 		ret = IRQ_HANDLED;
 	}
 
@@ -392,7 +426,8 @@ static const struct net_driver _drv_ops = {
 	.xmit = xmit,
 	.start = e1000_open,
 	.stop = e1000_stop,
-	.set_macaddr = set_mac_address
+	.set_macaddr = set_mac_address,
+	.poll = e1000_poll
 };
 
 static void e1000_enable_bus_mastering(struct pci_slot_dev *pci_dev) {
@@ -1,6 +1,18 @@
 /**
  * @file
  * @brief Virtual High Performance Ethernet card
+ * @details Transmitted packets are put to the ring without copying and
+ *          released when the device uses them. The device is notified
+ *          once per batch of packets passed by the TX handler, and only
+ *          if it has not suppressed notifications.
+ *          Checksums and splitting of large TCP segments are left to the
+ *          device when it supports that.
+ *          With VIRTIO_NET_F_MQ there is a queue pair per CPU. Flows are
+ *          spread over transmit queues by hash of addresses and ports.
+ *          Host tap backend steers replies to the receive queue of the
+ *          pair the flow was sent from. When the device is stopped, packets
+ *          in flight on the other pairs are waited for, and the device is
+ *          asked to use the first pair only.
  *
  * @date 13.08.13
  * @author Ilia Vaprol
@@ -16,86 +28,248 @@
 #include <drivers/pci/pci_driver.h>
 #include <errno.h>
 #include <framework/mod/options.h>
+#include <hal/clock.h>
+#include <hal/ipl.h>
+#include <hal/cpu.h>
 #include <kernel/irq.h>
+#include <kernel/spinlock.h>
+#include <kernel/time/time.h>
+#include <linux/compiler.h>
+#include <mem/sysmalloc.h>
 #include <net/inetdevice.h>
 #include <net/l0/net_entry.h>
 #include <net/l2/ethernet.h>
+#include <net/l3/ipv4/ip.h>
+#include <net/l4/tcp.h>
 #include <net/netdevice.h>
 #include <stdlib.h>
 #include <string.h>
 #include <util/log.h>
-#include <kernel/sched/sched_lock.h>
+#include <util/math.h>
 
 PCI_DRIVER("virtio", virtio_init, PCI_VENDOR_ID_VIRTIO, PCI_DEV_ID_VIRTIO_NET);
 
 #define MODOPS_PREP_BUFF_CNT OPTION_GET(NUMBER, prep_buff_cnt)
+#define MODOPS_OFFLOAD       OPTION_GET(BOOLEAN, offload)
+#define MODOPS_QUEUE_PAIRS   OPTION_GET(NUMBER, queue_pairs)
+#define MODOPS_CTRL_TIMEOUT  OPTION_GET(NUMBER, ctrl_timeout)
 
-struct virtio_priv {
+/* Transmitted skb is held by the ring until the device uses it */
+struct virtio_tx_slot {
+	struct virtio_net_hdr_mrg_rxbuf hdr;
+	struct sk_buff *skb;
+};
+
+struct virtio_queue_pair {
 	struct virtqueue rq;
 	struct virtqueue tq;
+	struct virtio_tx_slot *tx_slots; /* indexed by head descriptor id */
+	spinlock_t tx_lock;              /* xmit against reclaim from irq */
+	int rx_drop;     /* rx buffers left of the packet being dropped */
 };
 
+/* Control command, the device reads header and data and writes ack */
+struct virtio_net_ctrl {
+	struct virtio_net_ctrl_hdr hdr;
+	uint16_t data;
+	uint8_t ack;
+};
+
+struct virtio_priv {
+	struct virtio_queue_pair qp[MODOPS_QUEUE_PAIRS];
+	int qp_num;      /* created queue pairs */
+	int qp_active;   /* queue pairs the device was asked to use */
+	int rx_next;     /* queue pair the next poll starts with */
+	struct virtqueue cq;  /* control queue, if VIRTIO_NET_F_MQ */
+	int has_cq;
+	struct virtio_net_ctrl ctrl;
+	int ctrl_desc;   /* head of the command in flight, -1 if none */
+	size_t hdr_len;  /* size of packet header, depends on MRG_RXBUF */
+};
+
+/* Must be called with tx_lock held */
+static void virtio_tx_reclaim(struct virtio_queue_pair *qp) {
+	struct virtqueue *vq;
+	struct vring_used_elem *used_elem;
+	struct vring_desc *desc, *next;
+	struct virtio_tx_slot *slot;
+
+	vq = &qp->tq;
+	while (vq->last_seen_used != vq->ring.used->idx) {
+		used_elem = &vq->ring.used->ring[vq->last_seen_used % vq->ring.num];
+
+		slot = &qp->tx_slots[used_elem->id];
+		assert(slot->skb != NULL);
+		skb_free(slot->skb);
+		slot->skb = NULL;
+
+		desc = &vq->ring.desc[used_elem->id];
+		desc->addr = 0;
+		assert(desc->flags & VRING_DESC_F_NEXT);
+
+		next = &vq->ring.desc[desc->next];
+		next->addr = 0;
+		assert(~next->flags & VRING_DESC_F_NEXT);
+
+		++vq->last_seen_used;
+	}
+}
+
+/* Must be called with tx_lock held */
+static void virtio_tx_kick(struct net_device *dev,
+		struct virtio_queue_pair *qp) {
+	if (virtqueue_notify_needed(&qp->tq)) {
+		virtio_net_notify_queue(qp->tq.id, dev);
+	}
+}
+
+/* Ask device to complete checksum and to split large TCP segment */
+static void virtio_tx_hdr_init(struct virtio_net_hdr *hdr,
+		struct sk_buff *skb) {
+	memset(hdr, 0, sizeof(struct virtio_net_hdr_mrg_rxbuf));
+	hdr->gso_type = VIRTIO_NET_HDR_GSO_NONE;
+
+	if (skb->ip_summed == CHECKSUM_PARTIAL) {
+		hdr->flags = VIRTIO_NET_HDR_F_NEEDS_CSUM;
+		hdr->csum_start = skb->h.raw - skb->mac.raw;
+		hdr->csum_offset = skb->csum_offset;
+	}
+
+	if (skb->gso_size != 0) {
+		assert(skb->ip_summed == CHECKSUM_PARTIAL);
+		hdr->gso_type = VIRTIO_NET_HDR_GSO_TPV4;
+		hdr->gso_size = skb->gso_size;
+		hdr->hdr_len = skb->h.raw - skb->mac.raw
+				+ TCP_HEADER_SIZE(skb->h.th);
+	}
+}
+
+/**
+ * Packets of one flow always go to the same queue, so they are not
+ * reordered. The device steers replies of the flow to the rx queue of
+ * the pair.
+ */
+static struct virtio_queue_pair *virtio_tx_select(
+		struct virtio_priv *virtio_priv, struct sk_buff *skb) {
+	uint32_t hash;
+
+	if ((virtio_priv->qp_active == 1)
+			|| (skb->mac.ethh->h_proto != htons(ETH_P_IP))
+			|| (skb->nh.raw == NULL)) {
+		return &virtio_priv->qp[0];
+	}
+
+	hash = ip_hdr(skb)->saddr ^ ip_hdr(skb)->daddr;
+	if ((skb->h.raw != NULL) && ((ip_hdr(skb)->proto == IPPROTO_TCP)
+				|| (ip_hdr(skb)->proto == IPPROTO_UDP))) {
+		/* source and destination ports */
+		hash ^= *(uint32_t *)skb->h.raw;
+	}
+	hash ^= hash >> 16;
+	hash ^= hash >> 8;
+
+	return &virtio_priv->qp[hash % virtio_priv->qp_active];
+}
+
 static int virtio_xmit(struct net_device *dev, struct sk_buff *skb) {
-	struct sk_buff_extra *skb_extra;
-	struct sk_buff_data *skb_data;
 	struct virtqueue *vq;
-	struct virtio_net_hdr *hdr;
-	uint32_t desc_id;
+	struct virtio_queue_pair *qp;
+	struct virtio_tx_slot *slot;
+	uint16_t desc_id;
 	struct vring_desc *desc;
 	struct virtio_priv *virtio_priv;
+	ipl_t ipl;
 
 	assert(dev != NULL);
 	assert(skb != NULL);
 
 	virtio_priv = netdev_priv(dev);
+	qp = virtio_tx_select(virtio_priv, skb);
+	vq = &qp->tq;
 
-	skb_extra = skb_extra_alloc();
-	if (skb_extra == NULL) {
-		return -ENOMEM;
-	}
-
-	skb_data = skb_data_clone(skb->data);
-	if (skb_data == NULL) {
-		skb_extra_free(skb_extra);
-		return -ENOMEM;
-	}
-
-	vq = &virtio_priv->tq;
+	ipl = spin_lock_ipl(&qp->tx_lock);
+	{
+		/* Completions are not signalled while the batch is filled,
+		 * virtio_xmit_flush() enables them again */
+		if (!vq->event_idx) {
+			vq->ring.avail->flags |= VRING_AVAIL_F_NO_INTERRUPT;
+		}
 
-	hdr = skb_extra_cast_in(skb_extra);
-	hdr->flags = 0;
-	hdr->gso_type = VIRTIO_NET_HDR_GSO_NONE;
+		virtio_tx_reclaim(qp);
+		while (vq->ring.desc[vq->next_free_desc].addr != 0) {
+			/* Ring is full, let the device drain it */
+			virtio_tx_kick(dev, qp);
+			spin_unlock_ipl(&qp->tx_lock, ipl);
+			ipl = spin_lock_ipl(&qp->tx_lock);
+			virtio_tx_reclaim(qp);
+		}
 
-	sched_lock();
-	{
 		desc_id = vq->next_free_desc;
-		do { desc = virtqueue_alloc_desc(vq); } while (desc == NULL);
-		vring_desc_init(desc, hdr, sizeof *hdr, VRING_DESC_F_NEXT);
+		slot = &qp->tx_slots[desc_id];
+		virtio_tx_hdr_init(&slot->hdr.hdr, skb);
+		slot->skb = skb;
+
+		desc = virtqueue_alloc_desc(vq);
+		assert(desc != NULL);
+		vring_desc_init(desc, &slot->hdr, virtio_priv->hdr_len,
+				VRING_DESC_F_NEXT);
 		desc->next = vq->next_free_desc;
 
-		do { desc = virtqueue_alloc_desc(vq); } while (desc == NULL);
-		vring_desc_init(desc, skb_data_cast_in(skb_data), skb->len, 0);
+		/* Device reads packet right from skb data, no copy is needed */
+		desc = virtqueue_alloc_desc(vq);
+		assert(desc != NULL);
+		vring_desc_init(desc, skb_data_cast_in(skb->data), skb->len, 0);
 
 		vring_push_desc(desc_id, &vq->ring);
 	}
-	sched_unlock();
+	spin_unlock_ipl(&qp->tx_lock, ipl);
 
-	skb_free(skb);
+	return 0;
+}
 
-	virtio_net_notify_queue(VIRTIO_NET_QUEUE_TX, dev);
+static void virtio_xmit_flush(struct net_device *dev) {
+	struct virtqueue *vq;
+	struct virtio_queue_pair *qp;
+	struct virtio_priv *virtio_priv;
+	ipl_t ipl;
 
-	return 0;
+	virtio_priv = netdev_priv(dev);
+
+	for (qp = &virtio_priv->qp[0];
+			qp < &virtio_priv->qp[virtio_priv->qp_active]; ++qp) {
+		vq = &qp->tq;
+
+		ipl = spin_lock_ipl(&qp->tx_lock);
+		{
+			/* Single interrupt when the whole batch is transmitted */
+			if (vq->event_idx) {
+				vring_used_event(&vq->ring) = vq->ring.avail->idx - 1;
+			} else {
+				vq->ring.avail->flags &= ~VRING_AVAIL_F_NO_INTERRUPT;
+			}
+			/* Device must see it before used ring is checked again */
+			__sync_synchronize();
+
+			virtio_tx_kick(dev, qp);
+
+			/* Completions which came while interrupts were suppressed */
+			virtio_tx_reclaim(qp);
+		}
+		spin_unlock_ipl(&qp->tx_lock, ipl);
+	}
+}
+
+static inline int virtio_rx_pending(struct virtqueue *vq) {
+	return vq->last_seen_used != vq->ring.used->idx;
 }
 
 static irq_return_t virtio_interrupt(unsigned int irq_num,
 		void *dev_id) {
 	struct net_device *dev;
 	struct virtqueue *vq;
-	struct vring_used_elem *used_elem;
-	struct sk_buff *skb;
-	struct sk_buff_data *new_data;
-	struct vring_desc *desc, *next;
+	struct virtio_queue_pair *qp;
 	struct virtio_priv *virtio_priv;
+	int rx_pending;
 
 	dev = dev_id;
 
@@ -105,28 +279,51 @@ static irq_return_t virtio_interrupt(unsigned int irq_num,
 	}
 
 	virtio_priv = netdev_priv(dev);
+	rx_pending = 0;
+
+	/* All queues share the interrupt line */
+	for (qp = &virtio_priv->qp[0];
+			qp < &virtio_priv->qp[virtio_priv->qp_num]; ++qp) {
+		/* release outgoing packets, pairs out of use may complete too */
+		spin_lock(&qp->tx_lock);
+		virtio_tx_reclaim(qp);
+		spin_unlock(&qp->tx_lock);
+
+		if (qp >= &virtio_priv->qp[virtio_priv->qp_active]) {
+			continue;
+		}
 
-	/* release outgoing packets */
-	vq = &virtio_priv->tq;
-	while (vq->last_seen_used != vq->ring.used->idx) {
-		used_elem = &vq->ring.used->ring[vq->last_seen_used % vq->ring.num];
+		/* incoming packets are received by virtio_poll() */
+		vq = &qp->rq;
+		if (virtio_rx_pending(vq)) {
+			vq->ring.avail->flags |= VRING_AVAIL_F_NO_INTERRUPT;
+			rx_pending = 1;
+		}
+	}
 
-		desc = &vq->ring.desc[used_elem->id];
-		skb_extra_free(skb_extra_cast_out((void *)(uintptr_t)desc->addr));
-		desc->addr = 0;
-		assert(desc->flags & VRING_DESC_F_NEXT);
+	if (rx_pending) {
+		netif_rx_schedule(dev);
+	}
 
-		next = &vq->ring.desc[desc->next];
-		skb_data_free(skb_data_cast_out((void *)(uintptr_t)next->addr));
-		next->addr = 0;
-		assert(~next->flags & VRING_DESC_F_NEXT);
+	return IRQ_HANDLED;
+}
 
-		++vq->last_seen_used;
-	}
+/* Receive at most budget packets from rx queue of the pair */
+static int virtio_rx_poll(struct net_device *dev,
+		struct virtio_queue_pair *qp, int budget, int *stalled) {
+	struct virtqueue *vq;
+	struct vring_used_elem *used_elem;
+	struct sk_buff *skb;
+	struct sk_buff_data *new_data;
+	struct vring_desc *desc, *next;
+	struct virtio_net_hdr_mrg_rxbuf *hdr;
+	struct virtio_priv *virtio_priv;
+	int work;
 
-	/* receive incoming packets */
-	vq = &virtio_priv->rq;
-	while (vq->last_seen_used != vq->ring.used->idx) {
+	virtio_priv = netdev_priv(dev);
+	vq = &qp->rq;
+
+	for (work = 0; (work < budget) && virtio_rx_pending(vq); work++) {
 		used_elem = &vq->ring.used->ring[vq->last_seen_used % vq->ring.num];
 
 		desc = &vq->ring.desc[used_elem->id];
@@ -135,14 +332,39 @@ static irq_return_t virtio_interrupt(unsigned int irq_num,
 		next = &vq->ring.desc[desc->next];
 		assert(~next->flags & VRING_DESC_F_NEXT);
 
-		skb = skb_wrap(used_elem->len - sizeof(struct virtio_net_hdr),
+		hdr = (void *)(uintptr_t)desc->addr;
+		if ((qp->rx_drop == 0)
+				&& (virtio_priv->hdr_len == sizeof *hdr)
+				&& (hdr->num_buffers > 1)) {
+			/* Packets are not bigger than the buffer without
+			 * GUEST_TSO, so packet that takes many of them is dropped */
+			log_error("packet takes %d buffers", hdr->num_buffers);
+			qp->rx_drop = hdr->num_buffers;
+		}
+		if (qp->rx_drop != 0) {
+			qp->rx_drop--;
+			dev->stats.rx_dropped++;
+			++vq->last_seen_used;
+			vring_push_desc(used_elem->id, &vq->ring);
+			continue;
+		}
+
+		skb = skb_wrap(used_elem->len - virtio_priv->hdr_len,
 				skb_data_cast_out((void *)(uintptr_t)next->addr));
 		if (skb == NULL) {
 			log_error("skb_wrap return NULL");
+			*stalled = 1;
 			break;
 		}
 		skb->dev = dev;
-		netif_rx(skb);
+
+		/* Flags are set only if GUEST_CSUM is negotiated */
+		if (hdr->hdr.flags & VIRTIO_NET_HDR_F_NEEDS_CSUM) {
+			skb->ip_summed = CHECKSUM_PARTIAL;
+			skb->csum_offset = hdr->hdr.csum_offset;
+		} else if (hdr->hdr.flags & VIRTIO_NET_HDR_F_DATA_VALID) {
+			skb->ip_summed = CHECKSUM_UNNECESSARY;
+		}
 
 		++vq->last_seen_used;
 
@@ -151,6 +373,9 @@ static irq_return_t virtio_interrupt(unsigned int irq_num,
 			skb_extra_free(skb_extra_cast_out((void *)(uintptr_t)desc->addr));
 			desc->addr = next->addr = 0;
 			log_error("skb_data_alloc return NULL");
+			netif_receive_skb(skb);
+			work++;
+			*stalled = 1;
 			break;
 		}
 
@@ -158,21 +383,240 @@ static irq_return_t virtio_interrupt(unsigned int irq_num,
 		next->addr = (uintptr_t)skb_data_cast_in(new_data);
 
 		vring_push_desc(used_elem->id, &vq->ring);
-		virtio_net_notify_queue(VIRTIO_NET_QUEUE_RX, dev);
+
+		netif_receive_skb(skb);
 	}
 
-	return IRQ_HANDLED;
+	/* Notify about all refilled buffers at once */
+	if (virtqueue_notify_needed(vq)) {
+		virtio_net_notify_queue(vq->id, dev);
+	}
+
+	return work;
+}
+
+static int virtio_poll(struct net_device *dev, int budget) {
+	struct virtqueue *vq;
+	struct virtio_queue_pair *qp;
+	struct virtio_priv *virtio_priv;
+	int work, i, idx, stalled, pending;
+	ipl_t ipl;
+
+	virtio_priv = netdev_priv(dev);
+	stalled = 0;
+	work = 0;
+
+	/* Queues are polled in turn, starting from the next one each time,
+	 * so a busy queue can't take the whole budget all the time */
+	idx = virtio_priv->rx_next;
+	for (i = 0; (i < virtio_priv->qp_active) && (work < budget); i++) {
+		qp = &virtio_priv->qp[(idx + i) % virtio_priv->qp_active];
+		work += virtio_rx_poll(dev, qp, budget - work, &stalled);
+	}
+	virtio_priv->rx_next = (idx + 1) % virtio_priv->qp_active;
+
+	if (work < budget) {
+		ipl = ipl_save();
+		{
+			netif_rx_complete(dev);
+
+			pending = 0;
+			for (qp = &virtio_priv->qp[0];
+					qp < &virtio_priv->qp[virtio_priv->qp_active]; ++qp) {
+				vq = &qp->rq;
+				vq->ring.avail->flags &= ~VRING_AVAIL_F_NO_INTERRUPT;
+				if (vq->event_idx) {
+					/* Interrupt on the next used buffer. Until then the
+					 * device signals once after used_event is passed */
+					vring_used_event(&vq->ring) = vq->last_seen_used;
+				}
+				/* Device must see it before used ring is checked again */
+				__sync_synchronize();
+				pending |= virtio_rx_pending(vq);
+			}
+
+			/* A packet could be received before interrupts were enabled.
+			 * Out of memory case waits for the next interrupt instead */
+			if (!stalled && pending) {
+				for (qp = &virtio_priv->qp[0];
+						qp < &virtio_priv->qp[virtio_priv->qp_active]; ++qp) {
+					qp->rq.ring.avail->flags |= VRING_AVAIL_F_NO_INTERRUPT;
+				}
+				netif_rx_schedule(dev);
+			}
+		}
+		ipl_restore(ipl);
+	}
+
+	return work;
+}
+
+static inline int virtio_timed_out(clock_t start) {
+	return clock_sys_ticks() - start > ms2jiffies(MODOPS_CTRL_TIMEOUT);
+}
+
+/**
+ * Release descriptors of the command in flight if the device has handled it
+ * @return 0 if the command is still handled
+ */
+static int virtio_ctrl_done(struct virtio_priv *virtio_priv) {
+	struct virtqueue *vq;
+	struct vring_desc *desc;
+
+	vq = &virtio_priv->cq;
+
+	if (virtio_priv->ctrl_desc < 0) {
+		return 1;
+	}
+	if (vq->last_seen_used == vq->ring.used->idx) {
+		return 0;
+	}
+	++vq->last_seen_used;
+
+	for (desc = &vq->ring.desc[virtio_priv->ctrl_desc]; ;
+			desc = &vq->ring.desc[desc->next]) {
+		desc->addr = 0;
+		if (~desc->flags & VRING_DESC_F_NEXT) {
+			break;
+		}
+	}
+	virtio_priv->ctrl_desc = -1;
+
+	return 1;
+}
+
+/**
+ * Send command over control queue and wait for the device to handle it
+ * @return negative error code
+ */
+static int virtio_ctrl_cmd(struct net_device *dev, uint8_t class,
+		uint8_t cmd, uint16_t data) {
+	struct virtio_priv *virtio_priv;
+	struct virtio_net_ctrl *ctrl;
+	struct virtqueue *vq;
+	struct vring_desc *desc;
+	uint16_t desc_id;
+	clock_t start;
+
+	virtio_priv = netdev_priv(dev);
+	ctrl = &virtio_priv->ctrl;
+	vq = &virtio_priv->cq;
+
+	/* Command which timed out still owns the buffers */
+	if (!virtio_ctrl_done(virtio_priv)) {
+		return -EBUSY;
+	}
+
+	ctrl->hdr.class = class;
+	ctrl->hdr.cmd = cmd;
+	ctrl->data = data;
+	ctrl->ack = VIRTIO_NET_ERR;
+
+	desc_id = vq->next_free_desc;
+	desc = virtqueue_alloc_desc(vq);
+	if (desc == NULL) {
+		return -EBUSY;
+	}
+	vring_desc_init(desc, &ctrl->hdr, sizeof ctrl->hdr, VRING_DESC_F_NEXT);
+	desc->next = vq->next_free_desc;
+
+	desc = virtqueue_alloc_desc(vq);
+	assert(desc != NULL);
+	vring_desc_init(desc, &ctrl->data, sizeof ctrl->data, VRING_DESC_F_NEXT);
+	desc->next = vq->next_free_desc;
+
+	desc = virtqueue_alloc_desc(vq);
+	assert(desc != NULL);
+	vring_desc_init(desc, &ctrl->ack, sizeof ctrl->ack, VRING_DESC_F_WRITE);
+
+	vring_push_desc(desc_id, &vq->ring);
+	virtio_priv->ctrl_desc = desc_id;
+	virtio_net_notify_queue(vq->id, dev);
+
+	/* Commands are sent rarely, just wait for the answer */
+	start = clock_sys_ticks();
+	while (!virtio_ctrl_done(virtio_priv)) {
+		if (virtio_timed_out(start)) {
+			log_error("control command %d.%d timed out", class, cmd);
+			return -ETIMEDOUT;
+		}
+		__barrier();
+	}
+
+	return ctrl->ack == VIRTIO_NET_OK ? 0 : -EIO;
+}
+
+/* Wait for the device to transmit packets of pairs which are not used */
+static void virtio_tx_drain(struct net_device *dev) {
+	struct virtio_queue_pair *qp;
+	struct virtio_priv *virtio_priv;
+	struct virtqueue *vq;
+	clock_t start;
+	ipl_t ipl;
+
+	virtio_priv = netdev_priv(dev);
+
+	start = clock_sys_ticks();
+	for (qp = &virtio_priv->qp[virtio_priv->qp_active];
+			qp < &virtio_priv->qp[virtio_priv->qp_num]; ++qp) {
+		vq = &qp->tq;
+
+		ipl = spin_lock_ipl(&qp->tx_lock);
+		virtio_tx_kick(dev, qp);
+		while (vq->last_seen_used != vq->ring.avail->idx) {
+			if (virtio_timed_out(start)) {
+				/* Rest is released by interrupt when it's transmitted */
+				log_error("tx queue %d is not drained", vq->id);
+				break;
+			}
+			spin_unlock_ipl(&qp->tx_lock, ipl);
+			ipl = spin_lock_ipl(&qp->tx_lock);
+			virtio_tx_reclaim(qp);
+		}
+		spin_unlock_ipl(&qp->tx_lock, ipl);
+	}
 }
 
 static int virtio_open(struct net_device *dev) {
+	struct virtio_priv *virtio_priv;
+
+	virtio_priv = netdev_priv(dev);
+
 	/* device is ready */
 	virtio_net_add_status(VIRTIO_CONFIG_S_DRIVER_OK, dev);
+
+	/* device uses only the first pair until it's asked for more */
+	if (virtio_priv->qp_num > 1) {
+		if (0 == virtio_ctrl_cmd(dev, VIRTIO_NET_CTRL_MQ,
+					VIRTIO_NET_CTRL_MQ_VQ_PAIRS_SET, virtio_priv->qp_num)) {
+			virtio_priv->qp_active = virtio_priv->qp_num;
+		} else {
+			log_error("can't use %d queue pairs", virtio_priv->qp_num);
+		}
+	}
+
 	return 0;
 }
 
 static int virtio_stop(struct net_device *dev) {
+	struct virtio_priv *virtio_priv;
+
+	virtio_priv = netdev_priv(dev);
+
+	/* New packets go to the first pair. Packets queued to the other pairs
+	 * are transmitted before the device is asked to stop using them */
+	if (virtio_priv->qp_active > 1) {
+		virtio_priv->qp_active = 1;
+		virtio_tx_drain(dev);
+		if (0 != virtio_ctrl_cmd(dev, VIRTIO_NET_CTRL_MQ,
+					VIRTIO_NET_CTRL_MQ_VQ_PAIRS_SET, 1)) {
+			log_error("can't return to a single queue pair");
+		}
+	}
+
 	/* device is not ready */
 	virtio_net_del_status(VIRTIO_CONFIG_S_DRIVER_OK, dev);
+
 	return 0;
 }
 
@@ -191,15 +635,18 @@ static const struct net_driver virtio_drv_ops = {
 	.xmit = virtio_xmit,
 	.start = virtio_open,
 	.stop = virtio_stop,
-	.set_macaddr = virtio_set_macaddr
+	.set_macaddr = virtio_set_macaddr,
+	.poll = virtio_poll,
+	.xmit_flush = virtio_xmit_flush
 };
 
-static void virtio_config(struct net_device *dev) {
+static uint32_t virtio_config(struct net_device *dev) {
 	unsigned char i;
 	uint32_t guest_features;
 
 	/* check extra header size */
 	assert(skb_extra_max_size() >= sizeof(struct virtio_net_hdr));
+	dev->features = 0;
 
 	/* reset device */
 	virtio_net_reset(dev);
@@ -226,35 +673,71 @@ static void virtio_config(struct net_device *dev) {
 		guest_features |= VIRTIO_NET_F_STATUS;
 	}
 
+	if (MODOPS_OFFLOAD) {
+		/* device completes checksums and splits TCP segments */
+		if (virtio_net_has_feature(VIRTIO_NET_F_CSUM, dev)) {
+			guest_features |= VIRTIO_NET_F_CSUM;
+			dev->features |= NETIF_F_HW_CSUM;
+
+			if (virtio_net_has_feature(VIRTIO_NET_F_HOST_TSO4, dev)) {
+				guest_features |= VIRTIO_NET_F_HOST_TSO4;
+				dev->features |= NETIF_F_TSO;
+			}
+		}
+
+		/* received packets may have partial or verified checksum */
+		if (virtio_net_has_feature(VIRTIO_NET_F_GUEST_CSUM, dev)) {
+			guest_features |= VIRTIO_NET_F_GUEST_CSUM;
+		}
+
+		/* header is extended with number of buffers */
+		if (virtio_net_has_feature(VIRTIO_NET_F_MRG_RXBUF, dev)
+				&& (skb_extra_max_size()
+					>= sizeof(struct virtio_net_hdr_mrg_rxbuf))) {
+			guest_features |= VIRTIO_NET_F_MRG_RXBUF;
+		}
+	}
+
+	/* multiple queue pairs are enabled by command over control queue */
+	if ((MODOPS_QUEUE_PAIRS > 1)
+			&& virtio_net_has_feature(VIRTIO_NET_F_CTRL_VQ, dev)
+			&& virtio_net_has_feature(VIRTIO_NET_F_MQ, dev)) {
+		guest_features |= VIRTIO_NET_F_CTRL_VQ | VIRTIO_NET_F_MQ;
+	}
+
+	/* negotiate notification suppression by event indexes */
+	if (virtio_net_has_feature(VIRTIO_RING_F_EVENT_IDX, dev)) {
+		guest_features |= VIRTIO_RING_F_EVENT_IDX;
+	}
+
 	/* finalize guest features bits */
 	virtio_net_set_feature(guest_features, dev);
+
+	return guest_features;
 }
 
-static void virtio_priv_fini(struct virtio_priv *dev_priv,
+static void virtio_qp_fini(struct virtio_queue_pair *qp,
 		struct net_device *dev) {
 	struct virtqueue *vq;
 	struct vring_desc *desc;
+	int i;
 
 	/* free transmit queue */
-	vq = &dev_priv->tq;
-	for (desc = &vq->ring.desc[0];
-			desc < &vq->ring.desc[vq->ring.num]; ++desc) {
-		if (desc->addr != 0) {
-			skb_extra_free(skb_extra_cast_out((void *)(uintptr_t)desc->addr));
-			desc->addr = 0;
-			assert(desc->flags & VRING_DESC_F_NEXT);
-
-			assert(desc + 1 == &vq->ring.desc[desc->next]);
-			++desc;
-			skb_data_free(skb_data_cast_out((void *)(uintptr_t)desc->addr));
-			desc->addr = 0;
-			assert(~desc->flags & VRING_DESC_F_NEXT);
+	vq = &qp->tq;
+	if (qp->tx_slots != NULL) {
+		for (i = 0; i < vq->ring.num; ++i) {
+			if (qp->tx_slots[i].skb != NULL) {
+				skb_free(qp->tx_slots[i].skb);
+			}
+			vq->ring.desc[i].addr = 0;
 		}
+		sysfree(qp->tx_slots);
+		qp->tx_slots = NULL;
 	}
 	virtqueue_net_destroy(vq, dev);
 
 	/* free receive queue */
-	vq = &dev_priv->rq;
+	vq = &qp->rq;
 	for (desc = &vq->ring.desc[0];
 			desc < &vq->ring.desc[vq->ring.num]; ++desc) {
 		if (desc->addr != 0) {
@@ -272,8 +755,8 @@ static void virtio_priv_fini(struct virtio_priv *dev_priv,
 	virtqueue_net_destroy(vq, dev);
 }
 
-static int virtio_priv_init(struct virtio_priv *dev_priv,
-		struct net_device *dev) {
+static int virtio_qp_init(struct virtio_queue_pair *qp, int idx,
+		struct virtio_priv *dev_priv, struct net_device *dev) {
 	int ret, i;
 	struct sk_buff_extra *skb_extra;
 	struct sk_buff_data *skb_data;
@@ -281,22 +764,29 @@ static int virtio_priv_init(struct virtio_priv *dev_priv,
 	uint32_t desc_id;
 	struct vring_desc *desc;
 
+	qp->tx_slots = NULL;
+	qp->rx_drop = 0;
+	spin_init(&qp->tx_lock, __SPIN_UNLOCKED);
+
 	/* init receive queue */
-	ret = virtqueue_net_create(&dev_priv->rq, VIRTIO_NET_QUEUE_RX, dev);
+	ret = virtqueue_net_create(&qp->rq, VIRTIO_NET_QUEUE_RX + 2 * idx, dev);
 	if (ret != 0) {
 		return ret;
 	}
 
 	/* init transmit queue */
-	ret = virtqueue_net_create(&dev_priv->tq,
-			VIRTIO_NET_QUEUE_TX, dev);
+	ret = virtqueue_net_create(&qp->tq, VIRTIO_NET_QUEUE_TX + 2 * idx, dev);
 	if (ret != 0) {
-		virtqueue_net_destroy(&dev_priv->rq, dev);
+		virtqueue_net_destroy(&qp->rq, dev);
 		return ret;
 	}
 
+	qp->tx_slots = sysmalloc(qp->tq.ring.num * sizeof *qp->tx_slots);
+	if (qp->tx_slots == NULL) goto out_nomem;
+	memset(qp->tx_slots, 0, qp->tq.ring.num * sizeof *qp->tx_slots);
+
 	/* add receive buffer */
-	vq = &dev_priv->rq;
+	vq = &qp->rq;
 	if (MODOPS_PREP_BUFF_CNT * 2 > vq->ring.num) goto out_nomem;
 
 	for (i = 0; i < MODOPS_PREP_BUFF_CNT; ++i) {
@@ -308,7 +798,7 @@ static int virtio_priv_init(struct virtio_priv *dev_priv,
 		if (skb_extra == NULL) goto out_nomem;
 
 		vring_desc_init(desc, skb_extra_cast_in(skb_extra),
-				sizeof(struct virtio_net_hdr),
+				dev_priv->hdr_len,
 				VRING_DESC_F_WRITE | VRING_DESC_F_NEXT);
 		desc->next = vq->next_free_desc;
 
@@ -324,17 +814,72 @@ static int virtio_priv_init(struct virtio_priv *dev_priv,
 
 		vring_push_desc(desc_id, &vq->ring);
 	}
-	virtio_net_notify_queue(VIRTIO_NET_QUEUE_RX, dev);
+	virtio_net_notify_queue(vq->id, dev);
+	vq->notified_avail = vq->ring.avail->idx;
 
 	return 0;
 
 out_nomem:
-	virtio_priv_fini(dev_priv, dev);
+	virtio_qp_fini(qp, dev);
 	return -ENOMEM;
 }
 
+static void virtio_priv_fini(struct virtio_priv *dev_priv,
+		struct net_device *dev) {
+	while (dev_priv->qp_num > 0) {
+		virtio_qp_fini(&dev_priv->qp[--dev_priv->qp_num], dev);
+	}
+
+	if (dev_priv->has_cq) {
+		virtqueue_net_destroy(&dev_priv->cq, dev);
+		dev_priv->has_cq = 0;
+	}
+}
+
+static int virtio_priv_init(struct virtio_priv *dev_priv,
+		struct net_device *dev, uint32_t features) {
+	int ret, qp_max;
+
+	dev_priv->qp_num = 0;
+	dev_priv->qp_active = 1;
+	dev_priv->rx_next = 0;
+	dev_priv->has_cq = 0;
+	dev_priv->ctrl_desc = -1;
+
+	/* one queue pair per CPU */
+	qp_max = 1;
+	if (features & VIRTIO_NET_F_MQ) {
+		qp_max = min(min(virtio_net_get_max_vq_pairs(dev),
+					MODOPS_QUEUE_PAIRS), NCPU);
+
+		/* control queue follows all queue pairs device has */
+		ret = virtqueue_net_create(&dev_priv->cq,
+				2 * virtio_net_get_max_vq_pairs(dev), dev);
+		if (ret != 0) {
+			return ret;
+		}
+		dev_priv->has_cq = 1;
+	}
+
+	while (dev_priv->qp_num < max(qp_max, 1)) {
+		ret = virtio_qp_init(&dev_priv->qp[dev_priv->qp_num],
+				dev_priv->qp_num, dev_priv, dev);
+		if (ret != 0) {
+			virtio_priv_fini(dev_priv, dev);
+			return ret;
+		}
+		dev_priv->qp[dev_priv->qp_num].rq.event_idx =
+			dev_priv->qp[dev_priv->qp_num].tq.event_idx =
+				(features & VIRTIO_RING_F_EVENT_IDX) != 0;
+		dev_priv->qp_num++;
+	}
+
+	return 0;
+}
+
 static int virtio_init(struct pci_slot_dev *pci_dev) {
 	int ret;
+	uint32_t features;
 	struct net_device *nic;
 	struct virtio_priv *nic_priv;
 
@@ -347,9 +892,12 @@ static int virtio_init(struct pci_slot_dev *pci_dev) {
 	nic->base_addr = pci_dev->bar[0] & PCI_BASE_ADDR_IO_MASK;
 	nic_priv = netdev_priv(nic);
 
-	virtio_config(nic);
+	features = virtio_config(nic);
+	nic_priv->hdr_len = (features & VIRTIO_NET_F_MRG_RXBUF)
+			? sizeof(struct virtio_net_hdr_mrg_rxbuf)
+			: sizeof(struct virtio_net_hdr);
 
-	ret = virtio_priv_init(nic_priv, nic);
+	ret = virtio_priv_init(nic_priv, nic, features);
 	if (ret != 0) {
 		return ret;
 	}
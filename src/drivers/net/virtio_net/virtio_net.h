@@ -21,6 +21,8 @@
  */
 #define VIRTIO_REG_NET_MAC(i) (0x14 + i) /* MAC address (i:0..5) */
 #define VIRTIO_REG_NET_STATUS 0x1A       /* Status (2 bytes) */
+#define VIRTIO_REG_NET_MAX_VQ_PAIRS 0x1C /* Maximum number of queue pairs
+											(2 bytes) */
 
 /**
  * VirtIO Network Device Queues
@@ -74,6 +76,7 @@
 struct virtio_net_hdr {
 	uint8_t flags;        /* Flags */
 #define VIRTIO_NET_HDR_F_NEEDS_CSUM 0x1
+#define VIRTIO_NET_HDR_F_DATA_VALID 0x2
 	uint8_t gso_type;     /* Type of Generic segmentation
 							 offload (GSO) */
 #define VIRTIO_NET_HDR_GSO_NONE 0x00
@@ -87,6 +90,28 @@ struct virtio_net_hdr {
 	uint16_t csum_offset; /* Size of this place */
 };
 
+/**
+ * VirtIO Network Packet Header If VIRTIO_NET_F_MRG_RXBUF Is Negotiated
+ */
+struct virtio_net_hdr_mrg_rxbuf {
+	struct virtio_net_hdr hdr;
+	uint16_t num_buffers; /* Number of merged rx buffers */
+};
+
+/**
+ * VirtIO Network Control Command Header
+ */
+struct virtio_net_ctrl_hdr {
+	uint8_t class;
+	uint8_t cmd;
+};
+
+#define VIRTIO_NET_OK  0
+#define VIRTIO_NET_ERR 1
+
+#define VIRTIO_NET_CTRL_MQ              4
+#define VIRTIO_NET_CTRL_MQ_VQ_PAIRS_SET 0 /* Set number of used pairs */
+
 /**
  * VirtIO Operation Definitions For Network Module
  */
@@ -140,4 +165,12 @@ static inline uint16_t virtio_net_get_status(
 	return virtio_load16(VIRTIO_REG_NET_STATUS, dev->base_addr);
 }
 
+/**
+ * VirtIO Network Multiqueue Operations
+ */
+static inline uint16_t virtio_net_get_max_vq_pairs(
+		struct net_device *dev) {
+	return virtio_load16(VIRTIO_REG_NET_MAX_VQ_PAIRS, dev->base_addr);
+}
+
 #endif /* DRIVERS_ETHERNET_VIRTIO_NET_H_ */
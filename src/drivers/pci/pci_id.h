@@ -90,6 +90,7 @@
 
 /* VirtIO device id's */
 #define PCI_DEV_ID_VIRTIO_NET             0x1000
+#define PCI_DEV_ID_VIRTIO_BLK             0x1001
 
 #define PCI_DEV_ID_LYNX_EXP               0x0750
 #define PCI_DEV_ID_LYNX_SE                0x0718
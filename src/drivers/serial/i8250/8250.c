@@ -13,6 +13,7 @@
 #include <drivers/serial/uart_device.h>
 #include <drivers/serial/diag_serial.h>
 #include <embox/unit.h>
+#include <hal/ipl.h>
 
 EMBOX_UNIT_INIT(uart_init);
 
@@ -23,6 +24,21 @@ EMBOX_UNIT_INIT(uart_init);
 #define COM0_PORT_BASE      OPTION_GET(NUMBER,base_addr)
 #define COM0_IRQ_NUM        OPTION_GET(NUMBER,irq_num)
 
+/* Chars transmitter takes when it is empty */
+static int i8250_tx_fifo = 1;
+
+/* Receiver and transmitter interrupts are switched from different contexts */
+static void i8250_ier_update(struct uart *dev, uint8_t clear, uint8_t set) {
+	ipl_t ipl;
+
+	ipl = ipl_save();
+	{
+		out8((in8(dev->base_addr + UART_IER) & ~clear) | set,
+				dev->base_addr + UART_IER);
+	}
+	ipl_restore(ipl);
+}
+
 static uint8_t calc_line_stat(const struct uart_params *params) {
 	uint8_t line_stat;
 
@@ -57,6 +73,10 @@ static int i8250_setup(struct uart *dev, const struct uart_params *params) {
 	out8(line_stat, dev->base_addr + UART_LCR);
 	/* Uart enable FIFO */
 	out8(UART_ENABLE_FIFO, dev->base_addr + UART_FCR);
+	/* 8250 and 16450 have no FIFO */
+	if ((in8(dev->base_addr + UART_IIR) & UART_IIR_FIFO) == UART_IIR_FIFO) {
+		i8250_tx_fifo = UART_FIFO_SIZE;
+	}
 	/* Uart enable modem (turn on DTR, RTS, and OUT2) */
 	out8(UART_ENABLE_MODEM, dev->base_addr + UART_MCR);
 
@@ -70,10 +90,9 @@ static int i8250_setup(struct uart *dev, const struct uart_params *params) {
 }
 
 static int i8250_irq_en(struct uart *dev, const struct uart_params *params) {
-	/*enable rx interrupt*/
 	if (params->irq) {
 		/*enable rx interrupt*/
-		out8(UART_IER_RX_ENABLE, dev->base_addr + UART_IER);
+		i8250_ier_update(dev, 0, UART_IER_RX_ENABLE);
 	}
 
 	return 0;
@@ -82,12 +101,33 @@ static int i8250_irq_en(struct uart *dev, const struct uart_params *params) {
 static int i8250_irq_dis(struct uart *dev, const struct uart_params *params) {
 	if (params->irq) {
 		/*disable rx interrupt*/
-		out8(0, dev->base_addr + UART_IER);
+		i8250_ier_update(dev, UART_IER_RX_ENABLE, 0);
 	}
 
 	return 0;
 }
 
+static int i8250_tx_room(struct uart *dev) {
+	return (in8(dev->base_addr + UART_LSR) & UART_EMPTY_TX) ? i8250_tx_fifo : 0;
+}
+
+static int i8250_tx_irq(struct uart *dev, int enable) {
+	/* Interrupt comes at once if transmitter is already empty */
+	if (enable) {
+		i8250_ier_update(dev, 0, UART_IER_TX_ENABLE);
+	} else {
+		i8250_ier_update(dev, UART_IER_TX_ENABLE, 0);
+	}
+
+	return 0;
+}
+
+/* Called after i8250_tx_room() told there is room */
+static int i8250_tx_put(struct uart *dev, int ch) {
+	out8((uint8_t) ch, dev->base_addr + UART_TX);
+	return 0;
+}
+
 static int i8250_putc(struct uart *dev, int ch) {
 	while (!(in8(dev->base_addr + UART_LSR) & UART_EMPTY_TX));
 	out8((uint8_t) ch, dev->base_addr + UART_TX);
@@ -109,6 +149,9 @@ static const struct uart_ops i8250_uart_ops = {
 		.uart_setup = i8250_setup,
 		.uart_irq_en = i8250_irq_en,
 		.uart_irq_dis = i8250_irq_dis,
+		.uart_tx_room = i8250_tx_room,
+		.uart_tx_put = i8250_tx_put,
+		.uart_tx_irq = i8250_tx_irq,
 };
 
 static struct uart uart0 = {
@@ -83,5 +83,10 @@
 #define DIVISOR(baud) (115200 / baud)
 
 #define UART_IER_RX_ENABLE  0x1
+#define UART_IER_TX_ENABLE  0x2
+
+/* Both bits are set if FIFO is enabled */
+#define UART_IIR_FIFO       0xC0
+#define UART_FIFO_SIZE      16
 
 #endif /* SERIAL_8250_H_ */
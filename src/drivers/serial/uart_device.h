@@ -36,6 +36,11 @@ struct uart_ops {
 	int (*uart_setup)(struct uart *dev, const struct uart_params *params);
 	int (*uart_irq_en)(struct uart *dev, const struct uart_params *params);
 	int (*uart_irq_dis)(struct uart *dev, const struct uart_params *params);
+
+	/* Optional, output is sent from interrupt of empty transmitter */
+	int (*uart_tx_room)(struct uart *dev); /* chars to put without waiting */
+	int (*uart_tx_put)(struct uart *dev, int symbol); /* doesn't wait */
+	int (*uart_tx_irq)(struct uart *dev, int enable);
 };
 
 struct uart {
@@ -130,6 +135,14 @@ static inline int uart_putc(struct uart *uart, int ch) {
 	return uart->uart_ops->uart_putc(uart, ch);
 }
 
+/**
+ * @brief Check if output to @a uart is buffered and sent from interrupt
+ */
+static inline int uart_tx_buffered(struct uart *uart) {
+	return uart->params.irq && uart->uart_ops->uart_tx_room
+		&& uart->uart_ops->uart_tx_put && uart->uart_ops->uart_tx_irq;
+}
+
 static inline int uart_getc(struct uart *uart) {
 	return uart->uart_ops->uart_getc(uart);
 }
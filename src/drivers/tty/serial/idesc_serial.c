@@ -64,7 +64,6 @@ static ssize_t serial_read(struct idesc *idesc, const struct iovec *iov, int cnt
 static ssize_t serial_write(struct idesc *idesc, const struct iovec *iov, int cnt) {
 	void *buf;
 	size_t nbyte;
-	int ch;
 	struct uart *uart;
 	size_t written, left;
 
@@ -84,12 +83,9 @@ static ssize_t serial_write(struct idesc *idesc, const struct iovec *iov, int cn
 	assert(uart->tty);
 
 	do {
+		/* Output is sent by tty out_wake */
 		written = tty_write(uart->tty, buf, left);
 
-		while (-1 != (ch = tty_out_getc(uart->tty))) {
-			uart_putc(uart, ch);
-		}
-
 		left -= written;
 		buf = (void *)((char *)buf + written);
 	} while (left != 0);
@@ -107,6 +103,7 @@ static void serial_close(struct idesc *idesc) {
 
 	uart = idesc_to_uart(idesc);
 	assert(uart);
+	uart_tx_flush(uart);
 	res = uart_close(uart);
 	if (res) {
 		panic("Failed to close UART");
@@ -146,7 +143,8 @@ static int serial_status(struct idesc *idesc, int mask) {
 
 	if (mask & POLLOUT) {
 		/* how many we can write */
-		res += INT_MAX;
+		res += uart_tx_buffered(uart)
+			? ring_room_size(&uart->tty->o_ring, TTY_IO_BUFF_SZ) : INT_MAX;
 	}
 
 	if (mask & POLLERR) {
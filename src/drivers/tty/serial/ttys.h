@@ -21,6 +21,11 @@ struct tty_uart {
 
 extern struct idesc *uart_cdev_open(struct dev_module *cdev, void *priv);
 
+/* Output is sent from interrupt, see uart_tx_buffered() */
+extern void uart_tx_irq_handler(struct uart *uart_dev);
+/* Sends output left in tty ring at once */
+extern void uart_tx_flush(struct uart *uart_dev);
+
 #define TTYS_DEF(name, uart) \
 		CHAR_DEV_DEF(name, uart_cdev_open, NULL, NULL, uart)
 
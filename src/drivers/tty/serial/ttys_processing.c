@@ -113,6 +113,7 @@ irq_return_t uart_irq_handler(unsigned int irq_nr, void *data) {
 	struct uart *dev = data;
 
 	uart_rx_buff_put(dev);
+	uart_tx_irq_handler(dev);
 
 	return IRQ_HANDLED;
 }
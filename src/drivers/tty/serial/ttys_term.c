@@ -5,10 +5,15 @@
  * @author: Anton Bondarev
  */
 
+#include <poll.h>
+
 #include <drivers/tty.h>
 #include <drivers/ttys.h>
 #include <drivers/serial/uart_device.h>
+#include <fs/idesc_event.h>
+#include <util/math.h>
 
+#define UART_TX_CHUNK 16
 
 static inline struct uart *tty2uart(struct tty *tty) {
 	struct tty_uart *tu;
@@ -16,14 +21,75 @@ static inline struct uart *tty2uart(struct tty *tty) {
 	return tu->uart;
 }
 
+/* Put as many chars as transmitter takes without waiting, called with
+ * interrupts disabled. Return 1 if some output is left in the ring. */
+static int uart_tx_fill(struct uart *uart_dev, struct tty *t) {
+	char buf[UART_TX_CHUNK];
+	int room, cnt, i;
+
+	while ((room = uart_dev->uart_ops->uart_tx_room(uart_dev)) > 0) {
+		cnt = tty_out_buf(t, buf, min(room, UART_TX_CHUNK));
+		if (cnt == 0) {
+			return 0;
+		}
+
+		/* Room is checked once for the whole chunk */
+		for (i = 0; i < cnt; i++) {
+			uart_dev->uart_ops->uart_tx_put(uart_dev, buf[i]);
+		}
+	}
+
+	return !ring_empty(&t->o_ring);
+}
+
+/* Called from interrupt handler of the UART */
+void uart_tx_irq_handler(struct uart *uart_dev) {
+	struct tty *t = uart_dev->tty;
+
+	if (!t || !uart_tx_buffered(uart_dev)) {
+		return;
+	}
+
+	if (!uart_tx_fill(uart_dev, t)) {
+		uart_dev->uart_ops->uart_tx_irq(uart_dev, 0);
+	}
+
+	/* Writer may wait for room in the ring */
+	if (t->idesc) {
+		idesc_notify(t->idesc, POLLOUT);
+	}
+}
+
+/* Send the rest of output at once, before UART interrupt is detached */
+void uart_tx_flush(struct uart *uart_dev) {
+	int ich;
+
+	irq_lock();
+	{
+		if (uart_tx_buffered(uart_dev)) {
+			uart_dev->uart_ops->uart_tx_irq(uart_dev, 0);
+		}
+
+		while ((ich = tty_out_getc(uart_dev->tty)) != -1) {
+			uart_putc(uart_dev, (char) ich);
+		}
+	}
+	irq_unlock();
+}
+
 static void uart_out_wake(struct tty *t) {
 	struct uart *uart_dev = tty2uart(t);
 	int ich;
 
 	irq_lock();
 
-	while ((ich = tty_out_getc(t)) != -1)
-		uart_putc(uart_dev, (char) ich);
+	if (uart_tx_buffered(uart_dev)) {
+		/* The rest is sent from interrupt, so writer doesn't wait */
+		uart_dev->uart_ops->uart_tx_irq(uart_dev, uart_tx_fill(uart_dev, t));
+	} else {
+		while ((ich = tty_out_getc(t)) != -1)
+			uart_putc(uart_dev, (char) ich);
+	}
 
 	irq_unlock();
 }
@@ -40,17 +40,11 @@ static inline void tty_out_wake(struct tty *t) {
 	t->ops->out_wake(t);
 }
 
-/* called from mutex locked context */
+/* called from mutex locked context. Output is only queued, the driver is
+ * woken once for the whole tty_write() or when the queue is full */
 static int tty_output(struct tty *t, char ch) {
 	// TODO locks? context? -- Eldar
-	int len = termios_putc(&t->termios, ch, &t->o_ring, t->o_buff, TTY_IO_BUFF_SZ);
-
-	if (len > 0) {
-		MUTEX_UNLOCKED_DO(tty_out_wake(t), &t->lock);
-	}
-
-	return len;
-	// t->ops->tx_char(t, ch);
+	return termios_putc(&t->termios, ch, &t->o_ring, t->o_buff, TTY_IO_BUFF_SZ);
 }
 
 static void tty_rx_do(struct tty *t) {
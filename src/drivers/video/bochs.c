@@ -22,6 +22,9 @@
 
 PCI_DRIVER("bochs", bochs_init, PCI_VENDOR_ID_BOCHS, PCI_DEV_ID_BOCHS_VGA);
 
+static char *bochs_vram;
+static size_t bochs_vram_len;
+
 static int bochs_set_var(struct fb_info *info, const struct fb_var_screeninfo *var) {
 	if (var->xres > VBE_DISPI_MAX_XRES
 			|| var->yres > VBE_DISPI_MAX_YRES
@@ -69,9 +72,40 @@ static int bochs_get_var(struct fb_info *info, struct fb_var_screeninfo *var) {
 	return 0;
 }
 
+/* Show frame starting at line of video memory, virtual height grows to
+ * cover it */
+static int bochs_set_base(struct fb_info *info, void *new_base) {
+	size_t line, off;
+	uint32_t yoffset;
+
+	line = info->var.xres * info->var.bits_per_pixel / 8;
+	off = (char *) new_base - bochs_vram;
+
+	if (((char *) new_base < bochs_vram) || (line == 0) || (off % line)
+			|| (off + line * info->var.yres > bochs_vram_len)) {
+		return -EINVAL;
+	}
+
+	yoffset = off / line;
+
+	if (vbe_read(VBE_DISPI_INDEX_VIRT_HEIGHT) < yoffset + info->var.yres) {
+		vbe_write(VBE_DISPI_INDEX_VIRT_HEIGHT, yoffset + info->var.yres);
+	}
+	vbe_write(VBE_DISPI_INDEX_Y_OFFSET, yoffset);
+
+	if (vbe_read(VBE_DISPI_INDEX_Y_OFFSET) != yoffset) {
+		return -EINVAL;
+	}
+
+	info->var.yoffset = yoffset;
+
+	return 0;
+}
+
 static const struct fb_ops bochs_ops = {
 	.fb_set_var = bochs_set_var,
 	.fb_get_var = bochs_get_var,
+	.fb_set_base = bochs_set_base,
 };
 
 static int bochs_init(struct pci_slot_dev *pci_dev) {
@@ -89,6 +123,9 @@ static int bochs_init(struct pci_slot_dev *pci_dev) {
 		return -EIO;
 	}
 
+	bochs_vram = mmap_base;
+	bochs_vram_len = mmap_len;
+
 	info = fb_create(&bochs_ops, mmap_base, mmap_len);
 	if (info == NULL) {
 		munmap(mmap_base, mmap_len);
@@ -25,7 +25,10 @@
 #include <framework/mod/options.h>
 #include <mem/misc/pool.h>
 
+#include "fb_accel.h"
+
 #define MODOPS_FB_AMOUNT OPTION_GET(NUMBER, fb_amount)
+#define MODOPS_FB_SHADOW OPTION_GET(BOOLEAN, shadow)
 
 struct fb_dev {
 	struct dlist_head link;
@@ -90,10 +93,15 @@ struct fb_info *fb_create(const struct fb_ops *ops, char *map_base, size_t map_s
 		dlist_add_next(&dev->link, &fb_list);
 		info->screen_base = map_base;
 		info->screen_size = map_size;
+		info->shadow = NULL;
 
 		memcpy(&info->ops, ops, sizeof(struct fb_ops));
 		fb_ops_fixup(&info->ops);
 		fb_update_current_var(info);
+		if (MODOPS_FB_SHADOW && (0 != fb_shadow_enable(info))) {
+			/* Mode may be not set yet, then it's tried again by fb_set_var() */
+			log_debug("No shadow buffer for framebuffer %d", info->id);
+		}
 		fb_devfs_create(info, map_base, map_size);
 	}
 out:
@@ -106,6 +114,8 @@ void fb_delete(struct fb_info *info) {
 	struct fb_dev *dev = member_cast_out(info, struct fb_dev, info);
 
 	if (info) {
+		fb_shadow_disable(info);
+
 		mutex_lock(&fb_static);
 		{
 			dlist_del(&dev->link);
@@ -134,20 +144,29 @@ struct fb_info *fb_lookup(int id) {
 }
 
 int fb_set_var(struct fb_info *info, const struct fb_var_screeninfo *var) {
-	int ret;
+	int ret, shadow;
 
 	assert(info != NULL);
 	assert(var != NULL);
 
+	/* Shadow buffer is sized for the current mode, so it's made anew */
+	shadow = MODOPS_FB_SHADOW || (info->shadow != NULL);
+	fb_shadow_disable(info);
+
+	ret = 0;
 	if (info->ops.fb_set_var != NULL) {
 		ret = info->ops.fb_set_var(info, var);
-		if (ret < 0) {
-			return ret;
+		if (ret >= 0) {
+			memcpy(&info->var, var, sizeof(struct fb_var_screeninfo));
+			ret = 0;
 		}
-		memcpy(&info->var, var, sizeof(struct fb_var_screeninfo));
 	}
 
-	return 0;
+	if (shadow && (0 != fb_shadow_enable(info))) {
+		log_error("No shadow buffer for framebuffer %d", info->id);
+	}
+
+	return ret;
 }
 
 int fb_get_var(struct fb_info *info, struct fb_var_screeninfo *var) {
@@ -155,16 +174,23 @@ int fb_get_var(struct fb_info *info, struct fb_var_screeninfo *var) {
 	return 0;
 }
 
+/* Driver operations draw to the screen, so they are bypassed if drawing
+ * goes to shadow buffer */
+#define fb_draw_op(info, op) \
+	((info)->shadow ? fb_default_##op : (info)->ops.fb_##op)
+
 void fb_copyarea(struct fb_info *info, const struct fb_copyarea *area) {
-	info->ops.fb_copyarea(info, area);
+	fb_draw_op(info, copyarea)(info, area);
+	fb_damage(info, area->dx, area->dy, area->width, area->height);
 }
 
 void fb_cursor(struct fb_info *info, const struct fb_cursor *cursor) {
-	info->ops.fb_cursor(info, cursor);
+	fb_draw_op(info, cursor)(info, cursor);
 }
 
 void fb_imageblit(struct fb_info *info, const struct fb_image *image) {
-	info->ops.fb_imageblit(info, image);
+	fb_draw_op(info, imageblit)(info, image);
+	fb_damage(info, image->dx, image->dy, image->width, image->height);
 }
 
 #define _val_fixup(x, low, high) (min((high), max((low), (x))))
@@ -179,7 +205,8 @@ void fb_fillrect(struct fb_info *info, const struct fb_fillrect *rect) {
 	r.width  = _val_fixup(rect->width, 0, info->var.xres - r.dx);
 	r.height = _val_fixup(rect->height, 0, info->var.yres - r.dy);
 
-	info->ops.fb_fillrect(info, &r);
+	fb_draw_op(info, fillrect)(info, &r);
+	fb_damage(info, r.dx, r.dy, r.width, r.height);
 }
 
 static int fb_update_current_var(struct fb_info *info) {
@@ -381,6 +408,33 @@ static void bitcpy_rev(uint32_t *dst, uint32_t dstn, uint32_t *src,
 	}
 }
 
+/* Rows of pixels taking whole bytes are moved by memmove() */
+static void fb_copyarea_rows(struct fb_info *info, const struct fb_copyarea *area,
+		uint32_t width, uint32_t height) {
+	uint32_t bytes, line;
+	char *dst, *src;
+	int step;
+
+	bytes = info->var.bits_per_pixel / CHAR_BIT;
+	line = info->var.xres * bytes;
+	dst = info->screen_base + area->dy * line + area->dx * bytes;
+	src = info->screen_base + area->sy * line + area->sx * bytes;
+	step = line;
+
+	/* Overlapping area is copied from the last row if it moves down */
+	if (area->dy > area->sy) {
+		dst += (height - 1) * line;
+		src += (height - 1) * line;
+		step = -step;
+	}
+
+	for (; height > 0; height--) {
+		memmove(dst, src, width * bytes);
+		dst += step;
+		src += step;
+	}
+}
+
 static void fb_default_copyarea(struct fb_info *info, const struct fb_copyarea *area) {
 	uint32_t width, height, *dst, dstn, *src, srcn;
 
@@ -394,6 +448,12 @@ static void fb_default_copyarea(struct fb_info *info, const struct fb_copyarea *
 	height = min(area->height, info->var.yres - max(area->sy, area->dy));
 
 	assert(info->screen_base != NULL);
+
+	if (fb_accel_bpp(info->var.bits_per_pixel)) {
+		fb_copyarea_rows(info, area, width, height);
+		return;
+	}
+
 	dstn = srcn = (uintptr_t)info->screen_base % sizeof(*dst);
 	dst = src = (uint32_t *)((uintptr_t)info->screen_base - dstn);
 	dstn = dstn * CHAR_BIT + (area->dy * info->var.xres
@@ -524,7 +584,8 @@ static void bitfill_rev(uint32_t *dst, uint32_t dstn, uint32_t pat,
 }
 
 static void fb_default_fillrect(struct fb_info *info, const struct fb_fillrect *rect) {
-	uint32_t width, height, pat_orig, pat, *dst, dstn, loff, roff;
+	uint32_t width, height, pat_orig, pat, *dst, dstn, loff, roff, line;
+	char *row;
 	void (*fill_op)(uint32_t *dst, uint32_t dstn, uint32_t pat,
 		uint32_t loff, uint32_t roff, uint32_t len);
 
@@ -536,9 +597,25 @@ static void fb_default_fillrect(struct fb_info *info, const struct fb_fillrect *
 	width = min(rect->width, info->var.xres - rect->dx);
 	height = min(rect->height, info->var.yres - rect->dy);
 
+	assert(info->screen_base != NULL);
+
+	if (fb_accel_bpp(info->var.bits_per_pixel)) {
+		line = info->var.xres * info->var.bits_per_pixel / CHAR_BIT;
+		row = info->screen_base + rect->dy * line
+			+ rect->dx * info->var.bits_per_pixel / CHAR_BIT;
+
+		for (; height > 0; height--, row += line) {
+			if (rect->rop == ROP_COPY) {
+				fb_row_fill(row, rect->color, width, info->var.bits_per_pixel);
+			} else {
+				fb_row_xor(row, rect->color, width, info->var.bits_per_pixel);
+			}
+		}
+		return;
+	}
+
 	pat_orig = pixel_to_pat(info->var.bits_per_pixel, rect->color);
 
-	assert(info->screen_base != NULL);
 	dstn = (uintptr_t)info->screen_base % sizeof(*dst);
 	dst = (uint32_t *)((uintptr_t)info->screen_base - dstn);
 	dstn = dstn * CHAR_BIT + (rect->dy * info->var.xres
@@ -561,30 +638,49 @@ static void fb_default_fillrect(struct fb_info *info, const struct fb_fillrect *
 }
 
 static void fb_default_imageblit(struct fb_info *info, const struct fb_image *image) {
-	/* TODO it's slow version:) */
-	uint32_t i, j;
+	uint32_t i, j, width, height, pitch, line;
+	const uint8_t *bits;
 	struct fb_fillrect rect;
+	char *row;
 
 	assert(info != NULL);
 	assert(image != NULL);
 	assert(image->depth == 1);
-	assert(image->width == 8);
+
+	if ((image->dx >= info->var.xres) || (image->dy >= info->var.yres)) return;
+
+	width = min(image->width, info->var.xres - image->dx);
+	height = min(image->height, info->var.yres - image->dy);
+	/* Rows of bitmap are padded to bytes */
+	pitch = (image->width + CHAR_BIT - 1) / CHAR_BIT;
+	bits = (const uint8_t *) image->data;
+
+	if (fb_accel_bpp(info->var.bits_per_pixel)) {
+		line = info->var.xres * info->var.bits_per_pixel / CHAR_BIT;
+		row = info->screen_base + image->dy * line
+			+ image->dx * info->var.bits_per_pixel / CHAR_BIT;
+
+		for (j = 0; j < height; j++, row += line, bits += pitch) {
+			fb_row_mono(row, bits, width, image->fg_color, image->bg_color,
+					info->var.bits_per_pixel);
+		}
+		return;
+	}
 
 	rect.width = rect.height = 1;
 	rect.rop = ROP_COPY;
-	for (j = 0; j < image->height; ++j) {
-		rect.dy = image->dy + j * rect.height;
-		for (i = 0; i < image->width; ++i) {
-			rect.dx = image->dx + i * rect.width;
-			rect.color = *(uint8_t *)(image->data + j) & (1 << ((image->width - i - 1)))
+	for (j = 0; j < height; ++j, bits += pitch) {
+		rect.dy = image->dy + j;
+		for (i = 0; i < width; ++i) {
+			rect.dx = image->dx + i;
+			rect.color = bits[i / CHAR_BIT] & (0x80 >> (i % CHAR_BIT))
 					? image->fg_color : image->bg_color;
-			info->ops.fb_fillrect(info, &rect);
+			fb_draw_op(info, fillrect)(info, &rect);
 		}
 	}
 }
 
 static void fb_default_cursor(struct fb_info *info, const struct fb_cursor *cursor) {
-	uint32_t i, j;
 	struct fb_fillrect rect;
 
 	assert(info != NULL);
@@ -592,16 +688,13 @@ static void fb_default_cursor(struct fb_info *info, const struct fb_cursor *curs
 
 	if (!cursor->enable) return;
 
-	rect.width = rect.height = 1;
+	rect.dx = cursor->hot.x * cursor->image.width;
+	rect.dy = cursor->hot.y * cursor->image.height;
+	rect.width = cursor->image.width;
+	rect.height = cursor->image.height;
 	rect.rop = cursor->rop;
 	rect.color = cursor->image.fg_color;
-	for (j = 0; j < cursor->image.height; ++j) {
-		rect.dy = cursor->hot.y * cursor->image.height + j * rect.height;
-		for (i = 0; i < cursor->image.width; ++i) {
-			rect.dx = cursor->hot.x * cursor->image.width + i * rect.width;
-			info->ops.fb_fillrect(info, &rect);
-		}
-	}
+	fb_fillrect(info, &rect);
 }
 
 int pix_fmt_has_alpha(enum pix_fmt fmt) {
@@ -646,93 +739,3 @@ int pix_fmt_chan_bits(enum pix_fmt fmt, enum pix_chan chan) {
 		return 0;
 	}
 }
-
-/* sr - shift of red component, sg - for green, etc.
- * dr - bits of red componen, dg - for green, etc. */
-static const struct fb_rgb_conv {
-	uint8_t sr, sg, sb, sa, dr, dg, db, da;
-} rgb_conv[] = {
-	[RGB888]   = { 0,  8,  16, 24, 8, 8, 8, 0, },
-	[BGR888]   = { 16, 8,  0,  24, 8, 8, 8, 0, },
-	[RGBA8888] = { 0,  8,  16, 24, 8, 8, 8, 8, },
-	[BGRA8888] = { 16, 8,  0,  24, 8, 8, 8, 8, },
-	[RGB565]   = { 0,  5,  11, 16, 5, 6, 5, 0, },
-	[BGR565]   = { 11, 5,  0,  16, 5, 6, 5, 0, },
-};
-
-static inline int fb_fmt_supported(enum pix_fmt fmt) {
-	return
-		(fmt == RGB888)   || (fmt == BGR888) || (fmt == RGBA8888) ||
-		(fmt == BGRA8888) || (fmt == RGB565) || (fmt == BGR565);
-}
-
-static inline int fb_component_conv(int c, int in_dx, int out_dx) {
-	if (in_dx > out_dx) {
-		return c >> (in_dx - out_dx);
-	} else {
-		return c << (out_dx - in_dx);
-	}
-}
-
-static inline void fb_copy_pixel(char *dst, int px, int bpp) {
-	int i;
-
-	switch (bpp) {
-	case 1:
-		*(uint8_t *)dst = px;
-		break;
-	case 2:
-		*(uint16_t *)dst = px;
-		break;
-	case 4:
-		*(uint32_t *)dst = px;
-		break;
-	default:
-		for (i = 0; i < bpp; i++) {
-			dst[i] = px & 0xff;
-			px >>= bpp;
-		}
-		break;
-	}
-}
-
-int pix_fmt_convert(void *src, void *dst, int n,
-		enum pix_fmt in, enum pix_fmt out) {
-	int i, a, r, g, b, src_bpp, dst_bpp;
-	uint32_t in_px, out_px;
-	struct fb_rgb_conv in_cv, out_cv;
-
-	if (!fb_fmt_supported(in) || !fb_fmt_supported(out)) {
-		return -1;
-	}
-
-	in_cv = rgb_conv[in];
-	out_cv = rgb_conv[out];
-
-	src_bpp = (in_cv.da + in_cv.dr + in_cv.dg + in_cv.db) / 8;
-	dst_bpp = (out_cv.da + out_cv.dr + out_cv.dg + out_cv.db) / 8;
-
-	for (i = 0; i < n; i++) {
-		in_px = *(uint32_t *)src;
-
-		a = ((in_px >> in_cv.sa) & 0xff) >> (8 - in_cv.da);
-		r = ((in_px >> in_cv.sr) & 0xff) >> (8 - in_cv.dr);
-		g = ((in_px >> in_cv.sg) & 0xff) >> (8 - in_cv.dg);
-		b = ((in_px >> in_cv.sb) & 0xff) >> (8 - in_cv.db);
-
-		a = fb_component_conv(a, in_cv.da, out_cv.da);
-		r = fb_component_conv(r, in_cv.dr, out_cv.dr);
-		g = fb_component_conv(g, in_cv.dg, out_cv.dg);
-		b = fb_component_conv(b, in_cv.db, out_cv.db);
-
-		out_px = (a << out_cv.sa) | (r << out_cv.sr) |
-		         (g << out_cv.sg) | (b << out_cv.sb);
-
-		fb_copy_pixel(dst, out_px, dst_bpp);
-
-		dst += dst_bpp;
-		src += src_bpp;
-	}
-
-	return 0;
-}
@@ -162,14 +162,18 @@ struct fb_ops {
 	int (*fb_set_base)(struct fb_info *info, void *new_base);
 };
 
+struct fb_shadow;
+
 struct fb_info {
 	int id; /**< ID, monothonically incremented for each fb */
 
 	struct fb_ops ops; /**< Operations on fb, allowed to be modified by driver */
-	char *screen_base; /**< Start of frame buffer */
+	char *screen_base; /**< Start of frame buffer, shadow buffer if enabled */
 	size_t screen_size; /**< Maximum lenght of frame buffer */
 
 	struct fb_var_screeninfo var; /**< Current variable settins */
+
+	struct fb_shadow *shadow; /**< See fb_shadow_enable() */
 };
 
 extern struct fb_info *fb_create(const struct fb_ops *ops, char *map_base,
@@ -189,6 +193,26 @@ extern void fb_fillrect(struct fb_info *info, const struct fb_fillrect *rect);
 extern void fb_imageblit(struct fb_info *info, const struct fb_image *image);
 extern void fb_cursor(struct fb_info *info, const struct fb_cursor *cursor);
 
+/**
+ * @brief Make drawing go to a buffer in RAM, which becomes screen_base.
+ *        fb_flush() copies damaged regions of the buffer to the screen. If
+ *        driver can change base of the screen, pages of the screen are
+ *        flipped, so a half drawn frame is never shown. It's done for each
+ *        framebuffer if @a shadow option of fb module is set.
+ *
+ * @return 0 on success, negative error code otherwise
+ */
+extern int fb_shadow_enable(struct fb_info *info);
+extern void fb_shadow_disable(struct fb_info *info);
+
+/**
+ * @brief Mark region which was drawn to screen_base not by fb_* functions,
+ *        they mark their regions themselves. Does nothing without shadow.
+ */
+extern void fb_damage(struct fb_info *info, uint32_t x, uint32_t y,
+		uint32_t width, uint32_t height);
+extern void fb_flush(struct fb_info *info);
+
 
 extern int fb_devfs_create(struct fb_info *fbi, char *map_base, size_t map_size);
 
@@ -0,0 +1,302 @@
+/**
+ * @file
+ * @brief Row kernels of framebuffer drawing and pixel format conversion
+ * @details Rows are processed by 32-bit words, and by 128-bit vectors if the
+ *          compiler targets SSE2 or NEON. Conversion kernel is chosen for
+ *          a pair of formats once per call, not per pixel.
+ *
+ * @date 18.10.2026
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include <drivers/video/fb.h>
+
+#include "fb_accel.h"
+
+#if defined(__SSE2__) || defined(__ARM_NEON)
+#define FB_VEC_WORDS 4
+typedef uint32_t fb_vec_t __attribute__ ((vector_size(16), aligned(4), may_alias));
+#endif
+
+static inline uint16_t fb_load16(const uint8_t *p) {
+	uint16_t v;
+
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static inline uint32_t fb_load32(const uint8_t *p) {
+	uint32_t v;
+
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static inline void fb_store16(uint8_t *p, uint16_t v) {
+	memcpy(p, &v, sizeof(v));
+}
+
+static inline void fb_store32(uint8_t *p, uint32_t v) {
+	memcpy(p, &v, sizeof(v));
+}
+
+static inline uint32_t fb_pattern(uint32_t pixel, int bpp) {
+	switch (bpp) {
+	case 8:
+		return (pixel & 0xff) * 0x01010101;
+	case 16:
+		return (pixel & 0xffff) * 0x00010001;
+	default:
+		return pixel;
+	}
+}
+
+static inline void fb_pixel_put(uint8_t *p, uint32_t pixel, int bpp, int xor) {
+	switch (bpp) {
+	case 8:
+		*p = xor ? *p ^ pixel : pixel;
+		break;
+	case 16:
+		fb_store16(p, xor ? fb_load16(p) ^ pixel : pixel);
+		break;
+	default:
+		fb_store32(p, xor ? fb_load32(p) ^ pixel : pixel);
+		break;
+	}
+}
+
+/* @a dst is aligned to word */
+static void fb_words_put(uint32_t *dst, uint32_t pat, uint32_t cnt, int xor) {
+#ifdef FB_VEC_WORDS
+	fb_vec_t vpat = { pat, pat, pat, pat };
+
+	for (; cnt >= FB_VEC_WORDS; cnt -= FB_VEC_WORDS, dst += FB_VEC_WORDS) {
+		if (xor) {
+			*(fb_vec_t *) dst ^= vpat;
+		} else {
+			*(fb_vec_t *) dst = vpat;
+		}
+	}
+#endif
+	for (; cnt > 0; cnt--, dst++) {
+		*dst = xor ? *dst ^ pat : pat;
+	}
+}
+
+static void fb_row_put(uint8_t *dst, uint32_t pixel, uint32_t n, int bpp,
+		int xor) {
+	uint32_t bytes, words;
+
+	bytes = bpp / 8;
+
+	/* Pixels up to word boundary, pattern of word has the same phase
+	 * then since pixels are 1, 2 or 4 bytes */
+	for (; (n > 0) && ((uintptr_t) dst & (sizeof(uint32_t) - 1)); n--) {
+		fb_pixel_put(dst, pixel, bpp, xor);
+		dst += bytes;
+	}
+
+	words = n * bytes / sizeof(uint32_t);
+	fb_words_put((uint32_t *) dst, fb_pattern(pixel, bpp), words, xor);
+	dst += words * sizeof(uint32_t);
+	n -= words * sizeof(uint32_t) / bytes;
+
+	for (; n > 0; n--) {
+		fb_pixel_put(dst, pixel, bpp, xor);
+		dst += bytes;
+	}
+}
+
+void fb_row_fill(void *dst, uint32_t pixel, uint32_t n, int bpp) {
+	if (bpp == 8) {
+		memset(dst, pixel, n);
+		return;
+	}
+
+	fb_row_put(dst, pixel, n, bpp, 0);
+}
+
+void fb_row_xor(void *dst, uint32_t pixel, uint32_t n, int bpp) {
+	fb_row_put(dst, pixel, n, bpp, 1);
+}
+
+#define FB_MONO_PIXEL(bits, i, fg, bg) \
+	(((bits)[(i) / 8] & (0x80 >> ((i) % 8))) ? (fg) : (bg))
+
+void fb_row_mono(void *dst, const uint8_t *bits, uint32_t n,
+		uint32_t fg, uint32_t bg, int bpp) {
+	uint8_t *d = dst;
+	uint32_t i;
+
+	switch (bpp) {
+	case 8:
+		for (i = 0; i < n; i++) {
+			d[i] = FB_MONO_PIXEL(bits, i, fg, bg);
+		}
+		break;
+	case 16:
+		for (i = 0; i < n; i++) {
+			fb_store16(d + 2 * i, FB_MONO_PIXEL(bits, i, fg, bg));
+		}
+		break;
+	case 32:
+		for (i = 0; i < n; i++) {
+			fb_store32(d + 4 * i, FB_MONO_PIXEL(bits, i, fg, bg));
+		}
+		break;
+	}
+}
+
+/* sr - shift of red component, sg - for green, etc.
+ * dr - bits of red componen, dg - for green, etc. */
+static const struct fb_rgb_conv {
+	uint8_t sr, sg, sb, sa, dr, dg, db, da;
+} rgb_conv[] = {
+	[RGB888]   = { 0,  8,  16, 24, 8, 8, 8, 0, },
+	[BGR888]   = { 16, 8,  0,  24, 8, 8, 8, 0, },
+	[RGBA8888] = { 0,  8,  16, 24, 8, 8, 8, 8, },
+	[BGRA8888] = { 16, 8,  0,  24, 8, 8, 8, 8, },
+	[RGB565]   = { 0,  5,  11, 16, 5, 6, 5, 0, },
+	[BGR565]   = { 11, 5,  0,  16, 5, 6, 5, 0, },
+};
+
+typedef void (*pix_conv_t)(const uint8_t *src, uint8_t *dst, int n,
+		const struct fb_rgb_conv *in, const struct fb_rgb_conv *out);
+
+static inline int fb_fmt_supported(enum pix_fmt fmt) {
+	return
+		(fmt == RGB888)   || (fmt == BGR888) || (fmt == RGBA8888) ||
+		(fmt == BGRA8888) || (fmt == RGB565) || (fmt == BGR565);
+}
+
+/* Formats with 8-bit channels take 32 bits even without alpha,
+ * see pix_fmt_bpp() */
+static inline int pix_conv_bytes(const struct fb_rgb_conv *cv) {
+	return cv->dr == 8 ? 4 : 2;
+}
+
+static void pix_conv_copy(const uint8_t *src, uint8_t *dst, int n,
+		const struct fb_rgb_conv *in, const struct fb_rgb_conv *out) {
+	memcpy(dst, src, n * pix_conv_bytes(in));
+}
+
+/* 32-bit formats differ in order of red and blue and in alpha, which is
+ * kept only if both formats have it. Red and blue masks are zero if their
+ * order is the same. */
+#define PIX_CONV_32_32(px, keep, lo, hi) \
+	(((px) & (keep)) | (((px) << 16) & (hi)) | (((px) >> 16) & (lo)))
+
+static void pix_conv_32_32(const uint8_t *src, uint8_t *dst, int n,
+		const struct fb_rgb_conv *in, const struct fb_rgb_conv *out) {
+	uint32_t keep, lo, hi, px;
+
+	keep = 0x0000ff00 | ((in->da && out->da) ? 0xff000000 : 0);
+	if (in->sr == out->sr) {
+		keep |= 0x00ff00ff;
+		lo = hi = 0;
+	} else {
+		lo = 0x000000ff;
+		hi = 0x00ff0000;
+	}
+
+#ifdef FB_VEC_WORDS
+	{
+		fb_vec_t vkeep = { keep, keep, keep, keep };
+		fb_vec_t vlo = { lo, lo, lo, lo };
+		fb_vec_t vhi = { hi, hi, hi, hi };
+
+		for (; n >= FB_VEC_WORDS; n -= FB_VEC_WORDS) {
+			*(fb_vec_t *) dst = PIX_CONV_32_32(*(const fb_vec_t *) src,
+					vkeep, vlo, vhi);
+			src += sizeof(fb_vec_t);
+			dst += sizeof(fb_vec_t);
+		}
+	}
+#endif
+
+	for (; n > 0; n--) {
+		px = fb_load32(src);
+		fb_store32(dst, PIX_CONV_32_32(px, keep, lo, hi));
+		src += 4;
+		dst += 4;
+	}
+}
+
+static void pix_conv_32_16(const uint8_t *src, uint8_t *dst, int n,
+		const struct fb_rgb_conv *in, const struct fb_rgb_conv *out) {
+	uint32_t px;
+
+	for (; n > 0; n--) {
+		px = fb_load32(src);
+		fb_store16(dst,
+			((((px >> in->sr) & 0xff) >> 3) << out->sr) |
+			((((px >> in->sg) & 0xff) >> 2) << out->sg) |
+			((((px >> in->sb) & 0xff) >> 3) << out->sb));
+		src += 4;
+		dst += 2;
+	}
+}
+
+static void pix_conv_16_32(const uint8_t *src, uint8_t *dst, int n,
+		const struct fb_rgb_conv *in, const struct fb_rgb_conv *out) {
+	uint32_t px;
+
+	for (; n > 0; n--) {
+		px = fb_load16(src);
+		fb_store32(dst,
+			(((px >> in->sr) & 0x1f) << (out->sr + 3)) |
+			(((px >> in->sg) & 0x3f) << (out->sg + 2)) |
+			(((px >> in->sb) & 0x1f) << (out->sb + 3)));
+		src += 2;
+		dst += 4;
+	}
+}
+
+/* RGB565 <-> BGR565, two pixels in a word are converted at once */
+static void pix_conv_16_16(const uint8_t *src, uint8_t *dst, int n,
+		const struct fb_rgb_conv *in, const struct fb_rgb_conv *out) {
+	uint32_t px;
+
+	for (; n >= 2; n -= 2) {
+		px = fb_load32(src);
+		fb_store32(dst, (px & 0x07e007e0) | ((px & 0x001f001f) << 11)
+				| ((px >> 11) & 0x001f001f));
+		src += 4;
+		dst += 4;
+	}
+
+	if (n) {
+		px = fb_load16(src);
+		fb_store16(dst, (px & 0x07e0) | ((px & 0x001f) << 11) | (px >> 11));
+	}
+}
+
+static pix_conv_t pix_conv_select(enum pix_fmt in, enum pix_fmt out) {
+	int in_bytes, out_bytes;
+
+	if (in == out) {
+		return pix_conv_copy;
+	}
+
+	in_bytes = pix_conv_bytes(&rgb_conv[in]);
+	out_bytes = pix_conv_bytes(&rgb_conv[out]);
+
+	if (in_bytes == 4) {
+		return out_bytes == 4 ? pix_conv_32_32 : pix_conv_32_16;
+	} else {
+		return out_bytes == 4 ? pix_conv_16_32 : pix_conv_16_16;
+	}
+}
+
+int pix_fmt_convert(void *src, void *dst, int n,
+		enum pix_fmt in, enum pix_fmt out) {
+	if (!fb_fmt_supported(in) || !fb_fmt_supported(out)) {
+		return -1;
+	}
+
+	pix_conv_select(in, out)(src, dst, n, &rgb_conv[in], &rgb_conv[out]);
+
+	return 0;
+}
@@ -0,0 +1,28 @@
+/**
+ * @file
+ * @brief Row kernels of framebuffer drawing
+ *
+ * @date 18.10.2026
+ */
+
+#ifndef DRIVERS_VIDEO_FB_ACCEL_H_
+#define DRIVERS_VIDEO_FB_ACCEL_H_
+
+#include <stdint.h>
+
+/* Kernels work with pixels taking whole bytes */
+static inline int fb_accel_bpp(uint32_t bpp) {
+	return (bpp == 8) || (bpp == 16) || (bpp == 32);
+}
+
+extern void fb_row_fill(void *dst, uint32_t pixel, uint32_t n, int bpp);
+extern void fb_row_xor(void *dst, uint32_t pixel, uint32_t n, int bpp);
+
+/**
+ * @brief Draw @a n pixels of a bitmap, the most significant bit of a byte
+ *        is the leftmost pixel
+ */
+extern void fb_row_mono(void *dst, const uint8_t *bits, uint32_t n,
+		uint32_t fg, uint32_t bg, int bpp);
+
+#endif /* DRIVERS_VIDEO_FB_ACCEL_H_ */
@@ -55,7 +55,14 @@ static int fb_device_ioctl(struct idesc *desc, int request, void *data) {
 		finfo = data;
 		finfo->line_length = info->var.xres * (info->var.bits_per_pixel / 8);
 		finfo->smem_start = (uintptr_t) info->screen_base;
-		finfo->smem_len = info->screen_size;
+		/* Shadow buffer holds only the visible frame */
+		finfo->smem_len = info->shadow ? finfo->line_length * info->var.yres
+			: info->screen_size;
+		break;
+	case FBIOPAN_DISPLAY:
+		/* Mapped memory is written without tracking, so flush it all */
+		fb_damage(info, 0, 0, info->var.xres, info->var.yres);
+		fb_flush(info);
 		break;
 	default:
 		return -ENOSYS;
@@ -96,6 +103,7 @@ static ssize_t fb_id_writev(struct idesc *idesc, const struct iovec *iov, int cn
 	struct fb_info *info;
 	int i;
 	uint8_t *ptr;
+	size_t line;
 
 	devmod = idesc_to_dev_module(idesc);
 	info = devmod->dev_priv;
@@ -109,6 +117,13 @@ static ssize_t fb_id_writev(struct idesc *idesc, const struct iovec *iov, int cn
 		ptr += iov[i].iov_len;
 	}
 
+	if (info->shadow && (ptr != (uint8_t *) info->screen_base)) {
+		line = info->var.xres * info->var.bits_per_pixel / 8;
+		fb_damage(info, 0, 0, info->var.xres,
+				(ptr - (uint8_t *) info->screen_base + line - 1) / line);
+		fb_flush(info);
+	}
+
 	return (size_t) (ptr - (uint8_t *) info->screen_base);
 }
 
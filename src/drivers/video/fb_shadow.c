@@ -0,0 +1,240 @@
+/**
+ * @file
+ * @brief Shadow buffer of framebuffer with damage tracking
+ * @details Screen memory is often uncached device memory, so drawing right
+ *          there is slow, read-modify-write the most, and half drawn frames
+ *          are seen. Drawing goes to a buffer in RAM instead, and regions
+ *          damaged since the last flush are copied to the screen. If there
+ *          are two pages of the screen, the regions are copied to the hidden
+ *          one which is shown then. The hidden page also misses damage of
+ *          the previous frame, so that is copied too.
+ *
+ * @date 18.10.2026
+ */
+
+#include <errno.h>
+#include <limits.h>
+#include <string.h>
+
+#include <drivers/video/fb.h>
+#include <framework/mod/options.h>
+#include <kernel/thread/sync/mutex.h>
+#include <mem/misc/pool.h>
+#include <mem/page.h>
+#include <mem/phymem.h>
+#include <util/binalign.h>
+#include <util/math.h>
+
+#define MODOPS_FB_AMOUNT    OPTION_GET(NUMBER, fb_amount)
+#define MODOPS_DAMAGE_RECTS OPTION_GET(NUMBER, damage_rects)
+
+struct fb_rect {
+	uint32_t x, y, width, height;
+};
+
+struct fb_damage_list {
+	int cnt;
+	struct fb_rect rects[MODOPS_DAMAGE_RECTS];
+};
+
+struct fb_shadow {
+	struct mutex lock;
+	char *buf;
+	size_t buf_pages;
+	char *page[2]; /* pages of the screen, the same if they aren't flipped */
+	int back;      /* page to show on the next flush */
+	struct fb_damage_list damage;
+	struct fb_damage_list prev; /* damage the back page misses */
+};
+
+POOL_DEF(fb_shadow_pool, struct fb_shadow, MODOPS_FB_AMOUNT);
+
+static inline size_t fb_line_bytes(struct fb_info *info) {
+	return info->var.xres * info->var.bits_per_pixel / CHAR_BIT;
+}
+
+static inline size_t fb_frame_bytes(struct fb_info *info) {
+	return info->var.yres * fb_line_bytes(info);
+}
+
+/* Rects overlap or adjoin */
+static int fb_rect_touch(const struct fb_rect *a, const struct fb_rect *b) {
+	return (a->x <= b->x + b->width) && (b->x <= a->x + a->width)
+		&& (a->y <= b->y + b->height) && (b->y <= a->y + a->height);
+}
+
+static void fb_rect_union(struct fb_rect *a, const struct fb_rect *b) {
+	uint32_t x2, y2;
+
+	x2 = max(a->x + a->width, b->x + b->width);
+	y2 = max(a->y + a->height, b->y + b->height);
+	a->x = min(a->x, b->x);
+	a->y = min(a->y, b->y);
+	a->width = x2 - a->x;
+	a->height = y2 - a->y;
+}
+
+static void fb_damage_add(struct fb_damage_list *d, const struct fb_rect *r) {
+	struct fb_rect u = *r;
+	int i;
+
+	/* Merged rect may touch rects which were checked already */
+	for (i = 0; i < d->cnt; i++) {
+		if (fb_rect_touch(&d->rects[i], &u)) {
+			fb_rect_union(&u, &d->rects[i]);
+			d->rects[i] = d->rects[--d->cnt];
+			i = -1;
+		}
+	}
+
+	if (d->cnt == MODOPS_DAMAGE_RECTS) {
+		/* Too many regions, take their bounding rect */
+		for (i = 0; i < d->cnt; i++) {
+			fb_rect_union(&u, &d->rects[i]);
+		}
+		d->cnt = 0;
+	}
+
+	d->rects[d->cnt++] = u;
+}
+
+static void fb_rect_copy(struct fb_info *info, char *dst, const char *src,
+		const struct fb_rect *r) {
+	size_t line, start, len;
+	uint32_t y;
+
+	line = fb_line_bytes(info);
+	/* Whole bytes covering the rect, if pixels are smaller */
+	start = r->x * info->var.bits_per_pixel / CHAR_BIT;
+	len = ((r->x + r->width) * info->var.bits_per_pixel + CHAR_BIT - 1)
+		/ CHAR_BIT - start;
+
+	for (y = r->y; y < r->y + r->height; y++) {
+		memcpy(dst + y * line + start, src + y * line + start, len);
+	}
+}
+
+void fb_damage(struct fb_info *info, uint32_t x, uint32_t y,
+		uint32_t width, uint32_t height) {
+	struct fb_shadow *sh = info->shadow;
+	struct fb_rect r;
+
+	if ((sh == NULL) || (x >= info->var.xres) || (y >= info->var.yres)) {
+		return;
+	}
+
+	r.x = x;
+	r.y = y;
+	r.width = min(width, info->var.xres - x);
+	r.height = min(height, info->var.yres - y);
+	if ((r.width == 0) || (r.height == 0)) {
+		return;
+	}
+
+	mutex_lock(&sh->lock);
+	{
+		fb_damage_add(&sh->damage, &r);
+	}
+	mutex_unlock(&sh->lock);
+}
+
+void fb_flush(struct fb_info *info) {
+	struct fb_shadow *sh = info->shadow;
+	char *back;
+	int i;
+
+	if (sh == NULL) {
+		return;
+	}
+
+	mutex_lock(&sh->lock);
+	{
+		back = sh->page[sh->back];
+
+		for (i = 0; i < sh->damage.cnt; i++) {
+			fb_rect_copy(info, back, sh->buf, &sh->damage.rects[i]);
+		}
+
+		if (sh->page[0] != sh->page[1]) {
+			for (i = 0; i < sh->prev.cnt; i++) {
+				fb_rect_copy(info, back, sh->buf, &sh->prev.rects[i]);
+			}
+
+			info->ops.fb_set_base(info, back);
+			sh->back ^= 1;
+			sh->prev = sh->damage;
+		}
+
+		sh->damage.cnt = 0;
+	}
+	mutex_unlock(&sh->lock);
+}
+
+int fb_shadow_enable(struct fb_info *info) {
+	struct fb_shadow *sh;
+	size_t size;
+
+	if (info->shadow != NULL) {
+		return 0;
+	}
+
+	size = fb_frame_bytes(info);
+	if ((size == 0) || (size > info->screen_size)) {
+		return -EINVAL;
+	}
+
+	sh = pool_alloc(&fb_shadow_pool);
+	if (sh == NULL) {
+		return -ENOMEM;
+	}
+
+	sh->buf_pages = binalign_bound(size, PAGE_SIZE()) / PAGE_SIZE();
+	sh->buf = phymem_alloc(sh->buf_pages);
+	if (sh->buf == NULL) {
+		pool_free(&fb_shadow_pool, sh);
+		return -ENOMEM;
+	}
+
+	mutex_init(&sh->lock);
+	sh->damage.cnt = sh->prev.cnt = 0;
+
+	/* What is on the screen stays there */
+	memcpy(sh->buf, info->screen_base, size);
+
+	sh->page[0] = sh->page[1] = info->screen_base;
+	sh->back = 0;
+
+	if ((info->ops.fb_set_base != NULL) && (info->screen_size >= 2 * size)) {
+		sh->page[1] = info->screen_base + size;
+		memcpy(sh->page[1], sh->buf, size);
+
+		if (0 != info->ops.fb_set_base(info, sh->page[1])) {
+			/* Driver can't show the second page */
+			sh->page[1] = sh->page[0];
+		}
+	}
+
+	info->screen_base = sh->buf;
+	info->shadow = sh;
+
+	return 0;
+}
+
+void fb_shadow_disable(struct fb_info *info) {
+	struct fb_shadow *sh = info->shadow;
+
+	if (sh == NULL) {
+		return;
+	}
+
+	info->screen_base = sh->page[0];
+	info->shadow = NULL;
+
+	memcpy(sh->page[0], sh->buf, fb_frame_bytes(info));
+	if (sh->page[0] != sh->page[1]) {
+		info->ops.fb_set_base(info, sh->page[0]);
+	}
+
+	phymem_free(sh->buf, sh->buf_pages);
+	pool_free(&fb_shadow_pool, sh);
+}
@@ -38,6 +38,12 @@
 											the device */
 #define VIRTIO_CONFIG_S_FAILED      0x80 /* Something went wront */
 
+/**
+ * VirtIO Reserved Feature Bits
+ */
+#define VIRTIO_RING_F_EVENT_IDX 0x20000000 /* Used and avail event indexes
+											  suppress notifications */
+
 /**
  * VirtIO Ring Alignment
  */
@@ -40,6 +40,8 @@ int virtqueue_create(struct virtqueue *vq, uint16_t q_id,
 	vring_init(&vq->ring, queue_sz, ring_mem);
 	vq->ring_mem = ring_mem;
 	vq->last_seen_used = vq->next_free_desc = 0;
+	vq->notified_avail = 0;
+	vq->event_idx = 0;
 
 	virtio_set_queue_addr(ring_mem, base_addr);
 
@@ -71,3 +73,27 @@ struct vring_desc * virtqueue_alloc_desc(struct virtqueue *vq) {
 
 	return vrd;
 }
+
+int virtqueue_notify_needed(struct virtqueue *vq) {
+	uint16_t old_idx, new_idx;
+
+	assert(vq != NULL);
+
+	/* The avail index store must reach the device before its flags
+	 * are read, a compiler barrier doesn't order the CPU */
+	__sync_synchronize();
+
+	old_idx = vq->notified_avail;
+	new_idx = vq->ring.avail->idx;
+	if (old_idx == new_idx) {
+		return 0;
+	}
+	vq->notified_avail = new_idx;
+
+	if (vq->event_idx) {
+		return vring_need_event(vring_avail_event(&vq->ring),
+				new_idx, old_idx);
+	}
+
+	return !(vq->ring.used->flags & VRING_USED_F_NO_NOTIFY);
+}
@@ -25,6 +25,8 @@ struct virtqueue {
 	void *ring_mem;          /* Allocated data for ring storage */
 	uint16_t last_seen_used; /* Last seen used id */
 	uint16_t next_free_desc; /* Next free descriptor id */
+	uint16_t notified_avail; /* Available index at the last notification */
+	int event_idx;           /* VIRTIO_RING_F_EVENT_IDX is negotiated */
 };
 
 extern int virtqueue_create(struct virtqueue *vq, uint16_t q_id,
@@ -33,4 +35,11 @@ extern void virtqueue_destroy(struct virtqueue *vq,
 		unsigned long base_addr);
 extern struct vring_desc * virtqueue_alloc_desc(struct virtqueue *vq);
 
+/**
+ * Check if the device has to be notified about descriptors added to the
+ * available ring since the last call. Device may ask not to be notified,
+ * so a batch of descriptors costs a single notification at most.
+ */
+extern int virtqueue_notify_needed(struct virtqueue *vq);
+
 #endif /* DRIVERS_VIRTIO_VIRTIO_QUEUE_H_ */
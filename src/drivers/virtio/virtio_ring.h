@@ -57,7 +57,8 @@ struct vring_used {
 	uint16_t idx;                  /* Next ring id */
 	struct vring_used_elem ring[]; /* Rings */
 	/* uint16_t avail_event;       -- placed at ring[-1].id */
-#define vring_avail_event(vr) ((vr)->used->ring[(vr)->num].id)
+#define vring_avail_event(vr) \
+	(*(volatile uint16_t *)&(vr)->used->ring[(vr)->num])
 };
 
 /**
@@ -73,6 +74,15 @@ struct vring {
 								  free-running index */
 };
 
+/**
+ * Check if the other side asked for notification when the index passes
+ * @a event_idx and the index was moved from @a old_idx to @a new_idx
+ */
+static inline int vring_need_event(uint16_t event_idx, uint16_t new_idx,
+		uint16_t old_idx) {
+	return (uint16_t)(new_idx - event_idx - 1) < (uint16_t)(new_idx - old_idx);
+}
+
 extern size_t vring_size(uint16_t num);
 extern void vring_init(struct vring *vr, uint16_t num, void *mem);
 extern void vring_push_desc(uint16_t id, struct vring *vr);
@@ -1,20 +1,38 @@
 /**
  * @file
  * @brief Buffer cache
+ * @details Buffers are kept in LRU order, so when the pool is exhausted only
+ *   a few least recently used buffers are evicted. Modified buffers are either
+ *   written through or, if @a writeback_period option is set, flushed by
+ *   writeback thread in runs of adjacent blocks. Evicted dirty buffers are
+ *   written in runs too, and are kept if the write fails.
+ *   For devices with request queue each buffer is a separate request, which
+ *   are merged by the queue, and all runs of a flush are in flight together.
+ *   Large transfers may bypass buffers, cached copies of their blocks are
+ *   kept coherent with the disk, and no buffers are created for their blocks
+ *   until the transfer ends.
  *
  * @author  Alexander Kalmuk
  * @date    22.07.2013
  */
 
+#include <errno.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 
-#include <util/hashtable.h>
+#include <util/array.h>
+#include <util/err.h>
+#include <util/ohashtable.h>
+#include <util/math.h>
 
 #include <mem/misc/pool.h>
 #include <mem/sysmalloc.h>
 
+#include <kernel/thread.h>
+#include <kernel/thread/waitq.h>
+
 #include <fs/bcache.h>
 
 #include <embox/unit.h>
@@ -22,39 +40,126 @@ EMBOX_UNIT_INIT(bcache_init);
 
 #define BCACHE_SIZE   OPTION_GET(NUMBER, bcache_size)
 #define BCACHE_ALIGN  OPTION_GET(NUMBER, bcache_align)
+#define BCACHE_EVICT_BATCH  OPTION_GET(NUMBER, evict_batch)
+#define BCACHE_WB_PERIOD    OPTION_GET(NUMBER, writeback_period)
+#define BCACHE_WB_THRESHOLD OPTION_GET(NUMBER, writeback_threshold)
+#define BCACHE_IO_RUN_MAX   OPTION_GET(NUMBER, io_run_max)
 
 POOL_DEF(buffer_head_pool, struct buffer_head, BCACHE_SIZE);
+/* All buffers, least recently used first */
 static DLIST_DEFINE(bh_list);
 
 
-static size_t bh_hash(void *key);
+struct bcache_key {
+	struct block_dev *bdev;
+	int block;
+};
+
+/* Initial slots of buffers table, it grows if it becomes 3/4 full */
+#define BCACHE_HT_SIZE 256
+
+static size_t bcache_key_hash(const void *key);
 static int bh_cmp(void *key1, void *key2);
-HASHTABLE_DEF(bcache_ht, BCACHE_SIZE / 10, bh_hash, bh_cmp);
-POOL_DEF(bcach_ht_item_pool, struct hashtable_item, BCACHE_SIZE);
+OHASHTABLE_DEF(bcache_ht, BCACHE_HT_SIZE, struct bcache_key, bcache_key_hash);
 
-static struct hashtable *bcache = &bcache_ht;
+static struct ohashtable *bcache = &bcache_ht;
 static struct mutex bcache_mutex;
-static int graw_buffers(struct block_dev *bdev, int block, size_t size);
+static struct mutex bcache_flush_mutex; /* serializes users of flush array */
+static struct buffer_head *graw_buffers(struct block_dev *bdev, int block, size_t size);
 static void free_more_memory(size_t size);
 
+/* Blocks under direct I/O */
+struct bcache_direct_range {
+	struct dlist_head lnk;
+	struct block_dev *bdev;
+	int block;
+	int cnt;
+};
+static DLIST_DEFINE(bcache_direct_list);
+static struct waitq bcache_direct_waitq;
+static unsigned int bcache_direct_ended; /* direct transfers ended so far */
+
+#if BCACHE_WB_PERIOD
+static struct waitq bcache_wb_waitq;
+static int bcache_wb_dirtied; /* buffers dirtied since the last flush */
+#endif
+
+/**
+ * Lock buffer @a bh found in the cache with bcache_mutex held. Holder of
+ * the buffer may need the cache, so the mutex is released while waiting
+ * and the buffer is pinned to be not evicted meanwhile.
+ */
+static void bcache_buffer_lock_pinned(struct buffer_head *bh) {
+	if (0 == mutex_trylock(&bh->mutex)) {
+		bh->lock_count++;
+		return;
+	}
+
+	bh->pin_count++;
+	mutex_unlock(&bcache_mutex);
+
+	bcache_buffer_lock(bh);
+
+	mutex_lock(&bcache_mutex);
+	bh->pin_count--;
+}
+
+/* Whether a buffer for @a block would miss direct I/O going on */
+static int bcache_direct_busy(struct block_dev *bdev, int block) {
+	struct bcache_direct_range *range;
+
+	dlist_foreach_entry(range, &bcache_direct_list, lnk) {
+		if ((range->bdev == bdev) && (range->block <= block)
+				&& (block < range->block + range->cnt)) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+static inline void bcache_key_init(struct bcache_key *key,
+		struct block_dev *bdev, int block) {
+	/* Keys are compared bytewise, padding must be zeroed */
+	memset(key, 0, sizeof(*key));
+	key->bdev = bdev;
+	key->block = block;
+}
+
 struct buffer_head *bcache_getblk_locked(struct block_dev *bdev, int block, size_t size) {
-	struct buffer_head key = { .bdev = bdev, .block = block };
+	struct bcache_key key;
 	struct buffer_head *bh;
+	unsigned int ended;
 
 	assert(bdev);
 
+	bcache_key_init(&key, bdev, block);
+
 	mutex_lock(&bcache_mutex);
 	while (1) {
-		bh = (struct buffer_head *)hashtable_get(bcache, &key);
+		bh = ohashtable_get(bcache, &key);
 
 		if (bh) {
 			assert(size == bh->blocksize);
-			bcache_buffer_lock(bh);
+			/* Move to the most recently used end */
+			dlist_del(&bh->bh_next);
+			dlist_add_prev(&bh->bh_next, &bh_list);
+
+			bcache_buffer_lock_pinned(bh);
 			mutex_unlock(&bcache_mutex);
 			return bh;
 		}
 
-		while (-1 == graw_buffers(bdev, block, size)) {
+		if (bcache_direct_busy(bdev, block)) {
+			/* Wait for a transfer to end and look again */
+			ended = bcache_direct_ended;
+			mutex_unlock(&bcache_mutex);
+			WAITQ_WAIT(&bcache_direct_waitq, bcache_direct_ended != ended);
+			mutex_lock(&bcache_mutex);
+			continue;
+		}
+
+		while (NULL == graw_buffers(bdev, block, size)) {
 			free_more_memory(size);
 		}
 	}
@@ -64,49 +169,476 @@ struct buffer_head *bcache_getblk_locked(struct block_dev *bdev, int block, size
 	return NULL;
 }
 
-static void free_more_memory(size_t size) {
+static int bcache_run_cmp(const void *a, const void *b) {
+	return bh_cmp(*(struct buffer_head **)a, *(struct buffer_head **)b);
+}
+
+/**
+ * Do a single device request for locked buffers @a bhs which are adjacent
+ * blocks of the same device. Data is passed through a bounce buffer if there
+ * are several blocks.
+ */
+static int bcache_io_run_sync(struct buffer_head **bhs, int cnt, int write) {
+	struct block_dev *bdev;
+	size_t size;
+	char *buf;
+	int i, res;
+
+	assert(cnt > 0);
+
+	bdev = bhs[0]->bdev;
+	size = bhs[0]->blocksize;
+
+	assert(bdev && bdev->driver);
+	assert(write ? bdev->driver->write != NULL : bdev->driver->read != NULL);
+
+	if (cnt == 1) {
+		buf = bhs[0]->data;
+	}
+	else if (NULL == (buf = sysmemalign(BCACHE_ALIGN, cnt * size))) {
+		/* No memory for the bounce buffer, so go block by block */
+		for (i = 0; i < cnt; i++) {
+			if (0 != (res = bcache_io_run_sync(&bhs[i], 1, write))) {
+				return res;
+			}
+		}
+		return 0;
+	}
+
+	if (write) {
+		for (i = 0; i < cnt; i++) {
+			buffer_encrypt(bhs[i]);
+			if (cnt > 1) {
+				memcpy(buf + i * size, bhs[i]->data, size);
+				buffer_decrypt(bhs[i]);
+			}
+		}
+		res = bdev->driver->write(bdev, buf, cnt * size, bhs[0]->block);
+		if (cnt == 1) {
+			buffer_decrypt(bhs[0]);
+		}
+	}
+	else {
+		res = bdev->driver->read(bdev, buf, cnt * size, bhs[0]->block);
+		if (res == cnt * size) {
+			for (i = 0; i < cnt; i++) {
+				if (cnt > 1) {
+					memcpy(bhs[i]->data, buf + i * size, size);
+				}
+				if (0 != buffer_decrypt(bhs[i])) {
+					res = -EIO;
+				}
+			}
+		}
+	}
+
+	if (cnt > 1) {
+		sysfree(buf);
+	}
+
+	if (res != cnt * size) {
+		return res < 0 ? res : -EIO;
+	}
+
+	for (i = 0; i < cnt; i++) {
+		buffer_clear_flag(bhs[i], BH_DIRTY);
+		buffer_clear_flag(bhs[i], BH_NEW);
+	}
+
+	return 0;
+}
+
+/**
+ * Start I/O of locked buffers @a bhs which are adjacent blocks of the same
+ * device. Device with request queue gets a request per buffer, they are
+ * merged by the queue, so no bounce buffer is needed. Otherwise I/O is done
+ * at once.
+ */
+static int bcache_io_start(struct buffer_head **bhs, int cnt, int write) {
 	struct buffer_head *bh;
-	struct hashtable_item *ht_item;
+	int i;
 
-	/* Free everything that we can free */
-	dlist_foreach_entry(bh, &bh_list, bh_next) {
-		if (buffer_locked(bh)) {
+	assert(cnt > 0);
+
+	if (!block_req_is_async(bhs[0]->bdev)) {
+		return bcache_io_run_sync(bhs, cnt, write);
+	}
+
+	block_req_plug(bhs[0]->bdev);
+	for (i = 0; i < cnt; i++) {
+		bh = bhs[i];
+		if (write) {
+			buffer_encrypt(bh);
+		}
+		block_req_init(&bh->req, bh->bdev, write, bh->block,
+				bh->data, bh->blocksize);
+		block_req_submit(&bh->req);
+	}
+	block_req_unplug(bhs[0]->bdev);
+
+	return 0;
+}
+
+/**
+ * Wait for I/O started by bcache_io_start()
+ */
+static int bcache_io_end(struct buffer_head **bhs, int cnt, int write) {
+	struct buffer_head *bh;
+	int i, res, err;
+
+	if (!block_req_is_async(bhs[0]->bdev)) {
+		return 0;
+	}
+
+	err = 0;
+	for (i = 0; i < cnt; i++) {
+		bh = bhs[i];
+		res = block_req_wait(&bh->req);
+
+		if ((0 != buffer_decrypt(bh)) && !write) {
+			res = -EIO;
+		}
+		if (res != 0) {
+			err = res;
 			continue;
 		}
 
+		buffer_clear_flag(bh, BH_DIRTY);
+		buffer_clear_flag(bh, BH_NEW);
+	}
+
+	return err;
+}
+
+static int bcache_io_run(struct buffer_head **bhs, int cnt, int write) {
+	int res;
+
+	res = bcache_io_start(bhs, cnt, write);
+	if (res != 0) {
+		return res;
+	}
+
+	return bcache_io_end(bhs, cnt, write);
+}
+
+int bcache_buffer_read(struct buffer_head *bh, int count) {
+	struct buffer_head *run[BCACHE_IO_RUN_MAX];
+	struct bcache_key key;
+	int blocks_total, cnt, res, i;
+
+	assert(bh && buffer_locked(bh));
+
+	blocks_total = block_dev_size(bh->bdev) / bh->blocksize;
+	count = min(count, BCACHE_IO_RUN_MAX);
+	count = min(count, blocks_total - bh->block);
+
+	run[0] = bh;
+	cnt = 1;
+
+	/* Take following blocks which aren't cached yet. Nothing is evicted
+	 * for them, readahead just stops when the pool is empty */
+	mutex_lock(&bcache_mutex);
+	for (; cnt < count; cnt++) {
+		bcache_key_init(&key, bh->bdev, bh->block + cnt);
+		if (ohashtable_get(bcache, &key)
+				|| bcache_direct_busy(bh->bdev, key.block)
+				|| (NULL == (run[cnt] = graw_buffers(bh->bdev,
+						key.block, bh->blocksize)))) {
+			break;
+		}
+		bcache_buffer_lock(run[cnt]);
+	}
+	mutex_unlock(&bcache_mutex);
+
+	res = bcache_io_run(run, cnt, 0);
+
+	for (i = 1; i < cnt; i++) {
+		bcache_buffer_unlock(run[i]);
+	}
+
+	return res;
+}
+
+int bcache_buffer_write(struct buffer_head *bh) {
+	assert(bh && buffer_locked(bh));
+
+	buffer_clear_flag(bh, BH_NEW);
+
+#if BCACHE_WB_PERIOD
+	if (!buffer_dirty(bh)) {
+		buffer_set_flag(bh, BH_DIRTY);
+		if (++bcache_wb_dirtied == BCACHE_WB_THRESHOLD) {
+			waitq_wakeup_all(&bcache_wb_waitq);
+		}
+	}
+	return 0;
+#else
+	return bcache_io_run(&bh, 1, 1);
+#endif
+}
+
+int bcache_direct_io(struct block_dev *bdev, char *buf, int block, int cnt,
+		size_t blksize, int write) {
+	struct buffer_head *cached[BCACHE_IO_RUN_MAX];
+	struct bcache_direct_range range;
+	struct buffer_head *bh;
+	struct bcache_key key;
+	int i, n, res, started;
+
+	assert(bdev);
+
+	if ((uintptr_t) buf % BCACHE_ALIGN) {
+		return -EAGAIN;
+	}
+
+	/* Cached blocks are locked for the transfer, so they are neither
+	 * written back nor read meanwhile. Buffers of other blocks aren't
+	 * created until it ends, they would miss the transfer */
+	n = 0;
+	mutex_lock(&bcache_mutex);
+	for (i = 0; i < cnt; i++) {
+		bcache_key_init(&key, bdev, block + i);
+		if (NULL == (bh = ohashtable_get(bcache, &key))) {
+			continue;
+		}
+		if (buffer_locked(bh) || bh->pin_count || buffer_journal(bh)
+				|| (bh->blocksize != blksize) || (n == ARRAY_SIZE(cached))) {
+			break;
+		}
 		bcache_buffer_lock(bh);
-		{
-			if (buffer_journal(bh)) {
-				bcache_buffer_unlock(bh);
-				continue;
+		cached[n++] = bh;
+	}
+	started = (i == cnt);
+	if (started) {
+		range.bdev = bdev;
+		range.block = block;
+		range.cnt = cnt;
+		dlist_head_init(&range.lnk);
+		dlist_add_prev(&range.lnk, &bcache_direct_list);
+	}
+	mutex_unlock(&bcache_mutex);
+
+	res = -EAGAIN;
+	if (started) {
+		res = block_req_rw(bdev, write, buf, cnt * blksize, block);
+		res = res < 0 ? res : 0;
+	}
+
+	for (i = 0; i < n; i++) {
+		bh = cached[i];
+
+		if (res == 0) {
+			if (write) {
+				memcpy(bh->data, buf + (bh->block - block) * blksize, blksize);
+				buffer_clear_flag(bh, BH_DIRTY);
+				buffer_clear_flag(bh, BH_NEW);
+			} else if (!buffer_new(bh)) {
+				/* Cached copy is never older than the disk */
+				memcpy(buf + (bh->block - block) * blksize, bh->data, blksize);
 			}
+		}
+
+		bcache_buffer_unlock(bh);
+	}
+
+	if (started) {
+		mutex_lock(&bcache_mutex);
+		{
+			dlist_del(&range.lnk);
+			bcache_direct_ended++;
+		}
+		mutex_unlock(&bcache_mutex);
+
+		waitq_wakeup_all(&bcache_direct_waitq);
+	}
+
+	return res;
+}
+
+/* Amount of adjacent blocks at the start of sorted @a bhs */
+static int bcache_run_len(struct buffer_head **bhs, int cnt) {
+	int run;
+
+	for (run = 1; (run < cnt) && (run < BCACHE_IO_RUN_MAX); run++) {
+		if ((bhs[run]->bdev != bhs[0]->bdev)
+				|| (bhs[run]->block != bhs[0]->block + run)
+				|| (bhs[run]->blocksize != bhs[0]->blocksize)) {
+			break;
+		}
+	}
 
-			if (buffer_dirty(bh)) {
-				assert(bh->bdev && bh->bdev->driver);
-				assert(bh->bdev->driver->write);
-				/* Write directly to disk */
-				bh->bdev->driver->write(bh->bdev, bh->data, bh->blocksize, bh->block);
+	return run;
+}
+
+/**
+ * Write sorted locked buffers @a bhs in runs of adjacent blocks. Runs of
+ * devices with request queue are written concurrently, all of them are
+ * started before waiting for the first one.
+ *
+ * @return 0 on success, negative error code of the last failed run otherwise
+ */
+static int bcache_write_runs(struct buffer_head **bhs, int cnt) {
+	int i, run, res, err;
+
+	err = 0;
+	for (i = 0; i < cnt; i += run) {
+		run = bcache_run_len(&bhs[i], cnt - i);
+
+		res = bcache_io_start(&bhs[i], run, 1);
+		if (res != 0) {
+			err = res;
+		}
+	}
+
+	for (i = 0; i < cnt; i += run) {
+		run = bcache_run_len(&bhs[i], cnt - i);
+
+		res = bcache_io_end(&bhs[i], run, 1);
+		if (res != 0) {
+			err = res;
+		}
+	}
+
+	return err;
+}
+
+/**
+ * Write dirty buffers of @a bdev (of all devices if NULL). Buffers locked
+ * by other threads are skipped, or waited for and written if @a wait is set.
+ */
+static int bcache_flush_buffers(struct block_dev *bdev, int wait) {
+	static struct buffer_head *dirty[BCACHE_SIZE];
+	struct buffer_head *bh, *busy;
+	int cnt, i, res, err;
+
+	mutex_lock(&bcache_flush_mutex);
+
+	err = 0;
+	do {
+		/* Collect and lock dirty buffers, then do I/O without holding
+		 * the cache itself */
+		cnt = 0;
+		busy = NULL;
+		mutex_lock(&bcache_mutex);
+		{
+			dlist_foreach_entry(bh, &bh_list, bh_next) {
+				if (!buffer_dirty(bh) || buffer_journal(bh)
+						|| ((bdev != NULL) && (bh->bdev != bdev))) {
+					continue;
+				}
+				/* Buffer may be held by the caller itself */
+				if (0 != mutex_trylock(&bh->mutex)) {
+					if (wait && (busy == NULL)) {
+						busy = bh;
+						busy->pin_count++;
+					}
+					continue;
+				}
+				bh->lock_count++;
+				dirty[cnt++] = bh;
 			}
+#if BCACHE_WB_PERIOD
+			bcache_wb_dirtied = 0;
+#endif
+		}
+		mutex_unlock(&bcache_mutex);
+
+		qsort(dirty, cnt, sizeof(dirty[0]), bcache_run_cmp);
+
+		res = bcache_write_runs(dirty, cnt);
+		if (res != 0) {
+			err = res;
+		}
+
+		for (i = 0; i < cnt; i++) {
+			bcache_buffer_unlock(dirty[i]);
+		}
+
+		if (busy != NULL) {
+			/* Wait for the holder, the buffer is written by the next pass */
+			bcache_buffer_lock(busy);
+			bcache_buffer_unlock(busy);
 
+			mutex_lock(&bcache_mutex);
+			busy->pin_count--;
+			mutex_unlock(&bcache_mutex);
+		}
+	} while (busy != NULL);
+
+	mutex_unlock(&bcache_flush_mutex);
+
+	return err;
+}
+
+int bcache_flush(struct block_dev *bdev) {
+	return bcache_flush_buffers(bdev, 1);
+}
+
+static void free_more_memory(size_t size) {
+	struct buffer_head *victims[BCACHE_EVICT_BATCH];
+	struct buffer_head *dirty[BCACHE_EVICT_BATCH];
+	struct buffer_head *bh;
+	struct bcache_key key;
+	int cnt, dirty_cnt, i;
+
+	/* Evict a few least recently used buffers instead of the whole cache */
+	cnt = dirty_cnt = 0;
+	dlist_foreach_entry(bh, &bh_list, bh_next) {
+		if (cnt == BCACHE_EVICT_BATCH) {
+			break;
+		}
+
+		if (buffer_locked(bh) || bh->pin_count) {
+			continue;
+		}
+
+		bcache_buffer_lock(bh);
+		if (buffer_journal(bh)) {
+			bcache_buffer_unlock(bh);
+			continue;
+		}
+
+		victims[cnt++] = bh;
+		if (buffer_dirty(bh)) {
+			dirty[dirty_cnt++] = bh;
+		}
+	}
+
+	/* Write directly to disk */
+	qsort(dirty, dirty_cnt, sizeof(dirty[0]), bcache_run_cmp);
+	bcache_write_runs(dirty, dirty_cnt);
+
+	for (i = 0; i < cnt; i++) {
+		bh = victims[i];
+
+		if (buffer_dirty(bh)) {
+			/* Write failed, so the buffer is the only copy of data. It goes
+			 * to the most recently used end for other buffers to be tried
+			 * first next time */
 			dlist_del(&bh->bh_next);
-			ht_item = hashtable_del(bcache, bh);
+			dlist_add_prev(&bh->bh_next, &bh_list);
+			bcache_buffer_unlock(bh);
+			continue;
 		}
+
+		dlist_del(&bh->bh_next);
+		bcache_key_init(&key, bh->bdev, bh->block);
+		ohashtable_del(bcache, &key);
 		bcache_buffer_unlock(bh);
 
 		sysfree(bh->data);
-		pool_free(&bcach_ht_item_pool, ht_item);
 		pool_free(&buffer_head_pool, bh);
 	}
 }
 
-static int graw_buffers(struct block_dev *bdev, int block, size_t size) {
+static struct buffer_head *graw_buffers(struct block_dev *bdev, int block, size_t size) {
 	struct buffer_head *bh;
-	struct hashtable_item *ht_item;
+	struct bcache_key key;
 
 	bh = pool_alloc(&buffer_head_pool);
 
 	if (!bh) {
-		return -1;
+		return NULL;
 	}
 
 	memset(bh, 0, sizeof(struct buffer_head));
@@ -121,24 +653,25 @@ static int graw_buffers(struct block_dev *bdev, int block, size_t size) {
 
 	if (!bh->data) {
 		pool_free(&buffer_head_pool, bh);
-		return -1;
+		return NULL;
 	}
-	ht_item = pool_alloc(&bcach_ht_item_pool);
-	if (!ht_item) {
+
+	bcache_key_init(&key, bdev, block);
+	if (0 != ohashtable_put(bcache, &key, bh)) {
 		sysfree(bh->data);
 		pool_free(&buffer_head_pool, bh);
-		return -1;
+		return NULL;
 	}
-	ht_item = hashtable_item_init(ht_item, bh, bh);
-	hashtable_put(bcache, ht_item);
 
-	dlist_add_next(&bh->bh_next, &bh_list);
+	dlist_add_prev(&bh->bh_next, &bh_list);
 
-	return 0;
+	return bh;
 }
 
-static size_t bh_hash(void *key) {
-	return ((struct buffer_head *)key)->block;
+static size_t bcache_key_hash(const void *key) {
+	const struct bcache_key *bkey = key;
+
+	return (size_t)bkey->block ^ ((uintptr_t)bkey->bdev >> 4);
 }
 
 static int bh_cmp(void *key1, void *key2) {
@@ -154,9 +687,31 @@ static int bh_cmp(void *key1, void *key2) {
 	return cmp_bdev;
 }
 
+#if BCACHE_WB_PERIOD
+static void *bcache_writeback(void *arg) {
+	while (1) {
+		WAITQ_WAIT_TIMEOUT(&bcache_wb_waitq,
+				bcache_wb_dirtied >= BCACHE_WB_THRESHOLD, BCACHE_WB_PERIOD);
+		bcache_flush_buffers(NULL, 0);
+	}
+
+	return NULL;
+}
+#endif
+
 static int bcache_init(void) {
 
 	mutex_init(&bcache_mutex);
+	mutex_init(&bcache_flush_mutex);
+	waitq_init(&bcache_direct_waitq);
+
+#if BCACHE_WB_PERIOD
+	waitq_init(&bcache_wb_waitq);
+	if (err(thread_create(THREAD_FLAG_DETACHED | THREAD_FLAG_NOTASK,
+			bcache_writeback, NULL))) {
+		return -ENOMEM;
+	}
+#endif
 
 	return 0;
 }
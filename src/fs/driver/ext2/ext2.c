@@ -117,6 +117,8 @@
 
 static int ext2_read_inode(struct nas *nas, uint32_t);
 static int ext2_block_map(struct nas *nas, int32_t, uint32_t *);
+static int ext2_block_run(struct nas *nas, int32_t, int, uint32_t *, int *);
+static int ext2_read_run(struct nas *nas, char *buf, size_t size);
 static int ext2_buf_read_file(struct nas *nas, char **, size_t *);
 static size_t ext2_write_file(struct nas *nas, char *buf_p, size_t size);
 static int ext2_new_block(struct nas *nas, long position);
@@ -489,17 +491,26 @@ static size_t ext2fs_read(struct file_desc *desc, void *buff, size_t size) {
 			break;
 		}
 
-		if (0 != (rc = ext2_buf_read_file(nas, &buf, &buf_size))) {
-			SET_ERRNO(rc);
+		/* Whole blocks go right to the user buffer */
+		if (0 > (rc = ext2_read_run(nas, addr, size))) {
+			SET_ERRNO(-rc);
 			return 0;
 		}
+		csize = rc;
 
-		csize = size;
-		if (csize > buf_size) {
-			csize = buf_size;
-		}
+		if (csize == 0) {
+			if (0 != (rc = ext2_buf_read_file(nas, &buf, &buf_size))) {
+				SET_ERRNO(rc);
+				return 0;
+			}
 
-		memcpy(addr, buf, csize);
+			csize = size;
+			if (csize > buf_size) {
+				csize = buf_size;
+			}
+
+			memcpy(addr, buf, csize);
+		}
 
 		fi->f_pointer += csize;
 		addr += csize;
@@ -1054,6 +1065,86 @@ static int ext2_block_map(struct nas *nas, int32_t file_block,
 	return 0;
 }
 
+/*
+ * Map up to @a max file blocks from @a file_block while they follow each
+ * other on disk. Amount of them is returned in @a cnt_p, it's 0 if the first
+ * block is not allocated.
+ */
+static int ext2_block_run(struct nas *nas, int32_t file_block, int max,
+		uint32_t *disk_block_p, int *cnt_p) {
+	int rc, cnt;
+	uint32_t disk_block;
+	struct ext2_file_info *fi;
+
+	fi = inode_priv(nas->node);
+
+	cnt = 0;
+	if (0 != (rc = ext2_block_map(nas, file_block, disk_block_p))) {
+		goto out;
+	}
+
+	if (*disk_block_p != 0) {
+		for (cnt = 1; cnt < max; cnt++) {
+			if (0 != (rc = ext2_block_map(nas, file_block + cnt, &disk_block))) {
+				goto out;
+			}
+			if (disk_block != *disk_block_p + cnt) {
+				break;
+			}
+		}
+	}
+
+out:
+	/* Indirect blocks are read through the internal buffer */
+	fi->f_buf_blkno = -1;
+	*cnt_p = cnt;
+	return rc;
+}
+
+/*
+ * Read whole blocks of a file which follow each other on disk right to
+ * @a buf in one request. Return amount of bytes read, 0 if the file pointer
+ * is not at the start of such blocks, or negative error code.
+ */
+static int ext2_read_run(struct nas *nas, char *buf, size_t size) {
+	int rc, cnt;
+	uint32_t disk_block;
+	size_t block_size;
+	struct ext2_file_info *fi;
+	struct ext2_fs_info *fsi;
+
+	fi = inode_priv(nas->node);
+	fsi = nas->fs->sb_data;
+	block_size = fsi->s_block_size; /* no fragment */
+
+	if (0 != blkoff(fsi, fi->f_pointer)) {
+		return 0;
+	}
+
+	/* XXX should handle LARGEFILE */
+	if (size > fi->f_di.i_size - fi->f_pointer) {
+		size = fi->f_di.i_size - fi->f_pointer;
+	}
+	if (size < block_size) {
+		return 0;
+	}
+
+	if (0 != (rc = ext2_block_run(nas, lblkno(fsi, fi->f_pointer),
+					size / block_size, &disk_block, &cnt))) {
+		return -rc;
+	}
+	if (cnt == 0) {
+		/* Hole is read through the internal buffer */
+		return 0;
+	}
+
+	if (cnt != ext2_read_sector(nas->fs, buf, cnt, disk_block)) {
+		return -EIO;
+	}
+
+	return cnt * block_size;
+}
+
 /*
  * Read a portion of a file into an internal buffer.
  * Return the location in the buffer and the amount in the buffer.
@@ -1118,6 +1209,7 @@ static size_t ext2_write_file(struct nas *nas, char *buf, size_t size) {
 	char *buff;
 	size_t block_size, len, cnt;
 	size_t bytecount, end_pointer;
+	int run;
 	struct ext2fs_dinode fdi;
 	struct ext2_file_info *fi;
 	struct ext2_fs_info *fsi;
@@ -1147,11 +1239,36 @@ static size_t ext2_write_file(struct nas *nas, char *buf, size_t size) {
 			return bytecount;
 		}
 
-		fi->f_buf_blkno = file_block;
-
 		/* calculate f_pointer in scratch buffer */
 		inblock_off = blkoff(fsi, fi->f_pointer);
 
+		/* Whole blocks which follow each other on disk are written right
+		 * from the user buffer at once */
+		if ((0 == inblock_off) && (end_pointer - fi->f_pointer >= block_size)) {
+			if (0 != ext2_block_run(nas, file_block,
+						(end_pointer - fi->f_pointer) / block_size,
+						&disk_block, &run)) {
+				bytecount = 0;
+				break;
+			}
+
+			if (run != ext2_write_sector(nas->fs, buff, run, disk_block)) {
+				bytecount = 0;
+				break;
+			}
+
+			cnt = run * block_size;
+			bytecount += cnt;
+			buff += cnt;
+			fi->f_pointer += cnt;
+			if (end_pointer <= fi->f_pointer) {
+				break;
+			}
+			continue;
+		}
+
+		fi->f_buf_blkno = file_block;
+
 		/* set the counter how many bytes written in block */
 		/* more than block */
 		if (end_pointer - fi->f_pointer > block_size) {
@@ -233,10 +233,41 @@ struct volinfo {
  */
 #define DFS_DI_BLANKENT		0x01	/* Searching for blank entry */
 
+#include <framework/mod/options.h>
+#define FAT_MAX_SECTOR_SIZE OPTION_MODULE_GET(embox__fs__driver__fat, NUMBER, fat_max_sector_size)
+#define FAT_FAT_CACHE_SIZE  OPTION_MODULE_GET(embox__fs__driver__fat, NUMBER, fat_cache_sectors)
+#define FAT_EXTENT_CNT      OPTION_MODULE_GET(embox__fs__driver__fat, NUMBER, extent_cache_size)
+
+/*
+ *	Sector of the first FAT kept in memory. Changes are written through to
+ *	both FAT copies.
+ */
+struct fat_fat_sector {
+	uint32_t sector;			/* 0 if unused */
+	uint32_t stamp;				/* time of last access, LRU is replaced */
+	uint8_t data[FAT_MAX_SECTOR_SIZE];
+};
+
+/*
+ *	Clusters [dclus, dclus + len) on disk are clusters [fclus, fclus + len)
+ *	of a file
+ */
+struct fat_extent {
+	uint32_t fclus;
+	uint32_t dclus;
+	uint32_t len;
+};
+
 struct fat_fs_info {
 	struct volinfo vi;
 	struct block_dev *bdev;
 	struct inode *root;
+
+	struct fat_fat_sector fat_cache[FAT_FAT_CACHE_SIZE];
+	uint32_t fat_cache_stamp;
+
+	unsigned long *free_map;	/* bit is set for used cluster, built on first allocation */
+	uint32_t free_hint;			/* search for free cluster starts here */
 };
 
 struct fat_file_info {
@@ -251,6 +282,12 @@ struct fat_file_info {
 
 	uint32_t pointer;
 	uint32_t cluster;			/* current cluster */
+	uint32_t cluster_idx;		/* number of current cluster in the file */
+
+	/* Runs of contiguous clusters from the start of the file which are
+	 * already known, so seek doesn't follow the chain in FAT */
+	struct fat_extent extents[FAT_EXTENT_CNT];
+	int extent_cnt;
 };
 
 /*
@@ -265,9 +302,6 @@ struct dirinfo {
 	uint8_t flags;				/* internal DOSFS flags */
 };
 
-#include <framework/mod/options.h>
-#define FAT_MAX_SECTOR_SIZE OPTION_MODULE_GET(embox__fs__driver__fat, NUMBER, fat_max_sector_size)
-
 static inline int fat_sec_by_clus(struct fat_fs_info *fsi, int clus) {
 	return (clus - 2) * fsi->vi.secperclus + fsi->vi.dataarea;
 }
@@ -1,6 +1,10 @@
 /**
  * @file
  * @brief  VFS-independent part of FAT driver
+ * @details A few FAT sectors are cached per volume and free clusters are
+ *          tracked with a bitmap, so allocation doesn't scan the FAT. Files
+ *          keep runs of contiguous clusters they consist of, so seek is
+ *          resolved without following the cluster chain.
  * @data   9 Apr 2015
  * @author Denis Deryugin
  */
@@ -23,8 +27,11 @@
 #include <fs/super_block.h>
 #include "fat.h"
 
+#include <mem/sysmalloc.h>
+#include <util/bitmap.h>
 #include <util/log.h>
 #include <util/math.h>
+#include <util/member.h>
 
 #include <framework/mod/options.h>
 
@@ -77,38 +84,54 @@ static uint32_t fat_dir_rewind(struct dirinfo *di, int n);
 static uint32_t fat_write_de(struct dirinfo *di, struct fat_dirent *de);
 static uint32_t fat_get_free_entries(struct dirinfo *dir, int n);
 static uint32_t fat_dir_extend(struct dirinfo *di);
-int fat_read_sector(struct fat_fs_info *fsi, uint8_t *buffer, uint32_t sector) {
+/*
+ *	Read @a cnt adjacent sectors at once
+ */
+static int fat_read_sectors(struct fat_fs_info *fsi, uint8_t *buffer,
+		uint32_t sector, uint32_t cnt) {
 	size_t ret;
 	int blk;
 	int blkpersec = fsi->vi.bytepersec / fsi->bdev->block_size;
 
-	log_debug("sector(%d), fsi: bytepersec(%d), bdev->block_size(%d)",
-			sector, fsi->vi.bytepersec, fsi->bdev->block_size);
+	log_debug("sector(%d), cnt(%d), fsi: bytepersec(%d), bdev->block_size(%d)",
+			sector, cnt, fsi->vi.bytepersec, fsi->bdev->block_size);
 	blk = sector * blkpersec;
 
-	ret = block_dev_read(fsi->bdev, (char*) buffer, fsi->vi.bytepersec, blk);
-	if (ret != fsi->vi.bytepersec)
+	ret = block_dev_read(fsi->bdev, (char*) buffer, cnt * fsi->vi.bytepersec, blk);
+	if (ret != cnt * fsi->vi.bytepersec)
 		return DFS_ERRMISC;
 	else
 		return DFS_OK;
 }
 
-int fat_write_sector(struct fat_fs_info *fsi, uint8_t *buffer, uint32_t sector) {
+/*
+ *	Write @a cnt adjacent sectors at once
+ */
+static int fat_write_sectors(struct fat_fs_info *fsi, uint8_t *buffer,
+		uint32_t sector, uint32_t cnt) {
 	size_t ret;
 	int blk;
 	int blkpersec = fsi->vi.bytepersec / fsi->bdev->block_size;
 
-	log_debug("sector(%d), fsi: bytepersec(%d), bdev->block_size(%d)",
-			sector, fsi->vi.bytepersec, fsi->bdev->block_size);
+	log_debug("sector(%d), cnt(%d), fsi: bytepersec(%d), bdev->block_size(%d)",
+			sector, cnt, fsi->vi.bytepersec, fsi->bdev->block_size);
 
 	blk = sector * blkpersec;
-	ret = block_dev_write(fsi->bdev, (char*) buffer, fsi->vi.bytepersec, blk);
-	if (ret != fsi->vi.bytepersec)
+	ret = block_dev_write(fsi->bdev, (char*) buffer, cnt * fsi->vi.bytepersec, blk);
+	if (ret != cnt * fsi->vi.bytepersec)
 		return DFS_ERRMISC;
 	else
 		return DFS_OK;
 }
 
+int fat_read_sector(struct fat_fs_info *fsi, uint8_t *buffer, uint32_t sector) {
+	return fat_read_sectors(fsi, buffer, sector, 1);
+}
+
+int fat_write_sector(struct fat_fs_info *fsi, uint8_t *buffer, uint32_t sector) {
+	return fat_write_sectors(fsi, buffer, sector, 1);
+}
+
 uint32_t fat_current_dirsector(struct dirinfo *di) {
 	struct fat_fs_info *fsi = di->fi.fsi;
 	struct volinfo *vi = &fsi->vi;
@@ -438,15 +461,65 @@ uint32_t fat_get_volinfo(void *bdev, struct volinfo * volinfo, uint32_t startsec
 }
 
 /*
- *	Fetch FAT entry for specified cluster number You must provide a scratch
- *	buffer for one sector (SECTOR_SIZE) and a populated struct volinfo
- *	Returns a FAT32 BAD_CLUSTER value for any error, otherwise the contents
- *	of the desired FAT entry.
+ *	Get sector of the first FAT. Volume keeps a few recently used FAT
+ *	sectors, so following a cluster chain mostly doesn't touch the disk.
+ *	Returns NULL on read error.
+ */
+static uint8_t *fat_fat_sector(struct fat_fs_info *fsi, uint32_t sector) {
+	struct fat_fat_sector *fs, *victim;
+	int i;
+
+	victim = &fsi->fat_cache[0];
+	for (i = 0; i < FAT_FAT_CACHE_SIZE; i++) {
+		fs = &fsi->fat_cache[i];
+		if (fs->sector == sector) {
+			fs->stamp = ++fsi->fat_cache_stamp;
+			return fs->data;
+		}
+		if (fs->stamp < victim->stamp) {
+			victim = fs;
+		}
+	}
+
+	victim->sector = 0;
+	if (fat_read_sector(fsi, victim->data, sector)) {
+		return NULL;
+	}
+	victim->sector = sector;
+	victim->stamp = ++fsi->fat_cache_stamp;
+
+	return victim->data;
+}
+
+/*
+ *	Write cached FAT sector to both FAT copies
+ */
+static uint32_t fat_fat_sector_write(struct fat_fs_info *fsi, uint8_t *data,
+		uint32_t sector) {
+	uint32_t result;
+
+	result = fat_write_sector(fsi, data, sector);
+	/* mirror the FAT into copy 2 */
+	if (DFS_OK == result) {
+		result = fat_write_sector(fsi, data, sector + fsi->vi.secperfat);
+	}
+
+	if (DFS_OK != result) {
+		/* Sector on disk may differ from the cached one */
+		member_cast_out(data, struct fat_fat_sector, data)->sector = 0;
+	}
+
+	return result;
+}
+
+/*
+ *	Fetch FAT entry for specified cluster number. Returns a FAT32 BAD_CLUSTER
+ *	value for any error, otherwise the contents of the desired FAT entry.
  */
-uint32_t fat_get_fat(struct fat_fs_info *fsi,
-		uint8_t *p_scratch, uint32_t cluster) {
+uint32_t fat_get_fat(struct fat_fs_info *fsi, uint32_t cluster) {
 	uint32_t offset, sector, result;
 	struct volinfo *volinfo = &fsi->vi;
+	uint8_t *buf;
 
 	switch (volinfo->filesystem) {
 	case FAT12:
@@ -464,16 +537,14 @@ uint32_t fat_get_fat(struct fat_fs_info *fsi,
 
 	sector = offset / volinfo->bytepersec + volinfo->fat1;
 
-	if (fat_read_sector(fsi, p_scratch, sector)) {
+	if (NULL == (buf = fat_fat_sector(fsi, sector))) {
 		return DFS_BAD_CLUS;
 	}
 
 	/*
 	 * At this point, we "merely" need to extract the relevant entry.
 	 * This is easy for FAT16 and FAT32, but a royal PITA for FAT12 as
-	 * a single entry may span a sector boundary. The normal way around this is
-	 * always to read two FAT sectors, but that luxury is (by design intent)
-	 * unavailable to DOSFS.
+	 * a single entry may span a sector boundary.
 	 */
 	offset %= volinfo->bytepersec;
 	if (volinfo->filesystem == FAT12) {
@@ -482,28 +553,28 @@ uint32_t fat_get_fat(struct fat_fs_info *fsi,
 		 * into the high byte of result.
 		 */
 		if (offset == volinfo->bytepersec - 1) {
-			result = (uint32_t) p_scratch[offset];
+			result = (uint32_t) buf[offset];
 			sector++;
-			if (fat_read_sector(fsi, p_scratch, sector)) {
+			if (NULL == (buf = fat_fat_sector(fsi, sector))) {
 				return DFS_BAD_CLUS;
 			}
-			result |= ((uint32_t) p_scratch[0]) << 8;
+			result |= ((uint32_t) buf[0]) << 8;
 		} else {
-			result = (uint32_t) p_scratch[offset] |
-			  ((uint32_t) p_scratch[offset+1]) << 8;
+			result = (uint32_t) buf[offset] |
+			  ((uint32_t) buf[offset+1]) << 8;
 		}
 		if (cluster & 1)
 			result = result >> 4;
 		else
 			result = result & 0xfff;
 	} else if (volinfo->filesystem == FAT16) {
-		result = (uint32_t) p_scratch[offset] |
-		  ((uint32_t) p_scratch[offset+1]) << 8;
+		result = (uint32_t) buf[offset] |
+		  ((uint32_t) buf[offset+1]) << 8;
 	} else if (volinfo->filesystem == FAT32) {
-		result = ((uint32_t) p_scratch[offset] |
-		  ((uint32_t) p_scratch[offset+1]) << 8 |
-		  ((uint32_t) p_scratch[offset+2]) << 16 |
-		  ((uint32_t) p_scratch[offset+3]) << 24) & 0x0fffffff;
+		result = ((uint32_t) buf[offset] |
+		  ((uint32_t) buf[offset+1]) << 8 |
+		  ((uint32_t) buf[offset+2]) << 16 |
+		  ((uint32_t) buf[offset+3]) << 24) & 0x0fffffff;
 	} else
 		result = DFS_BAD_CLUS;
 
@@ -538,14 +609,13 @@ static uint32_t fat_is_end_of_chain(struct fat_fs_info *fsi, uint32_t clus) {
 
 /*
  * Set FAT entry for specified cluster number
- * You must provide a scratch buffer for one sector (SECTOR_SIZE)
- * and a populated volinfo_t Returns DFS_ERRMISC for any error, otherwise
- * DFS_OK p_scratchcache should point to a UINT32.
+ * Returns DFS_ERRMISC for any error, otherwise DFS_OK
  * */
-static uint32_t fat_set_fat(struct fat_fs_info *fsi, uint8_t *p_scratch,
+static uint32_t fat_set_fat(struct fat_fs_info *fsi,
 		uint32_t cluster, uint32_t new_contents) {
 	uint32_t offset, sector, result;
 	struct volinfo *volinfo = &fsi->vi;
+	uint8_t *buf;
 
 	switch (volinfo->filesystem) {
 	case FAT12:
@@ -569,16 +639,14 @@ static uint32_t fat_set_fat(struct fat_fs_info *fsi, uint8_t *p_scratch,
 	 */
 	sector = offset / volinfo->bytepersec + volinfo->fat1;
 
-	if (fat_read_sector(fsi, p_scratch, sector)) {
+	if (NULL == (buf = fat_fat_sector(fsi, sector))) {
 		return DFS_ERRMISC;
 	}
 
 	/*
 	 * At this point, we "merely" need to extract the relevant entry.
 	 * This is easy for FAT16 and FAT32, but a royal PITA for FAT12 as a
-	 * single entry may span a sector boundary. The normal way around this
-	 * is always to read two FAT sectors, but that luxury is (by design intent)
-	 * unavailable to DOSFS.
+	 * single entry may span a sector boundary.
 	 */
 	offset %= volinfo->bytepersec;
 
@@ -590,42 +658,33 @@ static uint32_t fat_set_fat(struct fat_fs_info *fsi, uint8_t *p_scratch,
 		if (offset == volinfo->bytepersec - 1) {
 			/* Odd cluster: High 12 bits being set */
 			if (cluster & 1) {
-				p_scratch[offset] = (p_scratch[offset] & 0x0f) |
+				buf[offset] = (buf[offset] & 0x0f) |
 						(new_contents & 0xf0);
 			}
 			/* Even cluster: Low 12 bits being set */
 			else {
-				p_scratch[offset] = new_contents & 0xff;
-			}
-			result = fat_write_sector(fsi, p_scratch, sector);
-			/* mirror the FAT into copy 2 */
-			if (DFS_OK == result) {
-				result = fat_write_sector(fsi, p_scratch,
-						sector + volinfo->secperfat);
+				buf[offset] = new_contents & 0xff;
 			}
+			result = fat_fat_sector_write(fsi, buf, sector);
 
 			/*
-			 * If we wrote that sector OK, then read in the subsequent sector
+			 * If we wrote that sector OK, then get the subsequent sector
 			 * and poke the first byte with the remainder of this FAT entry.
 			 */
 			if (DFS_OK == result) {
-				result = fat_read_sector(fsi, p_scratch, ++sector);
-				if (DFS_OK == result) {
+				if (NULL == (buf = fat_fat_sector(fsi, ++sector))) {
+					result = DFS_ERRMISC;
+				} else {
 					/* Odd cluster: High 12 bits being set*/
 					if (cluster & 1) {
-						p_scratch[0] = new_contents & 0xff00;
+						buf[0] = new_contents & 0xff00;
 					}
 					/* Even cluster: Low 12 bits being set */
 					else {
-						p_scratch[0] = (p_scratch[0] & 0xf0) |
+						buf[0] = (buf[0] & 0xf0) |
 								(new_contents & 0x0f);
 					}
-					result = fat_write_sector(fsi, p_scratch, sector);
-					/* mirror the FAT into copy 2 */
-					if (DFS_OK == result) {
-						result = fat_write_sector(fsi, p_scratch,
-								sector+volinfo->secperfat);
-					}
+					result = fat_fat_sector_write(fsi, buf, sector);
 				}
 			}
 		}
@@ -637,44 +696,42 @@ static uint32_t fat_set_fat(struct fat_fs_info *fsi, uint8_t *p_scratch,
 		else {
 			/* Odd cluster: High 12 bits being set */
 			if (cluster & 1) {
-				p_scratch[offset] = (p_scratch[offset] & 0x0f) |
+				buf[offset] = (buf[offset] & 0x0f) |
 						(new_contents & 0xf0);
-				p_scratch[offset + 1] = (new_contents & 0xff00) >> 8;
+				buf[offset + 1] = (new_contents & 0xff00) >> 8;
 			}
 			/* Even cluster: Low 12 bits being set */
 			else {
-				p_scratch[offset] = new_contents & 0xff;
-				p_scratch[offset+1] = (p_scratch[offset+1] & 0xf0) |
+				buf[offset] = new_contents & 0xff;
+				buf[offset+1] = (buf[offset+1] & 0xf0) |
 						((new_contents & 0x0f00) >> 8);
 			}
-			result = fat_write_sector(fsi, p_scratch, sector);
-			/* mirror the FAT into copy 2 */
-			if (DFS_OK == result) {
-				result = fat_write_sector(fsi, p_scratch,
-						sector + volinfo->secperfat);
-			}
+			result = fat_fat_sector_write(fsi, buf, sector);
 		}
 		break;
 	case FAT32:
-		p_scratch[offset + 3] = (p_scratch[offset  + 3] & 0xf0) |
+		buf[offset + 3] = (buf[offset  + 3] & 0xf0) |
 				((new_contents & 0x0f000000) >> 24);
-		p_scratch[offset + 2] = (new_contents & 0xff0000) >> 16;
+		buf[offset + 2] = (new_contents & 0xff0000) >> 16;
 		/* Fall through */
 	case FAT16:
-		p_scratch[offset + 1] = (new_contents & 0xff00) >> 8;
-		p_scratch[offset] = (new_contents & 0xff);
-		result = fat_write_sector(fsi, p_scratch, sector);
-		/* mirror the FAT into copy 2 */
-		if (DFS_OK == result)
-			result = fat_write_sector(
-					fsi,
-					p_scratch,
-					sector + volinfo->secperfat
-				);
+		buf[offset + 1] = (new_contents & 0xff00) >> 8;
+		buf[offset] = (new_contents & 0xff);
+		result = fat_fat_sector_write(fsi, buf, sector);
 		break;
 	default:
 		result = DFS_ERRMISC;
 	}
+
+	if ((DFS_OK == result) && fsi->free_map
+			&& (cluster < fsi->vi.numclusters)) {
+		if (new_contents) {
+			bitmap_set_bit(fsi->free_map, cluster);
+		} else {
+			bitmap_clear_bit(fsi->free_map, cluster);
+		}
+	}
+
 	return result;
 }
 
@@ -715,27 +772,250 @@ static void fat_append_longname(char *name, struct fat_dirent *di) {
 }
 
 /*
- * 	Find the first unused FAT entry
- * 	You must provide a scratch buffer for one sector (SECTOR_SIZE) and a
- * 	populated volinfo_t Returns a FAT32 BAD_CLUSTER value for any error,
- * 	otherwise the contents of the desired FAT entry.
+ *	Build map of used clusters. FAT is read sequentially, so it's done
+ *	sector by sector. Map is not built if there is no memory for it.
+ */
+static void fat_free_map_build(struct fat_fs_info *fsi) {
+	uint32_t i, clus;
+	unsigned long *map;
+
+	/* One more word as map search may look past the last bit */
+	map = sysmalloc((BITMAP_SIZE(fsi->vi.numclusters) + 1) * sizeof(*map));
+	if (map == NULL) {
+		return;
+	}
+	bitmap_clear_all(map, fsi->vi.numclusters);
+
+	/* Clusters 0 and 1 are reserved */
+	for (i = 0; (i < 2) && (i < fsi->vi.numclusters); i++) {
+		bitmap_set_bit(map, i);
+	}
+
+	for (i = 2; i < fsi->vi.numclusters; i++) {
+		/* Clusters which can't be read are not allocated as well */
+		clus = fat_get_fat(fsi, i);
+		if (clus != 0) {
+			bitmap_set_bit(map, i);
+		}
+	}
+
+	fsi->free_map = map;
+	fsi->free_hint = 2;
+}
+
+/*
+ * 	Find unused FAT entry. Search starts after the last found one, so
+ * 	clusters allocated one by one for a growing file are contiguous.
  * 	Returns FAT32 bad_sector (0x0ffffff7) if there is no free cluster available
  */
-static uint32_t fat_get_free_fat(struct fat_fs_info *fsi, uint8_t *p_scratch) {
+static uint32_t fat_get_free_fat(struct fat_fs_info *fsi) {
 	uint32_t i;
+
+	if (fsi->free_map == NULL) {
+		fat_free_map_build(fsi);
+	}
+
+	if (fsi->free_map != NULL) {
+		i = bitmap_find_zero_bit(fsi->free_map, fsi->vi.numclusters,
+				fsi->free_hint);
+		if (i >= fsi->vi.numclusters) {
+			i = bitmap_find_zero_bit(fsi->free_map, fsi->vi.numclusters, 2);
+		}
+		if (i >= fsi->vi.numclusters) {
+			return DFS_BAD_CLUS;
+		}
+
+		fsi->free_hint = i + 1;
+		return i;
+	}
+
 	/*
 	 * Search starts at cluster 2, which is the first usable cluster
 	 * NOTE: This search can't terminate at a bad cluster, because there might
 	 * legitimately be bad clusters on the disk.
 	 */
 	for (i = 2; i < fsi->vi.numclusters; i++) {
-		if (!fat_get_fat(fsi, p_scratch, i)) {
+		if (!fat_get_fat(fsi, i)) {
 			return i;
 		}
 	}
 	return DFS_BAD_CLUS;
 }
 
+/*
+ *	Forget known clusters of the file, current cluster is the first one
+ */
+static void fat_file_extents_reset(struct fat_file_info *fi) {
+	fi->extent_cnt = 0;
+	fi->cluster = fi->firstcluster;
+	fi->cluster_idx = 0;
+}
+
+/*
+ *	Remember that @a clus is cluster number @a idx of the file. It's only
+ *	added if it follows the clusters which are already known.
+ */
+static void fat_extent_add(struct fat_file_info *fi, uint32_t idx,
+		uint32_t clus) {
+	struct fat_extent *ext;
+
+	if (fi->extent_cnt == 0) {
+		if (idx == 0) {
+			fi->extents[0] = (struct fat_extent) {
+				.fclus = 0,
+				.dclus = clus,
+				.len   = 1,
+			};
+			fi->extent_cnt = 1;
+		}
+		return;
+	}
+
+	ext = &fi->extents[fi->extent_cnt - 1];
+	if (idx != ext->fclus + ext->len) {
+		return;
+	}
+
+	if (clus == ext->dclus + ext->len) {
+		ext->len++;
+	} else if (fi->extent_cnt < FAT_EXTENT_CNT) {
+		fi->extents[fi->extent_cnt++] = (struct fat_extent) {
+			.fclus = idx,
+			.dclus = clus,
+			.len   = 1,
+		};
+	}
+}
+
+/*
+ *	Make cluster number @a idx of the file current. Known extents are
+ *	looked up first, then the chain is followed from the nearest known
+ *	cluster. Returns the cluster or end of chain mark if the file is
+ *	shorter, in this case the last cluster of the file is left current.
+ */
+static uint32_t fat_file_seek_clus(struct fat_file_info *fi, uint32_t idx) {
+	struct fat_fs_info *fsi = fi->fsi;
+	struct fat_extent *ext;
+	uint32_t i, clus, next;
+	int lo, hi, mid;
+
+	if (fi->firstcluster == 0) {
+		return fat_end_of_chain(fsi);
+	}
+
+	if (idx == fi->cluster_idx) {
+		return fi->cluster;
+	}
+
+	if (fi->extent_cnt == 0) {
+		fat_extent_add(fi, 0, fi->firstcluster);
+	}
+
+	lo = 0;
+	hi = fi->extent_cnt - 1;
+	while (lo <= hi) {
+		mid = (lo + hi) / 2;
+		ext = &fi->extents[mid];
+
+		if (idx < ext->fclus) {
+			hi = mid - 1;
+		} else if (idx >= ext->fclus + ext->len) {
+			lo = mid + 1;
+		} else {
+			fi->cluster = ext->dclus + (idx - ext->fclus);
+			fi->cluster_idx = idx;
+			return fi->cluster;
+		}
+	}
+
+	ext = &fi->extents[fi->extent_cnt - 1];
+	i = ext->fclus + ext->len - 1;
+	clus = ext->dclus + ext->len - 1;
+	/* Current cluster may be beyond extents if there was no room for them */
+	if ((fi->cluster_idx > i) && (fi->cluster_idx <= idx)) {
+		i = fi->cluster_idx;
+		clus = fi->cluster;
+	}
+
+	while (i < idx) {
+		next = fat_get_fat(fsi, clus);
+		if (next < 2 || fat_is_end_of_chain(fsi, next)) {
+			break;
+		}
+		clus = next;
+		i++;
+		fat_extent_add(fi, i, clus);
+	}
+
+	fi->cluster = clus;
+	fi->cluster_idx = i;
+
+	return i == idx ? clus : fat_end_of_chain(fsi);
+}
+
+/*
+ *	Same as fat_file_seek_clus(), but the file is extended up to cluster
+ *	@a idx if it's shorter. Returns DFS_BAD_CLUS if there is no free space.
+ */
+static uint32_t fat_file_seek_alloc(struct fat_file_info *fi, uint32_t idx) {
+	struct fat_fs_info *fsi = fi->fsi;
+	uint32_t clus;
+
+	fat_file_seek_clus(fi, idx);
+
+	while (fi->cluster_idx < idx) {
+		clus = fat_get_free_fat(fsi);
+		if (clus == DFS_BAD_CLUS) {
+			return DFS_BAD_CLUS;
+		}
+
+		/* Link new cluster onto file */
+		if (fat_set_fat(fsi, clus, fat_end_of_chain(fsi))
+				|| fat_set_fat(fsi, fi->cluster, clus)) {
+			return DFS_BAD_CLUS;
+		}
+
+		fi->cluster = clus;
+		fi->cluster_idx++;
+		fat_extent_add(fi, fi->cluster_idx, clus);
+	}
+
+	return fi->cluster;
+}
+
+/*
+ *	Amount of sectors up to @a max which follow each other on disk from
+ *	sector @a first of the current cluster. Clusters are allocated if the
+ *	file is shorter and @a alloc is set. The last cluster of the run is left
+ *	current.
+ */
+static uint32_t fat_file_run(struct fat_file_info *fi, uint32_t first,
+		uint32_t max, int alloc) {
+	uint32_t cnt, clus, idx, next;
+
+	cnt = fi->volinfo->secperclus - first;
+	while (cnt < max) {
+		clus = fi->cluster;
+		idx = fi->cluster_idx;
+
+		if (alloc) {
+			next = fat_file_seek_alloc(fi, idx + 1);
+		} else {
+			next = fat_file_seek_clus(fi, idx + 1);
+		}
+
+		if (next != clus + 1) {
+			fi->cluster = clus;
+			fi->cluster_idx = idx;
+			break;
+		}
+
+		cnt += fi->volinfo->secperclus;
+	}
+
+	return min(cnt, max);
+}
+
 static inline int dir_is_root(uint8_t *name) {
 	return !strlen((char *) name) ||
 		((strlen((char *) name) == 1) && (name[0] == DIR_SEPARATOR));
@@ -796,9 +1076,7 @@ static uint32_t fat_fetch_dir(struct dirinfo *dir) {
 
 				dir->currentsector = 0;
 
-				tempclus = fat_get_fat(fsi,
-						dir->p_scratch,
-						dir->currentcluster);
+				tempclus = fat_get_fat(fsi, dir->currentcluster);
 
 				if (fat_is_end_of_chain(fsi, tempclus)) {
 					return DFS_ALLOCNEW;
@@ -965,7 +1243,7 @@ static uint32_t fat_clear_clus(struct fat_fs_info *fsi,
 static uint32_t fat_dir_extend(struct dirinfo *di) {
 	struct fat_fs_info *fsi = di->fi.fsi;
 	uint32_t clus;
-	clus = fat_get_free_fat(fsi, di->p_scratch);
+	clus = fat_get_free_fat(fsi);
 	if (clus == DFS_BAD_CLUS) {
 		return DFS_ERRMISC;
 	}
@@ -974,7 +1252,7 @@ static uint32_t fat_dir_extend(struct dirinfo *di) {
 		return DFS_ERRMISC;
 	}
 
-	fat_set_fat(fsi, di->p_scratch, di->currentcluster, clus);
+	fat_set_fat(fsi, di->currentcluster, clus);
 
 	di->currentcluster = clus;
 	di->currentsector = 0;
@@ -982,7 +1260,7 @@ static uint32_t fat_dir_extend(struct dirinfo *di) {
 				 so next loop will call */
 	clus = fat_end_of_chain(fsi);
 
-	fat_set_fat(fsi, di->p_scratch, di->currentcluster, clus);
+	fat_set_fat(fsi, di->currentcluster, clus);
 
 	read_dir_buf(di);
 
@@ -1055,28 +1333,35 @@ static void fat_set_direntry(uint32_t dir_cluster, uint32_t cluster) {
 
 int fat_root_dir_record(void *bdev) {
 	uint32_t cluster;
-	struct fat_fs_info fsi;
+	struct fat_fs_info *fsi;
 	uint32_t pstart, psize;
 	uint8_t pactive, ptype;
 	struct fat_dirent de;
 	int dev_blk_size = block_dev(bdev)->block_size;
 	int root_dir_sz;
+	int res;
 
 	assert(dev_blk_size > 0);
 
-	fsi.bdev = bdev;
-
 	/* Obtain pointer to first partition on first (only) unit */
 	pstart = fat_get_ptn_start(bdev, 0, &pactive, &ptype, &psize);
 	if (pstart == 0xffffffff) {
 		return -1;
 	}
 
-	if (fat_get_volinfo(bdev, &fsi.vi, pstart)) {
+	/* Volume isn't mounted yet, FAT is accessed with temporary descriptor */
+	if (NULL == (fsi = fat_fs_alloc())) {
+		return -ENOMEM;
+	}
+	memset(fsi, 0, sizeof(*fsi));
+	fsi->bdev = bdev;
+
+	if (fat_get_volinfo(bdev, &fsi->vi, pstart)) {
+		fat_fs_free(fsi);
 		return -1;
 	}
 
-	cluster = fsi.vi.rootdir / fsi.vi.secperclus;
+	cluster = fsi->vi.rootdir / fsi->vi.secperclus;
 
 	de = (struct fat_dirent) {
 		.name = "ROOT DIR   ",
@@ -1098,13 +1383,14 @@ int fat_root_dir_record(void *bdev) {
 
 	if (0 > block_dev_write(	bdev,
 					(char *) fat_sector_buff,
-					fsi.vi.bytepersec,
-					fsi.vi.rootdir * fsi.vi.bytepersec / dev_blk_size)) {
+					fsi->vi.bytepersec,
+					fsi->vi.rootdir * fsi->vi.bytepersec / dev_blk_size)) {
+		fat_fs_free(fsi);
 		return DFS_ERRMISC;
 	}
 
-	root_dir_sz = (fsi.vi.rootentries * sizeof(struct fat_dirent) +
-	               fsi.vi.bytepersec - 1) / fsi.vi.bytepersec - 1;
+	root_dir_sz = (fsi->vi.rootentries * sizeof(struct fat_dirent) +
+	               fsi->vi.bytepersec - 1) / fsi->vi.bytepersec - 1;
 
 	if (root_dir_sz)
 		memset(fat_sector_buff, 0, sizeof(struct fat_dirent)); /* The rest is zeroes already */
@@ -1112,15 +1398,17 @@ int fat_root_dir_record(void *bdev) {
 	while (root_dir_sz) {
 		block_dev_write(bdev,
 				(char *) fat_sector_buff,
-				fsi.vi.bytepersec,
-				(root_dir_sz + fsi.vi.rootdir) * fsi.vi.bytepersec / dev_blk_size);
+				fsi->vi.bytepersec,
+				(root_dir_sz + fsi->vi.rootdir) * fsi->vi.bytepersec / dev_blk_size);
 		root_dir_sz--;
 	}
 
-	cluster = fat_end_of_chain(&fsi);
-	fat_set_fat(&fsi, fat_sector_buff, cluster, cluster);
+	cluster = fat_end_of_chain(fsi);
+	res = fat_set_fat(fsi, cluster, cluster);
+
+	fat_fs_free(fsi);
 
-	return DFS_OK;
+	return res == DFS_OK ? DFS_OK : DFS_ERRMISC;
 }
 
 /*
@@ -1137,6 +1425,7 @@ uint32_t fat_read_file(struct fat_file_info *fi, uint8_t *p_scratch,
 	uint32_t sector;
 	uint32_t bytesread;
 	uint32_t clastersize;
+	uint32_t cnt;
 	struct fat_fs_info *fsi;
 	fsi = fi->fsi;
 
@@ -1148,6 +1437,10 @@ uint32_t fat_read_file(struct fat_file_info *fi, uint8_t *p_scratch,
 	*successcount = 0;
 	clastersize = fi->volinfo->secperclus * fi->volinfo->bytepersec;
 
+	if (fat_is_end_of_chain(fsi, fat_file_seek_clus(fi, fi->pointer / clastersize))) {
+		return DFS_EOF;
+	}
+
 	while (remain && result == DFS_OK) {
 		/* This is a bit complicated. The sector we want to read is addressed
 		 * at a cluster granularity by the fi->cluster member. The file
@@ -1208,11 +1501,17 @@ uint32_t fat_read_file(struct fat_file_info *fi, uint8_t *p_scratch,
 			 * [large] read requests would be able to go a cluster at a time).
 			 */
 			 if (remain >= fi->volinfo->bytepersec) {
-				result = fat_read_sector(fsi, buffer, sector);
-				remain -= fi->volinfo->bytepersec;
-				buffer += fi->volinfo->bytepersec;
-				fi->pointer += fi->volinfo->bytepersec;
-				bytesread = fi->volinfo->bytepersec;
+				/* Sectors which follow each other on disk are read at once */
+				cnt = fat_file_run(fi,
+						div(fi->pointer, fi->volinfo->bytepersec).quot
+							% fi->volinfo->secperclus,
+						remain / fi->volinfo->bytepersec, 0);
+				bytesread = cnt * fi->volinfo->bytepersec;
+
+				result = fat_read_sectors(fsi, buffer, sector, cnt);
+				remain -= bytesread;
+				buffer += bytesread;
+				fi->pointer += bytesread;
 			}
 			/* Case 2B - We are only reading a partial sector */
 			else {
@@ -1227,12 +1526,10 @@ uint32_t fat_read_file(struct fat_file_info *fi, uint8_t *p_scratch,
 
 		*successcount += bytesread;
 		/* check to see if we stepped over a cluster boundary */
-		if (div(fi->pointer - bytesread, clastersize).quot !=
-			div(fi->pointer, clastersize).quot) {
-			if (fat_is_end_of_chain(fsi, fi->cluster)) {
+		if (remain && (div(fi->pointer, clastersize).quot != fi->cluster_idx)) {
+			if (fat_is_end_of_chain(fsi,
+					fat_file_seek_clus(fi, div(fi->pointer, clastersize).quot))) {
 				result = DFS_EOF;
-			} else {
-				fi->cluster = fat_get_fat(fsi, p_scratch, fi->cluster);
 			}
 		}
 	}
@@ -1254,6 +1551,7 @@ uint32_t fat_write_file(struct fat_file_info *fi, uint8_t *p_scratch,
 	uint32_t result = DFS_OK;
 	uint32_t sector;
 	uint32_t byteswritten;
+	uint32_t cnt;
 	uint32_t lastcluster, nextcluster;
 	uint32_t clastersize;
 	uint32_t new_clus = 0;
@@ -1268,15 +1566,24 @@ uint32_t fat_write_file(struct fat_file_info *fi, uint8_t *p_scratch,
 			len, fi->volinfo->secperclus, fi->volinfo->bytepersec );
 
 	if (fi->firstcluster == 0) {
-		new_clus = fat_get_free_fat(fsi, fat_sector_buff);
-		fat_set_fat(fsi, fat_sector_buff, new_clus, fat_end_of_chain(fsi));
-		fi->firstcluster = fi->cluster = new_clus;
+		new_clus = fat_get_free_fat(fsi);
+		if (new_clus == DFS_BAD_CLUS) {
+			return DFS_ERRMISC;
+		}
+		fat_set_fat(fsi, new_clus, fat_end_of_chain(fsi));
+		fi->firstcluster = new_clus;
+		fat_file_extents_reset(fi);
 	}
 
 	remain = len;
 	*successcount = 0;
 	clastersize = fi->volinfo->secperclus * fi->volinfo->bytepersec;
 
+	if (remain && (DFS_BAD_CLUS ==
+			fat_file_seek_alloc(fi, fi->pointer / clastersize))) {
+		return DFS_ERRMISC;
+	}
+
 	while (remain && result == DFS_OK) {
 		/*
 		 * This is a bit complicated. The sector we want to read is addressed
@@ -1346,14 +1653,21 @@ uint32_t fat_write_file(struct fat_file_info *fi, uint8_t *p_scratch,
 			 * were thus inclined. Refer to similar notes in fat_read_file.
 			 */
 			if (remain >= fi->volinfo->bytepersec) {
-				result = fat_write_sector(fsi, buffer, sector);
-				remain -= fi->volinfo->bytepersec;
-				buffer += fi->volinfo->bytepersec;
-				fi->pointer += fi->volinfo->bytepersec;
+				/* Sectors which follow each other on disk are written at once,
+				 * clusters are allocated ahead for that */
+				cnt = fat_file_run(fi,
+						div(fi->pointer, fi->volinfo->bytepersec).quot
+							% fi->volinfo->secperclus,
+						remain / fi->volinfo->bytepersec, 1);
+				byteswritten = cnt * fi->volinfo->bytepersec;
+
+				result = fat_write_sectors(fsi, buffer, sector, cnt);
+				remain -= byteswritten;
+				buffer += byteswritten;
+				fi->pointer += byteswritten;
 				if (*size < fi->pointer) {
 					*size = fi->pointer;
 				}
-				byteswritten = fi->volinfo->bytepersec;
 			}
 			/*
 			 * Case 2B - We are only writing a partial sector and potentially
@@ -1391,33 +1705,12 @@ uint32_t fat_write_file(struct fat_file_info *fi, uint8_t *p_scratch,
 		*successcount += byteswritten;
 
 		/* check to see if we stepped over a cluster boundary */
-		if (div(fi->pointer - byteswritten, clastersize).quot !=
-				div(fi->pointer, clastersize).quot) {
-
-		  	/* We've transgressed into another cluster. If we were already
-		  	 * at EOF, we need to allocate a new cluster.
-		  	 * An act of minor evil - we use byteswritten as a scratch integer,
-		  	 * knowing that its value is not used after updating *successcount
-		  	 * above
-		  	 */
-		  	byteswritten = 0;
-
-			lastcluster = fi->cluster;
-			fi->cluster = fat_get_fat(fsi, p_scratch, fi->cluster);
-
-			/* Allocate a new cluster? */
-			if (fat_is_end_of_chain(fsi, fi->cluster)) {
-			  	uint32_t tempclus;
-				tempclus = fat_get_free_fat(fsi, p_scratch);
-				if (tempclus == DFS_BAD_CLUS)
-					return DFS_ERRMISC;
-				/* Link new cluster onto file */
-				fat_set_fat(fsi, p_scratch, lastcluster, tempclus);
-				fi->cluster = tempclus;
-				tempclus = fat_end_of_chain(fsi);
-				fat_set_fat(fsi, p_scratch, fi->cluster, tempclus);
-
-				result = DFS_OK;
+		if (remain && (div(fi->pointer, clastersize).quot != fi->cluster_idx)) {
+			/* We've transgressed into another cluster. If we were already
+			 * at EOF, we need to allocate a new cluster. */
+			if (DFS_BAD_CLUS == fat_file_seek_alloc(fi,
+					div(fi->pointer, clastersize).quot)) {
+				return DFS_ERRMISC;
 			}
 		}
 	}
@@ -1427,17 +1720,17 @@ uint32_t fat_write_file(struct fat_file_info *fi, uint8_t *p_scratch,
 		if (div(*size, clastersize).quot !=
 			div(fi->pointer, clastersize).quot) {
 
-			nextcluster = fat_get_fat(fsi, p_scratch, fi->cluster);
+			nextcluster = fat_get_fat(fsi, fi->cluster);
 
 			lastcluster = fat_end_of_chain(fsi);
-			fat_set_fat(fsi, p_scratch, fi->cluster, lastcluster);
+			fat_set_fat(fsi, fi->cluster, lastcluster);
 
 			/* Now follow the cluster chain to free the file space */
 			while (!fat_is_end_of_chain(fsi, nextcluster)) {
 				lastcluster = nextcluster;
-				nextcluster = fat_get_fat(fsi, p_scratch, nextcluster);
+				nextcluster = fat_get_fat(fsi, nextcluster);
 
-				fat_set_fat(fsi, p_scratch, lastcluster, 0);
+				fat_set_fat(fsi, lastcluster, 0);
 			}
 
 		}
@@ -1565,9 +1858,11 @@ int fat_unlike_file(struct fat_file_info *fi, uint8_t *p_scratch) {
 	/* Now follow the cluster chain to free the file space */
 	while (!fat_is_end_of_chain(fsi, fi->firstcluster)) {
 		tempclus = fi->firstcluster;
-		fi->firstcluster = fat_get_fat(fsi, p_scratch, fi->firstcluster);
-		fat_set_fat(fsi, p_scratch, tempclus, 0);
+		fi->firstcluster = fat_get_fat(fsi, fi->firstcluster);
+		fat_set_fat(fsi, tempclus, 0);
 	}
+	fat_file_extents_reset(fi);
+
 	return DFS_OK;
 }
 
@@ -1695,7 +1990,7 @@ int fat_create_file(struct fat_file_info *fi, struct dirinfo *di, char *name, in
 		memcpy(filename, name, sizeof(filename));
 	}
 
-	cluster = fat_get_free_fat(fsi, fat_sector_buff);
+	cluster = fat_get_free_fat(fsi);
 	de = (struct fat_dirent) {
 		.attr = S_ISDIR(mode) ? ATTR_DIRECTORY : 0,
 	};
@@ -1707,13 +2002,13 @@ int fat_create_file(struct fat_file_info *fi, struct dirinfo *di, char *name, in
 	fi->pointer = 0;
 	fi->dirsector = fat_current_dirsector(di);
 	fi->diroffset = di->currententry;
-	fi->cluster = cluster;
 	fi->firstcluster = cluster;
+	fat_file_extents_reset(fi);
 
 	fat_write_de(di, &de);
 
 	cluster = fat_end_of_chain(fsi);
-	fat_set_fat(fsi, fat_sector_buff, fi->cluster, cluster);
+	fat_set_fat(fsi, fi->cluster, cluster);
 
 	if (S_ISDIR(mode)) {
 		/* create . and ..  files of this catalog */
@@ -2143,8 +2438,8 @@ int fat_fill_inode(struct inode *inode, struct fat_dirent *de, struct dirinfo *d
 	}
 
 	fi->diroffset    = tmp_entry - 1;
-	fi->cluster      = fat_direntry_get_clus(de);
-	fi->firstcluster = fi->cluster;
+	fi->firstcluster = fat_direntry_get_clus(de);
+	fat_file_extents_reset(fi);
 	fi->filelen      = fat_direntry_get_size(de);
 	fi->fdi          = di;
 
@@ -5,6 +5,7 @@
  * @author Anton Bondarev
  */
 #include <mem/misc/pool.h>
+#include <mem/sysmalloc.h>
 
 #include "fat.h"
 
@@ -22,6 +23,10 @@ struct fat_fs_info *fat_fs_alloc(void) {
 }
 
 void fat_fs_free(struct fat_fs_info *fsi) {
+	if (fsi->free_map) {
+		sysfree(fsi->free_map);
+		fsi->free_map = NULL;
+	}
 	pool_free(&fat_fs_pool, fsi);
 }
 
@@ -0,0 +1,60 @@
+/**
+ * @file
+ * @brief File system keeping files in memory pages
+ *
+ * @date 18.10.2026
+ */
+
+#ifndef TMPFS_H_
+#define TMPFS_H_
+
+#include <stddef.h>
+#include <sys/types.h>
+
+#include <framework/mod/options.h>
+#include <util/dlist.h>
+#include <module/embox/fs/driver/tmpfs.h>
+
+#define TMPFS_FILES       OPTION_MODULE_GET(embox__fs__driver__tmpfs, NUMBER, inode_quantity)
+#define TMPFS_DESCRIPTORS OPTION_MODULE_GET(embox__fs__driver__tmpfs, NUMBER, tmpfs_descriptor_quantity)
+#define TMPFS_PAGE_LIMIT  OPTION_MODULE_GET(embox__fs__driver__tmpfs, NUMBER, page_limit)
+#define TMPFS_MAPS        OPTION_MODULE_GET(embox__fs__driver__tmpfs, NUMBER, map_quantity)
+
+struct inode;
+struct super_block;
+
+struct tmpfs_fs_info {
+	size_t page_cnt;            /* pages taken by files and their index */
+};
+
+/*
+ * Pages of a file are found by their number in a radix tree. Index pages
+ * hold pointers to pages of the next level, absent pages are holes.
+ */
+struct tmpfs_file_info {
+	void *root;                 /* NULL if the file has no pages */
+	int height;                 /* levels of index pages above data pages */
+	struct tmpfs_fs_info *fsi;
+	struct dlist_head maps;     /* struct tmpfs_map */
+};
+
+/*
+ * Pages from first to first + cnt were given by mmap() as one block at
+ * base. File systems aren't told about munmap(), so the block is never
+ * moved or freed until the file is released.
+ */
+struct tmpfs_map {
+	struct dlist_head link;
+	unsigned long first, cnt;
+	char *base;
+};
+
+extern struct file_operations tmpfs_fops;
+extern int tmpfs_fill_sb(struct super_block *sb, const char *source);
+extern int tmpfs_clean_sb(struct super_block *sb);
+extern int tmpfs_truncate(struct inode *node, off_t length);
+
+extern struct tmpfs_file_info *tmpfs_file_alloc(struct inode *node);
+extern void tmpfs_file_free(struct tmpfs_file_info *fi);
+
+#endif /* TMPFS_H_ */
@@ -0,0 +1,59 @@
+/**
+ * @file
+ * @brief Tmp file system for old VFS
+ *
+ * @date 18.10.2026
+ */
+
+#include <errno.h>
+
+#include <fs/fs_driver.h>
+#include <fs/inode.h>
+#include <fs/super_block.h>
+
+#include "tmpfs.h"
+
+static int tmpfs_create(struct inode *parent_node, struct inode *node) {
+	if (!node_is_directory(node)) {
+		if (NULL == tmpfs_file_alloc(node)) {
+			return -ENOMEM;
+		}
+	}
+
+	return 0;
+}
+
+static int tmpfs_delete(struct inode *node) {
+	struct tmpfs_file_info *fi;
+
+	fi = inode_priv(node);
+	if (fi != NULL && !node_is_directory(node)) {
+		tmpfs_file_free(fi);
+		inode_priv_set(node, NULL);
+	}
+
+	return 0;
+}
+
+static int tmpfs_mount(struct super_block *sb, struct inode *dest) {
+	return 0;
+}
+
+static struct fsop_desc tmpfs_fsop = {
+	.mount        = tmpfs_mount,
+	.create_node  = tmpfs_create,
+	.delete_node  = tmpfs_delete,
+	.truncate     = tmpfs_truncate,
+	/* Memory of files is released on umount */
+	.umount_entry = tmpfs_delete,
+};
+
+static struct fs_driver tmpfs_driver = {
+	.name     = "tmpfs",
+	.fill_sb  = tmpfs_fill_sb,
+	.clean_sb = tmpfs_clean_sb,
+	.file_op  = &tmpfs_fops,
+	.fsop     = &tmpfs_fsop,
+};
+
+DECLARE_FILE_SYSTEM_DRIVER(tmpfs_driver);
@@ -0,0 +1,434 @@
+/**
+ * @file
+ * @brief File system keeping files in memory pages
+ * @details Pages are taken from physical memory allocator only for written
+ *          data, so the file system has no fixed size and unwritten parts
+ *          of files are holes. Data is copied right between file pages and
+ *          user buffers. Mapped range of a file is moved to contiguous pages
+ *          which are given to the caller, so mapping shares the file data.
+ *          Pages which were mapped once stay in place for the life of the
+ *          file, see struct tmpfs_map.
+ *
+ * @date 18.10.2026
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <limits.h>
+#include <string.h>
+
+#include <fs/file_desc.h>
+#include <fs/file_operation.h>
+#include <fs/inode.h>
+#include <fs/super_block.h>
+#include <mem/misc/pool.h>
+#include <mem/phymem.h>
+#include <util/math.h>
+
+#include "tmpfs.h"
+
+/* Pointers to pages of the next level in an index page */
+#define TMPFS_SLOTS (PAGE_SIZE() / sizeof(void *))
+
+POOL_DEF(tmpfs_fs_pool, struct tmpfs_fs_info, TMPFS_DESCRIPTORS);
+POOL_DEF(tmpfs_file_pool, struct tmpfs_file_info, TMPFS_FILES);
+POOL_DEF(tmpfs_map_pool, struct tmpfs_map, TMPFS_MAPS);
+
+static inline int tmpfs_slot_shift(void) {
+	int shift;
+
+	for (shift = 0; (1UL << shift) < TMPFS_SLOTS; shift++) {
+	}
+
+	return shift;
+}
+
+/* Check if page number @a pg is covered by tree of @a height */
+static inline int tmpfs_fits(unsigned long pg, int height) {
+	int bits = height * tmpfs_slot_shift();
+
+	return (bits >= sizeof(pg) * CHAR_BIT) || ((pg >> bits) == 0);
+}
+
+static inline int tmpfs_may_alloc(struct tmpfs_fs_info *fsi, size_t cnt) {
+	return (TMPFS_PAGE_LIMIT == 0) || (fsi->page_cnt + cnt <= TMPFS_PAGE_LIMIT);
+}
+
+static void *tmpfs_page_alloc(struct tmpfs_fs_info *fsi) {
+	void *page;
+
+	if (!tmpfs_may_alloc(fsi, 1) || (NULL == (page = phymem_alloc(1)))) {
+		return NULL;
+	}
+	memset(page, 0, PAGE_SIZE());
+	fsi->page_cnt++;
+
+	return page;
+}
+
+static void tmpfs_page_free(struct tmpfs_fs_info *fsi, void *page) {
+	phymem_free(page, 1);
+	fsi->page_cnt--;
+}
+
+/**
+ * @brief Find slot which points to page @a pg of the file. Missing index
+ *        pages are allocated if @a alloc is set.
+ *
+ * @return Slot or NULL if there is no index for the page
+ */
+static void **tmpfs_slot(struct tmpfs_file_info *fi, unsigned long pg,
+		int alloc) {
+	void **slot, **node;
+	int shift, level;
+
+	if (!tmpfs_fits(pg, fi->height)) {
+		if (!alloc) {
+			return NULL;
+		}
+
+		/* Tree grows at the top, the old one becomes its first subtree */
+		while (!tmpfs_fits(pg, fi->height)) {
+			if (fi->root != NULL) {
+				if (NULL == (node = tmpfs_page_alloc(fi->fsi))) {
+					return NULL;
+				}
+				node[0] = fi->root;
+				fi->root = node;
+			}
+			fi->height++;
+		}
+	}
+
+	shift = tmpfs_slot_shift();
+	slot = &fi->root;
+	for (level = fi->height; level > 0; level--) {
+		if (*slot == NULL) {
+			if (!alloc || (NULL == (*slot = tmpfs_page_alloc(fi->fsi)))) {
+				return NULL;
+			}
+		}
+		slot = (void **) *slot
+			+ ((pg >> ((level - 1) * shift)) & (TMPFS_SLOTS - 1));
+	}
+
+	return slot;
+}
+
+static char *tmpfs_page_get(struct tmpfs_file_info *fi, unsigned long pg) {
+	void **slot;
+
+	slot = tmpfs_slot(fi, pg, 0);
+
+	return slot ? *slot : NULL;
+}
+
+/* Find mapping which shares any of @a cnt pages from @a first */
+static struct tmpfs_map *tmpfs_map_find(struct tmpfs_file_info *fi,
+		unsigned long first, unsigned long cnt) {
+	struct tmpfs_map *map;
+
+	dlist_foreach_entry(map, &fi->maps, link) {
+		if ((first < map->first + map->cnt) && (map->first < first + cnt)) {
+			return map;
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief Free pages from @a first in subtree @a node of @a height, which
+ *        starts with page @a base. Mapped pages are cleared, or are only
+ *        dropped from the index if @a drop_mapped is set, as they are freed
+ *        with their mapped block.
+ *
+ * @return 1 if the whole subtree was freed
+ */
+static int tmpfs_free_from(struct tmpfs_file_info *fi, void *node, int height,
+		unsigned long base, unsigned long first, int drop_mapped) {
+	void **slots;
+	unsigned long i, start;
+	int shift, empty;
+
+	if (height == 0) {
+		if (first != 0) {
+			return 0;
+		}
+		if (tmpfs_map_find(fi, base, 1)) {
+			if (drop_mapped) {
+				return 1;
+			}
+			memset(node, 0, PAGE_SIZE());
+			return 0;
+		}
+		tmpfs_page_free(fi->fsi, node);
+		return 1;
+	}
+
+	shift = (height - 1) * tmpfs_slot_shift();
+	start = first >> shift;
+	slots = node;
+	empty = 1;
+
+	for (i = 0; i < TMPFS_SLOTS; i++) {
+		if (slots[i] == NULL) {
+			continue;
+		}
+
+		if ((i < start) || !tmpfs_free_from(fi, slots[i], height - 1,
+				base + (i << shift),
+				(i == start) ? first - (start << shift) : 0, drop_mapped)) {
+			empty = 0;
+			continue;
+		}
+		slots[i] = NULL;
+	}
+
+	if (empty) {
+		tmpfs_page_free(fi->fsi, node);
+	}
+
+	return empty;
+}
+
+static void tmpfs_pages_free(struct tmpfs_file_info *fi, unsigned long first,
+		int drop_mapped) {
+	if ((fi->root != NULL) && tmpfs_free_from(fi, fi->root, fi->height, 0,
+				first, drop_mapped)) {
+		fi->root = NULL;
+		fi->height = 0;
+	}
+}
+
+static size_t tmpfs_read(struct file_desc *desc, void *buf, size_t size) {
+	struct tmpfs_file_info *fi;
+	char *page, *dst;
+	off_t pos;
+	size_t off, cnt;
+
+	fi = file_get_inode_data(desc);
+	assert(fi);
+
+	pos = file_get_pos(desc);
+	if (pos >= file_get_size(desc)) {
+		return 0;
+	}
+	size = min(size, file_get_size(desc) - pos);
+
+	for (dst = buf; dst < (char *) buf + size; dst += cnt, pos += cnt) {
+		off = pos % PAGE_SIZE();
+		cnt = min(PAGE_SIZE() - off, (char *) buf + size - dst);
+
+		page = tmpfs_page_get(fi, pos / PAGE_SIZE());
+		if (page) {
+			memcpy(dst, page + off, cnt);
+		} else {
+			/* Hole */
+			memset(dst, 0, cnt);
+		}
+	}
+
+	return size;
+}
+
+static size_t tmpfs_write(struct file_desc *desc, void *buf, size_t size) {
+	struct tmpfs_file_info *fi;
+	char *src;
+	void **slot;
+	off_t pos;
+	size_t off, cnt;
+
+	fi = file_get_inode_data(desc);
+	assert(fi);
+
+	pos = file_get_pos(desc);
+
+	for (src = buf; src < (char *) buf + size; src += cnt, pos += cnt) {
+		off = pos % PAGE_SIZE();
+		cnt = min(PAGE_SIZE() - off, (char *) buf + size - src);
+
+		slot = tmpfs_slot(fi, pos / PAGE_SIZE(), 1);
+		if ((slot == NULL)
+				|| ((*slot == NULL)
+					&& (NULL == (*slot = tmpfs_page_alloc(fi->fsi))))) {
+			break;
+		}
+
+		memcpy((char *) *slot + off, src, cnt);
+	}
+
+	if (file_get_size(desc) < pos) {
+		file_set_size(desc, pos);
+	}
+
+	if (src == buf && size != 0) {
+		return -ENOSPC;
+	}
+
+	return src - (char *) buf;
+}
+
+static void *tmpfs_mmap(struct file_desc *desc, void *addr, size_t len,
+		int prot, int flags, off_t off) {
+	struct tmpfs_file_info *fi;
+	struct tmpfs_map *map;
+	unsigned long first, cnt, i;
+	char *base, *page;
+	void **slot;
+
+	fi = file_get_inode_data(desc);
+	assert(fi);
+
+	if ((off % PAGE_SIZE()) || (len == 0)) {
+		SET_ERRNO(EINVAL);
+		return NULL;
+	}
+
+	first = off / PAGE_SIZE();
+	cnt = (len + PAGE_SIZE() - 1) / PAGE_SIZE();
+
+	map = tmpfs_map_find(fi, first, cnt);
+	if (map != NULL) {
+		if ((map->first <= first)
+				&& (first + cnt <= map->first + map->cnt)) {
+			/* Already in place */
+			return map->base + (first - map->first) * PAGE_SIZE();
+		}
+		/* Pages given to another mapping can't be moved */
+		SET_ERRNO(EBUSY);
+		return NULL;
+	}
+
+	/* Index is completed first, so the file stays intact on failure */
+	for (i = 0; i < cnt; i++) {
+		if (NULL == tmpfs_slot(fi, first + i, 1)) {
+			SET_ERRNO(ENOMEM);
+			return NULL;
+		}
+	}
+
+	if (NULL == (map = pool_alloc(&tmpfs_map_pool))) {
+		SET_ERRNO(ENOMEM);
+		return NULL;
+	}
+	if (!tmpfs_may_alloc(fi->fsi, cnt) || (NULL == (base = phymem_alloc(cnt)))) {
+		pool_free(&tmpfs_map_pool, map);
+		SET_ERRNO(ENOMEM);
+		return NULL;
+	}
+	fi->fsi->page_cnt += cnt;
+
+	for (i = 0; i < cnt; i++) {
+		slot = tmpfs_slot(fi, first + i, 0);
+		page = base + i * PAGE_SIZE();
+
+		if (*slot != NULL) {
+			memcpy(page, *slot, PAGE_SIZE());
+			tmpfs_page_free(fi->fsi, *slot);
+		} else {
+			memset(page, 0, PAGE_SIZE());
+		}
+		*slot = page;
+	}
+
+	map->first = first;
+	map->cnt = cnt;
+	map->base = base;
+	dlist_head_init(&map->link);
+	dlist_add_prev(&map->link, &fi->maps);
+
+	return base;
+}
+
+struct file_operations tmpfs_fops = {
+	.read  = tmpfs_read,
+	.write = tmpfs_write,
+	.mmap  = tmpfs_mmap,
+};
+
+int tmpfs_fill_sb(struct super_block *sb, const char *source) {
+	struct tmpfs_fs_info *fsi;
+
+	assert(sb);
+
+	if (NULL == (fsi = pool_alloc(&tmpfs_fs_pool))) {
+		return -ENOMEM;
+	}
+	memset(fsi, 0, sizeof(*fsi));
+
+	sb->sb_data = fsi;
+	sb->sb_fops = &tmpfs_fops;
+
+	return 0;
+}
+
+int tmpfs_clean_sb(struct super_block *sb) {
+	struct tmpfs_fs_info *fsi;
+
+	fsi = sb->sb_data;
+	assert(fsi);
+
+	pool_free(&tmpfs_fs_pool, fsi);
+
+	return 0;
+}
+
+struct tmpfs_file_info *tmpfs_file_alloc(struct inode *node) {
+	struct tmpfs_file_info *fi;
+
+	if (NULL == (fi = pool_alloc(&tmpfs_file_pool))) {
+		return NULL;
+	}
+
+	fi->root = NULL;
+	fi->height = 0;
+	fi->fsi = node->i_sb->sb_data;
+	dlist_init(&fi->maps);
+
+	inode_size_set(node, 0);
+	inode_priv_set(node, fi);
+
+	return fi;
+}
+
+void tmpfs_file_free(struct tmpfs_file_info *fi) {
+	struct tmpfs_map *map;
+
+	tmpfs_pages_free(fi, 0, 1);
+
+	/* Mappings must be gone with the file, munmap() doesn't reach us */
+	dlist_foreach_entry(map, &fi->maps, link) {
+		dlist_del(&map->link);
+		phymem_free(map->base, map->cnt);
+		fi->fsi->page_cnt -= map->cnt;
+		pool_free(&tmpfs_map_pool, map);
+	}
+
+	pool_free(&tmpfs_file_pool, fi);
+}
+
+int tmpfs_truncate(struct inode *node, off_t length) {
+	struct tmpfs_file_info *fi;
+	char *page;
+
+	assert(node);
+
+	fi = inode_priv(node);
+	assert(fi);
+
+	/* Tail of the last page must read as zeroes if the file grows again */
+	if (length % PAGE_SIZE()) {
+		page = tmpfs_page_get(fi, length / PAGE_SIZE());
+		if (page) {
+			memset(page + length % PAGE_SIZE(), 0,
+					PAGE_SIZE() - length % PAGE_SIZE());
+		}
+	}
+
+	tmpfs_pages_free(fi, (length + PAGE_SIZE() - 1) / PAGE_SIZE(), 0);
+
+	inode_size_set(node, length);
+
+	return 0;
+}
@@ -35,3 +35,13 @@ int dvfs_cache_del(struct dentry *dentry) {
 int dvfs_cache_add(struct dentry *dentry) {
 	return 0;
 }
+
+int dvfs_cache_negative(struct dentry *parent, const char *name) {
+	return 0;
+}
+
+void dvfs_cache_add_negative(struct dentry *parent, const char *name) {
+}
+
+void dvfs_cache_del_negative(struct dentry *parent, const char *name) {
+}
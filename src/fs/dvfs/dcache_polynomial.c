@@ -1,62 +1,194 @@
 /**
  * @file
  * @brief Cache strategy using polynomial hashes to retrive dentries
+ * @details Dentries are keyed by parent dentry and name of the path
+ *          component, so path walk is a chain of hash table lookups.
+ *          Names which were not found by file system are cached as
+ *          negative entries for a short time. Dentries which could not be
+ *          added to the table are kept in a list and added again when some
+ *          entry is removed.
  * @author Denis Deryugin <deryugin.denis@gmail.com>
  * @version 0.1
  * @date 2015-06-09
  */
 
+#include <assert.h>
+#include <stdint.h>
 #include <string.h>
 
+#include <embox/unit.h>
 #include <fs/dvfs.h>
-#include <kernel/printk.h>
+#include <hal/clock.h>
+#include <kernel/time/time.h>
 #include <mem/misc/pool.h>
-#include <util/hashtable.h>
+#include <util/dlist.h>
+#include <util/ohashtable.h>
 
-/* TODO remove this */
-#define DENTRY_POOL_SIZE 64
+#include <framework/mod/options.h>
 
-static const unsigned long long prime = 19, module = 1023;
-static unsigned long long pows[DVFS_MAX_PATH_LEN];
+#define DCACHE_TABLE_SIZE  OPTION_GET(NUMBER, table_size)
+#define DCACHE_NEG_MAX     OPTION_GET(NUMBER, negative_max)
+#define DCACHE_NEG_TTL     OPTION_GET(NUMBER, negative_ttl)
+/* Each dentry is in the list of missing ones at most once */
+#define DCACHE_MISS_MAX    OPTION_MODULE_GET(embox__fs__dvfs__core, \
+			NUMBER, dentry_pool_size)
 
-static void hash_init(void) {
-	/* TODO precount in runtime or even in compiletime */
-	int i;
-	pows[0] = 1;
-	for (i = 1; i < DVFS_MAX_PATH_LEN; i++)
-		pows[i] = (pows[i - 1] * prime) % module;
+struct dcache_key {
+	struct dentry *parent;
+	uint32_t hash;
+	char name[DENTRY_NAME_LEN];
+};
+
+struct dcache_neg {
+	struct dcache_key key;
+	clock_t expire;
+	struct dlist_head lnk;
+	struct dlist_head parent_lnk;
+};
+
+struct dcache_miss {
+	struct dentry *dentry;
+	struct dlist_head lnk;
+};
+
+/* Negative entries are stored in the table with this bit set */
+#define DCACHE_NEG_BIT 0x1
+
+static size_t dcache_key_hash(const void *key);
+
+OHASHTABLE_DEF(dcache_ht, DCACHE_TABLE_SIZE, struct dcache_key, dcache_key_hash);
+
+POOL_DEF(dcache_neg_pool, struct dcache_neg, DCACHE_NEG_MAX);
+/* Negative entries, least recently added first */
+static DLIST_DEFINE(dcache_neg_list);
+/* Negative entries by hash of parent, so they are dropped with the parent */
+static struct dlist_head dcache_neg_parent[DCACHE_NEG_MAX];
+
+POOL_DEF(dcache_miss_pool, struct dcache_miss, DCACHE_MISS_MAX);
+/* Dentries of VFS tree which could not be added to the table */
+static DLIST_DEFINE(dcache_miss_list);
+
+EMBOX_UNIT_INIT(dcache_init);
+
+static size_t dcache_key_hash(const void *key) {
+	return ((const struct dcache_key *)key)->hash;
 }
 
-static unsigned long long poly_hash(const char *str) {
-	unsigned long long res = 0;
-	const char *pos = str;
+/**
+ * @brief Fill the key with component @a name of @a len characters, the
+ *        name hash is counted while copying it
+ *
+ * @return Negative error code
+ */
+static int dcache_key_init(struct dcache_key *key, struct dentry *parent,
+		const char *name, size_t len) {
+	uint32_t hash;
+	size_t i;
+
+	if (len >= DENTRY_NAME_LEN) {
+		return -1;
+	}
 
-	hash_init();
+	/* Keys are compared bytewise, tail of the name must be zeroed */
+	memset(key, 0, sizeof(*key));
+	key->parent = parent;
 
-	while (*pos) {
-		res += ((int) *str) * pows[pos - str];
-		res %= module;
-		pos++;
+	hash = (uint32_t)((uintptr_t) parent >> 4);
+	for (i = 0; i < len; i++) {
+		key->name[i] = name[i];
+		hash = hash * 31 + (unsigned char) name[i];
 	}
-	return res;
+	key->hash = hash;
+
+	return 0;
 }
 
-static size_t get_dentry_hash(void *key) {
-	return (size_t) key;
+static inline int dcache_is_neg(void *value) {
+	return (uintptr_t) value & DCACHE_NEG_BIT;
 }
 
-static int cmp_dentries(void *key1, void *key2) {
-	return !(key1 == key2);
+static inline struct dcache_neg *dcache_to_neg(void *value) {
+	return (struct dcache_neg *)((uintptr_t) value & ~DCACHE_NEG_BIT);
 }
 
-HASHTABLE_DEF(dentry_ht,
-		DENTRY_POOL_SIZE * sizeof(struct dentry *),
-		get_dentry_hash,
-		cmp_dentries);
+static inline struct dlist_head *dcache_neg_bucket(struct dentry *parent) {
+	return &dcache_neg_parent[((uintptr_t) parent >> 4) % DCACHE_NEG_MAX];
+}
+
+static void dcache_neg_unlink(struct dcache_neg *neg) {
+	ohashtable_del(&dcache_ht, &neg->key);
+	dlist_del(&neg->lnk);
+	dlist_del(&neg->parent_lnk);
+}
 
-POOL_DEF(dentry_ht_pool, struct hashtable_item, DENTRY_POOL_SIZE);
+static void dcache_neg_free(struct dcache_neg *neg) {
+	dcache_neg_unlink(neg);
+	pool_free(&dcache_neg_pool, neg);
+}
 
-extern int dentry_full_path(struct dentry *dentry, char *buf);
+static struct dcache_miss *dcache_miss_find(struct dentry *dentry) {
+	struct dcache_miss *miss;
+
+	dlist_foreach_entry(miss, &dcache_miss_list, lnk) {
+		if (miss->dentry == dentry) {
+			return miss;
+		}
+	}
+
+	return NULL;
+}
+
+static void dcache_miss_free(struct dcache_miss *miss) {
+	dlist_del(&miss->lnk);
+	pool_free(&dcache_miss_pool, miss);
+}
+
+/**
+ * @brief Get positive entry or NULL. Expired negative entry is dropped.
+ */
+static void *dcache_get(struct dcache_key *key) {
+	void *value;
+
+	value = ohashtable_get(&dcache_ht, key);
+	if (value && dcache_is_neg(value)) {
+		if ((int32_t)(clock_sys_ticks() - dcache_to_neg(value)->expire) >= 0) {
+			dcache_neg_free(dcache_to_neg(value));
+			return NULL;
+		}
+	}
+
+	return value;
+}
+
+static int dcache_put(struct dentry *dentry) {
+	struct dcache_key key;
+	void *value;
+
+	if (dcache_key_init(&key, dentry->parent, dentry->name,
+				strlen(dentry->name))) {
+		return -1;
+	}
+
+	value = ohashtable_get(&dcache_ht, &key);
+	if (value && dcache_is_neg(value)) {
+		/* Name appeared */
+		dcache_neg_free(dcache_to_neg(value));
+	}
+
+	return ohashtable_put(&dcache_ht, &key, dentry);
+}
+
+/* Some entry was removed from the table, add missing dentries again */
+static void dcache_miss_retry(void) {
+	struct dcache_miss *miss;
+
+	dlist_foreach_entry(miss, &dcache_miss_list, lnk) {
+		if (dcache_put(miss->dentry)) {
+			break;
+		}
+		dcache_miss_free(miss);
+	}
+}
 
 /**
  * @brief Add dentry to cache
@@ -65,14 +197,29 @@ extern int dentry_full_path(struct dentry *dentry, char *buf);
  * @return Negative error code
  */
 int dvfs_cache_add(struct dentry *dentry) {
-	char pathname[DVFS_MAX_PATH_LEN];
-	unsigned long long hash;
-	struct hashtable_item *ht_item = pool_alloc(&dentry_ht_pool);
-	assert(ht_item);
-	dentry_full_path(dentry, pathname);
-	hash = poly_hash(pathname);
-	ht_item = hashtable_item_init(ht_item, (void *) *((size_t *) &hash), dentry);
-	hashtable_put(&dentry_ht, ht_item);
+	struct dcache_miss *miss;
+
+	if (!dentry->parent || dentry->name[0] == '\0') {
+		return 0;
+	}
+
+	miss = dcache_miss_find(dentry);
+
+	if (dcache_put(dentry)) {
+		if (!miss) {
+			miss = pool_alloc(&dcache_miss_pool);
+			assert(miss);
+			miss->dentry = dentry;
+			dlist_head_init(&miss->lnk);
+			dlist_add_prev(&miss->lnk, &dcache_miss_list);
+		}
+		return -1;
+	}
+
+	if (miss) {
+		dcache_miss_free(miss);
+	}
+
 	return 0;
 }
 
@@ -85,47 +232,194 @@ int dvfs_cache_add(struct dentry *dentry) {
  * @return Negative error code
  */
 int dvfs_cache_del(struct dentry *dentry) {
-	char pathname[DVFS_MAX_PATH_LEN];
-	unsigned long long hash;
-	struct hashtable_item *ht_item;
-	if (dentry->name[0] == '\0')
+	struct dcache_key key;
+	struct dcache_neg *neg;
+	struct dcache_miss *miss;
+
+	/* Names cached as absent in this directory are not valid anymore, as
+	 * the dentry may be reused for another directory */
+	dlist_foreach_entry(neg, dcache_neg_bucket(dentry), parent_lnk) {
+		if (neg->key.parent == dentry) {
+			dcache_neg_free(neg);
+		}
+	}
+
+	if ((miss = dcache_miss_find(dentry))) {
+		dcache_miss_free(miss);
+	}
+
+	if (!dentry->parent || dentry->name[0] == '\0') {
+		return -1;
+	}
+
+	if (dcache_key_init(&key, dentry->parent, dentry->name,
+				strlen(dentry->name))) {
 		return -1;
-	dentry_full_path(dentry, pathname);
-	hash = poly_hash(pathname);
-	if (!(ht_item = hashtable_del(&dentry_ht, (void *) *((size_t *) &hash)))) {
-		printk("Remove empty dentry\n");
 	}
-	pool_free(&dentry_ht_pool, ht_item);
+
+	/* The key may be already taken by another dentry with the same name,
+	 * e.g. by a mount point */
+	if (ohashtable_get(&dcache_ht, &key) == dentry) {
+		ohashtable_del(&dcache_ht, &key);
+		dcache_miss_retry();
+	}
+
 	return 0;
 }
 
 /**
- * @brief Try to get dentry with given path from cache
+ * @brief Try to get dentry with given name from cache
  *
- * @param path
+ * @param path   Name of the dentry
+ * @param lookup Parent of the dentry, lookup->item is skipped
  *
- * @return
+ * @return Dentry or NULL if it is not cached
  */
 struct dentry *dvfs_cache_get(char *path, struct lookup *lookup) {
-	unsigned long long hash = poly_hash(path);
-	struct dentry *res;
-	/* TODO local path hash offset */
-	res = hashtable_get(&dentry_ht, (void *) *((size_t *) &hash));
-	return res;
+	struct dcache_key key;
+	struct dcache_miss *miss;
+	struct dentry *d;
+
+	if (dcache_key_init(&key, lookup->parent, path, strlen(path))) {
+		return NULL;
+	}
+
+	d = dcache_get(&key);
+	if (d && !dcache_is_neg(d) && d != lookup->item) {
+		dentry_touch(d);
+		return d;
+	}
+
+	/* Dentry may be missing in the table */
+	dlist_foreach_entry(miss, &dcache_miss_list, lnk) {
+		d = miss->dentry;
+		if (d->parent == lookup->parent && d != lookup->item
+				&& !strcmp(d->name, path)) {
+			return d;
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief Resolve @a path relative to @a base using only cached dentries
+ *
+ * @return Referenced dentry or NULL if some component is not cached
+ */
+struct dentry *dvfs_cache_lookup(const char *path, struct dentry *base) {
+	struct dcache_key key;
+	struct dentry *d;
+	size_t len;
+
+	d = base;
+	while (1) {
+		while (*path == '/') {
+			path++;
+		}
+		if (*path == '\0') {
+			break;
+		}
+
+		len = strcspn(path, "/");
+		if (path[0] == '.' && (len == 1 || (len == 2 && path[1] == '.'))) {
+			/* Leave dot entries to the path walk */
+			return NULL;
+		}
+
+		if (dcache_key_init(&key, d, path, len)) {
+			return NULL;
+		}
+		d = dcache_get(&key);
+		if (!d || dcache_is_neg(d)) {
+			return NULL;
+		}
+		dentry_touch(d);
+
+		path += len;
+	}
+
+	dentry_ref_inc(d);
+
+	return d;
+}
+
+/**
+ * @brief Check if @a name is known to be absent in @a parent
+ */
+int dvfs_cache_negative(struct dentry *parent, const char *name) {
+	struct dcache_key key;
+	void *value;
+
+	if (dcache_key_init(&key, parent, name, strlen(name))) {
+		return 0;
+	}
+
+	value = dcache_get(&key);
+
+	return value && dcache_is_neg(value);
 }
 
-struct dentry *dvfs_cache_lookup(const char *path,
-	struct dentry *base) {
-	char full_path[DVFS_MAX_PATH_LEN];
-	struct dentry *ret;
+/**
+ * @brief Remember that file system has no @a name in @a parent
+ */
+void dvfs_cache_add_negative(struct dentry *parent, const char *name) {
+	struct dcache_key key;
+	struct dcache_neg *neg;
 
-	dentry_full_path(base, full_path);
-	strncat(full_path, path, DVFS_MAX_PATH_LEN - strlen(path));
+	if (dcache_key_init(&key, parent, name, strlen(name))) {
+		return;
+	}
 
-	/* TODO check path from root */
+	if (ohashtable_get(&dcache_ht, &key)) {
+		return;
+	}
 
-	ret = dvfs_cache_get(full_path, NULL);
-	dentry_ref_inc(ret);
+	neg = pool_alloc(&dcache_neg_pool);
+	if (!neg) {
+		/* Reuse the oldest entry */
+		neg = dlist_first_entry(&dcache_neg_list, struct dcache_neg, lnk);
+		dcache_neg_unlink(neg);
+	}
 
-	return ret;
+	neg->key = key;
+	neg->expire = clock_sys_ticks() + ms2jiffies(DCACHE_NEG_TTL);
+	dlist_head_init(&neg->lnk);
+	dlist_head_init(&neg->parent_lnk);
+
+	if (ohashtable_put(&dcache_ht, &neg->key,
+				(void *)((uintptr_t) neg | DCACHE_NEG_BIT))) {
+		pool_free(&dcache_neg_pool, neg);
+		return;
+	}
+	dlist_add_prev(&neg->lnk, &dcache_neg_list);
+	dlist_add_prev(&neg->parent_lnk, dcache_neg_bucket(parent));
+}
+
+/**
+ * @brief Forget that @a name is absent in @a parent, e.g. after it was
+ *        created by rename
+ */
+void dvfs_cache_del_negative(struct dentry *parent, const char *name) {
+	struct dcache_key key;
+	void *value;
+
+	if (dcache_key_init(&key, parent, name, strlen(name))) {
+		return;
+	}
+
+	value = ohashtable_get(&dcache_ht, &key);
+	if (value && dcache_is_neg(value)) {
+		dcache_neg_free(dcache_to_neg(value));
+	}
+}
+
+static int dcache_init(void) {
+	int i;
+
+	for (i = 0; i < DCACHE_NEG_MAX; i++) {
+		dlist_init(&dcache_neg_parent[i]);
+	}
+
+	return 0;
 }
@@ -76,6 +76,7 @@ int dvfs_create_new(const char *name, struct lookup *lookup, int flags) {
 	}
 
 	inode_fill(sb, new_inode, d);
+	dvfs_cache_add(d);
 
 	d->flags |= flags;
 	new_inode->i_mode |= flags;
@@ -416,6 +417,7 @@ int dvfs_mount(const char *source, const char *dest, const char *fs_type, int fl
 		d->flags |= VFS_DIR_VIRTUAL;
 		dentry_fill(sb, sb->sb_root, d, lookup.parent);
 		strcpy(d->name, lookup.item->name);
+		dvfs_cache_add(d);
 
 		d->flags |= S_IFDIR | DVFS_MOUNT_POINT;
 
@@ -96,6 +96,9 @@ extern struct dentry *dvfs_cache_lookup(const char *path, struct dentry *base);
 extern struct dentry *dvfs_cache_get(char *path, struct lookup *lookup);
 extern int dvfs_cache_del(struct dentry *dentry);
 extern int dvfs_cache_add(struct dentry *dentry);
+extern int dvfs_cache_negative(struct dentry *parent, const char *name);
+extern void dvfs_cache_add_negative(struct dentry *parent, const char *name);
+extern void dvfs_cache_del_negative(struct dentry *parent, const char *name);
 
 extern struct block_dev *bdev_by_path(const char *source);
 extern int dvfs_mount(const char *dev, const char *dest, const char *fstype, int flags);
@@ -108,6 +111,7 @@ extern int dentry_full_path(struct dentry *dentry, char *buf);
 extern int dentry_ref_inc(struct dentry *dentry);
 extern int dentry_ref_dec(struct dentry *dentry);
 extern int dentry_disconnect(struct dentry *dentry);
+extern void dentry_touch(struct dentry *dentry);
 extern int dentry_reconnect(struct dentry *parent, const char *name);
 
 #endif
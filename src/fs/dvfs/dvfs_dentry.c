@@ -55,8 +55,6 @@ int dentry_full_path(struct dentry *dentry, char *buf) {
 	return 0;
 }
 
-extern struct dentry *local_lookup(struct dentry *parent, char *name);
-
 /**
  * @brief Get the length of next element int the path
  * @param path Pointer to the path
@@ -90,6 +88,7 @@ int dvfs_path_walk(const char *path, struct dentry *parent, struct lookup *looku
 	struct inode *in;
 	int len;
 	struct dentry *d;
+	struct lookup cached = { .parent = parent };
 	assert(parent);
 	assert(path);
 
@@ -117,7 +116,7 @@ int dvfs_path_walk(const char *path, struct dentry *parent, struct lookup *looku
 		return -ENOTDIR;
 	}
 
-	if ((d = local_lookup(parent, buff))) {
+	if ((d = dvfs_cache_get(buff, &cached))) {
 		return dvfs_path_walk(path + strlen(buff), d, lookup);
 	}
 
@@ -134,7 +133,9 @@ int dvfs_path_walk(const char *path, struct dentry *parent, struct lookup *looku
 	assert(parent->d_sb->sb_iops);
 	assert(parent->d_sb->sb_iops->lookup);
 
-	if (!(in = parent->d_sb->sb_iops->lookup(buff, parent->d_inode))) {
+	if (dvfs_cache_negative(parent, buff)
+			|| !(in = parent->d_sb->sb_iops->lookup(buff, parent->d_inode))) {
+		dvfs_cache_add_negative(parent, buff);
 		*lookup = (struct lookup) {
 			.item   = NULL,
 			.parent = parent,
@@ -147,6 +148,7 @@ int dvfs_path_walk(const char *path, struct dentry *parent, struct lookup *looku
 		dentry_fill(parent->d_sb, in, d, parent);
 		strcpy(d->name, buff);
 		d->flags = in->i_mode;
+		dvfs_cache_add(d);
 	}
 
 	return dvfs_path_walk(path + strlen(buff), in->i_dentry, lookup);
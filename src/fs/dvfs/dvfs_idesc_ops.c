@@ -72,6 +72,22 @@ static int idesc_file_ops_status(struct idesc *idesc, int mask) {
 	return 1;
 }
 
+static void *idesc_file_ops_mmap(struct idesc *idesc, void *addr, size_t len,
+		int prot, int flags, int fd, off_t off) {
+	struct file_desc *desc;
+
+	assert(idesc);
+	assert(idesc->idesc_ops == &idesc_file_ops);
+
+	desc = (struct file_desc *) idesc;
+	if (NULL == desc->f_ops->mmap) {
+		SET_ERRNO(ENODEV);
+		return NULL;
+	}
+
+	return desc->f_ops->mmap(desc, addr, len, prot, flags, off);
+}
+
 const struct idesc_ops idesc_file_ops = {
 	.close = idesc_file_ops_close,
 	.id_readv  = idesc_file_ops_read,
@@ -79,5 +95,6 @@ const struct idesc_ops idesc_file_ops = {
 	.ioctl = idesc_file_ops_ioctl,
 	.fstat = idesc_file_ops_stat,
 	.status = idesc_file_ops_status,
+	.idesc_mmap = idesc_file_ops_mmap,
 };
 
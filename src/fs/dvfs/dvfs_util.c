@@ -10,6 +10,7 @@
 #include <sys/stat.h>
 
 #include <drivers/device.h>
+#include <fs/bcache.h>
 #include <fs/dvfs.h>
 #include <framework/mod/options.h>
 #include <mem/misc/pool.h>
@@ -204,8 +205,9 @@ struct dentry *dvfs_alloc_dentry(void) {
 
 	memset(dentry, 0, sizeof(struct dentry));
 
+	/* Least recently used dentries are at the list head */
 	dlist_head_init(&dentry->d_lnk);
-	dlist_add_next(&dentry->d_lnk, &dentry_dlist);
+	dlist_add_prev(&dentry->d_lnk, &dentry_dlist);
 	dlist_init(&dentry->children);
 
 	return dentry;
@@ -442,11 +444,24 @@ int super_block_free(struct super_block *sb) {
 		err = sb->fs_drv->clean_sb(sb);
 	}
 
+	if (sb->bdev) {
+		/* Don't leave delayed writes of unmounted file system */
+		bcache_flush(sb->bdev);
+	}
+
 	pool_free(&superblock_pool, sb);
 
 	return err;
 }
 
+/**
+ * @brief Mark dentry as recently used, so it is reclaimed last
+ */
+void dentry_touch(struct dentry *dentry) {
+	dlist_del(&dentry->d_lnk);
+	dlist_add_prev(&dentry->d_lnk, &dentry_dlist);
+}
+
 /**
  * @brief Remove dentry from file tree, but leave it
  * in dentry cache
@@ -471,6 +486,7 @@ int dentry_reconnect(struct dentry *parent, const char *name) {
 		if (dentry->parent == parent && !strcmp(dentry->name, name)) {
 			dlist_head_init(&dentry->children_lnk);
 			dlist_add_prev(&dentry->children_lnk, &parent->children);
+			dvfs_cache_add(dentry);
 		}
 	}
 	return 0;
@@ -57,6 +57,7 @@ static int fuse_fill_dentry(struct super_block *sb, char *dest) {
 
 		dentry_fill(sb, NULL, d, lookup.parent);
 		strcpy(d->name, lookup.item->name);
+		dvfs_cache_add(d);
 	} else {
 		d = lookup.item;
 		/* TODO free related inode */
@@ -13,9 +13,18 @@
 #include <fs/idesc.h>
 #include <fcntl.h>
 #include <kernel/sched.h>
+#include <kernel/thread/sync/rwlock.h>
 
 #include <fs/idesc_event.h>
 
+#include <embox/unit.h>
+
+EMBOX_UNIT_INIT(idesc_event_init);
+
+/* Watched descriptors are used by watch owners for reading and are
+ * released for writing */
+static rwlock_t idesc_watch_rwlock;
+
 int idesc_wait_prepare(struct idesc *i, struct idesc_wait_link *wl) {
 
 	waitq_wait_prepare(&i->idesc_waitq, &wl->link);
@@ -28,6 +37,16 @@ int idesc_wait_prepare(struct idesc *i, struct idesc_wait_link *wl) {
 }
 
 int idesc_notify(struct idesc *idesc, int mask) {
+	struct idesc_watch *watch;
+	ipl_t ipl;
+
+	if (idesc->idesc_watchers != NULL) {
+		ipl = spin_lock_ipl(&idesc->idesc_waitq.lock);
+		for (watch = idesc->idesc_watchers; watch != NULL; watch = watch->next) {
+			watch->notify(watch, mask);
+		}
+		spin_unlock_ipl(&idesc->idesc_waitq.lock, ipl);
+	}
 
 	//TODO MASK
 	waitq_wakeup(&idesc->idesc_waitq, 0);
@@ -35,6 +54,65 @@ int idesc_notify(struct idesc *idesc, int mask) {
 	return 0;
 }
 
+void idesc_watch_add(struct idesc *idesc, struct idesc_watch *watch) {
+	ipl_t ipl;
+
+	ipl = spin_lock_ipl(&idesc->idesc_waitq.lock);
+	watch->next = idesc->idesc_watchers;
+	idesc->idesc_watchers = watch;
+	spin_unlock_ipl(&idesc->idesc_waitq.lock, ipl);
+}
+
+void idesc_watch_del(struct idesc *idesc, struct idesc_watch *watch) {
+	struct idesc_watch **pwatch;
+	ipl_t ipl;
+
+	ipl = spin_lock_ipl(&idesc->idesc_waitq.lock);
+	for (pwatch = &idesc->idesc_watchers; *pwatch != NULL;
+			pwatch = &(*pwatch)->next) {
+		if (*pwatch == watch) {
+			*pwatch = watch->next;
+			watch->next = NULL;
+			break;
+		}
+	}
+	spin_unlock_ipl(&idesc->idesc_waitq.lock, ipl);
+}
+
+void idesc_watch_release(struct idesc *idesc) {
+	struct idesc_watch *watch;
+	ipl_t ipl;
+
+	if (idesc->idesc_watchers == NULL) {
+		return;
+	}
+
+	rwlock_write_up(&idesc_watch_rwlock);
+	{
+		ipl = spin_lock_ipl(&idesc->idesc_waitq.lock);
+		while ((watch = idesc->idesc_watchers) != NULL) {
+			idesc->idesc_watchers = watch->next;
+			watch->next = NULL;
+			watch->notify(watch, POLLNVAL);
+		}
+		spin_unlock_ipl(&idesc->idesc_waitq.lock, ipl);
+	}
+	rwlock_write_down(&idesc_watch_rwlock);
+}
+
+void idesc_watch_use_begin(void) {
+	rwlock_read_up(&idesc_watch_rwlock);
+}
+
+void idesc_watch_use_end(void) {
+	rwlock_read_down(&idesc_watch_rwlock);
+}
+
 void idesc_wait_cleanup(struct idesc *i, struct idesc_wait_link *wl) {
 	waitq_wait_cleanup(&i->idesc_waitq, &wl->link);
 }
+
+static int idesc_event_init(void) {
+	rwlock_init(&idesc_watch_rwlock);
+	return 0;
+}
@@ -9,6 +9,7 @@
 #include <string.h>
 
 #include <embox/unit.h>
+#include <fs/bcache.h>
 #include <fs/dentry.h>
 #include <fs/fs_driver.h>
 #include <fs/inode.h>
@@ -63,6 +64,11 @@ int super_block_free(struct super_block *sb) {
 		ret = sb->fs_drv->clean_sb(sb);
 	}
 
+	if (sb->bdev) {
+		/* Don't leave delayed writes of unmounted file system */
+		bcache_flush(sb->bdev);
+	}
+
 	if (sb->sb_root) {
 		/* Mount root should be generally
 		 * freed on umount */
@@ -10,6 +10,7 @@
 #define EMBOX_NET_PROTO_H_
 
 struct sk_buff;
+struct sk_buff_head;
 
 /**
  * Each netproto implements this interface.
@@ -19,6 +20,8 @@ typedef struct net_proto {
 	unsigned char type;
 	int (*handle)(struct sk_buff *skb);
 	void (*handle_error)(const struct sk_buff *skb, int error_info);
+	/* optional handler for list of packets, may be NULL */
+	void (*handle_list)(struct sk_buff_head *list);
 } net_proto_t;
 
 
@@ -46,4 +49,19 @@ ARRAY_SPREAD_DECLARE(const struct net_proto, __net_proto_registry);
 				.handle_error = _handle_error                                \
 			})
 
+#define EMBOX_NET_PROTO_LIST(_pack, _type, _handle, _handle_error,          \
+		_handle_list)                                                        \
+	static int _handle(struct sk_buff *skb);                                 \
+	static void _handle_error(const struct sk_buff *skb, int error_info);    \
+	static void _handle_list(struct sk_buff_head *list);                     \
+	ARRAY_SPREAD_DECLARE(const struct net_proto, __net_proto_registry);      \
+	ARRAY_SPREAD_ADD_NAMED(__net_proto_registry,                             \
+			__net_proto_##_pack##_type, {                                    \
+				.pack = _pack,                                               \
+				.type = _type,                                               \
+				.handle = _handle,                                           \
+				.handle_error = _handle_error,                               \
+				.handle_list = _handle_list                                  \
+			})
+
 #endif /* EMBOX_NET_PROTO_H_ */
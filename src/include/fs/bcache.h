@@ -28,4 +28,41 @@ static inline void bcache_buffer_unlock(struct buffer_head *bh) {
  */
 extern struct buffer_head *bcache_getblk_locked(struct block_dev *bdev, int block, size_t size);
 
+/**
+ * Read locked buffer @a bh from disk. Up to @a count - 1 following blocks
+ * which are not cached yet are read ahead in the same device request.
+ *
+ * @return 0 on success, negative error code otherwise
+ */
+extern int bcache_buffer_read(struct buffer_head *bh, int count);
+
+/**
+ * Commit modification of locked buffer @a bh. Buffer is written to disk
+ * immediately or later by writeback thread, depending on bcache options.
+ *
+ * @return 0 on success, negative error code otherwise
+ */
+extern int bcache_buffer_write(struct buffer_head *bh);
+
+/**
+ * Read or write @a cnt adjacent blocks of @a bdev starting from @a block
+ * right to or from @a buf in one device request. Cached copies of the blocks
+ * are updated on write and take precedence on read.
+ *
+ * @return 0 on success, -EAGAIN if the transfer should go through buffers,
+ *   e.g. if @a buf is not aligned, negative error code otherwise
+ */
+extern int bcache_direct_io(struct block_dev *bdev, char *buf, int block,
+		int cnt, size_t blksize, int write);
+
+/**
+ * Write all dirty buffers of @a bdev (of all devices if NULL) to disk,
+ * sorted and merged into runs of adjacent blocks. Buffers locked by other
+ * threads are waited for, so the caller must not hold buffers of other
+ * threads' interest.
+ *
+ * @return 0 on success, negative error code of the last failed write otherwise
+ */
+extern int bcache_flush(struct block_dev *bdev);
+
 #endif /* FS_BCACHE_H_ */
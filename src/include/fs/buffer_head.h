@@ -38,10 +38,12 @@ struct buffer_head {
 	struct dlist_head bh_next;      /* link to global list of buffer_heads */
 	char *data;                     /* pointer to block's data */
 	int lock_count;			/* lock count to support multiplie locks */
+	int pin_count;                  /* waiters for the lock, buffer is kept while they wait */
 	/*
 	 * XXX Seems it is not better solution to have back reference to journal.
 	 */
 	journal_block_t *journal_block; /* pointer to corresponding up-to-date block from journal (if any) */
+	struct block_req req;           /* request for asynchronous device */
 };
 
 extern void buffer_encrypt(struct buffer_head *bh);
@@ -10,6 +10,7 @@
 #define FS_FILE_OPERATION_H_
 
 #include <stddef.h>
+#include <sys/types.h>
 
 struct inode;
 struct file_desc;
@@ -30,6 +31,9 @@ struct file_operations {
 	size_t (*read)(struct file_desc *desc, void *buf, size_t size);
 	size_t (*write)(struct file_desc *desc, void *buf, size_t size);
 	int    (*ioctl)(struct file_desc *desc, int request, void *data);
+	/* Return address of the file data at @a off, NULL on error */
+	void  *(*mmap)(struct file_desc *desc, void *addr, size_t len, int prot,
+			int flags, off_t off);
 };
 
 #endif /* FS_FILE_OPERATION_H_ */
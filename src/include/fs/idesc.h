@@ -10,6 +10,7 @@
 
 struct idesc_ops;
 struct idesc_xattrops;
+struct idesc_watch;
 
 #include <sys/types.h>
 
@@ -21,6 +22,7 @@ struct idesc {
 	const struct idesc_xattrops *idesc_xattrops;
 	unsigned int idesc_flags;
 	int idesc_count;
+	struct idesc_watch *idesc_watchers; /* see fs/idesc_event.h */
 };
 
 struct iovec;
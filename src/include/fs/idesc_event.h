@@ -10,9 +10,10 @@
 #define IDESC_EVENT_H_
 
 #include <kernel/sched/waitq.h>
+#include <kernel/spinlock.h>
 #include <poll.h> /* for flags */
 
-struct idesc;
+#include <fs/idesc.h>
 
 /**
  * The same as struct wait_link link but have poll flags
@@ -56,6 +57,32 @@ extern void idesc_wait_cleanup(struct idesc *idesc, struct idesc_wait_link *wl);
  */
 extern int idesc_notify(struct idesc *idesc, int mask);
 
+/**
+ * Persistent subscription to events of idesc. Unlike idesc_wait_link it isn't
+ * bound to a waiting thread: @a notify is called from idesc_notify() (with
+ * idesc locked, so it must not sleep) on every event until the watch is
+ * removed. When the descriptor is finally closed @a notify is called with
+ * POLLNVAL and the watch is removed automatically. Owner of the watch that
+ * uses the descriptor outside of @a notify does it between
+ * idesc_watch_use_begin() and idesc_watch_use_end(), so the descriptor isn't
+ * closed meanwhile.
+ */
+struct idesc_watch {
+	struct idesc_watch *next;
+	void (*notify)(struct idesc_watch *watch, int mask);
+};
+
+extern void idesc_watch_add(struct idesc *idesc, struct idesc_watch *watch);
+extern void idesc_watch_del(struct idesc *idesc, struct idesc_watch *watch);
+
+/**
+ * @brief Detach all watches of idesc which is being closed
+ */
+extern void idesc_watch_release(struct idesc *idesc);
+
+extern void idesc_watch_use_begin(void);
+extern void idesc_watch_use_end(void);
+
 /* TODO mask is unused, and not sure if sometime will. This is called from
  * object's operation which can't continue until some condition occur. Even
  * if this is successfuly worked, it is not unlikely that operation still can't
@@ -165,6 +165,8 @@ static inline int critical_inside(unsigned int level) {
 	return critical_count() & level;
 }
 
+/* The outermost critical level of a CPU takes Big Kernel Lock. With
+ * embox.kernel.cpu.smp_no_bkl it's a no-op, and the levels are per-CPU only. */
 static inline void critical_enter(unsigned int level) {
 	__critical_count_add(__CRITICAL_COUNT(level));
 	if (critical_count() == __CRITICAL_COUNT(level)) {
@@ -14,9 +14,14 @@
 #include <kernel/printk.h>
 #include <debug/whereami.h>
 
+/* Prints messages stored by deferred logging, see util/logging.h */
+extern void logging_flush(void) __attribute__ ((weak));
+
 #define panic(...) \
 	do { \
 		ipl_disable(); \
+		if (logging_flush) \
+			logging_flush(); \
 		printk(__VA_ARGS__); \
 		whereami(); \
 		arch_shutdown(ARCH_SHUTDOWN_MODE_ABORT); \
@@ -45,6 +45,8 @@
  *                others can set it to a non-zero during wake up
  *   s->waiting - current can change it from zero to a non-zero with no locks,
  *                others access it with s->lock held and interrupts off
+ *   s->cpu     - (SMP) CPU which runq the schedee belongs to, changed only
+ *                with that runq lock held
  */
 struct schedee {
 	runq_item_t       runq_link;
@@ -67,6 +69,8 @@ struct schedee {
 	unsigned int ready;   /**< Managed by the scheduler. */
 	unsigned int waiting; /**< Waiting for an event. */
 
+	unsigned int cpu;     /**< Runq owner CPU (last CPU it was run on). */
+
 	struct affinity         affinity;
 	struct sched_timing     sched_timing;
 	struct schedee_priority priority;
@@ -17,6 +17,8 @@ extern void runq_init(runq_t *queue);
 extern void runq_insert(runq_t *queue, struct schedee *schedee);
 extern void runq_remove(runq_t *queue, struct schedee *schedee);
 extern struct schedee *runq_extract(runq_t *queue);
+/** The schedee runq_extract() would return, but left in the queue */
+extern struct schedee *runq_peek(runq_t *queue);
 
 extern void runq_item_init(runq_item_t *runq_link);
 
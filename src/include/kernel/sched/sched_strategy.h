@@ -19,6 +19,7 @@
 struct runq {
 	runq_t queue;
 	spinlock_t lock;
+	unsigned int count; /**< Number of schedees in the queue. */
 };
 
 #endif /* KERNEL_SCHED_SCHED_STRATEGY_H_ */
@@ -21,4 +21,12 @@ extern void timer_strat_stop(struct sys_timer *ptimer);
 
 extern void timer_strat_start(struct sys_timer *ptimer);
 
+/**
+ * Protects timers of the strategy on SMP. It is taken around all timer_strat
+ * calls and may be taken again by the same CPU, so timer handlers called from
+ * timer_strat_sched() are free to start and stop timers.
+ */
+extern void timer_strat_lock(void);
+extern void timer_strat_unlock(void);
+
 #endif /* TIMER_STRAT_H_ */
@@ -15,5 +15,7 @@ extern void bm_init(void *heap, size_t size);
 extern void *bm_memalign(void *heap, size_t boundary, size_t size);
 extern void bm_free(void *heap, void *ptr);
 extern int bm_heap_is_empty(void *heap);
+/* Size of busy block data or 0 if the block is free */
+extern size_t bm_usable_size(void *heap, void *ptr);
 
 #endif /* MEM_HEAP_BM_H_ */
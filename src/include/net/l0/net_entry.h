@@ -17,4 +17,31 @@
  */
 extern int netif_rx(void *pack);
 
+struct net_device;
+struct sk_buff;
+
+/**
+ * Schedule polling of the device which has a poll handler in its driver.
+ * Called from the interrupt handler after the device RX interrupts were
+ * disabled. Driver poll handler will be called with the budget it may spend
+ * until all received packets are processed.
+ * @param dev device with received packets
+ */
+extern void netif_rx_schedule(struct net_device *dev);
+
+/**
+ * Stop polling of the device. Called from the poll handler which processed
+ * less packets than its budget, then driver may enable RX interrupts.
+ * @param dev polled device
+ */
+extern void netif_rx_complete(struct net_device *dev);
+
+/**
+ * Pass received packet to the stack from the driver poll handler. Packets
+ * are collected and handled as one batch after the poll handler returns.
+ * @param skb received packet
+ * @return NET_RX_SUCCESS or NET_RX_DROP
+ */
+extern int netif_receive_skb(struct sk_buff *skb);
+
 #endif /* NET_L0_NET_ENTRY_ */
@@ -17,4 +17,11 @@
  */
 extern int net_rx(struct sk_buff *skb);
 
+/**
+ * Handle list of incoming packages at once. Packages are passed to upper
+ * layers in batches, so per packet lookups and locking could be amortized.
+ * @param list - incoming packages, it's empty on return
+ */
+extern void net_rx_list(struct sk_buff_head *list);
+
 #endif /* NET_L0_NET_RX_ */
@@ -17,6 +17,9 @@
 
 #include <linux/types.h>
 #include <linux/list.h>
+#include <util/dlist.h>
+#include <kernel/spinlock.h>
+#include <kernel/time/timer.h>
 #include <net/socket/inet_sock.h>
 #include <net/socket/inet6_sock.h>
 
@@ -100,12 +103,24 @@ typedef struct tcp_sock {
 	struct list_head conn_free; /* Queue of free sockets for incoming connections */
 	unsigned int free_wait_queue_len; /* @a conn_wait length plus @a conn_free length */
 	unsigned int free_wait_queue_max; /* Maximum @a conn_wait length plus @a conn_free length */
-	unsigned int lock;          /* Tool for synchronization */
+	unsigned int lock;          /* Nesting of the lock by the owning CPU */
+	spinlock_t lock_spin;       /* Lock of the socket, see tcp_sock_lock() */
+	struct tcp_sock *lock_parent; /* Listening socket locked with this one */
 	struct timeval syn_time;    /* The time when synchronization started */
-	struct timeval ack_time;    /* The time when message was ACKed */
-	struct timeval rcv_time;    /* The time when last message was received (ONLY FOR TCP_TIMEWAIT) */
 	unsigned int dup_ack;       /* Amount of duplicated packets */
 	unsigned int rexmit_mode;   /* Socket in rexmit mode */
+	struct sys_timer rexmit_tmr; /* Retransmission (and SYN timeout) timer */
+	unsigned int srtt;          /* Smoothed RTT in ms scaled by 8 (0 if no sample yet) */
+	unsigned int rttvar;        /* RTT variation in ms scaled by 4 */
+	unsigned int rto;           /* Current retransmission timeout in ms */
+	unsigned int backoff;       /* Amount of timeouts without new acknowledgments */
+	unsigned int rtt_timing;    /* Is there a segment timed for RTT sample */
+	uint32_t rtt_seq;           /* End sequence of the timed segment */
+	clock_t rtt_start;          /* The time when timed segment was sent */
+	struct dlist_head tw_lnk;   /* Link for TIME-WAIT reaper queue */
+	struct dlist_head rexmit_lnk; /* Link for queue of expired rexmit timers */
+	clock_t tw_expire;          /* The time when TIME-WAIT state is over */
+	uint16_t mss;               /* MSS option of remote, 0 if it's not sent */
 } tcp_sock_t;
 
 static inline struct tcp_sock * to_tcp_sock(
@@ -122,10 +137,11 @@ enum {
 };
 
 /* Delays in milliseconds */
-#define TCP_TIMER_FREQUENCY   1000  /* Frequency for tcp_tmr_default */
 #define TCP_TIMEWAIT_DELAY    2000  /* Delay for TIME-WAIT state */
-#define TCP_REXMIT_DELAY      2000  /* Delay between rexmitting */
 #define TCP_SYNC_TIMEOUT      5000  /* Synchronization timeout */
+#define TCP_RTO_INITIAL       1000  /* RTO before first RTT sample (RFC 6298) */
+#define TCP_RTO_MIN            200  /* Lower bound of RTO */
+#define TCP_RTO_MAX          60000  /* Upper bound of RTO after backoff */
 
 #define TCP_REXMIT_DUP_ACK       5  /* Rexmit after n duplicate ack */
 
@@ -153,6 +169,7 @@ extern const struct sock_proto_ops *const tcp_sock_ops __attribute__((weak));
 
 /* Others functionality */
 extern void tcp_sock_release(struct tcp_sock *tcp_sk);
+extern void tcp_sock_timers_init(struct tcp_sock *tcp_sk);
 extern void tcp_sock_set_state(struct tcp_sock *tcp_sk,
 		enum tcp_sock_state new_state);
 extern void tcp_seq_state_set_wind_value(struct tcp_seq_state *tcp_seq_st,
@@ -47,6 +47,13 @@ extern void tcp6_set_check_field(struct tcphdr *tcph,
 extern void tcp_set_check_field(struct tcphdr *tcph,
 		const void *nhhdr);
 
+/**
+ * Set TCP check field to the sum of pseudo header only, the rest of
+ * checksum is counted by device (CHECKSUM_PARTIAL)
+ */
+extern void tcp4_set_check_partial(struct tcphdr *tcph,
+		const struct iphdr *iph);
+
 /**
  * Calculate TCP data length
  */
@@ -75,6 +75,10 @@ typedef struct net_driver {
 	int (*mdio_write)(struct net_device *dev, uint8_t reg, uint16_t data);
 	void (*set_phyid)(struct net_device *dev, uint8_t phyid);
 	int (*set_speed)(struct net_device *dev, int speed);
+	/* Process at most budget received packets, return number of them */
+	int (*poll)(struct net_device *dev, int budget);
+	/* Kick device after a batch of xmit calls */
+	void (*xmit_flush)(struct net_device *dev);
 } net_driver_t;
 
 
@@ -104,6 +108,12 @@ typedef struct net_device_ops {
 	int (*check_mtu)(int mtu);
 } net_device_ops_t;
 
+/**
+ * Offloads supported by device
+ */
+#define NETIF_F_HW_CSUM 0x1 /* Device completes CHECKSUM_PARTIAL checksums */
+#define NETIF_F_TSO     0x2 /* Device splits TCP over IPv4 by gso_size */
+
 /**
  * structure of net device
  */
@@ -116,6 +126,7 @@ typedef struct net_device {
 	unsigned char hdr_len; /**< hardware header length      */
 	unsigned char addr_len; /**< hardware address length      */
 	unsigned int flags; /**< interface flags (a la BSD)   */
+	unsigned int features; /**< offloads, see NETIF_F_xxx */
 	unsigned int mtu; /**< interface MTU value          */
 	uintptr_t base_addr; /**< device I/O address           */
 	unsigned int irq; /**< device IRQ number            */
@@ -51,6 +51,15 @@ typedef struct sk_buff {        /* Socket buffer */
 		/* Length of actual data, from LL header till the end */
 	size_t len;
 
+		/* Checksum state of transport layer, see CHECKSUM_xxx */
+	unsigned char ip_summed;
+		/* Offset of checksum field from transport header, checksum is
+		 * counted from the transport header till the end of packet */
+	unsigned short csum_offset;
+		/* Size of data in segments device must split packet to,
+		 * zero if the packet is sent as is */
+	unsigned short gso_size;
+
 		/* Transport layer header */
 	union {
 		struct tcphdr *th;
@@ -94,6 +103,14 @@ typedef struct sk_buff {        /* Socket buffer */
 	struct timeval tstamp;
 } sk_buff_t;
 
+/**
+ * Values of sk_buff ip_summed
+ */
+#define CHECKSUM_NONE        0 /* Checksum is complete, it's not verified */
+#define CHECKSUM_UNNECESSARY 1 /* Device has verified checksum */
+#define CHECKSUM_PARTIAL     2 /* Checksum field contains pseudo header sum
+								  only, device completes it */
+
 extern size_t skb_max_size(void);
 extern size_t skb_extra_max_size(void);
 
@@ -144,6 +161,11 @@ extern void skb_free(struct sk_buff *skb);
  */
 extern void skb_rshift(struct sk_buff *skb, size_t count);
 
+/**
+ * Count CHECKSUM_PARTIAL checksum in software, e.g. if device can't do it
+ */
+extern void skb_checksum_complete(struct sk_buff *skb);
+
 /**
  * Make a full sk_buff copy
  */
@@ -74,6 +74,7 @@ struct sock {
 	struct idesc idesc;
 	struct sock_xattr sock_xattr;
 	struct dlist_head lnk;
+	struct dlist_head demux_lnk;
 	enum sock_state state;
 	struct sock_opt opt;
 	struct sk_buff_head rx_queue;
@@ -146,8 +147,33 @@ struct sock_proto_ops {
 	int (*shutdown)(struct sock *sk, int how);
 	struct pool *sock_pool;
 	struct dlist_head *sock_list;
+	struct sock_demux *sock_demux;
 };
 
+/**
+ * Receive demultiplexing table of a protocol. Sockets connected to a foreign
+ * address and port are hashed by (local port, foreign port, foreign address),
+ * all the others only by the local port. Table has to be defined with
+ * #SOCK_DEMUX_DEF.
+ */
+struct sock_demux {
+	unsigned int conn_size;
+	struct dlist_head *conn;
+	unsigned int bound_size;
+	struct dlist_head *bound;
+	int initialized;
+};
+
+#define SOCK_DEMUX_DEF(name, conn_sz, bound_sz) \
+	static struct dlist_head name ## _conn[conn_sz];   \
+	static struct dlist_head name ## _bound[bound_sz]; \
+	static struct sock_demux name = {                  \
+		.conn_size  = conn_sz,                         \
+		.conn       = name ## _conn,                   \
+		.bound_size = bound_sz,                        \
+		.bound      = name ## _bound,                  \
+	}
+
 /* Base class for protocol sockets */
 struct proto_sock {
 	struct sock *sk;
@@ -170,6 +196,12 @@ extern void sock_release(struct sock *sk);
 extern void sock_hash(struct sock *sk);
 extern void sock_unhash(struct sock *sk);
 
+/**
+ * Moves @p sk to the proper demux bucket. Must be called each time
+ * the socket local or foreign address is changed.
+ */
+extern void sock_rehash(struct sock *sk);
+
 
 extern void sock_rcv(struct sock *sk, struct sk_buff *skb,
 		unsigned char *p_data, size_t size);
@@ -201,6 +233,25 @@ extern struct sock * sock_lookup(const struct sock *sk,
 		sock_lookup_tester_ft tester,
 		const struct sk_buff *skb);
 
+/**
+ * Looks up a connected socket in the demux table of @p p_ops. Only sockets
+ * hashed with the same ports and foreign address are passed to @p tester.
+ * Falls back to #sock_lookup if the protocol has no demux table.
+ */
+extern struct sock * sock_lookup_connected(const struct sock_proto_ops *p_ops,
+		sock_lookup_tester_ft tester, const struct sk_buff *skb,
+		const void *faddr, size_t faddr_len,
+		in_port_t lport, in_port_t fport);
+
+/**
+ * Looks up a not connected (bound or listening) socket with local port
+ * @p lport in the demux table of @p p_ops.
+ * Falls back to #sock_lookup if the protocol has no demux table.
+ */
+extern struct sock * sock_lookup_bound(const struct sock_proto_ops *p_ops,
+		sock_lookup_tester_ft tester, const struct sk_buff *skb,
+		in_port_t lport);
+
 typedef int (*sock_addr_tester_ft)(const struct sockaddr *addr1,
 		const struct sockaddr *addr2);
 
@@ -0,0 +1,142 @@
+/**
+ * @file
+ *
+ * @brief Open addressing hash table with inline keys
+ *
+ * @details Robin Hood hashing with linear probing. Keys of fixed size are
+ * copied into the slot array, so a lookup is a walk over a contiguous
+ * array without per-item allocations. When the table becomes too full a
+ * twice bigger table is allocated and entries are moved there a few slots
+ * per operation, so no single insertion pays for the whole rehash.
+ *
+ * Keys are compared bytewise, so key structures with padding must be
+ * zeroed before they are filled in.
+ *
+ * @date 17.10.2026
+ */
+
+#ifndef UTIL_OHASHTABLE_H_
+#define UTIL_OHASHTABLE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <util/binalign.h>
+
+/** Hash function type definition */
+typedef size_t (*oht_hash_ft)(const void *key);
+
+struct ohashtable_slot {
+	uint32_t hash; /**< 0 for empty slot */
+	void *value;
+	char key[];
+};
+
+struct ohashtable_tab {
+	void *slots;
+	unsigned int size; /**< power of two */
+	unsigned int cnt;
+};
+
+/**
+ * Handler of open addressing hash table. Fields must not be used outside
+ * of hash table implementation.
+ */
+struct ohashtable {
+	struct ohashtable_tab cur;
+	struct ohashtable_tab old; /**< table being migrated to @c cur */
+	unsigned int migrate_pos;
+	size_t key_size;
+	size_t slot_size;
+	oht_hash_ft get_hash;
+	void *static_slots; /**< initial slots buffer, it is never freed */
+	unsigned int static_size;
+};
+
+#define OHASHTABLE_SLOT_SIZE(key_size) \
+	binalign_bound(sizeof(struct ohashtable_slot) + (key_size), 8)
+
+#define OHASHTABLE_BUFFER_DEF(buff_name, size, key_size) \
+	uint64_t buff_name[(size) * OHASHTABLE_SLOT_SIZE(key_size) / sizeof(uint64_t)]
+
+/**
+ * Defines static hash table with initial @a size slots (power of two) for
+ * keys of @a key_type.
+ */
+#define OHASHTABLE_DEF(name, size, key_type, hash_fn)                   \
+	static OHASHTABLE_BUFFER_DEF(name##_buff, size, sizeof(key_type)); \
+	static struct ohashtable name = {                                  \
+		.cur = { name##_buff, size, 0 },                               \
+		.key_size = sizeof(key_type),                                  \
+		.slot_size = OHASHTABLE_SLOT_SIZE(sizeof(key_type)),           \
+		.get_hash = hash_fn,                                           \
+		.static_slots = name##_buff,                                   \
+		.static_size = size,                                           \
+	}
+
+/**
+ * Initialize hash table in @a buf of @a size slots
+ *
+ * @param buf - buffer of at least size * OHASHTABLE_SLOT_SIZE(key_size) bytes
+ * @param size - initial number of slots, must be power of two
+ * @param key_size - size of key in bytes
+ * @param get_hash - handler for calculating key hash
+ *
+ * @return initialized hash table
+ */
+extern struct ohashtable *ohashtable_init(struct ohashtable *ht, void *buf,
+		unsigned int size, size_t key_size, oht_hash_ft get_hash);
+
+/**
+ * Free memory allocated by the hash table while growing. Table becomes
+ * empty and returns to its initial buffer.
+ */
+extern void ohashtable_destroy(struct ohashtable *ht);
+
+/**
+ * Insert @a value with @a key, value of existing entry with the same key is
+ * replaced.
+ *
+ * @return error code
+ * @retval -ENOMEM table is full and can't be grown
+ */
+extern int ohashtable_put(struct ohashtable *ht, const void *key, void *value);
+
+/**
+ * Search value by key
+ *
+ * @return value or NULL if there is no such key
+ */
+extern void *ohashtable_get(struct ohashtable *ht, const void *key);
+
+/**
+ * Delete entry from the hash table
+ *
+ * @return value of deleted entry or NULL if there is no such key
+ */
+extern void *ohashtable_del(struct ohashtable *ht, const void *key);
+
+/**
+ * Number of entries in the hash table
+ */
+static inline unsigned int ohashtable_count(struct ohashtable *ht) {
+	return ht->cur.cnt + ht->old.cnt;
+}
+
+/**
+ * Get pointer to the first inline key. Keys are not iterated in any
+ * particular order and iteration is invalidated by ohashtable_put() and
+ * ohashtable_del().
+ *
+ * @return pointer to the first key or NULL if hash table is empty
+ */
+extern void *ohashtable_get_key_first(struct ohashtable *ht);
+
+/**
+ * Get pointer to the key next to @a prev_key
+ *
+ * @return pointer to next key or NULL if no more entries in hash table
+ */
+extern void *ohashtable_get_key_next(struct ohashtable *ht, void *prev_key);
+
+#endif /* UTIL_OHASHTABLE_H_ */
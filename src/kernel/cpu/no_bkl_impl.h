@@ -9,6 +9,9 @@
 #ifndef KERNEL_CPU_NO_BKL_IMLP_H_
 #define KERNEL_CPU_NO_BKL_IMLP_H_
 
+/* Critical sections of different CPUs don't exclude each other */
+#define NO_BKL
+
 static inline void bkl_lock(void) { }
 static inline void bkl_unlock(void) { }
 
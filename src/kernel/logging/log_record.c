@@ -0,0 +1,334 @@
+/**
+ * @file
+ * @brief Binary records of log messages
+ *
+ * @date 18.10.2026
+ */
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <util/math.h>
+
+#include "log_record.h"
+
+/* Longest conversion which is formatted, longer ones are printed as is */
+#define SPEC_MAX      32
+
+enum log_arg {
+	LOG_ARG_NONE,
+	LOG_ARG_INT,
+	LOG_ARG_LONG,
+	LOG_ARG_LLONG,
+	LOG_ARG_PTR,
+	LOG_ARG_DOUBLE,
+	LOG_ARG_LDOUBLE,
+	LOG_ARG_STR,
+	LOG_ARG_COUNT,      /* %n, consumed but not printed */
+};
+
+struct log_spec {
+	const char *start;  /* '%' of the conversion */
+	int len;
+	int stars;          /* int arguments for width and precision */
+	enum log_arg arg;
+};
+
+/**
+ * Find the next conversion in @a fmt
+ *
+ * @return Pointer past the conversion or NULL if there is no more
+ */
+static const char *log_spec_next(const char *fmt, struct log_spec *spec) {
+	const char *p;
+	int lng;
+
+	p = strchr(fmt, '%');
+	if (p == NULL) {
+		return NULL;
+	}
+
+	spec->start = p++;
+	spec->stars = 0;
+	lng = 0;
+
+	while (*p && strchr("-+ #0'", *p)) {
+		p++;
+	}
+	if (*p == '*') {
+		spec->stars++;
+		p++;
+	}
+	while (*p >= '0' && *p <= '9') {
+		p++;
+	}
+	if (*p == '.') {
+		p++;
+		if (*p == '*') {
+			spec->stars++;
+			p++;
+		}
+		while (*p >= '0' && *p <= '9') {
+			p++;
+		}
+	}
+
+	for (; *p && strchr("hlLqjzt", *p); p++) {
+		switch (*p) {
+		case 'l':
+		case 'z':
+		case 't':
+			lng++;
+			break;
+		case 'L':
+		case 'q':
+		case 'j':
+			lng = 2;
+			break;
+		}
+	}
+
+	switch (*p) {
+	case 'd': case 'i': case 'u': case 'o': case 'x': case 'X': case 'c':
+		spec->arg = lng == 0 ? LOG_ARG_INT
+			: (lng == 1 ? LOG_ARG_LONG : LOG_ARG_LLONG);
+		break;
+	case 'p':
+		spec->arg = LOG_ARG_PTR;
+		break;
+	case 's':
+		spec->arg = LOG_ARG_STR;
+		break;
+	case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+		spec->arg = lng == 2 ? LOG_ARG_LDOUBLE : LOG_ARG_DOUBLE;
+		break;
+	case 'n':
+		spec->arg = LOG_ARG_COUNT;
+		break;
+	default:
+		/* "%%" or unknown conversion is printed as is */
+		spec->arg = LOG_ARG_NONE;
+		spec->stars = 0;
+		break;
+	}
+
+	if (*p) {
+		p++;
+	}
+	spec->len = p - spec->start;
+
+	return p;
+}
+
+#define LOG_PUT(rec, max, pos, type, val) \
+	({                                                   \
+		type __v = (val);                                \
+		int __ok = (pos) + sizeof(__v) <= (max);         \
+		if (__ok) {                                      \
+			memcpy((rec) + (pos), &__v, sizeof(__v));    \
+			(pos) += sizeof(__v);                        \
+		}                                                \
+		__ok;                                            \
+	})
+
+#define LOG_GET(rec, pos, type) \
+	({                                                   \
+		type __v;                                        \
+		memcpy(&__v, (rec) + (pos), sizeof(__v));        \
+		(pos) += sizeof(__v);                            \
+		__v;                                             \
+	})
+
+size_t log_record_encode(char *rec, size_t rec_max, const char *fmt,
+		va_list args) {
+	struct log_spec spec;
+	struct log_record_hdr hdr;
+	const char *p, *str;
+	size_t pos, len;
+	int i, ok;
+
+	pos = sizeof(hdr);
+	ok = 1;
+
+	for (p = fmt; ok && (p = log_spec_next(p, &spec)); ) {
+		for (i = 0; ok && (i < spec.stars); i++) {
+			ok = LOG_PUT(rec, rec_max, pos, int, va_arg(args, int));
+		}
+
+		switch (spec.arg) {
+		case LOG_ARG_INT:
+			ok = ok && LOG_PUT(rec, rec_max, pos, int, va_arg(args, int));
+			break;
+		case LOG_ARG_LONG:
+			ok = ok && LOG_PUT(rec, rec_max, pos, long,
+					va_arg(args, long));
+			break;
+		case LOG_ARG_LLONG:
+			ok = ok && LOG_PUT(rec, rec_max, pos, long long,
+					va_arg(args, long long));
+			break;
+		case LOG_ARG_PTR:
+		case LOG_ARG_COUNT:
+			ok = ok && LOG_PUT(rec, rec_max, pos, void *,
+					va_arg(args, void *));
+			break;
+		case LOG_ARG_DOUBLE:
+			ok = ok && LOG_PUT(rec, rec_max, pos, double,
+					va_arg(args, double));
+			break;
+		case LOG_ARG_LDOUBLE:
+			ok = ok && LOG_PUT(rec, rec_max, pos, long double,
+					va_arg(args, long double));
+			break;
+		case LOG_ARG_STR:
+			/* String may be gone when the record is printed */
+			str = va_arg(args, const char *);
+			if (str == NULL) {
+				str = "(null)";
+			}
+			if (!ok || (pos >= rec_max)) {
+				ok = 0;
+				break;
+			}
+			len = strnlen(str, rec_max - pos - 1);
+			memcpy(rec + pos, str, len);
+			rec[pos + len] = '\0';
+			pos += len + 1;
+			break;
+		case LOG_ARG_NONE:
+			break;
+		}
+	}
+
+	/* Arguments which don't fit are printed as zeroes */
+	hdr.fmt = fmt;
+	hdr.len = pos;
+	memcpy(rec, &hdr, sizeof(hdr));
+
+	return pos;
+}
+
+/* Position in @a rec after arguments of @a spec which start at @a pos */
+static size_t log_arg_skip(const char *rec, size_t pos,
+		const struct log_spec *spec) {
+	pos += spec->stars * sizeof(int);
+
+	switch (spec->arg) {
+	case LOG_ARG_INT:
+		return pos + sizeof(int);
+	case LOG_ARG_LONG:
+		return pos + sizeof(long);
+	case LOG_ARG_LLONG:
+		return pos + sizeof(long long);
+	case LOG_ARG_PTR:
+	case LOG_ARG_COUNT:
+		return pos + sizeof(void *);
+	case LOG_ARG_DOUBLE:
+		return pos + sizeof(double);
+	case LOG_ARG_LDOUBLE:
+		return pos + sizeof(long double);
+	case LOG_ARG_STR:
+		return pos + strlen(rec + pos) + 1;
+	case LOG_ARG_NONE:
+		break;
+	}
+
+	return pos;
+}
+
+void log_record_decode(char *msg, size_t msg_max, const char *rec,
+		size_t rec_len) {
+	struct log_spec spec;
+	struct log_record_hdr hdr;
+	char fmt_spec[SPEC_MAX];
+	const char *fmt, *str;
+	size_t pos, out;
+	int w[2], i, res;
+
+	memcpy(&hdr, rec, sizeof(hdr));
+	fmt = hdr.fmt;
+	pos = sizeof(hdr);
+	out = 0;
+
+#define LOG_PRINT(val) \
+	(spec.stars == 0 ? snprintf(msg + out, msg_max - out, fmt_spec, val) \
+	: spec.stars == 1 ? snprintf(msg + out, msg_max - out, fmt_spec, \
+			w[0], val) \
+	: snprintf(msg + out, msg_max - out, fmt_spec, w[0], w[1], val))
+
+	while (out < msg_max - 1) {
+		str = fmt;
+		fmt = log_spec_next(fmt, &spec);
+
+		/* Text before the conversion */
+		res = fmt ? spec.start - str : strlen(str);
+		res = min(res, (int) (msg_max - 1 - out));
+		memcpy(msg + out, str, res);
+		out += res;
+
+		if ((fmt == NULL) || (out >= msg_max - 1)) {
+			break;
+		}
+
+		pos = min(pos, rec_len);
+
+		if (spec.len >= SPEC_MAX) {
+			/* Arguments are skipped, so the following ones are right */
+			pos = log_arg_skip(rec, pos, &spec);
+			res = min(spec.len, (int) (msg_max - 1 - out));
+			memcpy(msg + out, spec.start, res);
+			out += res;
+			continue;
+		}
+		memcpy(fmt_spec, spec.start, spec.len);
+		fmt_spec[spec.len] = '\0';
+
+		for (i = 0; i < spec.stars; i++) {
+			w[i] = LOG_GET(rec, pos, int);
+		}
+
+		res = 0;
+		switch (spec.arg) {
+		case LOG_ARG_INT:
+			res = LOG_PRINT(LOG_GET(rec, pos, int));
+			break;
+		case LOG_ARG_LONG:
+			res = LOG_PRINT(LOG_GET(rec, pos, long));
+			break;
+		case LOG_ARG_LLONG:
+			res = LOG_PRINT(LOG_GET(rec, pos, long long));
+			break;
+		case LOG_ARG_PTR:
+			res = LOG_PRINT(LOG_GET(rec, pos, void *));
+			break;
+		case LOG_ARG_DOUBLE:
+			res = LOG_PRINT(LOG_GET(rec, pos, double));
+			break;
+		case LOG_ARG_LDOUBLE:
+			res = LOG_PRINT(LOG_GET(rec, pos, long double));
+			break;
+		case LOG_ARG_STR:
+			str = rec + pos;
+			pos += strlen(str) + 1;
+			res = LOG_PRINT(str);
+			break;
+		case LOG_ARG_COUNT:
+			LOG_GET(rec, pos, void *);
+			break;
+		case LOG_ARG_NONE:
+			if (!strcmp(fmt_spec, "%%")) {
+				fmt_spec[1] = '\0';
+			}
+			res = snprintf(msg + out, msg_max - out, "%s", fmt_spec);
+			break;
+		}
+
+		out = min(out + max(res, 0), (size_t) msg_max - 1);
+	}
+#undef LOG_PRINT
+
+	msg[out] = '\0';
+}
+
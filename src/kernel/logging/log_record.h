@@ -0,0 +1,42 @@
+/**
+ * @file
+ * @brief Binary records of log messages
+ * @details Record is a header followed by raw arguments read with respect to
+ *          the format, strings are copied into the record. Formatting is done
+ *          later from the record only.
+ *
+ * @date 18.10.2026
+ */
+
+#ifndef KERNEL_LOGGING_LOG_RECORD_H_
+#define KERNEL_LOGGING_LOG_RECORD_H_
+
+#include <stdarg.h>
+#include <stddef.h>
+
+/* Zeroes after a record, so truncated arguments are read as zeroes */
+#define LOG_RECORD_PAD 32
+
+struct log_record_hdr {
+	const char *fmt;
+	unsigned short len; /* of the whole record */
+};
+
+/**
+ * @brief Store @a fmt and its arguments to @a rec of @a rec_max bytes.
+ *        Strings are cut and arguments which don't fit are left out.
+ *
+ * @return Length of the record
+ */
+extern size_t log_record_encode(char *rec, size_t rec_max, const char *fmt,
+		va_list args);
+
+/**
+ * @brief Format record @a rec of @a rec_len bytes, which is followed by
+ *        LOG_RECORD_PAD zeroes, into @a msg of @a msg_max bytes. Arguments
+ *        left out of the record are printed as zeroes.
+ */
+extern void log_record_decode(char *msg, size_t msg_max, const char *rec,
+		size_t rec_len);
+
+#endif /* KERNEL_LOGGING_LOG_RECORD_H_ */
@@ -0,0 +1,212 @@
+/**
+ * @file
+ * @brief Logging which stores messages to be printed later
+ * @details Each CPU has a ring of binary records: pointer to the format and
+ *          raw arguments read with respect to the format, strings are copied
+ *          into the record. Writer only disables interrupts on its CPU while
+ *          appending a record, so logging costs a copy of arguments instead
+ *          of formatting and console output. Low priority thread formats
+ *          records and prints them, on panic the rings are flushed at once.
+ *
+ * @date 18.10.2026
+ */
+
+#include <assert.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <embox/unit.h>
+#include <framework/mod/options.h>
+#include <hal/cpu.h>
+#include <hal/ipl.h>
+#include <kernel/printk.h>
+#include <kernel/sched/schedee_priority.h>
+#include <kernel/thread.h>
+#include <kernel/time/ktime.h>
+#include <util/err.h>
+#include <util/logging.h>
+#include <util/math.h>
+
+#include "log_record.h"
+
+#define RING_SIZE     OPTION_GET(NUMBER, ring_size)
+#define RECORD_MAX    OPTION_GET(NUMBER, record_max)
+#define MESSAGE_MAX   OPTION_GET(NUMBER, message_max)
+#define DRAIN_PERIOD  OPTION_GET(NUMBER, drain_period)
+
+/* Tries to wait for the drain on another CPU before a flush takes it over */
+#define DRAIN_SPINS   1000000
+
+/* Ring size is a power of two holding at least one record */
+static_assert((RING_SIZE & (RING_SIZE - 1)) == 0);
+static_assert(RECORD_MAX <= RING_SIZE);
+
+EMBOX_UNIT_INIT(logging_deferred_init);
+
+struct log_ring {
+	volatile unsigned long head;
+	volatile unsigned long tail;
+	unsigned long dropped;
+	char buf[RING_SIZE];
+};
+
+static struct log_ring log_rings[NCPU];
+
+/* Messages are printed at once until the drain thread is started */
+static int logging_deferred_ready;
+
+/* CPU draining the rings plus one, zero if there is none */
+static volatile int log_drain_owner;
+
+static void log_ring_copy_out(struct log_ring *ring, unsigned long from,
+		void *dst, size_t len) {
+	size_t off, cnt;
+
+	off = from & (RING_SIZE - 1);
+	cnt = min(len, RING_SIZE - off);
+	memcpy(dst, ring->buf + off, cnt);
+	memcpy((char *) dst + cnt, ring->buf, len - cnt);
+}
+
+static void log_ring_copy_in(struct log_ring *ring, unsigned long to,
+		const void *src, size_t len) {
+	size_t off, cnt;
+
+	off = to & (RING_SIZE - 1);
+	cnt = min(len, RING_SIZE - off);
+	memcpy(ring->buf + off, src, cnt);
+	memcpy(ring->buf, (const char *) src + cnt, len - cnt);
+}
+
+/* Print records of @a ring, it is the only consumer of the ring */
+static void log_ring_drain(struct log_ring *ring, int owner) {
+	static char rec[RECORD_MAX + LOG_RECORD_PAD];
+	static char msg[MESSAGE_MAX];
+	static unsigned long reported[NCPU];
+	struct log_record_hdr hdr;
+	unsigned long tail, dropped;
+	int cpu;
+
+	tail = ring->tail;
+	while (tail != ring->head) {
+		if (log_drain_owner != owner) {
+			/* Drain is taken over by a flush */
+			return;
+		}
+
+		/* Record is read after head which published it */
+		__sync_synchronize();
+
+		log_ring_copy_out(ring, tail, &hdr, sizeof(hdr));
+		log_ring_copy_out(ring, tail, rec, hdr.len);
+		memset(rec + hdr.len, 0, sizeof(rec) - hdr.len);
+
+		/* Space is given back to writer only after the copy */
+		__sync_synchronize();
+		tail += hdr.len;
+		ring->tail = tail;
+
+		log_record_decode(msg, MESSAGE_MAX, rec, hdr.len);
+		printk("%s", msg);
+	}
+
+	cpu = ring - log_rings;
+	dropped = ring->dropped;
+	if (dropped != reported[cpu]) {
+		printk("logging: %lu messages dropped on cpu %d\n",
+				dropped - reported[cpu], cpu);
+		reported[cpu] = dropped;
+	}
+}
+
+/**
+ * Print records of all rings. Drain thread and panic on another CPU must not
+ * read rings together, so if the rings are drained already, the thread just
+ * returns. Flush waits for the other drain instead, but it doesn't wait
+ * forever: the drain may be interrupted by the flush on the same CPU, or its
+ * CPU may be stopped. Then the flush takes the drain over.
+ */
+static void log_drain(int flush) {
+	int self, owner, spins, cpu;
+
+	self = cpu_get_id() + 1;
+
+	for (spins = 0; ; spins++) {
+		owner = log_drain_owner;
+		if ((owner == 0)
+				&& __sync_bool_compare_and_swap(&log_drain_owner, 0, self)) {
+			break;
+		}
+		if (!flush) {
+			return;
+		}
+		if ((owner == self) || (spins >= DRAIN_SPINS)) {
+			if (__sync_bool_compare_and_swap(&log_drain_owner, owner, self)) {
+				break;
+			}
+		}
+	}
+
+	for (cpu = 0; cpu < NCPU; cpu++) {
+		log_ring_drain(&log_rings[cpu], self);
+	}
+
+	__sync_bool_compare_and_swap(&log_drain_owner, self, 0);
+}
+
+void logging_vprint(const char *fmt, va_list args) {
+	char rec[RECORD_MAX];
+	struct log_ring *ring;
+	size_t len;
+	ipl_t ipl;
+
+	if (!logging_deferred_ready) {
+		vprintk(fmt, args);
+		return;
+	}
+
+	len = log_record_encode(rec, RECORD_MAX, fmt, args);
+
+	/* Interrupts are the only other writers to the ring of this CPU */
+	ipl = ipl_save();
+	{
+		ring = &log_rings[cpu_get_id()];
+
+		if (RING_SIZE - (ring->head - ring->tail) < len) {
+			ring->dropped++;
+		} else {
+			log_ring_copy_in(ring, ring->head, rec, len);
+			__sync_synchronize();
+			ring->head += len;
+		}
+	}
+	ipl_restore(ipl);
+}
+
+void logging_flush(void) {
+	log_drain(1);
+}
+
+static void *logging_drain_thread(void *arg) {
+	while (1) {
+		log_drain(0);
+		ksleep(DRAIN_PERIOD);
+	}
+
+	return NULL;
+}
+
+static int logging_deferred_init(void) {
+	struct thread *t;
+
+	t = thread_create(0, logging_drain_thread, NULL);
+	if (err(t)) {
+		return err(t);
+	}
+	schedee_priority_set(&t->schedee, SCHED_PRIORITY_LOW);
+
+	logging_deferred_ready = 1;
+
+	return 0;
+}
@@ -21,4 +21,7 @@ extern struct schedee *__current_schedee;
 #define __schedee_set_current(schedee) \
 	do { cpudata_var(__current_schedee) = schedee; } while (0)
 
+#define __schedee_get_cpu_current(cpu_id) \
+	cpudata_cpu_var(cpu_id, __current_schedee)
+
 #endif /* KERNEL_SCHEDEE_CURRENT_DEFAULT_H_ */
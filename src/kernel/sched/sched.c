@@ -30,6 +30,7 @@
 
 #include <kernel/critical.h>
 #include <kernel/spinlock.h>
+#include <kernel/cpu/cpudata.h>
 #include <kernel/sched/sched_strategy.h>
 #include <kernel/sched/current.h>
 
@@ -46,8 +47,15 @@
 static void sched_preempt(void);
 CRITICAL_DISPATCHER_DEF(sched_critical, sched_preempt, CRITICAL_SCHED_LOCK);
 
-//TODO these variable for scheduler (may be create object scheduler?)
-static struct runq rq;
+/* Each CPU has its own runq, so that wakeups and preemptions on different
+ * CPUs do not contend for a single lock. An idle CPU steals work from the
+ * others (see sched_steal()). Non-SMP kernel has just one runq. */
+static struct runq rq __cpudata__;
+static int rq_online __cpudata__;
+
+#ifdef SMP
+extern void smp_send_resched(int cpu_id);
+#endif /* SMP */
 
 void sched_post_switch(void) {
 	critical_request_dispatch(&sched_critical);
@@ -57,10 +65,45 @@ static inline int sched_in_interrupt(void) {
 	return critical_inside(__CRITICAL_HARDER(CRITICAL_SCHED_LOCK));
 }
 
+static inline struct runq *sched_cpu_runq(unsigned int cpu) {
+	return cpudata_cpu_ptr(cpu, &rq);
+}
+
+static void sched_runq_init(struct runq *queue) {
+	runq_init(&queue->queue);
+	queue->lock = SPIN_UNLOCKED;
+	queue->count = 0;
+}
+
+/**
+ * Locks the runq the schedee belongs to. The schedee could be moved to
+ * another runq while we were spinning, so check it once the lock is taken.
+ *
+ * Locks: IPL, (thread).
+ */
+static struct runq *sched_runq_lock(struct schedee *s) {
+	struct runq *queue;
+
+	while (1) {
+		queue = sched_cpu_runq(s->cpu);
+		spin_lock(&queue->lock);
+		if (queue == sched_cpu_runq(s->cpu)) {
+			return queue;
+		}
+		spin_unlock(&queue->lock);
+	}
+}
+
 int sched_init(struct schedee *current) {
+#ifdef SMP
+	int cpu;
 
-	runq_init(&rq.queue);
-	rq.lock = SPIN_UNLOCKED;
+	for (cpu = 0; cpu < NCPU; cpu++) {
+		sched_runq_init(sched_cpu_runq(cpu));
+	}
+#else
+	sched_runq_init(&rq);
+#endif /* SMP */
 
 	sched_set_current(current);
 
@@ -80,6 +123,8 @@ int schedee_init(struct schedee *schedee, int priority,
 	schedee->active = false;
 	schedee->waiting = true;
 
+	schedee->cpu = cpu_get_id();
+
 	schedee_priority_init(schedee, priority);
 	sched_affinity_init(&schedee->affinity);
 	sched_timing_init(schedee);
@@ -87,35 +132,112 @@ int schedee_init(struct schedee *schedee, int priority,
 	return 0;
 }
 
+/** Called on each CPU once it is ready to run schedees. */
 void sched_set_current(struct schedee *schedee) {
 	assert(schedee_get_current() == NULL);
 	__schedee_set_current(schedee);
 
+	schedee->cpu = cpu_get_id();
 	schedee->ready = true;
 	schedee->active = true;
 	schedee->waiting = false;
+
+	cpudata_var(rq_online) = true;
 }
 
 static void sched_check_preempt(struct schedee *t) {
+#ifdef SMP
+	unsigned int cpu = t->cpu;
+
+	if (cpu != cpu_get_id()) {
+		/* The value of a remote current can be stale, that costs
+		 * at most a spurious IPI. */
+		if (schedee_priority_get(schedee_get_cpu_current(cpu)) <=
+				schedee_priority_get(t))
+			smp_send_resched(cpu);
+		return;
+	}
+#endif /* SMP */
+
 	// TODO ask runq
 	if (schedee_priority_get(schedee_get_current()) <=
 			schedee_priority_get(t))
-		sched_post_switch(); // TODO SMP
+		sched_post_switch();
+}
+
+#ifdef SMP
+
+/**
+ * Chooses the CPU to enqueue a waking schedee to. Prefers an idle CPU allowed
+ * by affinity, then the CPU the schedee last run on (its caches are still
+ * warm), then the least loaded allowed one.
+ */
+static unsigned int sched_select_cpu(struct schedee *s) {
+	unsigned int cpu, best = -1u;
+	unsigned int best_count = -1u;
+	struct schedee *curr;
+
+	if (sched_affinity_check(&s->affinity, 1 << s->cpu)) {
+		curr = schedee_get_cpu_current(s->cpu);
+		if (curr && schedee_priority_get(curr) == SCHED_PRIORITY_MIN) {
+			return s->cpu;
+		}
+	}
+
+	for (cpu = 0; cpu < NCPU; cpu++) {
+		if (!cpudata_cpu_var(cpu, rq_online) ||
+				!sched_affinity_check(&s->affinity, 1 << cpu)) {
+			continue;
+		}
+
+		curr = schedee_get_cpu_current(cpu);
+		if (curr && schedee_priority_get(curr) == SCHED_PRIORITY_MIN) {
+			return cpu;
+		}
+
+		if (sched_cpu_runq(cpu)->count < best_count) {
+			best_count = sched_cpu_runq(cpu)->count;
+			best = cpu;
+		}
+	}
+
+	if (sched_affinity_check(&s->affinity, 1 << s->cpu) ||
+			best == -1u) {
+		return s->cpu;
+	}
+
+	return best;
+}
+
+#else /* !SMP */
+
+static inline unsigned int sched_select_cpu(struct schedee *s) {
+	return s->cpu;
 }
 
+#endif /* SMP */
+
 /** Locks: IPL, thread, runq. */
-static void __sched_enqueue(struct schedee *s) {
-	runq_insert(&rq.queue, s);
+static void __sched_enqueue(struct runq *queue, struct schedee *s) {
+	runq_insert(&queue->queue, s);
+	queue->count++;
 }
 
 /** Locks: IPL, thread, runq. */
-static void __sched_dequeue(struct schedee *s) {
-	runq_remove(&rq.queue, s);
+static void __sched_dequeue(struct runq *queue, struct schedee *s) {
+	runq_remove(&queue->queue, s);
+	queue->count--;
+}
+
+/** Locks: IPL, runq. */
+static struct schedee *__sched_extract(struct runq *queue) {
+	queue->count--;
+	return runq_extract(&queue->queue);
 }
 
 /** Locks: IPL, thread, runq. */
-static void __sched_enqueue_set_ready(struct schedee *s) {
-	__sched_enqueue(s);
+static void __sched_enqueue_set_ready(struct runq *queue, struct schedee *s) {
+	__sched_enqueue(queue, s);
 	s->ready = true;  /* let rq to see the previous state */
 }
 
@@ -134,35 +256,39 @@ int sched_change_priority(struct schedee *s, int prior,
 	ipl_t ipl;
 	int in_rq;
 
+	struct runq *queue;
+
 	assert(s);
 
-	ipl = spin_lock_ipl(&rq.lock);
+	ipl = ipl_save();
+	queue = sched_runq_lock(s);
 	in_rq = s->ready && !sched_active(s);
 
 	if (in_rq)
-		__sched_dequeue(s);
+		__sched_dequeue(queue, s);
 	set_priority(&s->priority, prior);
 	if (in_rq)
-		__sched_enqueue(s);
+		__sched_enqueue(queue, s);
 
 	sched_check_preempt(s);
 
-	spin_unlock_ipl(&rq.lock, ipl);
+	spin_unlock_ipl(&queue->lock, ipl);
 
 	return 0;
 }
 
 static void __sched_freeze(struct schedee *s) {
+	struct runq *queue;
 	int in_rq;
 
 	assert(s);
 
-	spin_lock(&rq.lock);
+	queue = sched_runq_lock(s);
 	{
 		in_rq = s->ready && !sched_active(s);
 
 		if (in_rq)
-			__sched_dequeue(s);
+			__sched_dequeue(queue, s);
 
 		s->ready = false;
 
@@ -170,7 +296,7 @@ static void __sched_freeze(struct schedee *s) {
 		s->active = false;
 		s->waiting = false;
 	}
-	spin_unlock(&rq.lock);
+	spin_unlock(&queue->lock);
 }
 
 void sched_freeze(struct schedee *s) {
@@ -268,12 +394,15 @@ void sched_freeze(struct schedee *s) {
 
 /** Locks: IPL, thread. */
 static int __sched_wakeup_ready(struct schedee *s) {
+	struct runq *queue;
 	int ready;
 
-	/* This doesn't necessarily spin until the lock is acquired.
-	 * SMP 'schedule' could outrun us getting the lock, but it will
-	 * clear t->ready state as soon as possible thus letting us to go. */
-	spin_protected_if (&rq.lock, (ready = s->ready))
+	/* A preempted schedee can be stolen by another CPU while we are
+	 * spinning, so the lock of its current runq is taken. */
+	queue = sched_runq_lock(s);
+
+	ready = s->ready;
+	if (ready)
 		/* Event has arrived before the thread reached 'schedule' and
 		 * went asleep (it could be even preempted after setting its
 		 * t->waiting state).
@@ -281,18 +410,44 @@ static int __sched_wakeup_ready(struct schedee *s) {
 		 * is done by the thread when it finally invokes the scheduler. */
 		s->waiting = false;
 
+	spin_unlock(&queue->lock);
+
 	return ready;
 }
 
 
 /** Locks: IPL, thread. */
 static void __sched_wakeup_waiting(struct schedee *s) {
+	struct runq *queue, *prev_queue;
+	unsigned int cpu;
+
 	assert(s && s->waiting);
 
-	spin_lock(&rq.lock);
-	__sched_enqueue_set_ready(s);
+	/* The schedee is neither ready nor active, so nobody else can
+	 * enqueue it or change its cpu concurrently. */
+	cpu = sched_select_cpu(s);
+	queue = sched_cpu_runq(cpu);
+	prev_queue = sched_cpu_runq(s->cpu);
+
+	/* s->cpu is changed with both runqs locked, in order of CPUs */
+	if (cpu < s->cpu) {
+		spin_lock(&queue->lock);
+		spin_lock(&prev_queue->lock);
+	} else {
+		spin_lock(&prev_queue->lock);
+		if (queue != prev_queue) {
+			spin_lock(&queue->lock);
+		}
+	}
+
+	s->cpu = cpu;
+	__sched_enqueue_set_ready(queue, s);
 	__sched_wokenup_clear_waiting(s);
-	spin_unlock(&rq.lock);
+
+	if (queue != prev_queue) {
+		spin_unlock(&prev_queue->lock);
+	}
+	spin_unlock(&queue->lock);
 }
 
 #ifdef SMP
@@ -365,16 +520,82 @@ void sched_start_switch(struct schedee *next) {
 	__sched_activate(next);
 }
 
+#ifdef SMP
+
+/**
+ * Tries to take a ready schedee from another CPU runq instead of running
+ * @p idle one. Remote runqs are only try-locked: we already hold our own lock
+ * and there is no point in spinning while being idle anyway.
+ *
+ * Locks: IPL, local runq.
+ */
+static struct schedee *sched_steal(struct runq *local, struct schedee *idle) {
+	unsigned int self = cpu_get_id();
+	unsigned int cpu;
+
+	for (cpu = 0; cpu < NCPU; cpu++) {
+		struct runq *remote = sched_cpu_runq(cpu);
+		struct schedee *s;
+
+		if (cpu == self || !cpudata_cpu_var(cpu, rq_online) ||
+				!remote->count) {
+			continue;
+		}
+
+		if (!spin_trylock(&remote->lock)) {
+			continue;
+		}
+
+		/* Only schedees allowed to run on this CPU are looked at */
+		s = runq_peek(&remote->queue);
+
+		/* Schedee that is still on the remote CPU (prev in the middle
+		 * of 'schedule') or that has nothing better than an idle one
+		 * to offer is left where it is. */
+		if (s && (sched_active(s) ||
+				schedee_priority_get(s) == SCHED_PRIORITY_MIN ||
+				!sched_affinity_check(&s->affinity, 1 << self))) {
+			s = NULL;
+		}
+
+		if (s) {
+			__sched_dequeue(remote, s);
+			s->cpu = self;
+		}
+
+		spin_unlock(&remote->lock);
+
+		if (s) {
+			__sched_enqueue(local, idle);
+			return s;
+		}
+	}
+
+	return idle;
+}
+
+#else /* !SMP */
+
+static inline struct schedee *sched_steal(struct runq *local,
+		struct schedee *idle) {
+	return idle;
+}
+
+#endif /* SMP */
+
 /** locks: sched */
 static void __schedule(int preempt) {
 	ipl_t ipl;
 	struct schedee *prev;
 	struct schedee *next;
+	struct runq *queue;
 
 	prev = schedee_get_current();
 
 	assert(!sched_in_interrupt());
-	ipl = spin_lock_ipl(&rq.lock);
+	ipl = ipl_save();
+	queue = cpudata_ptr(&rq);
+	spin_lock(&queue->lock);
 
 	if (!preempt && prev->waiting)
 		prev->ready = false;
@@ -384,16 +605,20 @@ static void __schedule(int preempt) {
 		 * without really waking it up.
 		 * 'sched_finish_switch' will sort out what to do in such case. */
 	else
-		__sched_enqueue(prev);
+		__sched_enqueue(queue, prev);
 
 	sched_timing_stop(prev);
 
 	while (1) {
-		next = runq_extract(&rq.queue);
+		next = __sched_extract(queue);
+
+		if (schedee_priority_get(next) == SCHED_PRIORITY_MIN) {
+			next = sched_steal(queue, next);
+		}
 
 		/* Runq is unlocked as soon as possible, but interrupts remain disabled
 		 * during the 'sched_switch' (if any). */
-		spin_unlock(&rq.lock);
+		spin_unlock(&queue->lock);
 
 		schedee_set_current(next);
 		log_debug("prev: %#x, next: %#x", prev, next);
@@ -405,8 +630,11 @@ static void __schedule(int preempt) {
 			break;
 		}
 
-		/* ipl is enabled, no need to save it. */
-		spin_lock_ipl_disable(&rq.lock);
+		/* ipl is enabled, no need to save it. We could have been moved to
+		 * another CPU by now. */
+		ipl_disable();
+		queue = cpudata_ptr(&rq);
+		spin_lock(&queue->lock);
 	}
 
 	sched_timing_start(next);
@@ -29,6 +29,14 @@ void runq_remove(runq_t *queue, struct schedee *schedee) {
 	dlist_del(&schedee->runq_link);
 }
 
+struct schedee *runq_peek(runq_t *queue) {
+	if (dlist_empty(queue)) {
+		return NULL;
+	}
+
+	return dlist_entry(queue->next, struct schedee, runq_link);
+}
+
 struct schedee *runq_extract(runq_t *queue) {
 	struct schedee *schedee;
 
@@ -39,9 +39,8 @@ void runq_remove(runq_t *queue, struct schedee *schedee) {
 	dlist_del(&schedee->runq_link);
 }
 
-struct schedee *runq_extract(runq_t *queue) {
+struct schedee *runq_peek(runq_t *queue) {
 	const unsigned int mask = 1 << cpu_get_id();
-	struct schedee *schedee = NULL;
 	int i;
 
 	for (i = SCHED_PRIORITY_MAX; i >= SCHED_PRIORITY_MIN; i--) {
@@ -51,15 +50,20 @@ struct schedee *runq_extract(runq_t *queue) {
 			/* Checking the affinity */
 
 			if (sched_affinity_check(&s->affinity, mask)) {
-				schedee = s;
-				break;
+				return s;
 			}
 		}
+	}
 
-		if (schedee) {
-			runq_remove(queue, schedee);
-			break;
-		}
+	return NULL;
+}
+
+struct schedee *runq_extract(runq_t *queue) {
+	struct schedee *schedee;
+
+	schedee = runq_peek(queue);
+	if (schedee) {
+		runq_remove(queue, schedee);
 	}
 
 	return schedee;
@@ -29,6 +29,14 @@ void runq_remove(runq_t *queue, struct schedee *s) {
 	priolist_del(&s->runq_link, queue);
 }
 
+struct schedee *runq_peek(runq_t *queue) {
+	if (priolist_empty(queue)) {
+		return NULL;
+	}
+
+	return mcast_out(priolist_first(queue), struct schedee, runq_link);
+}
+
 struct schedee *runq_extract(runq_t *queue) {
 	runq_item_t *first = priolist_first(queue);
 	struct schedee *result;
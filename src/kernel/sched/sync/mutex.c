@@ -9,6 +9,7 @@
 #include <assert.h>
 #include <errno.h>
 
+#include <hal/cpu.h>
 #include <kernel/sched/sync/mutex.h>
 #include <kernel/thread/waitq.h>
 #include <kernel/sched/schedee_priority.h>
@@ -26,12 +27,19 @@ int mutex_trylock_schedee(struct schedee *self, struct mutex *m) {
 	assert(m);
 	assert(!critical_inside(__CRITICAL_HARDER(CRITICAL_SCHED_LOCK)));
 
+#ifdef SMP
+	/* Mutex may be taken concurrently by another CPU */
+	if (!__sync_bool_compare_and_swap(&m->holder, NULL, self)) {
+		return -EBUSY;
+	}
+#else
 	if (m->holder) {
 		return -EBUSY;
 	}
+	m->holder = self;
+#endif
 
 	m->lock_count = 1;
-	m->holder = self;
 
 	return 0;
 }
@@ -42,16 +50,23 @@ void mutex_unlock_schedee(struct schedee *self, struct mutex *m) {
 
 	mutex_priority_uninherit(self);
 
-	m->holder = NULL;
 	m->lock_count = 0;
+#ifdef SMP
+	__sync_synchronize();
+#endif
+	m->holder = NULL;
 	waitq_wakeup_all(&m->wq);
 }
 
 void mutex_priority_inherit(struct schedee *self, struct mutex *m) {
 	int prior = schedee_priority_get(self);
+	struct schedee *holder = m->holder;
+
+	if (holder == NULL)
+		return; /* just released */
 
-	if (prior != schedee_priority_inherit(m->holder, prior))
-		schedee_priority_set(m->holder, prior);
+	if (prior != schedee_priority_inherit(holder, prior))
+		schedee_priority_set(holder, prior);
 }
 
 void mutex_priority_uninherit(struct schedee *self) {
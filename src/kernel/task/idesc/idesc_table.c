@@ -13,6 +13,7 @@
 #include <string.h>
 
 #include <fs/idesc.h>
+#include <fs/idesc_event.h>
 #include <kernel/task.h>
 
 #include <kernel/task/resource/idesc_table.h>
@@ -82,6 +83,7 @@ void idesc_table_del(struct idesc_table *t, int idx) {
 	assert(idesc->idesc_ops && idesc->idesc_ops->close);
 
 	if (!(--idesc->idesc_count)) {
+		idesc_watch_release(idesc);
 		idesc->idesc_ops->close(idesc);
 	}
 
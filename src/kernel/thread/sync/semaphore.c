@@ -8,6 +8,7 @@
 
 #include <assert.h>
 #include <errno.h>
+#include <hal/cpu.h>
 #include <kernel/thread/sync/semaphore.h>
 #include <kernel/sched.h>
 #include <kernel/thread/waitq.h>
@@ -56,13 +57,26 @@ int semaphore_timedwait(struct sem *restrict s, const struct timespec *restrict
 }
 
 static int tryenter_sched_lock(struct sem *s) {
+	int value;
+
 	assert(s);
 
-	if (s->value == s->max_value) {
+#ifdef SMP
+	/* Semaphore may be entered concurrently by another CPU */
+	do {
+		value = s->value;
+		if (value == s->max_value) {
+			return -EAGAIN;
+		}
+	} while (!__sync_bool_compare_and_swap(&s->value, value, value + 1));
+#else
+	value = s->value;
+	if (value == s->max_value) {
 		return -EAGAIN;
 	}
+	s->value = value + 1;
+#endif
 
-	s->value++;
 	return 0;
 }
 
@@ -82,7 +96,11 @@ void semaphore_leave(struct sem *s) {
 
 	sched_lock();
 	{
+#ifdef SMP
+		__sync_fetch_and_sub(&s->value, 1);
+#else
 		s->value--;
+#endif
 		waitq_wakeup_all(&s->wq);
 	}
 	sched_unlock();
@@ -17,10 +17,17 @@
 
 #include <kernel/thread/stack_protect.h>
 
-#define STACK_SZ      OPTION_GET(NUMBER, thread_stack_size)
+#include <framework/mod/options.h>
+#include <module/embox/kernel/thread/core.h>
+
+#define STACK_SZ      OPTION_MODULE_GET(embox__kernel__thread__core, \
+			NUMBER, thread_stack_size)
 static_assert(STACK_SZ > sizeof(struct thread));
 
-#define POOL_SZ       OPTION_GET(NUMBER, thread_pool_size)
+#define POOL_SZ       OPTION_MODULE_GET(embox__kernel__thread__core, \
+			NUMBER, thread_pool_size)
+#define STACK_POISON  OPTION_MODULE_GET(embox__kernel__thread__core, \
+			BOOLEAN, stack_poison)
 
 typedef union thread_pool_entry {
 	struct thread thread;
@@ -42,7 +49,9 @@ struct thread *thread_alloc(void) {
 	if (!(block = (thread_pool_entry_t *) pool_alloc(&thread_pool))) {
 		return NULL;
 	}
-	memset(block, 0x53, sizeof(*block));
+	if (STACK_POISON) {
+		memset(block, 0x53, sizeof(*block));
+	}
 
 	t = &block->thread;
 
@@ -63,7 +72,9 @@ void thread_free(struct thread *t) {
 
     stack_protect_release(t);
 
-	memset(block, 0xa5, sizeof(*block));
+	if (STACK_POISON) {
+		memset(block, 0xa5, sizeof(*block));
+	}
 
 	pool_free(&thread_pool, block);
 }
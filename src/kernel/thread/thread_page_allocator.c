@@ -0,0 +1,101 @@
+/**
+ * @file
+ * @brief Thread stacks allocated from pages
+ * @details Stack size is rounded up to whole pages, and number of threads is
+ *          limited by memory only. Stacks of exited threads are kept in
+ *          a cache, so creation of a thread usually takes one of them instead
+ *          of allocating pages.
+ *
+ * @date 18.10.2026
+ */
+
+#include <assert.h>
+#include <string.h>
+
+#include <kernel/spinlock.h>
+#include <kernel/thread.h>
+#include <kernel/thread/stack_protect.h>
+#include <kernel/thread/thread_alloc.h>
+#include <mem/page.h>
+#include <mem/phymem.h>
+#include <util/binalign.h>
+
+#include <framework/mod/options.h>
+#include <module/embox/kernel/thread/core.h>
+
+#define STACK_SZ      OPTION_MODULE_GET(embox__kernel__thread__core, \
+			NUMBER, thread_stack_size)
+static_assert(STACK_SZ > sizeof(struct thread));
+
+#define STACK_POISON  OPTION_MODULE_GET(embox__kernel__thread__core, \
+			BOOLEAN, stack_poison)
+
+#define CACHE_SZ      OPTION_GET(NUMBER, stack_cache_size)
+
+static void *stack_cache[CACHE_SZ];
+static int stack_cache_cnt;
+static spinlock_t stack_cache_lock = SPIN_STATIC_UNLOCKED;
+
+static inline size_t thread_stack_pages(void) {
+	return binalign_bound(STACK_SZ, PAGE_SIZE()) / PAGE_SIZE();
+}
+
+struct thread *thread_alloc(void) {
+	struct thread *t;
+	void *block = NULL;
+	size_t size;
+	ipl_t ipl;
+
+	ipl = spin_lock_ipl(&stack_cache_lock);
+	{
+		if (stack_cache_cnt > 0) {
+			block = stack_cache[--stack_cache_cnt];
+		}
+	}
+	spin_unlock_ipl(&stack_cache_lock, ipl);
+
+	if (block == NULL) {
+		block = phymem_alloc(thread_stack_pages());
+		if (block == NULL) {
+			return NULL;
+		}
+	}
+
+	size = thread_stack_pages() * PAGE_SIZE();
+	if (STACK_POISON) {
+		memset(block, 0x53, size);
+	}
+
+	t = block;
+
+	thread_stack_init(t, size);
+
+	stack_protect(t, size);
+
+	return t;
+}
+
+void thread_free(struct thread *t) {
+	ipl_t ipl;
+
+	assert(t != NULL);
+
+	stack_protect_release(t);
+
+	if (STACK_POISON) {
+		memset(t, 0xa5, thread_stack_pages() * PAGE_SIZE());
+	}
+
+	ipl = spin_lock_ipl(&stack_cache_lock);
+	{
+		if (stack_cache_cnt < CACHE_SZ) {
+			stack_cache[stack_cache_cnt++] = t;
+			t = NULL;
+		}
+	}
+	spin_unlock_ipl(&stack_cache_lock, ipl);
+
+	if (t != NULL) {
+		phymem_free(t, thread_stack_pages());
+	}
+}
@@ -9,6 +9,8 @@
 #include <embox/unit.h>
 #include <module/embox/kernel/time/slowdown.h>
 #include <kernel/irq_lock.h>
+#include <kernel/sched/sched_lock.h>
+#include <kernel/spinlock.h>
 #include <kernel/time/timer.h>
 #include <kernel/time/clock_source.h>
 
@@ -26,6 +28,28 @@ static struct lthread clock_handler_lt;
 extern struct clock_source *cs_jiffies;
 static clock_t timer_sched_cnt;
 
+static spinlock_t timer_strat_spin = SPIN_STATIC_UNLOCKED;
+static unsigned int timer_strat_nested;
+
+void timer_strat_lock(void) {
+	sched_lock();
+	/* Owner can be this CPU only if we hold the lock already */
+	if (timer_strat_spin.owner == cpu_get_id()) {
+		timer_strat_nested++;
+	} else {
+		spin_lock(&timer_strat_spin);
+	}
+}
+
+void timer_strat_unlock(void) {
+	if (timer_strat_nested != 0) {
+		timer_strat_nested--;
+	} else {
+		spin_unlock(&timer_strat_spin);
+	}
+	sched_unlock();
+}
+
 void clock_tick_handler(int irq_num, void *dev_id) {
 	struct clock_source *cs = (struct clock_source *) dev_id;
 
@@ -55,9 +79,11 @@ static int clock_handler(struct lthread *self) {
 		timer_sched_cnt = 0;
 	irq_unlock();
 
+	timer_strat_lock();
 	while (0 < sched_cnt--) {
 		timer_strat_sched();
 	}
+	timer_strat_unlock();
 	return 0;
 }
 
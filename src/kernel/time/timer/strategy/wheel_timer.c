@@ -0,0 +1,162 @@
+/**
+ * @file
+ * @brief Hierarchical timing wheel.
+ *
+ * @details Timers are kept in a set of wheels. The first one has a slot for
+ *   each of the nearest WHEEL_ROOT_SIZE ticks, each next wheel slot covers
+ *   the whole range of the previous wheel. Starting and stopping a timer is
+ *   O(1): it's just linked to or unlinked from a slot. On each tick the slot
+ *   of the root wheel is expired as a batch, and whenever the root wheel
+ *   wraps around the next slot of the upper wheel is cascaded down.
+ *
+ *   @c cnt field of a timer holds the absolute tick it expires at.
+ *
+ * @date 17.10.2026
+ */
+
+#include <stdint.h>
+
+#include <util/dlist.h>
+
+#include <kernel/time/timer.h>
+
+#define WHEEL_BITS        6
+#define WHEEL_SIZE        (1 << WHEEL_BITS)
+#define WHEEL_ROOT_MASK   (WHEEL_ROOT_SIZE - 1)
+#define WHEEL_MASK        (WHEEL_SIZE - 1)
+#define WHEEL_UPPER_CNT   4 /* 8 + 4 * 6 = 32 bits of ticks */
+
+#define WHEEL_UPPER_SHIFT(n) (WHEEL_ROOT_BITS + (n) * WHEEL_BITS)
+#define WHEEL_UPPER_INDEX(tick, n) \
+	(((tick) >> WHEEL_UPPER_SHIFT(n)) & WHEEL_MASK)
+
+static struct dlist_head wheel_root[WHEEL_ROOT_SIZE];
+static struct dlist_head wheel_upper[WHEEL_UPPER_CNT][WHEEL_SIZE];
+
+/** The tick the wheel is going to process next */
+static uint32_t wheel_tick;
+static int wheel_inited;
+
+static void wheel_init(void) {
+	int i, n;
+
+	for (i = 0; i < WHEEL_ROOT_SIZE; i++) {
+		dlist_init(&wheel_root[i]);
+	}
+
+	for (n = 0; n < WHEEL_UPPER_CNT; n++) {
+		for (i = 0; i < WHEEL_SIZE; i++) {
+			dlist_init(&wheel_upper[n][i]);
+		}
+	}
+
+	wheel_inited = 1;
+}
+
+static void wheel_add(struct sys_timer *tmr) {
+	uint32_t expires = tmr->cnt;
+	uint32_t delta = expires - wheel_tick;
+	struct dlist_head *slot;
+	int n;
+
+	if (delta < WHEEL_ROOT_SIZE) {
+		slot = &wheel_root[expires & WHEEL_ROOT_MASK];
+	} else {
+		for (n = 0; n < WHEEL_UPPER_CNT - 1; n++) {
+			if (delta < (1UL << WHEEL_UPPER_SHIFT(n + 1))) {
+				break;
+			}
+		}
+		slot = &wheel_upper[n][WHEEL_UPPER_INDEX(expires, n)];
+	}
+
+	dlist_add_prev(&tmr->lnk, slot);
+}
+
+void timer_strat_start(struct sys_timer *tmr) {
+	if (!wheel_inited) {
+		wheel_init();
+	}
+
+	dlist_head_init(&tmr->lnk);
+	timer_set_started(tmr);
+
+	/* Same semantic as head_timer: fire after @c load ticks */
+	tmr->cnt = wheel_tick + (tmr->load ? tmr->load - 1 : 0);
+
+	wheel_add(tmr);
+}
+
+void timer_strat_stop(struct sys_timer *tmr) {
+	timer_set_stopped(tmr);
+
+	dlist_del_init(&tmr->lnk);
+}
+
+/**
+ * Redistributes timers of the current slot of the @p n-th upper wheel over
+ * the lower wheels. Returns the slot index, zero means the upper wheel
+ * itself has wrapped around and the next one has to be cascaded too.
+ */
+static int wheel_cascade(int n) {
+	struct sys_timer *tmr;
+	struct dlist_head pending;
+	int index = WHEEL_UPPER_INDEX(wheel_tick, n);
+
+	dlist_init(&pending);
+	dlist_foreach_entry(tmr, &wheel_upper[n][index], lnk) {
+		dlist_move(&tmr->lnk, &pending);
+	}
+
+	dlist_foreach_entry(tmr, &pending, lnk) {
+		dlist_del_init(&tmr->lnk);
+		wheel_add(tmr);
+	}
+
+	return index;
+}
+
+/**
+ * Expires all the timers of the current root wheel slot as a batch and
+ * advances the wheel by one tick.
+ */
+void timer_strat_sched(void) {
+	struct dlist_head expired;
+	struct sys_timer *tmr;
+	int n;
+
+	if (!wheel_inited) {
+		wheel_init();
+	}
+
+	if (!(wheel_tick & WHEEL_ROOT_MASK)) {
+		for (n = 0; n < WHEEL_UPPER_CNT; n++) {
+			if (wheel_cascade(n)) {
+				break;
+			}
+		}
+	}
+
+	dlist_init(&expired);
+	dlist_foreach_entry(tmr, &wheel_root[wheel_tick & WHEEL_ROOT_MASK], lnk) {
+		dlist_move(&tmr->lnk, &expired);
+	}
+
+	wheel_tick++;
+
+	/* Handlers are free to start and stop any timers including
+	 * the ones from the batch, so the list is rechecked each time */
+	while (!dlist_empty(&expired)) {
+		tmr = dlist_entry(expired.next, struct sys_timer, lnk);
+
+		timer_strat_stop(tmr);
+		if (timer_is_periodic(tmr)) {
+			/* Count the next period from the expiry, not from now */
+			timer_set_started(tmr);
+			tmr->cnt += tmr->load ? tmr->load : 1;
+			wheel_add(tmr);
+		}
+
+		tmr->handle(tmr, tmr->param);
+	}
+}
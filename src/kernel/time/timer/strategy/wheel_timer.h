@@ -0,0 +1,20 @@
+/**
+ * @file
+ *
+ * @brief Hierarchical timing wheel strategy
+ *
+ * @date 17.10.2026
+ */
+
+#ifndef WHEEL_TIMER_H_
+#define WHEEL_TIMER_H_
+
+#include <util/dlist.h>
+
+/* Ticks covered by the root wheel, longer timers start in upper wheels */
+#define WHEEL_ROOT_BITS   8
+#define WHEEL_ROOT_SIZE   (1 << WHEEL_ROOT_BITS)
+
+typedef struct dlist_head sys_timer_queue_t;
+
+#endif /* WHEEL_TIMER_H_ */
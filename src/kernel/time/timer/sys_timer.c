@@ -13,7 +13,6 @@
 
 #include <kernel/time/timer.h>
 #include <kernel/time/time.h>
-#include <kernel/sched/sched_lock.h>
 
 POOL_DEF(timer_pool, sys_timer_t, OPTION_GET(NUMBER,timer_quantity));
 
@@ -41,21 +40,21 @@ void timer_start(struct sys_timer *tmr, clock_t jiffies) {
 		tmr->cnt = tmr->load = jiffies + 1;
 	}
 
-	sched_lock();
+	timer_strat_lock();
 	{
 		timer_strat_start(tmr);
 	}
-	sched_unlock();
+	timer_strat_unlock();
 }
 
 void timer_stop(struct sys_timer *tmr) {
-	if (timer_is_started(tmr)) {
-		sched_lock();
-		{
+	timer_strat_lock();
+	{
+		if (timer_is_started(tmr)) {
 			timer_strat_stop(tmr);
 		}
-		sched_unlock();
 	}
+	timer_strat_unlock();
 }
 
 int timer_init_start(struct sys_timer *tmr, unsigned int flags, clock_t jiffies,
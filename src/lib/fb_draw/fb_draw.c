@@ -42,6 +42,7 @@ int fb_draw_init_screen(struct screen *screen_info, int screen_id) {
 		return -1;
 	}
 
+	screen_info->fb = fb_info;
 	screen_info->fbp = (uint8_t *) fb_info->screen_base;
 	screen_info->height = fb_info->var.yres;
 	screen_info->width = fb_info->var.xres;
@@ -93,3 +94,9 @@ int fb_draw_put_pix(uint8_t r, uint8_t g, uint8_t b, int color_bpp, struct scree
 	printf("Unsupported screen format\n");
 	return -1;
 }
+
+void fb_draw_flush(struct screen *screen_info) {
+	/* Pixels are put right to screen_base, so the whole screen is damaged */
+	fb_damage(screen_info->fb, 0, 0, screen_info->width, screen_info->height);
+	fb_flush(screen_info->fb);
+}
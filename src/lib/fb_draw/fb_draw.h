@@ -9,7 +9,10 @@
 #ifndef LIB_FB_DRAW_H_
 #define LIB_FB_DRAW_H_
 
+struct fb_info;
+
 struct screen {
+	struct fb_info *fb;
 	uint8_t *fbp;
 	uint32_t width;
 	uint32_t height;
@@ -38,4 +41,12 @@ extern int fb_draw_init_screen(struct screen *screen_info, int screen_id);
 */
 extern int fb_draw_put_pix(uint8_t r, uint8_t g, uint8_t b, int color_bpp, struct screen *screen_info, long int scr_pos);
 
+/**
+  * @brief show pixels put since the last flush, if framebuffer
+  *        has shadow buffer
+  *
+  * @param *screen - pointer to the screen_info
+*/
+extern void fb_draw_flush(struct screen *screen_info);
+
 #endif /* LIB_FB_DRAW_H_ */
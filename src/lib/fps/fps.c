@@ -38,9 +38,11 @@ void fps_set_format(const char *format) {
 
 /* fps_sw_base is interpreted as follows:
  *   1) If framebuffer drivers supports changing frame base pointer, then
- *      sw_base[0] is a first buffer, and sw_base[1] is a back buffer
+ *      sw_base[0] is a first buffer, and sw_base[1] is a back buffer.
+ *      They are pages of video memory if it holds two frames
  *
- *   2) Otherwise they just point to the same memory location
+ *   2) Otherwise they just point to the same memory location, which is
+ *      the shadow buffer if framebuffer has it
  */
 static uint8_t *fps_sw_base[2] = { 0, 0 };
 void fps_set_base_frame(struct fb_info *fb, void *base) {
@@ -121,6 +123,21 @@ void *fps_enable_swap(struct fb_info *fb) {
 		return fps_sw_base;
 	}
 
+	if (fb->shadow != NULL) {
+		/* Drawing is in RAM already, and fb_flush() flips pages */
+		fps_sw_base[0] = fps_sw_base[1] = (uint8_t *) fb->screen_base;
+		return fps_sw_base[0];
+	}
+
+	if ((fb->ops.fb_set_base != NULL) && (fb->screen_size >= 2 * screen_sz)) {
+		/* Flip pages of video memory, some drivers (e.g. bochs) can't
+		 * show anything else. The first one is hidden now */
+		fps_sw_base[0] = (uint8_t *) fb->screen_base + screen_sz;
+		fps_sw_base[1] = (uint8_t *) fb->screen_base;
+		memset(fps_sw_base[0], 0, screen_sz);
+		return fps_sw_base[0];
+	}
+
 	if (fb->ops.fb_set_base != NULL) {
 		/* Use double buffering */
 		screen_sz *= 2;
@@ -164,16 +181,29 @@ void *fps_current_frame(struct fb_info *fb) {
  * @brief Copy temporary buffer to actual hw frame buffer
  */
 int fps_swap(struct fb_info *fb) {
+	void *frame;
+
 	assert(fb);
 	assert(fps_sw_base[0]);
 
-	if (fb->ops.fb_set_base != NULL) {
-		fb->ops.fb_set_base(fb, fps_current_frame(fb));
+	frame = fps_current_frame(fb);
+
+	/* Driver may refuse a buffer, e.g. bochs shows only video memory */
+	if ((fb->shadow == NULL) && (fps_sw_base[0] != fps_sw_base[1])
+			&& (fb->ops.fb_set_base != NULL)
+			&& (0 == fb->ops.fb_set_base(fb, frame))) {
 		fps_current++;
-	} else {
-		memcpy(fb->screen_base,
-			fps_sw_base[0],
+		return 0;
+	}
+
+	if (frame != (void *) fb->screen_base) {
+		memcpy(fb->screen_base, frame,
 			fb->var.xres * fb->var.yres * fb->var.bits_per_pixel / 8);
 	}
+
+	/* Frame was drawn around fb_* functions */
+	fb_damage(fb, 0, 0, fb->var.xres, fb->var.yres);
+	fb_flush(fb);
+
 	return 0;
 }
@@ -358,6 +358,17 @@ void bm_init(void *heap, size_t size) {
 	mark_block(block);
 }
 
+size_t bm_usable_size(void *heap, void *ptr) {
+	struct free_block *block;
+
+	block = (struct free_block *) ((uintptr_t *) ptr - 1);
+	if (!block_is_busy(block)) {
+		return 0;
+	}
+
+	return get_clear_size(block->size) - sizeof(block->size);
+}
+
 int bm_heap_is_empty(void *heap) {
 	struct heap_desc *heap_desc = (struct heap_desc *) heap;
 	return heap_desc->count == 0;
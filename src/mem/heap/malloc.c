@@ -17,6 +17,7 @@
 #include <kernel/printk.h>
 
 #include "mspace_malloc.h"
+#include "malloc_cache.h"
 
 static struct dlist_head *task_self_mspace(void) {
 	struct task_heap *task_heap;
@@ -33,7 +34,14 @@ static struct dlist_head *kernel_task_mspace(void) {
 }
 
 void *memalign(size_t boundary, size_t size) {
-	return mspace_memalign(boundary, size, task_self_mspace());
+	void *ptr;
+
+	ptr = mspace_memalign(boundary, size, task_self_mspace());
+	if ((ptr == NULL) && malloc_cache_drain(task_self())) {
+		ptr = mspace_memalign(boundary, size, task_self_mspace());
+	}
+
+	return ptr;
 }
 
 void *malloc(size_t size) {
@@ -43,7 +51,15 @@ void *malloc(size_t size) {
 		return NULL;
 	}
 
-	ptr = mspace_malloc(size, task_self_mspace());
+	ptr = malloc_cache_alloc(task_self(), size);
+	if (ptr == NULL) {
+		ptr = mspace_malloc(size, task_self_mspace());
+	}
+
+	if ((ptr == NULL) && malloc_cache_drain(task_self())) {
+		/* Cached blocks may be merged into the requested one */
+		ptr = mspace_malloc(size, task_self_mspace());
+	}
 
 	if (ptr == NULL) {
 		SET_ERRNO(ENOMEM);
@@ -55,6 +71,9 @@ void *malloc(size_t size) {
 void free(void *ptr) {
 	if (ptr == NULL)
 		return;
+	if (0 == malloc_cache_free(task_self(), ptr)) {
+		return;
+	}
 	/* XXX this workaround for such situation:
 	 * module ConstructionGlobal invokes constructors inside kernel task for all applications,
 	 * and call malloc. After a while Qt application call realloc() on some memory previously
@@ -89,7 +108,15 @@ void *realloc(void *ptr, size_t size) {
 }
 
 void *calloc(size_t nmemb, size_t size) {
+	void *ptr;
+
 	if (nmemb == 0 || size == 0)
 		return NULL; /* ok */
-	return mspace_calloc(nmemb, size, task_self_mspace());
+
+	ptr = mspace_calloc(nmemb, size, task_self_mspace());
+	if ((ptr == NULL) && malloc_cache_drain(task_self())) {
+		ptr = mspace_calloc(nmemb, size, task_self_mspace());
+	}
+
+	return ptr;
 }
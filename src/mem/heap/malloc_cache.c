@@ -0,0 +1,206 @@
+/**
+ * @file
+ * @brief Per-CPU magazines of small blocks in front of task heap
+ * @details Small blocks are rounded up to a few size classes. Each CPU keeps
+ *          a magazine of free blocks of every class for the task, so most
+ *          of malloc() and free() calls just take or put a pointer without
+ *          touching the heap. Empty magazine is refilled with a half of its
+ *          capacity at once, full one gives a half of blocks back to heap.
+ *          If heap is exhausted, magazines of all CPUs are emptied, so
+ *          blocks kept there may be merged into a larger one.
+ *
+ * @date 18.10.2026
+ */
+
+#include <assert.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <framework/mod/options.h>
+#include <hal/cpu.h>
+#include <kernel/sched/sched_lock.h>
+#include <kernel/spinlock.h>
+#include <kernel/task.h>
+#include <kernel/task/resource.h>
+#include <kernel/task/resource/task_heap.h>
+#include <mem/heap_afterfree.h>
+
+#include <mem/heap/mspace_malloc.h>
+
+#include "malloc_cache.h"
+
+#define CACHE_MAX_SIZE  OPTION_GET(NUMBER, max_size)
+#define MAGAZINE_SIZE   OPTION_GET(NUMBER, magazine_size)
+
+#define CACHE_STEP      16
+#define CACHE_CLASSES   (CACHE_MAX_SIZE / CACHE_STEP)
+
+struct malloc_magazine {
+	unsigned int cnt;
+	void *objs[MAGAZINE_SIZE];
+};
+
+struct malloc_cpu_cache {
+	/* Magazines are emptied by another CPU if heap is exhausted */
+	spinlock_t lock;
+	struct malloc_magazine mags[CACHE_CLASSES];
+};
+
+struct malloc_cache {
+	struct malloc_cpu_cache cpus[NCPU];
+};
+
+static void task_malloc_cache_init(const struct task *task, void *space);
+
+TASK_RESOURCE_DECLARE(static,
+		task_malloc_cache_desc,
+		struct malloc_cache,
+	.init = task_malloc_cache_init,
+);
+
+static void task_malloc_cache_init(const struct task *task, void *space) {
+	struct malloc_cache *cache = space;
+	int cpu;
+
+	/* Blocks of parent's heap are not inherited with the cache */
+	memset(cache, 0, sizeof(*cache));
+	for (cpu = 0; cpu < NCPU; cpu++) {
+		spin_init(&cache->cpus[cpu].lock, __SPIN_UNLOCKED);
+	}
+}
+
+/* Must be called with scheduler locked, so thread stays on the CPU */
+static struct malloc_cpu_cache *malloc_cpu_cache(struct task *task) {
+	struct malloc_cache *cache;
+
+	cache = task_resource(task, &task_malloc_cache_desc);
+
+	return &cache->cpus[cpu_get_id()];
+}
+
+/* Cached blocks are allocated for heap, so their double free isn't caught
+ * there. Only the magazine the block goes to is checked */
+static inline int malloc_magazine_has(struct malloc_magazine *mag, void *ptr) {
+	unsigned int i;
+
+	for (i = 0; i < mag->cnt; i++) {
+		if (mag->objs[i] == ptr) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+void *malloc_cache_alloc(struct task *task, size_t size) {
+	struct malloc_cpu_cache *cc;
+	struct malloc_magazine *mag;
+	struct dlist_head *mspace;
+	void *ptr;
+	int class;
+
+	if ((size == 0) || (size > CACHE_MAX_SIZE)) {
+		return NULL;
+	}
+
+	class = (size - 1) / CACHE_STEP;
+	mspace = &task_heap_get(task)->mm;
+
+	sched_lock();
+	{
+		cc = malloc_cpu_cache(task);
+		mag = &cc->mags[class];
+
+		spin_lock(&cc->lock);
+		if (mag->cnt == 0) {
+			while (mag->cnt < MAGAZINE_SIZE / 2) {
+				ptr = mspace_malloc((class + 1) * CACHE_STEP, mspace);
+				if (ptr == NULL) {
+					break;
+				}
+				mag->objs[mag->cnt++] = ptr;
+			}
+		}
+
+		ptr = (mag->cnt != 0) ? mag->objs[--mag->cnt] : NULL;
+		spin_unlock(&cc->lock);
+	}
+	sched_unlock();
+
+	return ptr;
+}
+
+int malloc_cache_free(struct task *task, void *ptr) {
+	struct malloc_cpu_cache *cc;
+	struct malloc_magazine *mag;
+	struct dlist_head *mspace;
+	size_t size;
+	int i;
+
+	mspace = &task_heap_get(task)->mm;
+
+	sched_lock();
+	{
+		size = mspace_usable_size(ptr, mspace);
+		if ((size < CACHE_STEP) || (size > CACHE_MAX_SIZE)) {
+			sched_unlock();
+			return -1;
+		}
+
+		afterfree(ptr, size);
+
+		/* Block may be larger than its class, it's cached as a smaller one */
+		cc = malloc_cpu_cache(task);
+		mag = &cc->mags[size / CACHE_STEP - 1];
+
+		spin_lock(&cc->lock);
+		assert(!malloc_magazine_has(mag, ptr));
+		if (mag->cnt == MAGAZINE_SIZE) {
+			/* Older blocks go back to heap */
+			for (i = 0; i < MAGAZINE_SIZE / 2; i++) {
+				mspace_free(mag->objs[i], mspace);
+			}
+			mag->cnt -= MAGAZINE_SIZE / 2;
+			memmove(mag->objs, mag->objs + MAGAZINE_SIZE / 2,
+					mag->cnt * sizeof(mag->objs[0]));
+		}
+
+		mag->objs[mag->cnt++] = ptr;
+		spin_unlock(&cc->lock);
+	}
+	sched_unlock();
+
+	return 0;
+}
+
+int malloc_cache_drain(struct task *task) {
+	struct malloc_cache *cache;
+	struct malloc_cpu_cache *cc;
+	struct malloc_magazine *mag;
+	struct dlist_head *mspace;
+	int cpu, class, cnt;
+
+	cache = task_resource(task, &task_malloc_cache_desc);
+	mspace = &task_heap_get(task)->mm;
+	cnt = 0;
+
+	sched_lock();
+	{
+		for (cpu = 0; cpu < NCPU; cpu++) {
+			cc = &cache->cpus[cpu];
+
+			spin_lock(&cc->lock);
+			for (class = 0; class < CACHE_CLASSES; class++) {
+				mag = &cc->mags[class];
+				while (mag->cnt != 0) {
+					mspace_free(mag->objs[--mag->cnt], mspace);
+					cnt++;
+				}
+			}
+			spin_unlock(&cc->lock);
+		}
+	}
+	sched_unlock();
+
+	return cnt;
+}
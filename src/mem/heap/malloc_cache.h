@@ -0,0 +1,33 @@
+/**
+ * @file
+ * @brief Cache of small blocks in front of task heap
+ *
+ * @date 18.10.2026
+ */
+
+#ifndef MEM_HEAP_MALLOC_CACHE_H_
+#define MEM_HEAP_MALLOC_CACHE_H_
+
+#include <stddef.h>
+
+struct task;
+
+/**
+ * @return Cached block of at least @a size bytes or NULL if the size isn't
+ *         cached or the heap is exhausted
+ */
+extern void *malloc_cache_alloc(struct task *task, size_t size);
+
+/**
+ * @return 0 if the block was taken by the cache, -1 otherwise
+ */
+extern int malloc_cache_free(struct task *task, void *ptr);
+
+/**
+ * @brief Give blocks cached by all CPUs for @a task back to its heap
+ *
+ * @return Number of blocks given back
+ */
+extern int malloc_cache_drain(struct task *task);
+
+#endif /* MEM_HEAP_MALLOC_CACHE_H_ */
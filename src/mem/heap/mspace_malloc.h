@@ -17,6 +17,8 @@ extern void *mspace_malloc(size_t size, struct dlist_head *mspace);
 extern int   mspace_free(void *ptr, struct dlist_head *mspace);
 extern void *mspace_calloc(size_t nmemb, size_t size, struct dlist_head *mspace);
 extern void *mspace_realloc(void *ptr, size_t size, struct dlist_head *mspace);
+/* Size of data of allocated block, 0 if @a ptr isn't allocated in @a mspace */
+extern size_t mspace_usable_size(void *ptr, struct dlist_head *mspace);
 
 typedef enum heap_type {
 	HEAP_RAM = 0,
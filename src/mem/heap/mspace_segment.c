@@ -0,0 +1,183 @@
+/**
+ * @file
+ * @brief Segments of task heaps which don't depend on heap algorithm
+ *
+ * @date 04.03.2014
+ * @author Alexander Kalmuk
+ */
+
+#include <assert.h>
+#include <string.h>
+
+#include <mem/page.h>
+
+#include <util/array.h>
+#include <util/dlist.h>
+#include <util/log.h>
+#include <util/member.h>
+
+#include <mem/heap/mspace_malloc.h>
+
+#include "mspace_segment.h"
+
+extern struct page_allocator *__heap_pgallocator;
+extern struct page_allocator *__heap_pgallocator2 __attribute__((weak));
+extern struct page_allocator *__heap_fixed_pgallocator __attribute__((weak));
+
+struct mm_heap_allocator {
+	struct page_allocator **pg_allocator;
+	heap_type_t type;
+};
+
+static struct mm_heap_allocator const mm_page_allocs[] = {
+	{ &__heap_pgallocator, HEAP_RAM },
+	{ &__heap_pgallocator2, HEAP_FAST_RAM },
+	{ &__heap_fixed_pgallocator, HEAP_EXTERN_MEM },
+};
+
+static struct mm_heap_allocator const *mm_cur_allocator =
+	&mm_page_allocs[0];
+
+void *mm_segment_alloc(int page_cnt) {
+	void *ret;
+	int i;
+
+	ret = page_alloc(*mm_cur_allocator->pg_allocator, page_cnt);
+	if (ret) {
+		return ret;
+	}
+
+	/* Requsted memory wasn't allocated by mm_cur_allocator->pg_allocator above,
+	 * because due to there is no more free memory. Try find new allocator */
+	for (i = 0; i < ARRAY_SIZE(mm_page_allocs); i++) {
+		if (mm_page_allocs[i].pg_allocator
+				&& *mm_page_allocs[i].pg_allocator) {
+			ret = page_alloc(*mm_page_allocs[i].pg_allocator, page_cnt);
+			if (ret) {
+				mm_cur_allocator = &mm_page_allocs[i];
+				break;
+			}
+		}
+	}
+
+	return ret;
+}
+
+/* XXX This functionality is experimental and currently only used
+ * in PISJP (stm32f7-discovery). Please, be careful if you want to use
+ * this function. */
+int mspace_set_heap(heap_type_t type, heap_type_t *prev_type) {
+	if (prev_type) {
+		*prev_type = mm_cur_allocator->type;
+	}
+
+	switch (type) {
+	case HEAP_FAST_RAM:
+	case HEAP_RAM:
+	case HEAP_EXTERN_MEM:
+		if (!mm_page_allocs[type].pg_allocator) {
+			return -1;
+		}
+		mm_cur_allocator = &mm_page_allocs[type];
+		break;
+	default:
+		log_error("Unknown heap type - %d\n", type);
+		return -1;
+	}
+
+	return 0;
+}
+
+void mm_segment_free(void *segment, int page_cnt) {
+	int i;
+	for (i = 0; i < ARRAY_SIZE(mm_page_allocs); i++) {
+		if (mm_page_allocs[i].pg_allocator &&
+				page_belong(*mm_page_allocs[i].pg_allocator, segment)) {
+			page_free(*mm_page_allocs[i].pg_allocator, segment, page_cnt);
+			break;
+		}
+	}
+}
+
+int mspace_init(struct dlist_head *mspace) {
+	dlist_init(mspace);
+	return 0;
+}
+
+int mspace_fini(struct dlist_head *mspace) {
+	struct mm_segment *mm;
+
+	dlist_foreach_entry(mm, mspace, link) {
+		mm_segment_free(mm, mm->size / PAGE_SIZE());
+	}
+
+	return 0;
+}
+
+size_t mspace_deep_copy_size(struct dlist_head *mspace) {
+	struct mm_segment *mm;
+	size_t ret;
+
+	ret = 0;
+	dlist_foreach_entry(mm, mspace, link) {
+		ret += mm->size;
+	}
+	return ret;
+}
+
+
+void mspace_deep_store(struct dlist_head *mspace, struct dlist_head *store_space, void *buf) {
+	struct mm_segment *mm;
+	void *p;
+
+	dlist_init(store_space);
+
+	/* if mspace is empty list manipulation is illegal */
+	if (dlist_empty(mspace)) {
+		return;
+	}
+
+	dlist_del(mspace);
+	dlist_add_prev(store_space, mspace->next);
+
+	p = buf;
+	dlist_foreach_entry(mm, store_space, link) {
+		memcpy(p, mm, mm->size);
+		p += mm->size;
+	}
+
+	dlist_del(store_space);
+	dlist_add_prev(mspace, mspace->next);
+}
+
+void mspace_deep_restore(struct dlist_head *mspace, struct dlist_head *store_space, void *buf) {
+	struct dlist_head *raw_mm;
+	void *p;
+
+	assert(mspace);
+	assert(store_space);
+	assert(buf);
+
+	dlist_init(mspace);
+
+	p = buf;
+	raw_mm = store_space->next;
+
+	/* can't use foreach, since it stores next pointer in accumulator */
+	while (raw_mm != store_space) {
+		struct mm_segment *buf_mm, *mm;
+
+		buf_mm = p;
+
+		mm = member_cast_out(raw_mm, struct mm_segment, link);
+		memcpy(mm, buf_mm, buf_mm->size);
+
+		p += buf_mm->size;
+		raw_mm = raw_mm->next;
+	}
+
+	if (!dlist_empty(store_space)) {
+		dlist_del(store_space);
+		dlist_add_prev(mspace, store_space->next);
+	}
+}
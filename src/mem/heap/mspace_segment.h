@@ -0,0 +1,26 @@
+/**
+ * @file
+ * @brief Memory segments of task heaps
+ * @details Heap of a task (mspace) is a list of segments taken from page
+ *          allocators. Each segment starts with struct mm_segment, the rest
+ *          of it is managed by the heap algorithm.
+ *
+ * @date 18.10.2026
+ */
+
+#ifndef MEM_HEAP_MSPACE_SEGMENT_H_
+#define MEM_HEAP_MSPACE_SEGMENT_H_
+
+#include <stddef.h>
+
+#include <util/dlist.h>
+
+struct mm_segment {
+	struct dlist_head link;
+	size_t size;
+};
+
+extern void *mm_segment_alloc(int page_cnt);
+extern void mm_segment_free(void *segment, int page_cnt);
+
+#endif /* MEM_HEAP_MSPACE_SEGMENT_H_ */
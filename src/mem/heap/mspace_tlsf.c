@@ -0,0 +1,520 @@
+/**
+ * @file
+ * @brief Heap implementation based on two-level segregated fit algorithm.
+ * @details
+ *    Free blocks of all segments of a task heap are kept in one matrix of
+ *    lists. First level splits sizes by powers of two, second level splits
+ *    each range to TLSF_SL_CNT equal parts. Two levels of bitmaps show
+ *    non-empty lists, so suitable block is found by a couple of bit scans
+ *    and malloc() and free() don't depend on heap size or fragmentation.
+ *
+ *    Segment structure:
+ *    |struct tlsf_segment|(struct tlsf_control)| blocks ... |sentinel|
+ *    Control is placed in the first segment of the heap, this segment is
+ *    kept until the heap is released.
+ *
+ *    Block header points to its segment, so segment of a freed pointer
+ *    is found at once.
+ *
+ * @date 18.10.2026
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <framework/mod/options.h>
+#include <kernel/printk.h>
+#include <kernel/sched/sched_lock.h>
+#include <mem/heap_afterfree.h>
+#include <mem/page.h>
+#include <util/binalign.h>
+#include <util/bit.h>
+#include <util/dlist.h>
+#include <util/err.h>
+#include <util/math.h>
+
+#include <mem/heap/mspace_malloc.h>
+
+#include "mspace_segment.h"
+
+#define SEGMENT_PAGES OPTION_GET(NUMBER, segment_pages)
+
+#define TLSF_WORD        sizeof(void *)
+#define TLSF_ALIGN       (2 * TLSF_WORD)
+#define TLSF_ALIGN_LOG2  (TLSF_WORD == 8 ? 4 : 3)
+
+#define TLSF_SL_LOG2     4
+#define TLSF_SL_CNT      (1 << TLSF_SL_LOG2)
+/* Blocks are less than 2^(TLSF_FL_MAX + 1) bytes */
+#define TLSF_FL_MAX      30
+#define TLSF_FL_SHIFT    (TLSF_SL_LOG2 + TLSF_ALIGN_LOG2)
+#define TLSF_FL_CNT      (TLSF_FL_MAX - TLSF_FL_SHIFT + 1)
+/* Blocks which are less are in the first list with linear steps */
+#define TLSF_SMALL       (1UL << TLSF_FL_SHIFT)
+
+#define TLSF_FREE        0x1
+#define TLSF_PREV_FREE   0x2
+
+struct tlsf_segment;
+
+struct tlsf_block {
+	/* Last word of the previous block, valid only if that one is free */
+	struct tlsf_block *prev_phys;
+
+	struct tlsf_segment *seg;
+	size_t size;                  /* of data, and TLSF_FREE, TLSF_PREV_FREE */
+
+	/* Data of busy block starts here */
+	struct tlsf_block *next_free;
+	struct tlsf_block *prev_free;
+};
+
+/* Header which precedes data of a block */
+#define TLSF_HDR         offsetof(struct tlsf_block, next_free)
+/* Space taken by a block besides its data */
+#define TLSF_OVERHEAD    (TLSF_HDR - TLSF_WORD)
+/* Free block keeps list links and prev_phys of the next one */
+#define TLSF_BLOCK_MIN   binalign_bound(3 * TLSF_WORD, TLSF_ALIGN)
+
+struct tlsf_control {
+	unsigned long fl_map;
+	unsigned long sl_map[TLSF_FL_CNT];
+	struct tlsf_block *heads[TLSF_FL_CNT][TLSF_SL_CNT];
+};
+
+struct tlsf_segment {
+	struct mm_segment mm;
+	struct tlsf_control *ctl;
+};
+
+static inline size_t tlsf_size(struct tlsf_block *block) {
+	return block->size & ~(TLSF_FREE | TLSF_PREV_FREE);
+}
+
+static inline void *tlsf_to_ptr(struct tlsf_block *block) {
+	return (char *) block + TLSF_HDR;
+}
+
+static inline struct tlsf_block *tlsf_from_ptr(void *ptr) {
+	return (struct tlsf_block *) ((char *) ptr - TLSF_HDR);
+}
+
+static inline struct tlsf_block *tlsf_next(struct tlsf_block *block) {
+	return tlsf_from_ptr((char *) tlsf_to_ptr(block) + tlsf_size(block)
+			+ TLSF_OVERHEAD);
+}
+
+static inline struct tlsf_block *tlsf_seg_first(struct tlsf_segment *seg) {
+	uintptr_t start;
+
+	start = (uintptr_t) (seg + 1);
+	if (seg->ctl == (void *) start) {
+		start += sizeof(struct tlsf_control);
+	}
+
+	/* prev_phys of the first block is never used, it may overlap header */
+	return tlsf_from_ptr((void *) binalign_bound(start + TLSF_OVERHEAD,
+			TLSF_ALIGN));
+}
+
+static void tlsf_mapping(size_t size, int *fl, int *sl) {
+	int msb;
+
+	if (size < TLSF_SMALL) {
+		*fl = 0;
+		*sl = size >> TLSF_ALIGN_LOG2;
+	} else {
+		msb = bit_fls(size) - 1;
+		*fl = msb - TLSF_FL_SHIFT + 1;
+		*sl = (size >> (msb - TLSF_SL_LOG2)) ^ TLSF_SL_CNT;
+	}
+}
+
+static void tlsf_insert(struct tlsf_control *ctl, struct tlsf_block *block) {
+	struct tlsf_block *head;
+	int fl, sl;
+
+	tlsf_mapping(tlsf_size(block), &fl, &sl);
+
+	head = ctl->heads[fl][sl];
+	block->next_free = head;
+	block->prev_free = NULL;
+	if (head) {
+		head->prev_free = block;
+	}
+	ctl->heads[fl][sl] = block;
+
+	ctl->fl_map |= 1UL << fl;
+	ctl->sl_map[fl] |= 1UL << sl;
+}
+
+static void tlsf_remove(struct tlsf_control *ctl, struct tlsf_block *block) {
+	int fl, sl;
+
+	tlsf_mapping(tlsf_size(block), &fl, &sl);
+
+	if (block->next_free) {
+		block->next_free->prev_free = block->prev_free;
+	}
+	if (block->prev_free) {
+		block->prev_free->next_free = block->next_free;
+		return;
+	}
+
+	ctl->heads[fl][sl] = block->next_free;
+	if (block->next_free == NULL) {
+		ctl->sl_map[fl] &= ~(1UL << sl);
+		if (ctl->sl_map[fl] == 0) {
+			ctl->fl_map &= ~(1UL << fl);
+		}
+	}
+}
+
+/* Find and take a free block of at least @a size bytes */
+static struct tlsf_block *tlsf_locate(struct tlsf_control *ctl, size_t size) {
+	struct tlsf_block *block;
+	unsigned long map;
+	int fl, sl;
+
+	/* Any block of the list must fit, so search starts from the next one */
+	if (size >= TLSF_SMALL) {
+		size += (1UL << (bit_fls(size) - 1 - TLSF_SL_LOG2)) - 1;
+	}
+	tlsf_mapping(size, &fl, &sl);
+	if (fl >= TLSF_FL_CNT) {
+		return NULL;
+	}
+
+	map = ctl->sl_map[fl] & (~0UL << sl);
+	if (map == 0) {
+		map = ctl->fl_map & (~0UL << (fl + 1));
+		if (map == 0) {
+			return NULL;
+		}
+		fl = bit_ctz(map);
+		map = ctl->sl_map[fl];
+	}
+	sl = bit_ctz(map);
+
+	block = ctl->heads[fl][sl];
+	assert(block);
+	tlsf_remove(ctl, block);
+
+	return block;
+}
+
+static void tlsf_release(struct tlsf_control *ctl, struct tlsf_block *block) {
+	struct tlsf_block *next;
+
+	block->size |= TLSF_FREE;
+
+	next = tlsf_next(block);
+	next->prev_phys = block;
+	next->size |= TLSF_PREV_FREE;
+
+	tlsf_insert(ctl, block);
+}
+
+/* Mark free block busy and return its tail above @a size to free lists */
+static void tlsf_use(struct tlsf_control *ctl, struct tlsf_block *block,
+		size_t size) {
+	struct tlsf_block *rest;
+
+	block->size &= ~TLSF_FREE;
+
+	if (tlsf_size(block) < size + TLSF_OVERHEAD + TLSF_BLOCK_MIN) {
+		tlsf_next(block)->size &= ~TLSF_PREV_FREE;
+		return;
+	}
+
+	rest = tlsf_from_ptr((char *) tlsf_to_ptr(block) + size + TLSF_OVERHEAD);
+	rest->seg = block->seg;
+	rest->size = tlsf_size(block) - size - TLSF_OVERHEAD;
+	block->size = size | (block->size & TLSF_PREV_FREE);
+
+	/* Next block of a free one is busy, nothing to merge */
+	tlsf_release(ctl, rest);
+}
+
+/* Return leading part of free @a block to free lists, so data of the rest
+ * starts at @a ptr */
+static struct tlsf_block *tlsf_cut_head(struct tlsf_control *ctl,
+		struct tlsf_block *block, void *ptr) {
+	struct tlsf_block *rest;
+	size_t gap;
+
+	gap = (char *) ptr - (char *) tlsf_to_ptr(block);
+
+	rest = tlsf_from_ptr(ptr);
+	rest->seg = block->seg;
+	rest->size = tlsf_size(block) - gap;
+
+	block->size = (gap - TLSF_OVERHEAD) | (block->size & TLSF_PREV_FREE);
+	tlsf_release(ctl, block);
+
+	return rest;
+}
+
+/* Size of free block which is enough for the request */
+static size_t tlsf_request(size_t boundary, size_t size) {
+	size = max(binalign_bound(size, TLSF_ALIGN), TLSF_BLOCK_MIN);
+
+	if (boundary > TLSF_ALIGN) {
+		/* Space before aligned data must fit a free block */
+		size += boundary + TLSF_OVERHEAD + TLSF_BLOCK_MIN;
+	}
+
+	return size;
+}
+
+static void *tlsf_alloc(struct tlsf_control *ctl, size_t boundary,
+		size_t size) {
+	struct tlsf_block *block;
+	uintptr_t ptr, aligned;
+
+	block = tlsf_locate(ctl, tlsf_request(boundary, size));
+	if (block == NULL) {
+		return NULL;
+	}
+
+	if (boundary > TLSF_ALIGN) {
+		ptr = (uintptr_t) tlsf_to_ptr(block);
+		aligned = binalign_bound(ptr, boundary);
+		if ((aligned != ptr)
+				&& (aligned - ptr < TLSF_OVERHEAD + TLSF_BLOCK_MIN)) {
+			aligned = binalign_bound(ptr + TLSF_OVERHEAD + TLSF_BLOCK_MIN,
+					boundary);
+		}
+		if (aligned != ptr) {
+			block = tlsf_cut_head(ctl, block, (void *) aligned);
+		}
+	}
+
+	tlsf_use(ctl, block, max(binalign_bound(size, TLSF_ALIGN),
+			TLSF_BLOCK_MIN));
+
+	return tlsf_to_ptr(block);
+}
+
+static struct tlsf_control *tlsf_ctl(struct dlist_head *mspace) {
+	if (dlist_empty(mspace)) {
+		return NULL;
+	}
+
+	return dlist_next_entry(mspace, struct tlsf_segment, mm.link)->ctl;
+}
+
+/* Add segment which has a free block of at least @a size bytes */
+static int tlsf_segment_add(struct dlist_head *mspace, size_t size) {
+	struct tlsf_segment *seg;
+	struct tlsf_block *block;
+	size_t hdr, pages;
+	char *end;
+
+	hdr = sizeof(struct tlsf_segment);
+	if (dlist_empty(mspace)) {
+		hdr += sizeof(struct tlsf_control);
+	}
+
+	/* Any block of the list the request is rounded up to must fit */
+	size += size >> TLSF_SL_LOG2;
+	pages = (hdr + size + 2 * (TLSF_ALIGN + TLSF_OVERHEAD) + PAGE_SIZE() - 1)
+		/ PAGE_SIZE();
+	pages = max(pages, (size_t) SEGMENT_PAGES);
+
+	seg = mm_segment_alloc(pages);
+	if (seg == NULL) {
+		return -ENOMEM;
+	}
+	seg->mm.size = pages * PAGE_SIZE();
+
+	if (dlist_empty(mspace)) {
+		seg->ctl = (struct tlsf_control *) (seg + 1);
+		memset(seg->ctl, 0, sizeof(struct tlsf_control));
+	} else {
+		seg->ctl = tlsf_ctl(mspace);
+	}
+
+	dlist_head_init(&seg->mm.link);
+	/* Segment with control remains the first one */
+	dlist_add_prev(&seg->mm.link, mspace);
+
+	/* Single free block followed by busy sentinel of zero size */
+	block = tlsf_seg_first(seg);
+	end = (char *) seg + seg->mm.size;
+	block->seg = seg;
+	block->size = (end - (char *) tlsf_to_ptr(block) - TLSF_OVERHEAD)
+		& ~(TLSF_ALIGN - 1);
+
+	tlsf_next(block)->seg = seg;
+	tlsf_next(block)->size = 0;
+
+	tlsf_release(seg->ctl, block);
+
+	return 0;
+}
+
+static void tlsf_free(struct tlsf_control *ctl, struct tlsf_block *block) {
+	struct tlsf_segment *seg;
+	struct tlsf_block *next;
+
+	seg = block->seg;
+
+	if (block->size & TLSF_PREV_FREE) {
+		tlsf_remove(ctl, block->prev_phys);
+		block->prev_phys->size += tlsf_size(block) + TLSF_OVERHEAD;
+		block = block->prev_phys;
+	}
+
+	next = tlsf_next(block);
+	if (next->size & TLSF_FREE) {
+		tlsf_remove(ctl, next);
+		block->size += tlsf_size(next) + TLSF_OVERHEAD;
+	}
+
+	if ((block == tlsf_seg_first(seg)) && (tlsf_size(tlsf_next(block)) == 0)
+			&& (seg->ctl != (void *) (seg + 1))) {
+		/* Whole segment is free */
+		dlist_del(&seg->mm.link);
+		mm_segment_free(seg, seg->mm.size / PAGE_SIZE());
+		return;
+	}
+
+	tlsf_release(ctl, block);
+}
+
+/* Busy block of @a mspace which holds @a ptr or NULL */
+static struct tlsf_block *tlsf_lookup(void *ptr, struct dlist_head *mspace) {
+	struct tlsf_block *block;
+	struct tlsf_control *ctl;
+
+	ctl = tlsf_ctl(mspace);
+	block = tlsf_from_ptr(ptr);
+
+	if ((ctl == NULL) || (block->seg->ctl != ctl)) {
+		return NULL;
+	}
+
+	return block;
+}
+
+void *mspace_memalign(size_t boundary, size_t size, struct dlist_head *mspace) {
+	void *ptr;
+
+	assert(mspace);
+
+	if ((size == 0) || (size > (1UL << TLSF_FL_MAX))) {
+		return NULL;
+	}
+
+	sched_lock();
+	{
+		ptr = NULL;
+		if (tlsf_ctl(mspace)) {
+			ptr = tlsf_alloc(tlsf_ctl(mspace), boundary, size);
+		}
+		if ((ptr == NULL)
+				&& (0 == tlsf_segment_add(mspace, tlsf_request(boundary, size)))) {
+			ptr = tlsf_alloc(tlsf_ctl(mspace), boundary, size);
+		}
+	}
+	sched_unlock();
+
+	return ptr;
+}
+
+void *mspace_malloc(size_t size, struct dlist_head *mspace) {
+	assert(mspace);
+	return mspace_memalign(8, size, mspace);
+}
+
+int mspace_free(void *ptr, struct dlist_head *mspace) {
+	struct tlsf_block *block;
+
+	assert(ptr);
+	assert(mspace);
+
+	sched_lock();
+	{
+		block = tlsf_lookup(ptr, mspace);
+		if (block == NULL) {
+			sched_unlock();
+			return -1;
+		}
+
+		if (block->size & TLSF_FREE) {
+			sched_unlock();
+			printk("***** free(): the block not busy\n");
+			return 0;
+		}
+
+		afterfree(ptr, tlsf_size(block));
+
+		tlsf_free(block->seg->ctl, block);
+	}
+	sched_unlock();
+
+	return 0;
+}
+
+size_t mspace_usable_size(void *ptr, struct dlist_head *mspace) {
+	struct tlsf_block *block;
+
+	assert(ptr);
+	assert(mspace);
+
+	block = tlsf_lookup(ptr, mspace);
+	if ((block == NULL) || (block->size & TLSF_FREE)) {
+		return 0;
+	}
+
+	return tlsf_size(block);
+}
+
+void *mspace_realloc(void *ptr, size_t size, struct dlist_head *mspace) {
+	struct tlsf_block *block;
+	void *ret;
+
+	assert(mspace);
+	assert(size != 0 || ptr == NULL);
+
+	if (ptr == NULL) {
+		return mspace_malloc(size, mspace);
+	}
+
+	block = tlsf_lookup(ptr, mspace);
+	if (block == NULL) {
+		return err_ptr(EINVAL);
+	}
+
+	ret = mspace_malloc(size, mspace);
+	if (ret == NULL) {
+		return NULL;
+	}
+
+	memcpy(ret, ptr, min(size, tlsf_size(block)));
+	mspace_free(ptr, mspace);
+
+	return ret;
+}
+
+void *mspace_calloc(size_t nmemb, size_t size, struct dlist_head *mspace) {
+	void *ret;
+	size_t total_size;
+
+	total_size = nmemb * size;
+
+	assert(mspace);
+	assert(total_size > 0);
+
+	ret = mspace_malloc(total_size, mspace);
+	if (ret == NULL) {
+		return NULL;
+	}
+
+	memset(ret, 0, total_size);
+	return ret;
+}
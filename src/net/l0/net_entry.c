@@ -15,17 +15,25 @@
 #include <string.h>
 
 #include <util/dlist.h>
+#include <util/math.h>
 
 #include <hal/ipl.h>
 #include <net/netdevice.h>
 #include <net/skbuff.h>
+#include <net/l0/net_entry.h>
 #include <net/l0/net_rx.h>
 #include <kernel/sched/schedee_priority.h>
 #include <kernel/lthread/lthread.h>
 
 #define NETIF_RX_HND_PRIORITY OPTION_GET(NUMBER, hnd_priority)
+#define NETIF_RX_BUDGET       OPTION_GET(NUMBER, rx_budget)
+#define NETIF_RX_WEIGHT       OPTION_GET(NUMBER, rx_weight)
 
 static DLIST_DEFINE(netif_rx_list);
+/* Packets received during one poll, they are passed to the stack at once */
+static struct sk_buff_head netif_rx_batch = {
+	(struct sk_buff *)&netif_rx_batch, (struct sk_buff *)&netif_rx_batch
+};
 
 static int netif_rx_action(struct lthread *self);
 static LTHREAD_DEF(netif_rx_irq_handler, netif_rx_action, NETIF_RX_HND_PRIORITY);
@@ -33,25 +41,70 @@ static LTHREAD_DEF(netif_rx_irq_handler, netif_rx_action, NETIF_RX_HND_PRIORITY)
 static int netif_tx_action(struct lthread *self);
 static LTHREAD_DEF(netif_tx_handler, netif_tx_action, NETIF_RX_HND_PRIORITY);
 
+static inline int netif_has_poll(struct net_device *dev) {
+	return (dev->drv_ops != NULL) && (dev->drv_ops->poll != NULL);
+}
+
+/* Process at most weight packets queued by netif_rx() */
+static int netif_rx_backlog(struct net_device *dev, int weight) {
+	struct sk_buff *skb;
+	int work;
+	ipl_t ipl;
+
+	for (work = 0; work < weight; work++) {
+		ipl = ipl_save();
+		{
+			skb = skb_queue_pop(&dev->dev_queue);
+		}
+		ipl_restore(ipl);
+
+		if (skb == NULL) {
+			break;
+		}
+		skb_queue_push(&netif_rx_batch, skb);
+	}
+
+	return work;
+}
+
 static int netif_rx_action(struct lthread *self) {
 	struct net_device *dev;
+	int budget, weight, work;
 	ipl_t ipl;
 
-	ipl= ipl_save();
-	{
-		dlist_foreach_entry_safe(dev, &netif_rx_list, rx_lnk) {
-			struct sk_buff *skb;
+	budget = NETIF_RX_BUDGET;
 
-			while ((skb = skb_queue_pop(&dev->dev_queue)) != NULL) {
-				ipl_restore(ipl);
-				{
-					net_rx(skb);
-				}
-				ipl= ipl_save();
-			}
+	ipl = ipl_save();
+	while (!dlist_empty(&netif_rx_list) && (budget > 0)) {
+		dev = dlist_first_entry(&netif_rx_list, struct net_device, rx_lnk);
+		weight = min(NETIF_RX_WEIGHT, budget);
+		ipl_restore(ipl);
+
+		if (netif_has_poll(dev)) {
+			/* Driver calls netif_rx_complete() when it's done */
+			work = dev->drv_ops->poll(dev, weight);
+		} else {
+			work = netif_rx_backlog(dev, weight);
+		}
+		net_rx_list(&netif_rx_batch);
+		/* Idle device costs something too, so the loop ends anyway */
+		budget -= max(work, 1);
+
+		ipl = ipl_save();
+		if (!dlist_empty(&dev->rx_lnk)) {
 			dlist_del_init(&dev->rx_lnk);
+			if (netif_has_poll(dev)
+					|| (skb_queue_front(&dev->dev_queue) != NULL)) {
+				/* Device still has packets, let others go first */
+				dlist_add_prev(&dev->rx_lnk, &netif_rx_list);
+			}
 		}
 	}
+
+	if (!dlist_empty(&netif_rx_list)) {
+		/* Budget is exhausted, give a chance to the rest of the system */
+		lthread_launch(self);
+	}
 	ipl_restore(ipl);
 
 	return 0;
@@ -83,6 +136,44 @@ int netif_rx(void *data) {
 	return NET_RX_SUCCESS;
 }
 
+void netif_rx_schedule(struct net_device *dev) {
+	ipl_t ipl;
+
+	assert(dev != NULL);
+	assert(netif_has_poll(dev));
+
+	ipl = ipl_save();
+	{
+		if (dlist_empty(&dev->rx_lnk)) {
+			dlist_add_prev(&dev->rx_lnk, &netif_rx_list);
+		}
+
+		lthread_launch(&netif_rx_irq_handler);
+	}
+	ipl_restore(ipl);
+}
+
+void netif_rx_complete(struct net_device *dev) {
+	ipl_t ipl;
+
+	assert(dev != NULL);
+
+	ipl = ipl_save();
+	{
+		dlist_del_init(&dev->rx_lnk);
+	}
+	ipl_restore(ipl);
+}
+
+int netif_receive_skb(struct sk_buff *skb) {
+	assert(skb != NULL);
+	assert(skb->dev != NULL);
+
+	skb_queue_push(&netif_rx_batch, skb);
+
+	return NET_RX_SUCCESS;
+}
+
 static DLIST_DEFINE(netif_tx_list);
 
 static struct lthread netif_tx_handler;
@@ -94,11 +185,14 @@ static int netif_tx_action(struct lthread *self) {
 	{
 		dlist_foreach_entry_safe(dev, &netif_tx_list, tx_lnk) {
 			struct sk_buff * skb;
+			size_t len;
 			int ret;
 
 			while ((skb = skb_queue_pop(&dev->dev_queue_tx)) != NULL) {
 				assert(dev->drv_ops != NULL);
 				assert(dev->drv_ops->xmit != NULL);
+				/* Driver may hold skb until transmission is completed */
+				len = skb->len;
 				ret = dev->drv_ops->xmit(dev, skb);
 				if (ret != 0) {
 					log_debug("xmit = %d", ret);
@@ -108,7 +202,11 @@ static int netif_tx_action(struct lthread *self) {
 				}
 
 				dev->stats.tx_packets++;
-				dev->stats.tx_bytes += skb->len;
+				dev->stats.tx_bytes += len;
+			}
+
+			if (dev->drv_ops->xmit_flush != NULL) {
+				dev->drv_ops->xmit_flush(dev);
 			}
 
 			dlist_del_init(&dev->tx_lnk);
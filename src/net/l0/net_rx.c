@@ -22,8 +22,11 @@
 #include <net/skbuff.h>
 #include <net/socket/packet.h>
 
-int net_rx(struct sk_buff *skb) {
-	const struct net_pack *npack;
+/**
+ * Check L2 header and pass skb to packet sockets
+ * @return skb which should be handled by L3 layer or NULL if it was consumed
+ */
+static struct sk_buff *net_rx_l2(struct sk_buff *skb, unsigned short *out_type) {
 	unsigned short type; /* packet type */
 
 	/* check L2 header size */
@@ -32,7 +35,7 @@ int net_rx(struct sk_buff *skb) {
 	if (skb->len < skb->dev->hdr_len) {
 		log_error("%p invalid length %zu", skb, skb->len);
 		skb_free(skb);
-		return 0; /* error: invalid size */
+		return NULL; /* error: invalid size */
 	}
 
 	type = ntohs(eth_hdr(skb)->h_proto);
@@ -42,7 +45,7 @@ int net_rx(struct sk_buff *skb) {
 	default:
 		log_debug("%p not for us", skb);
 		skb_free(skb);
-		return 0; /* ok, but: not for us */
+		return NULL; /* ok, but: not for us */
 	case PACKET_HOST:
 	case PACKET_LOOPBACK:
 	case PACKET_BROADCAST:
@@ -59,11 +62,25 @@ int net_rx(struct sk_buff *skb) {
 	/* decrypt packet */
 	skb = net_decrypt(skb);
 	if (skb == NULL) {
-		return 0; /* error: something wrong :( */
+		return NULL; /* error: something wrong :( */
 	}
 
 	sock_packet_add(skb, type);
 
+	*out_type = type;
+
+	return skb;
+}
+
+int net_rx(struct sk_buff *skb) {
+	const struct net_pack *npack;
+	unsigned short type; /* packet type */
+
+	skb = net_rx_l2(skb, &type);
+	if (skb == NULL) {
+		return 0;
+	}
+
 	/* lookup handler for L3 layer
 	 * We check if L3 handler exists only after sock_packet_add(), because of
 	 * we must pass skb to all packet sockets even though L3 header is not valid
@@ -78,3 +95,52 @@ int net_rx(struct sk_buff *skb) {
 	/* handling on L3 layer */
 	return npack->rcv_pack(skb, skb->dev);
 }
+
+static void net_rx_list_pack(struct sk_buff_head *list, unsigned short type) {
+	const struct net_pack *npack;
+	struct sk_buff *skb;
+
+	npack = net_pack_lookup(type);
+	if (npack == NULL) {
+		log_debug("unknown type %#.6hx", type);
+		skb_queue_purge(list);
+		return; /* ok, but: not supported */
+	}
+
+	if (npack->rcv_pack_list != NULL) {
+		npack->rcv_pack_list(list);
+		return;
+	}
+
+	while (NULL != (skb = skb_queue_pop(list))) {
+		npack->rcv_pack(skb, skb->dev);
+	}
+}
+
+void net_rx_list(struct sk_buff_head *list) {
+	struct sk_buff_head run;
+	struct sk_buff *skb;
+	unsigned short type, run_type;
+
+	skb_queue_init(&run);
+	run_type = 0;
+
+	/* Packets of the same type which follow one another are passed to L3
+	 * layer together */
+	while (NULL != (skb = skb_queue_pop(list))) {
+		skb = net_rx_l2(skb, &type);
+		if (skb == NULL) {
+			continue;
+		}
+
+		if ((skb_queue_front(&run) != NULL) && (type != run_type)) {
+			net_rx_list_pack(&run, run_type);
+		}
+		run_type = type;
+		skb_queue_push(&run, skb);
+	}
+
+	if (skb_queue_front(&run) != NULL) {
+		net_rx_list_pack(&run, run_type);
+	}
+}
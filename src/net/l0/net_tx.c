@@ -48,6 +48,11 @@ int net_tx_direct(struct sk_buff *skb) {
 	 */
 	sock_packet_add(skb, htons(ETH_P_ALL));
 
+	if (!(dev->features & NETIF_F_HW_CSUM)) {
+		/* e.g. forwarded packet received with partial checksum */
+		skb_checksum_complete(skb);
+	}
+
 	skb = net_encrypt(skb);
 	if (skb == NULL) {
 		return 0;
@@ -30,11 +30,15 @@
 #include <embox/net/proto.h>
 #include <embox/net/pack.h>
 
-EMBOX_NET_PACK(ETH_P_IP, ip_rcv);
+EMBOX_NET_PACK_LIST(ETH_P_IP, ip_rcv, ip_rcv_list);
 
-static int ip_rcv(struct sk_buff *skb, struct net_device *dev) {
+/**
+ * Validate IP header, forward packet or assemble it from fragments
+ * @return skb which should be passed to L4 layer or NULL if it was consumed
+ */
+static struct sk_buff *ip_rcv_local(struct sk_buff *skb,
+		struct net_device *dev) {
 	net_device_stats_t *stats = &dev->stats;
-	const struct net_proto *nproto;
 	iphdr_t *iph = ip_hdr(skb);
 	__u16 old_check;
 	size_t ip_len;
@@ -55,7 +59,7 @@ static int ip_rcv(struct sk_buff *skb, struct net_device *dev) {
 		log_debug("ip_rcv: invalid IPv4 header length");
 		stats->rx_length_errors++;
 		skb_free(skb);
-		return 0; /* error: invalid header length */
+		return NULL; /* error: invalid header length */
 	}
 
 
@@ -63,7 +67,7 @@ static int ip_rcv(struct sk_buff *skb, struct net_device *dev) {
 		log_debug("ip_rcv: invalid IPv4 version");
 		stats->rx_err++;
 		skb_free(skb);
-		return 0; /* error: not ipv4 */
+		return NULL; /* error: not ipv4 */
 	}
 
 	old_check = iph->check;
@@ -73,7 +77,7 @@ static int ip_rcv(struct sk_buff *skb, struct net_device *dev) {
 				ntohs(old_check), ntohs(iph->check));
 		stats->rx_crc_errors++;
 		skb_free(skb);
-		return 0; /* error: invalid crc */
+		return NULL; /* error: invalid crc */
 	}
 
 	ip_len = ntohs(iph->tot_len);
@@ -82,7 +86,7 @@ static int ip_rcv(struct sk_buff *skb, struct net_device *dev) {
 		log_debug("ip_rcv: invalid IPv4 length");
 		stats->rx_length_errors++;
 		skb_free(skb);
-		return 0; /* error: invalid length */
+		return NULL; /* error: invalid length */
 	}
 
 	/* Setup transport layer (L4) header */
@@ -93,7 +97,7 @@ static int ip_rcv(struct sk_buff *skb, struct net_device *dev) {
 		log_debug("ip_rcv: dropped by input netfilter");
 		stats->rx_dropped++;
 		skb_free(skb);
-		return 0; /* error: dropped */
+		return NULL; /* error: dropped */
 	}
 
 	/* Forwarding */
@@ -101,7 +105,7 @@ static int ip_rcv(struct sk_buff *skb, struct net_device *dev) {
 	if (!inetdev_get_by_dev(skb->dev)) {
 		log_debug("ip_rcv: dropped by input  because inet_dev is not set");
 		skb_free(skb);
-		return 0; /* didn't set inet dev yet */
+		return NULL; /* didn't set inet dev yet */
 	}
 
 	if (inetdev_get_by_dev(skb->dev)->ifa_address != 0) {
@@ -119,9 +123,10 @@ static int ip_rcv(struct sk_buff *skb, struct net_device *dev) {
 				log_debug("ip_rcv: dropped by forward netfilter");
 				stats->rx_dropped++;
 				skb_free(skb);
-				return 0; /* error: dropped */
+				return NULL; /* error: dropped */
 			}
-			return ip_forward(skb);
+			ip_forward(skb);
+			return NULL;
 		}
 	}
 
@@ -141,13 +146,13 @@ static int ip_rcv(struct sk_buff *skb, struct net_device *dev) {
 			log_debug("ip_rcv: invalid options");
 			stats->rx_err++;
 			skb_free(skb);
-			return 0; /* error: bad ops */
+			return NULL; /* error: bad ops */
 		}
 		if (ip_options_handle_srr(skb)) {
 			log_debug("ip_rcv: can't handle options");
 			stats->tx_err++;
 			skb_free(skb);
-			return 0; /* error: can't handle ops */
+			return NULL; /* error: can't handle ops */
 		}
 	}
 
@@ -159,7 +164,7 @@ static int ip_rcv(struct sk_buff *skb, struct net_device *dev) {
 	 */
 	if (ntohs(skb->nh.iph->frag_off) & (IP_MF | IP_OFFSET)) {
 		if ((complete_skb = ip_defrag(skb)) == NULL) {
-			return 0;
+			return NULL;
 		} else {
 			skb = complete_skb;
 			iph = ip_hdr(complete_skb);
@@ -170,6 +175,19 @@ static int ip_rcv(struct sk_buff *skb, struct net_device *dev) {
 	 * which have been bound to its protocol or to socket with concrete protocol */
 	raw_rcv(skb);
 
+	return skb;
+}
+
+static int ip_rcv(struct sk_buff *skb, struct net_device *dev) {
+	const struct net_proto *nproto;
+	iphdr_t *iph;
+
+	skb = ip_rcv_local(skb, dev);
+	if (skb == NULL) {
+		return 0;
+	}
+	iph = ip_hdr(skb);
+
 	nproto = net_proto_lookup(ETH_P_IP, iph->proto);
 	if (nproto != NULL) {
 		return nproto->handle(skb);
@@ -179,3 +197,53 @@ static int ip_rcv(struct sk_buff *skb, struct net_device *dev) {
 	skb_free(skb);
 	return 0; /* error: nobody wants this packet */
 }
+
+static void ip_rcv_list_proto(struct sk_buff_head *list, unsigned char proto) {
+	const struct net_proto *nproto;
+	struct sk_buff *skb;
+
+	nproto = net_proto_lookup(ETH_P_IP, proto);
+	if (nproto == NULL) {
+		log_debug("ip_rcv: unknown protocol %d", proto);
+		skb_queue_purge(list);
+		return; /* error: nobody wants these packets */
+	}
+
+	if (nproto->handle_list != NULL) {
+		nproto->handle_list(list);
+		return;
+	}
+
+	while (NULL != (skb = skb_queue_pop(list))) {
+		nproto->handle(skb);
+	}
+}
+
+static void ip_rcv_list(struct sk_buff_head *list) {
+	struct sk_buff_head run;
+	struct sk_buff *skb;
+	unsigned char run_proto;
+
+	skb_queue_init(&run);
+	run_proto = 0;
+
+	/* Packets of the same protocol which follow one another are passed
+	 * to L4 layer together */
+	while (NULL != (skb = skb_queue_pop(list))) {
+		skb = ip_rcv_local(skb, skb->dev);
+		if (skb == NULL) {
+			continue;
+		}
+
+		if ((skb_queue_front(&run) != NULL)
+				&& (ip_hdr(skb)->proto != run_proto)) {
+			ip_rcv_list_proto(&run, run_proto);
+		}
+		run_proto = ip_hdr(skb)->proto;
+		skb_queue_push(&run, skb);
+	}
+
+	if (skb_queue_front(&run) != NULL) {
+		ip_rcv_list_proto(&run, run_proto);
+	}
+}
@@ -90,6 +90,8 @@ static int fragment_skb_and_send(struct sk_buff *skb, struct net_device *dev) {
 	struct sk_buff *s_tmp;
 
 	skb->dev = dev;
+	/* Fragments can't be checksummed by device */
+	skb_checksum_complete(skb);
 	ret = ip_frag(skb, dev->mtu, &tx_buf);
 	if (ret != 0) {
 		skb_free(skb);
@@ -312,7 +314,8 @@ static int ip_snd(struct sk_buff *skb) {
 	ip_set_id_field(skb->nh.iph, global_id++);
 	ip_set_check_field(skb->nh.iph);
 
-	if (skb->len > skb->dev->mtu) {
+	/* Segments marked by gso_size are split by device */
+	if ((skb->len > skb->dev->mtu) && (skb->gso_size == 0)) {
 		if (!(skb->nh.iph->frag_off & htons(IP_DF))) {
 			return fragment_skb_and_send(skb, skb->dev);
 		}
@@ -10,6 +10,7 @@
  */
 #include <util/log.h>
 
+#include <stddef.h>
 #include <stdint.h>
 #include <time.h>
 #include <errno.h>
@@ -22,6 +23,7 @@
 #include <net/l4/tcp.h>
 #include <net/skbuff.h>
 #include <net/sock.h>
+#include <net/netdevice.h>
 
 #include <net/sock_wait.h>
 #include <net/socket/inet_sock.h>
@@ -35,8 +37,15 @@
 #include <net/lib/tcp.h>
 
 #include <kernel/time/timer.h>
+#include <kernel/time/time.h>
 #include <kernel/sched/sched_lock.h>
+#include <kernel/spinlock.h>
+#include <kernel/lthread/lthread.h>
 #include <kernel/time/ktime.h>
+#include <hal/clock.h>
+
+#include <util/dlist.h>
+#include <util/math.h>
 
 #include <fs/idesc.h>
 #include <fs/idesc_event.h>
@@ -47,12 +56,13 @@
 
 
 EMBOX_UNIT_INIT(tcp_init);
-EMBOX_NET_PROTO(ETH_P_IP, IPPROTO_TCP, tcp_rcv,
-		net_proto_handle_error_none);
+EMBOX_NET_PROTO_LIST(ETH_P_IP, IPPROTO_TCP, tcp_rcv,
+		net_proto_handle_error_none, tcp_rcv_list);
 EMBOX_NET_PROTO(ETH_P_IPV6, IPPROTO_TCP, tcp_rcv,
 		net_proto_handle_error_none);
 
 #define MODOPS_VERIFY_CHKSUM OPTION_GET(BOOLEAN, verify_chksum)
+#define MODOPS_GRO           OPTION_GET(BOOLEAN, gro)
 
 #if OPTION_GET(NUMBER, log_level) >= LOG_DEBUG
 #define TCP_DEBUG 1
@@ -93,12 +103,21 @@ typedef enum tcp_ret_code (*tcp_handler_t)(struct tcp_sock *tcp_sk,
 		const struct tcphdr *tcph, struct sk_buff *skb,
 		struct tcphdr *out_tcph);
 
-static struct sys_timer tcp_tmr_default; /* Timer structure for rexmitting or TIME-WAIT satate */
+static DLIST_DEFINE(tcp_timewait_queue); /* TIME-WAIT sockets ordered by expiry */
+static struct sys_timer tcp_timewait_tmr; /* Timer for reaping of TIME-WAIT sockets */
+static DLIST_DEFINE(tcp_rexmit_queue); /* Sockets with expired rexmit timer */
+static int tcp_timewait_expired;
+/* Protects the queues above, no other lock is taken under it */
+static spinlock_t tcp_timers_spin = SPIN_STATIC_UNLOCKED;
+static struct lthread tcp_timers_lt;
+/* Changed on every release, so sockets found before aren't trusted */
+static volatile unsigned int tcp_release_gen;
 
 /* Prototypes */
 static int tcp_handle(struct tcp_sock *tcp_sk, struct sk_buff *skb, tcp_handler_t hnd);
 static const tcp_handler_t tcp_st_handler[];
 static void tcp_get_now(struct timeval *out_now);
+static void tcp_timewait_start(struct tcp_sock *tcp_sk);
 
 /************************ Debug functions ******************************/
 #if !TCP_DEBUG
@@ -168,17 +187,40 @@ int alloc_prep_skb(struct tcp_sock *tcp_sk, size_t opt_len,
 	return 0;
 }
 
+/* Socket of an incoming connection is locked after its listening socket,
+ * so handling of a segment which touches both of them can't deadlock.
+ * The lock is recursive for the CPU which holds it. Timers must not be
+ * handled under the lock of timers, see tcp_timers_action(). */
 void tcp_sock_lock(struct tcp_sock *tcp_sk, unsigned int obj) {
-	if (tcp_sk->lock++ == 0) {
-		sched_lock();
+	struct tcp_sock *parent;
+
+	sched_lock();
+	if (tcp_sk->lock_spin.owner == cpu_get_id()) {
+		tcp_sk->lock++;
+		return;
+	}
+
+	parent = tcp_sk->parent;
+	if (parent != NULL) {
+		tcp_sock_lock(parent, obj);
 	}
+	spin_lock(&tcp_sk->lock_spin);
+	tcp_sk->lock_parent = parent;
+	tcp_sk->lock = 1;
 }
 
 void tcp_sock_unlock(struct tcp_sock *tcp_sk, unsigned int obj) {
+	struct tcp_sock *parent;
+
 	assert(tcp_sk->lock != 0);
 	if (--tcp_sk->lock == 0) {
-		sched_unlock();
+		parent = tcp_sk->lock_parent;
+		spin_unlock(&tcp_sk->lock_spin);
+		if (parent != NULL) {
+			tcp_sock_unlock(parent, obj);
+		}
 	}
+	sched_unlock();
 }
 
 void tcp_seq_state_set_wind_value(struct tcp_seq_state *tcp_seq_st,
@@ -247,6 +289,10 @@ void tcp_sock_set_state(struct tcp_sock *tcp_sk,
 	tcp_sk->state = new_state;
 	log_debug("sk %p set state %d-%s", sk, new_state, str_state[new_state]);
 
+	if (new_state == TCP_TIMEWAIT) {
+		tcp_timewait_start(tcp_sk);
+	}
+
 	/* idesc manipulation */
 	switch (new_state) {
 	default:
@@ -310,17 +356,6 @@ static void tcp_get_now(struct timeval *out_now) {
 	ktime_get_timeval(out_now);
 }
 
-static int tcp_is_expired(struct timeval *since, useconds_t limit_msec) {
-	struct timeval now, delta, limit;
-
-	ktime_get_timeval(&now);
-	timersub(&now, since, &delta);
-	limit.tv_sec = limit_msec / MSEC_PER_SEC;
-	limit.tv_usec = (limit_msec % MSEC_PER_SEC) * USEC_PER_MSEC;
-
-	return timercmp(&delta, &limit, >=);
-}
-
 static void tcp_xmit(struct sk_buff *skb,
 		const struct tcp_sock *tcp_sk,
 		const struct net_pack_out_ops *out_ops) {
@@ -348,6 +383,8 @@ static void tcp_rexmit(struct tcp_sock *tcp_sk) {
 
 	tcp_sock_lock(tcp_sk, TCP_SYNC_WRITE_QUEUE);
 	{
+		/* Karn's algorithm: retransmitted segments aren't timed */
+		tcp_sk->rtt_timing = 0;
 		skb = skb_queue_front(&to_sock(tcp_sk)->tx_queue);
 		if (skb == NULL) {
 			/**
@@ -372,6 +409,245 @@ static void tcp_rexmit(struct tcp_sock *tcp_sk) {
 	tcp_xmit(skb_send, tcp_sk, NULL);
 }
 
+/************************ Timers ***************************************/
+static unsigned int tcp_sync_left(struct tcp_sock *tcp_sk) {
+	struct timeval now, delta;
+	unsigned int elapsed;
+
+	ktime_get_timeval(&now);
+	timersub(&now, &tcp_sk->syn_time, &delta);
+	elapsed = delta.tv_sec * MSEC_PER_SEC + delta.tv_usec / USEC_PER_MSEC;
+
+	return elapsed < TCP_SYNC_TIMEOUT ? TCP_SYNC_TIMEOUT - elapsed : 0;
+}
+
+static void tcp_rexmit_timer_start(struct tcp_sock *tcp_sk) {
+	unsigned int msec;
+
+	/* Exponential backoff, RFC 6298 (5.5) */
+	msec = tcp_sk->backoff < 16 ? tcp_sk->rto << tcp_sk->backoff
+			: TCP_RTO_MAX;
+	msec = min(msec, (unsigned int)TCP_RTO_MAX);
+
+	/* Don't oversleep synchronization timeout of an incoming connection */
+	if ((tcp_sock_get_status(tcp_sk) == TCP_ST_NONSYNC)
+			&& (tcp_sk->parent != NULL)) {
+		msec = min(msec, tcp_sync_left(tcp_sk));
+	}
+
+	timer_start(&tcp_sk->rexmit_tmr, ms2jiffies(msec));
+}
+
+/**
+ * Update RTT estimation with a new sample as described in RFC 6298 (2.2, 2.3).
+ * @a srtt is kept scaled by 8 and @a rttvar by 4, so
+ * RTO = SRTT + 4 * RTTVAR is just a sum of scaled values.
+ */
+static void tcp_rtt_sample(struct tcp_sock *tcp_sk, unsigned int rtt) {
+	int delta;
+
+	rtt = max(rtt, 1U);
+
+	if (tcp_sk->srtt == 0) {
+		tcp_sk->srtt = rtt << 3;
+		tcp_sk->rttvar = rtt << 1;
+	}
+	else {
+		delta = rtt - (tcp_sk->srtt >> 3);
+		tcp_sk->srtt += delta;
+		if (delta < 0) {
+			delta = -delta;
+		}
+		tcp_sk->rttvar += delta - (tcp_sk->rttvar >> 2);
+	}
+
+	tcp_sk->rto = (tcp_sk->srtt >> 3) + tcp_sk->rttvar;
+	tcp_sk->rto = max(tcp_sk->rto, (unsigned int)TCP_RTO_MIN);
+	tcp_sk->rto = min(tcp_sk->rto, (unsigned int)TCP_RTO_MAX);
+
+	log_debug("sk %p rtt %u srtt %u rttvar %u rto %u", to_sock(tcp_sk), rtt,
+			tcp_sk->srtt >> 3, tcp_sk->rttvar >> 2, tcp_sk->rto);
+}
+
+/* Called from tcp_timers_action(), not from the timer handler */
+static void tcp_rexmit_expired(struct tcp_sock *tcp_sk) {
+	if ((tcp_sock_get_status(tcp_sk) == TCP_ST_NONSYNC)
+			&& !list_empty(&tcp_sk->conn_lnk)
+			&& (tcp_sync_left(tcp_sk) == 0)) {
+
+		assert(tcp_sk->parent != NULL);
+		log_debug("release nonsync sk %p", to_sock(tcp_sk));
+		tcp_sock_release(tcp_sk);
+		return;
+	}
+
+	if ((tcp_sock_get_status(tcp_sk) == TCP_ST_NOTEXIST)
+			|| (tcp_sk->last_ack == tcp_sk->self.seq)) {
+		return; /* nothing to retransmit */
+	}
+
+	log_debug("rexmit sk %p backoff %u", to_sock(tcp_sk), tcp_sk->backoff);
+	++tcp_sk->backoff;
+	tcp_sk->rexmit_mode = 1;
+	tcp_rexmit(tcp_sk);
+	tcp_rexmit_timer_start(tcp_sk);
+}
+
+/* Timer handlers run under the lock of timers, while sockets are locked
+ * before starting their timers. So handlers only queue the work. */
+static void tcp_rexmit_timer_handler(struct sys_timer *timer, void *param) {
+	struct tcp_sock *tcp_sk;
+	ipl_t ipl;
+
+	tcp_sk = param;
+	assert(tcp_sk != NULL);
+
+	ipl = spin_lock_ipl(&tcp_timers_spin);
+	{
+		if (dlist_empty(&tcp_sk->rexmit_lnk)) {
+			dlist_add_prev_entry(tcp_sk, &tcp_rexmit_queue, rexmit_lnk);
+		}
+	}
+	spin_unlock_ipl(&tcp_timers_spin, ipl);
+
+	lthread_launch(&tcp_timers_lt);
+}
+
+/**
+ * Put socket to the tail of TIME-WAIT queue. The delay is the same for all
+ * sockets, so the queue is always ordered by expiry and only its head has to
+ * be looked at by the reaper.
+ */
+static void tcp_timewait_start(struct tcp_sock *tcp_sk) {
+	ipl_t ipl;
+
+	timer_stop(&tcp_sk->rexmit_tmr);
+
+	ipl = spin_lock_ipl(&tcp_timers_spin);
+	{
+		tcp_sk->tw_expire = clock_sys_ticks() + ms2jiffies(TCP_TIMEWAIT_DELAY);
+		dlist_del_init_entry(tcp_sk, tw_lnk);
+		dlist_add_prev_entry(tcp_sk, &tcp_timewait_queue, tw_lnk);
+	}
+	spin_unlock_ipl(&tcp_timers_spin, ipl);
+
+	if (!timer_is_started(&tcp_timewait_tmr)) {
+		timer_start(&tcp_timewait_tmr, ms2jiffies(TCP_TIMEWAIT_DELAY));
+	}
+}
+
+static void tcp_timewait_reap(void) {
+	struct tcp_sock *tcp_sk;
+	clock_t now, left;
+	ipl_t ipl;
+
+	now = clock_sys_ticks();
+	left = 0;
+
+	do {
+		tcp_sk = NULL;
+
+		ipl = spin_lock_ipl(&tcp_timers_spin);
+		{
+			if (!dlist_empty(&tcp_timewait_queue)) {
+				tcp_sk = dlist_next_entry(&tcp_timewait_queue,
+						struct tcp_sock, tw_lnk);
+				if ((int)(tcp_sk->tw_expire - now) > 0) {
+					left = tcp_sk->tw_expire - now;
+					tcp_sk = NULL;
+				} else {
+					dlist_del_init_entry(tcp_sk, tw_lnk);
+				}
+			}
+		}
+		spin_unlock_ipl(&tcp_timers_spin, ipl);
+
+		if (tcp_sk != NULL) {
+			log_debug("release timewait sk %p", to_sock(tcp_sk));
+			tcp_sock_release(tcp_sk);
+		}
+	} while (tcp_sk != NULL);
+
+	if (left != 0) {
+		timer_start(&tcp_timewait_tmr, left);
+	}
+}
+
+static void tcp_timewait_handler(struct sys_timer *timer, void *param) {
+	ipl_t ipl;
+
+	ipl = spin_lock_ipl(&tcp_timers_spin);
+	{
+		tcp_timewait_expired = 1;
+	}
+	spin_unlock_ipl(&tcp_timers_spin, ipl);
+
+	lthread_launch(&tcp_timers_lt);
+}
+
+/* Handles expired timers outside of the lock of timers, so it is free to
+ * lock sockets and start timers */
+static int tcp_timers_action(struct lthread *self) {
+	struct tcp_sock *tcp_sk;
+	int timewait;
+	ipl_t ipl;
+
+	do {
+		tcp_sk = NULL;
+
+		ipl = spin_lock_ipl(&tcp_timers_spin);
+		{
+			if (!dlist_empty(&tcp_rexmit_queue)) {
+				tcp_sk = dlist_next_entry(&tcp_rexmit_queue,
+						struct tcp_sock, rexmit_lnk);
+				dlist_del_init_entry(tcp_sk, rexmit_lnk);
+			}
+		}
+		spin_unlock_ipl(&tcp_timers_spin, ipl);
+
+		if (tcp_sk != NULL) {
+			tcp_rexmit_expired(tcp_sk);
+		}
+	} while (tcp_sk != NULL);
+
+	ipl = spin_lock_ipl(&tcp_timers_spin);
+	{
+		timewait = tcp_timewait_expired;
+		tcp_timewait_expired = 0;
+	}
+	spin_unlock_ipl(&tcp_timers_spin, ipl);
+
+	if (timewait) {
+		tcp_timewait_reap();
+	}
+
+	return 0;
+}
+
+void tcp_sock_timers_init(struct tcp_sock *tcp_sk) {
+	timer_init(&tcp_sk->rexmit_tmr, TIMER_ONESHOT, tcp_rexmit_timer_handler,
+			tcp_sk);
+	tcp_sk->srtt = tcp_sk->rttvar = 0;
+	tcp_sk->rto = TCP_RTO_INITIAL;
+	tcp_sk->backoff = 0;
+	tcp_sk->rtt_timing = 0;
+	dlist_head_init(&tcp_sk->tw_lnk);
+	dlist_head_init(&tcp_sk->rexmit_lnk);
+}
+
+static void tcp_sock_timers_stop(struct tcp_sock *tcp_sk) {
+	ipl_t ipl;
+
+	timer_stop(&tcp_sk->rexmit_tmr);
+
+	ipl = spin_lock_ipl(&tcp_timers_spin);
+	{
+		dlist_del_init_entry(tcp_sk, tw_lnk);
+		dlist_del_init_entry(tcp_sk, rexmit_lnk);
+	}
+	spin_unlock_ipl(&tcp_timers_spin, ipl);
+}
+
 static void send_rst_reply(struct sk_buff *skb) {
 	struct tcphdr old_tcph, *tcph;
 	size_t tcph_size, old_seq_len;
@@ -414,6 +690,51 @@ static void send_rst_reply(struct sk_buff *skb) {
 	tcp_xmit(skb, NULL, out_ops);
 }
 
+/**
+ * Set checksum of outgoing segment or leave it to the device. Segment
+ * which is longer than MTU is split by the device if it can, otherwise
+ * it's fragmented by IP and needs complete checksum. Segments split by
+ * the device are not larger than MSS of remote.
+ */
+static void tcp_set_check(struct tcp_sock *tcp_sk, struct sk_buff *skb) {
+	struct net_device *dev;
+	size_t hdr_len, seg_len, data_len, opt_len;
+
+	dev = skb->dev;
+	skb->ip_summed = CHECKSUM_NONE;
+	skb->gso_size = 0;
+
+	if ((dev == NULL) || !(dev->features & NETIF_F_HW_CSUM)
+			|| !ip_check_version(ip_hdr(skb))) {
+		tcp_set_check_field(skb->h.th, skb->nh.raw);
+		return;
+	}
+
+	if ((skb->len > dev->mtu) && !(dev->features & NETIF_F_TSO)) {
+		tcp_set_check_field(skb->h.th, skb->nh.raw);
+		return;
+	}
+
+	if (dev->features & NETIF_F_TSO) {
+		hdr_len = skb->h.raw - skb->nh.raw + TCP_HEADER_SIZE(skb->h.th);
+		seg_len = dev->mtu - hdr_len;
+		opt_len = TCP_HEADER_SIZE(skb->h.th) - TCP_MIN_HEADER_SIZE;
+		if (tcp_sk->mss > opt_len) {
+			/* MSS doesn't count TCP options */
+			seg_len = min(seg_len, tcp_sk->mss - opt_len);
+		}
+		data_len = skb->len - (skb->h.raw - skb->mac.raw)
+				- TCP_HEADER_SIZE(skb->h.th);
+		if (data_len > seg_len) {
+			skb->gso_size = seg_len;
+		}
+	}
+
+	tcp4_set_check_partial(skb->h.th, ip_hdr(skb));
+	skb->ip_summed = CHECKSUM_PARTIAL;
+	skb->csum_offset = offsetof(struct tcphdr, check);
+}
+
 /**
  * Send any packet without sequence (i.e. seq_len is 0)
  */
@@ -421,7 +742,7 @@ static void send_nonseq_from_sock(struct tcp_sock *tcp_sk,
 		struct sk_buff *skb) {
 	log_debug("send %p", skb);
 	tcp_set_seq_field(skb->h.th, tcp_sk->self.seq);
-	tcp_set_check_field(skb->h.th, skb->nh.raw);
+	tcp_set_check(tcp_sk, skb);
 	tcp_xmit(skb, tcp_sk, NULL);
 }
 
@@ -441,14 +762,25 @@ void send_seq_from_sock(struct tcp_sock *tcp_sk, struct sk_buff *skb) {
 	tcp_sock_lock(tcp_sk, TCP_SYNC_WRITE_QUEUE);
 	{
 		tcp_set_seq_field(skb->h.th, tcp_sk->self.seq);
-		tcp_set_check_field(skb->h.th, skb->nh.raw);
+		tcp_set_check(tcp_sk, skb);
 		if (skb_send != NULL) {
 			/* set to cloned pkg */
 			memcpy(skb_send->h.th, skb->h.th, sizeof *skb->h.th);
+			skb_send->ip_summed = skb->ip_summed;
+			skb_send->csum_offset = skb->csum_offset;
+			skb_send->gso_size = skb->gso_size;
 		}
 		assert(to_sock(tcp_sk) != NULL);
 		skb_queue_push(&to_sock(tcp_sk)->tx_queue, skb);
 		tcp_sk->self.seq += tcp_seq_length(skb->h.th, skb->nh.raw);
+		if (!tcp_sk->rtt_timing && !tcp_sk->rexmit_mode) {
+			tcp_sk->rtt_timing = 1;
+			tcp_sk->rtt_seq = tcp_sk->self.seq;
+			tcp_sk->rtt_start = clock_sys_ticks();
+		}
+		if (!timer_is_started(&tcp_sk->rexmit_tmr)) {
+			tcp_rexmit_timer_start(tcp_sk);
+		}
 	}
 	tcp_sock_unlock(tcp_sk, TCP_SYNC_WRITE_QUEUE);
 
@@ -460,17 +792,22 @@ void send_seq_from_sock(struct tcp_sock *tcp_sk, struct sk_buff *skb) {
 void tcp_sock_release(struct tcp_sock *tcp_sk) {
 	struct tcp_sock *anticipant;
 
+	tcp_release_gen++;
+
 	if (tcp_sk->parent == NULL) {
 		tcp_sock_lock(tcp_sk, TCP_SYNC_CONN_QUEUE);
 		{
 			list_for_each_entry(anticipant,
 					&tcp_sk->conn_wait, conn_lnk) {
+				tcp_sock_timers_stop(anticipant);
 				sock_release(to_sock(anticipant));
 			}
 			list_for_each_entry(anticipant, &tcp_sk->conn_ready, conn_lnk) {
+				tcp_sock_timers_stop(anticipant);
 				sock_release(to_sock(anticipant));
 			}
 			list_for_each_entry(anticipant, &tcp_sk->conn_free, conn_lnk) {
+				tcp_sock_timers_stop(anticipant);
 				sock_release(to_sock(anticipant));
 			}
 		}
@@ -488,6 +825,7 @@ void tcp_sock_release(struct tcp_sock *tcp_sk) {
 		tcp_sock_unlock(tcp_sk->parent, TCP_SYNC_CONN_QUEUE);
 	}
 
+	tcp_sock_timers_stop(tcp_sk);
 	sock_release(to_sock(tcp_sk));
 }
 
@@ -567,6 +905,7 @@ static enum tcp_ret_code tcp_st_listen(struct tcp_sock *tcp_sk,
 					&ip6_hdr(skb)->saddr,
 					sizeof newsk.in6->dst_in6.sin6_addr);
 		}
+		sock_rehash(to_sock(tcp_newsk));
 		/* Save new socket to accept queue */
 		tcp_sock_lock(tcp_sk, TCP_SYNC_CONN_QUEUE);
 		{
@@ -880,7 +1219,19 @@ static enum tcp_ret_code process_ack(struct tcp_sock *tcp_sk,
 	else if (ack2last_ack <= seq - tcp_sk->last_ack) {
 		confirm_ack(tcp_sk, ack);
 		tcp_sk->last_ack = ack;
-		tcp_get_now(&tcp_sk->ack_time);
+		if (tcp_sk->rtt_timing && ((int32_t)(ack - tcp_sk->rtt_seq) >= 0)) {
+			tcp_sk->rtt_timing = 0;
+			tcp_rtt_sample(tcp_sk,
+					jiffies2ms(clock_sys_ticks() - tcp_sk->rtt_start));
+		}
+		/* New data is acknowledged, so restart timer without backoff */
+		tcp_sk->backoff = 0;
+		if (seq == ack) {
+			timer_stop(&tcp_sk->rexmit_tmr);
+		}
+		else {
+			tcp_rexmit_timer_start(tcp_sk);
+		}
 		if (!tcp_sk->rexmit_mode) {
 			tcp_sk->dup_ack = 0;
 			sock_notify(to_sock(tcp_sk), POLLOUT);
@@ -963,6 +1314,7 @@ static enum tcp_ret_code process_opt(struct tcp_sock *tcp_sk,
 	char *ptr = (char *)&tcph->options[0];
 	char *end = ptr + TCP_HEADER_SIZE(tcph) - TCP_MIN_HEADER_SIZE;
 	char *prev_ptr;
+	uint16_t mss;
 
 	do {
 		prev_ptr = ptr;
@@ -980,6 +1332,13 @@ static enum tcp_ret_code process_opt(struct tcp_sock *tcp_sk,
 			}
 			ptr += *(ptr + 1);
 			break;
+		case TCP_OPT_KIND_MSS:
+			if (tcph->syn && (*(ptr + 1) == 4)) {
+				memcpy(&mss, ptr + 2, sizeof mss);
+				tcp_sk->mss = ntohs(mss);
+			}
+			ptr += *(ptr + 1);
+			break;
 		}
 		// TODO this is hack to fix cycling when ptr does not change
 		if (prev_ptr == ptr) {
@@ -999,8 +1358,8 @@ static enum tcp_ret_code pre_process(struct tcp_sock *tcp_sk,
 	int ret;
 	uint32_t seq2rem_seq, seq_len, seq_last2rem_seq, rem_len;
 
-	/* Check CRC */
-	if (MODOPS_VERIFY_CHKSUM) {
+	/* Check CRC, unless device did it */
+	if (MODOPS_VERIFY_CHKSUM && (skb->ip_summed == CHECKSUM_NONE)) {
 		uint16_t old_check;
 		old_check = tcph->check;
 		/* XXX remove const qualifier */
@@ -1085,6 +1444,10 @@ static enum tcp_ret_code pre_process(struct tcp_sock *tcp_sk,
 	}
 
 	/* Process options */
+	if (tcph->syn) {
+		/* Connection may be made again, MSS is sent in SYN only */
+		tcp_sk->mss = 0;
+	}
 	if (TCP_HEADER_SIZE(tcph) != TCP_MIN_HEADER_SIZE) {
 		ret = process_opt(tcp_sk, tcph);
 		if (ret != TCP_RET_OK) {
@@ -1186,12 +1549,15 @@ static int tcp_handle(struct tcp_sock *tcp_sk, struct sk_buff *skb,
 /**
  * Main function of TCP protocol
  */
-static void tcp_process(struct tcp_sock *tcp_sk, struct sk_buff *skb) {
+static enum tcp_ret_code tcp_process(struct tcp_sock *tcp_sk,
+		struct sk_buff *skb) {
+	enum tcp_ret_code ret;
 
 	if (tcp_sk != NULL) {
-		enum tcp_ret_code ret;
-
-		tcp_get_now(&tcp_sk->rcv_time);
+		if (tcp_sk->state == TCP_TIMEWAIT) {
+			/* TIME-WAIT is counted from the last received segment */
+			tcp_timewait_start(tcp_sk);
+		}
 
 		ret = tcp_handle(tcp_sk, skb, pre_process);
 		if (ret == TCP_RET_OK) {
@@ -1205,11 +1571,15 @@ static void tcp_process(struct tcp_sock *tcp_sk, struct sk_buff *skb) {
 	else if (tcp_hdr(skb)->rst) {
 		/* ignore RST when socket doesn't exist */
 		skb_free(skb);
+		ret = TCP_RET_DROP;
 	}
 	else {
 		/* generate RST when socket doesn't exist */
 		send_rst_reply(skb);
+		ret = TCP_RET_RST;
 	}
+
+	return ret;
 }
 
 static int tcp4_rcv_tester_strict(const struct sock *sk,
@@ -1273,35 +1643,53 @@ static int tcp_rcv_need_check_security(struct tcp_sock *tcp_sk) {
 	return 0;
 }
 
-static int tcp_rcv(struct sk_buff *skb) {
+/**
+ * Find socket for incoming segment
+ * @param out_connected - set if socket was found by the full address of
+ *  connection, so it will get all following segments of this flow
+ */
+static struct tcp_sock *tcp_rcv_lookup(struct sk_buff *skb,
+		int *out_connected) {
 	struct sock *sk;
-	struct tcp_sock *tcp_sk;
 
 	assert(skb != NULL);
 	assert(ip_check_version(ip_hdr(skb))
 			|| ip6_check_version(ip6_hdr(skb)));
 
-	sk = sock_lookup(NULL, tcp_sock_ops,
-			ip_check_version(ip_hdr(skb))
-				? tcp4_rcv_tester_strict
-				: tcp6_rcv_tester_strict,
-			skb);
-	if (sk == NULL) {
-		sk = sock_lookup(NULL, tcp_sock_ops,
-				ip_check_version(ip_hdr(skb))
-					? tcp4_rcv_tester_soft
-					: tcp6_rcv_tester_soft,
-				skb);
+	*out_connected = 1;
+
+	if (ip_check_version(ip_hdr(skb))) {
+		sk = sock_lookup_connected(tcp_sock_ops, tcp4_rcv_tester_strict, skb,
+				&ip_hdr(skb)->saddr, sizeof ip_hdr(skb)->saddr,
+				tcp_hdr(skb)->dest, tcp_hdr(skb)->source);
+		if (sk == NULL) {
+			*out_connected = 0;
+			sk = sock_lookup_bound(tcp_sock_ops, tcp4_rcv_tester_soft, skb,
+					tcp_hdr(skb)->dest);
+		}
+	}
+	else {
+		sk = sock_lookup_connected(tcp_sock_ops, tcp6_rcv_tester_strict, skb,
+				&ip6_hdr(skb)->saddr, sizeof ip6_hdr(skb)->saddr,
+				tcp_hdr(skb)->dest, tcp_hdr(skb)->source);
+		if (sk == NULL) {
+			*out_connected = 0;
+			sk = sock_lookup_bound(tcp_sock_ops, tcp6_rcv_tester_soft, skb,
+					tcp_hdr(skb)->dest);
+		}
 	}
 
-	tcp_sk = sk != NULL ? to_tcp_sock(sk) : NULL;
+	return sk != NULL ? to_tcp_sock(sk) : NULL;
+}
 
+static enum tcp_ret_code tcp_rcv_sock(struct tcp_sock *tcp_sk,
+		struct sk_buff *skb) {
 	if (tcp_sk) {
 		if (tcp_rcv_need_check_security(tcp_sk)) {
 			/* if we have socket with secure label we have to check secure level */
-			if (sock_get_secure_level(sk) >	skb_get_secure_level(skb)) {
+			if (sock_get_secure_level(to_sock(tcp_sk)) > skb_get_secure_level(skb)) {
 				skb_free(skb);
-				return 0;
+				return TCP_RET_DROP;
 			}
 		}
 	}
@@ -1313,51 +1701,198 @@ static int tcp_rcv(struct sk_buff *skb) {
 				: (void *)&ip6_hdr(skb)->saddr,
 			tcp_hdr(skb)->source);
 
-	tcp_process(tcp_sk, skb);
+	return tcp_process(tcp_sk, skb);
+}
+
+static int tcp_rcv(struct sk_buff *skb) {
+	struct tcp_sock *tcp_sk;
+	int connected;
+
+	tcp_sk = tcp_rcv_lookup(skb, &connected);
+
+	tcp_rcv_sock(tcp_sk, skb);
 
 	return 0;
 }
 
-static void tcp_timer_handler(struct sys_timer *timer, void *param) {
-	struct sock *sk;
-	struct tcp_sock *tcp_sk;
+/* Address of connection which segment belongs to */
+struct tcp_flow {
+	in_addr_t saddr;
+	in_addr_t daddr;
+	__be16 source;
+	__be16 dest;
+};
 
-	(void)timer;
-	(void)param;
+static void tcp_flow_init(struct tcp_flow *flow, const struct sk_buff *skb) {
+	flow->saddr = ip_hdr(skb)->saddr;
+	flow->daddr = ip_hdr(skb)->daddr;
+	flow->source = tcp_hdr(skb)->source;
+	flow->dest = tcp_hdr(skb)->dest;
+}
 
-	sock_foreach(sk, tcp_sock_ops) {
-		tcp_sk = to_tcp_sock(sk);
-		if ((tcp_sk->state == TCP_TIMEWAIT)
-				&& tcp_is_expired(&tcp_sk->rcv_time, TCP_TIMEWAIT_DELAY)) {
+static int tcp_flow_match(const struct tcp_flow *flow,
+		const struct sk_buff *skb) {
+	return (flow->saddr == ip_hdr(skb)->saddr)
+			&& (flow->daddr == ip_hdr(skb)->daddr)
+			&& (flow->source == tcp_hdr(skb)->source)
+			&& (flow->dest == tcp_hdr(skb)->dest);
+}
 
-			log_debug("release timewait sk %p", to_sock(tcp_sk));
-			tcp_sock_release(tcp_sk);
-		}
-		else if ((tcp_sock_get_status(tcp_sk) == TCP_ST_NONSYNC)
-				&& !list_empty(&tcp_sk->conn_lnk)
-				&& tcp_is_expired(&tcp_sk->syn_time, TCP_SYNC_TIMEOUT)) {
+/**
+ * Check that segment could be appended to another one of the same flow:
+ * it has valid header, carries data and has no flags except ACK and PSH
+ * @return length of segment data or 0
+ */
+static size_t tcp_gro_data_len(const struct sk_buff *skb) {
+	const struct tcphdr *tcph;
+	size_t ip_data_len;
 
-			assert(tcp_sk->parent != NULL);
-			log_debug("release nonsync sk %p", to_sock(tcp_sk));
-			tcp_sock_release(tcp_sk);
+	if (IP_HEADER_SIZE(ip_hdr(skb)) != IP_MIN_HEADER_SIZE) {
+		return 0; /* IP options are kept in skb->cb for the first one */
+	}
+
+	tcph = tcp_hdr(skb);
+	ip_data_len = ip_data_length(ip_hdr(skb));
+	if ((TCP_HEADER_SIZE(tcph) < TCP_MIN_HEADER_SIZE)
+			|| (ip_data_len <= TCP_HEADER_SIZE(tcph))) {
+		return 0;
+	}
+
+	if (!tcph->ack || tcph->syn || tcph->fin || tcph->rst || tcph->urg) {
+		return 0;
+	}
+
+	return ip_data_len - TCP_HEADER_SIZE(tcph);
+}
+
+static int tcp_gro_verify(struct sk_buff *skb) {
+	uint16_t old_check, check;
+
+	if (!MODOPS_VERIFY_CHKSUM || (skb->ip_summed != CHECKSUM_NONE)) {
+		return 1;
+	}
+
+	old_check = tcp_hdr(skb)->check;
+	tcp_set_check_field(tcp_hdr(skb), skb->nh.raw);
+	check = tcp_hdr(skb)->check;
+	tcp_hdr(skb)->check = old_check;
+
+	return old_check == check;
+}
+
+/**
+ * Append data of @a next segment to @a skb if it directly follows data of
+ * @a skb, so the connection handles one segment instead of two. Merging is
+ * done only while data fits into the data buffer of @a skb.
+ * @return 1 if @a next was merged and freed, 0 otherwise
+ */
+static int tcp_gro_merge(struct sk_buff *skb, struct sk_buff *next) {
+	struct tcphdr *tcph, *ntcph;
+	struct tcp_flow flow;
+	size_t len, nlen, used;
+	unsigned char *data_end;
+
+	tcp_flow_init(&flow, skb);
+	if ((skb->dev != next->dev) || !tcp_flow_match(&flow, next)) {
+		return 0;
+	}
+
+	len = tcp_gro_data_len(skb);
+	nlen = tcp_gro_data_len(next);
+	if ((len == 0) || (nlen == 0) || tcp_hdr(skb)->psh) {
+		return 0;
+	}
+
+	tcph = tcp_hdr(skb);
+	ntcph = tcp_hdr(next);
+	if ((ntohl(ntcph->seq) != ntohl(tcph->seq) + len)
+			|| (ntcph->ack_seq != tcph->ack_seq)
+			|| (ntcph->window != tcph->window)
+			|| (TCP_HEADER_SIZE(ntcph) != TCP_HEADER_SIZE(tcph))
+			|| memcmp(ntcph + 1, tcph + 1,
+				TCP_HEADER_SIZE(tcph) - TCP_MIN_HEADER_SIZE)) {
+		return 0;
+	}
+
+	/* Data buffer must be owned by this skb and have a room for
+	 * the data of next segment */
+	if (skb_data_cloned(skb->data) || skb_data_cloned(next->data)) {
+		return 0;
+	}
+	data_end = skb->h.raw + TCP_HEADER_SIZE(tcph) + len;
+	used = data_end - (unsigned char *)skb_get_data_pointner(skb->data);
+	if ((skb->len > skb_max_size()) || (used + nlen > skb_max_size())) {
+		return 0;
+	}
+
+	/* Merged segment is not verified again, so corrupted segments must
+	 * not be merged */
+	if (!tcp_gro_verify(skb) || !tcp_gro_verify(next)) {
+		return 0;
+	}
+
+	memcpy(data_end, next->h.raw + TCP_HEADER_SIZE(ntcph), nlen);
+	tcph->psh = ntcph->psh;
+
+	ip_hdr(skb)->tot_len = htons(ntohs(ip_hdr(skb)->tot_len) + nlen);
+	ip_set_check_field(ip_hdr(skb));
+	skb->len = skb->nh.raw - skb->mac.raw + ntohs(ip_hdr(skb)->tot_len);
+	skb->ip_summed = CHECKSUM_UNNECESSARY;
+
+	skb_free(next);
+
+	return 1;
+}
+
+/**
+ * Handle list of segments: consecutive segments of the same connection use
+ * one socket lookup, and with 'gro' option the in-order data segments are
+ * merged before they are passed to the connection.
+ * Remembered socket is looked up again if any socket was released since,
+ * by tcp_process() or by user and timers contexts.
+ */
+static void tcp_rcv_list(struct sk_buff_head *list) {
+	struct tcp_sock *tcp_sk, *flow_sk;
+	struct tcp_flow flow;
+	struct sk_buff *skb, *next;
+	unsigned int flow_gen;
+	int connected;
+
+	flow_sk = NULL;
+
+	while (NULL != (skb = skb_queue_pop(list))) {
+		assert(ip_check_version(ip_hdr(skb)));
+
+		if (MODOPS_GRO) {
+			while ((NULL != (next = skb_queue_front(list)))
+					&& tcp_gro_merge(skb, next)) {
+			}
 		}
-		else if ((tcp_sock_get_status(tcp_sk) != TCP_ST_NOTEXIST)
-				&& tcp_is_expired(&tcp_sk->ack_time, TCP_REXMIT_DELAY)
-				&& (tcp_sk->last_ack != tcp_sk->self.seq)) {
 
-			log_debug("rexmit sk %p", to_sock(tcp_sk));
-			tcp_sk->rexmit_mode = 1;
-			tcp_rexmit(tcp_sk);
+		if ((flow_sk != NULL) && (flow_gen == tcp_release_gen)
+				&& tcp_flow_match(&flow, skb)) {
+			tcp_sk = flow_sk;
 		}
+		else {
+			flow_gen = tcp_release_gen;
+			tcp_sk = tcp_rcv_lookup(skb, &connected);
+			/* Listening socket creates new one for the connection,
+			 * so only connected sockets are remembered */
+			flow_sk = connected ? tcp_sk : NULL;
+			tcp_flow_init(&flow, skb);
+		}
+
+		tcp_rcv_sock(tcp_sk, skb);
 	}
 }
 
 static int tcp_init(void) {
 	int ret;
 
-	/* Create default timer */
-	ret = timer_init_start_msec(&tcp_tmr_default, TIMER_PERIODIC,
-			TCP_TIMER_FREQUENCY, tcp_timer_handler, NULL);
+	lthread_init(&tcp_timers_lt, tcp_timers_action);
+
+	ret = timer_init(&tcp_timewait_tmr, TIMER_ONESHOT,
+			tcp_timewait_handler, NULL);
 	if (ret != 0) {
 		return ret;
 	}
@@ -82,7 +82,7 @@ static int udp_rcv(struct sk_buff *skb) {
 			|| ip6_check_version(ip6_hdr(skb)));
 
 	/* Check CRC */
-	if (MODOPS_VERIFY_CHKSUM) {
+	if (MODOPS_VERIFY_CHKSUM && (skb->ip_summed == CHECKSUM_NONE)) {
 		uint16_t old_check;
 		old_check = skb->h.uh->check;
 		udp_set_check_field(skb->h.uh, skb->nh.raw);
@@ -91,10 +91,24 @@ static int udp_rcv(struct sk_buff *skb) {
 		}
 	}
 
-	sk = sock_lookup(NULL, udp_sock_ops,
-			ip_check_version(ip_hdr(skb))
-				? udp4_rcv_tester : udp6_rcv_tester,
-			skb);
+	if (ip_check_version(ip_hdr(skb))) {
+		sk = sock_lookup_connected(udp_sock_ops, udp4_rcv_tester, skb,
+				&ip_hdr(skb)->saddr, sizeof ip_hdr(skb)->saddr,
+				udp_hdr(skb)->dest, udp_hdr(skb)->source);
+		if (sk == NULL) {
+			sk = sock_lookup_bound(udp_sock_ops, udp4_rcv_tester, skb,
+					udp_hdr(skb)->dest);
+		}
+	}
+	else {
+		sk = sock_lookup_connected(udp_sock_ops, udp6_rcv_tester, skb,
+				&ip6_hdr(skb)->saddr, sizeof ip6_hdr(skb)->saddr,
+				udp_hdr(skb)->dest, udp_hdr(skb)->source);
+		if (sk == NULL) {
+			sk = sock_lookup_bound(udp_sock_ops, udp6_rcv_tester, skb,
+					udp_hdr(skb)->dest);
+		}
+	}
 	if (sk != NULL) {
 		if (ip_check_version(ip_hdr(skb))
 				? udp4_accept_dst(sk, skb)
@@ -56,6 +56,17 @@ void tcp4_set_check_field(struct tcphdr *tcph,
 			partial_sum(tcph, ntohs(ipph.data_len))) & 0xFFFF;
 }
 
+void tcp4_set_check_partial(struct tcphdr *tcph,
+		const struct iphdr *iph) {
+	struct ip_pseudohdr ipph;
+
+	assert(tcph != NULL);
+
+	ip_pseudo_build(iph, &ipph);
+
+	tcph->check = fold_short(partial_sum(&ipph, sizeof ipph));
+}
+
 void tcp6_set_check_field(struct tcphdr *tcph,
 		const struct ip6hdr *ip6h) {
 	struct ip6_pseudohdr ip6ph;
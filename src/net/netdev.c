@@ -62,6 +62,7 @@ static int netdev_init(struct net_device *dev, const char *name,
 	dlist_head_init(&dev->tx_lnk);
 	strcpy(&dev->name[0], name);
 	memset(&dev->stats, 0, sizeof dev->stats);
+	dev->features = 0;
 	skb_queue_init(&dev->dev_queue);
 	skb_queue_init(&dev->dev_queue_tx);
 
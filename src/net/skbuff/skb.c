@@ -25,6 +25,7 @@
 #include <linux/list.h>
 
 #include <net/skbuff.h>
+#include <net/util/checksum.h>
 
 #include <framework/mod/options.h>
 
@@ -71,6 +72,8 @@ struct sk_buff * skb_wrap_local(size_t size, struct sk_buff_data *skb_data,
 	skb->mac.raw = skb_get_data_pointner(skb_data);
 	skb->p_data = skb->p_data_end = NULL;
 	skb->pl = pl;
+	skb->ip_summed = CHECKSUM_NONE;
+	skb->csum_offset = skb->gso_size = 0;
 
 	return skb;
 }
@@ -107,6 +110,8 @@ struct sk_buff * skb_realloc(size_t size, struct sk_buff *skb) {
 	skb->len = size;
 	skb->mac.raw = skb_get_data_pointner(skb->data);
 	skb->nh.raw = skb->h.raw = NULL;
+	skb->ip_summed = CHECKSUM_NONE;
+	skb->csum_offset = skb->gso_size = 0;
 
 	return skb;
 }
@@ -148,6 +153,9 @@ static void skb_copy_ref(struct sk_buff *to, const struct sk_buff *from) {
 		to->h.raw = from->h.raw + offset;
 	}
 	to->p_data = to->p_data_end = NULL;
+	to->ip_summed = from->ip_summed;
+	to->csum_offset = from->csum_offset;
+	to->gso_size = from->gso_size;
 }
 
 static void skb_shift_ref(struct sk_buff *skb, ptrdiff_t offset) {
@@ -172,6 +180,25 @@ static void skb_copy_data(struct sk_buff_data *to_data,
 			from->len);
 }
 
+void skb_checksum_complete(struct sk_buff *skb) {
+	uint16_t *check;
+	size_t len;
+
+	assert(skb != NULL);
+
+	if (skb->ip_summed != CHECKSUM_PARTIAL) {
+		return;
+	}
+
+	assert(skb->h.raw != NULL);
+	len = skb->mac.raw + skb->len - skb->h.raw;
+	check = (uint16_t *)(skb->h.raw + skb->csum_offset);
+
+	/* Field already contains sum of pseudo header */
+	*check = ~fold_short(partial_sum(skb->h.raw, len)) & 0xFFFF;
+	skb->ip_summed = CHECKSUM_NONE;
+}
+
 struct sk_buff * skb_copy(const struct sk_buff *skb) {
 	struct sk_buff *copied;
 
@@ -4,21 +4,117 @@
  * @date Nov 7, 2013
  * @author: Anton Bondarev
  */
+#include <stdint.h>
+#include <string.h>
+
 #include <net/sock.h>
+#include <net/socket/inet_sock.h>
+#include <net/socket/inet6_sock.h>
 #include <util/dlist.h>
 #include <hal/ipl.h>
+#include <kernel/spinlock.h>
+
+#define SOCK_DEMUX_GOLDEN_RATIO 0x9E3779B1U
+
+/* Protects socket lists and demux tables of all protocols */
+spinlock_t sock_hash_lock = SPIN_STATIC_UNLOCKED;
+
+static uint32_t sock_demux_hash(const void *faddr, size_t faddr_len,
+		in_port_t lport, in_port_t fport) {
+	const uint8_t *p;
+	uint32_t hash, word;
+
+	hash = ((uint32_t)lport << 16) | fport;
+
+	/* Fold the address into 32 bits, IPv6 address is four words */
+	for (p = faddr; faddr_len >= sizeof word; faddr_len -= sizeof word) {
+		memcpy(&word, p, sizeof word);
+		hash ^= word;
+		p += sizeof word;
+	}
+
+	return (hash * SOCK_DEMUX_GOLDEN_RATIO) >> 8;
+}
+
+static inline uint32_t sock_demux_port_hash(in_port_t lport) {
+	return (lport * SOCK_DEMUX_GOLDEN_RATIO) >> 8;
+}
+
+static void sock_demux_init(struct sock_demux *demux) {
+	unsigned int i;
+
+	for (i = 0; i < demux->conn_size; i++) {
+		dlist_init(&demux->conn[i]);
+	}
+	for (i = 0; i < demux->bound_size; i++) {
+		dlist_init(&demux->bound[i]);
+	}
+
+	demux->initialized = 1;
+}
+
+static int sock_demux_addr_any(const void *faddr, size_t faddr_len) {
+	const unsigned char *p = faddr;
+
+	while (faddr_len--) {
+		if (*p++ != 0) {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+static struct dlist_head *sock_demux_bucket(struct sock_demux *demux,
+		const struct sock *sk) {
+	const void *faddr;
+	size_t faddr_len;
+	in_port_t lport, fport;
+
+	if (sk->opt.so_domain == AF_INET) {
+		faddr = &to_const_inet_sock(sk)->dst_in.sin_addr;
+		faddr_len = sizeof to_const_inet_sock(sk)->dst_in.sin_addr;
+	}
+	else if (sk->opt.so_domain == AF_INET6) {
+		faddr = &to_const_inet6_sock(sk)->dst_in6.sin6_addr;
+		faddr_len = sizeof to_const_inet6_sock(sk)->dst_in6.sin6_addr;
+	}
+	else {
+		return &demux->bound[0];
+	}
+
+	lport = sock_inet_get_src_port(sk);
+	fport = sock_inet_get_dst_port(sk);
+
+	/* Packets from any address or port may match, they are found by
+	 * the local port only */
+	if ((fport == 0) || sock_demux_addr_any(faddr, faddr_len)) {
+		return &demux->bound[sock_demux_port_hash(lport) % demux->bound_size];
+	}
+
+	return &demux->conn[sock_demux_hash(faddr, faddr_len, lport, fport)
+			% demux->conn_size];
+}
 
 void sock_hash(struct sock *sk) {
 	ipl_t ipl;
+	struct sock_demux *demux;
 
 	assert(sk != NULL);
 	assert(sk->p_ops != NULL);
 	assert(dlist_empty_entry(sk, lnk));
 
-	/* TODO Probably, it's better to use spinlock here */
-	ipl = ipl_save();
+	demux = sk->p_ops->sock_demux;
+
+	ipl = spin_lock_ipl(&sock_hash_lock);
 	dlist_add_prev_entry(sk, sk->p_ops->sock_list, lnk);
-	ipl_restore(ipl);
+	if (demux != NULL) {
+		if (!demux->initialized) {
+			sock_demux_init(demux);
+		}
+		dlist_add_prev_entry(sk, sock_demux_bucket(demux, sk), demux_lnk);
+	}
+	spin_unlock_ipl(&sock_hash_lock, ipl);
 }
 
 void sock_unhash(struct sock *sk) {
@@ -27,7 +123,90 @@ void sock_unhash(struct sock *sk) {
 	assert(sk != NULL);
 	assert(!dlist_empty_entry(sk, lnk));
 
-	ipl = ipl_save();
+	ipl = spin_lock_ipl(&sock_hash_lock);
 	dlist_del_init_entry(sk, lnk);
-	ipl_restore(ipl);
+	if (!dlist_empty_entry(sk, demux_lnk)) {
+		dlist_del_init_entry(sk, demux_lnk);
+	}
+	spin_unlock_ipl(&sock_hash_lock, ipl);
+}
+
+void sock_rehash(struct sock *sk) {
+	ipl_t ipl;
+	struct sock_demux *demux;
+
+	assert(sk != NULL);
+	assert(sk->p_ops != NULL);
+
+	demux = sk->p_ops->sock_demux;
+	if ((demux == NULL) || dlist_empty_entry(sk, demux_lnk)) {
+		return; /* not hashed */
+	}
+
+	ipl = spin_lock_ipl(&sock_hash_lock);
+	dlist_del_init_entry(sk, demux_lnk);
+	dlist_add_prev_entry(sk, sock_demux_bucket(demux, sk), demux_lnk);
+	spin_unlock_ipl(&sock_hash_lock, ipl);
+}
+
+static struct sock * sock_demux_bucket_lookup(struct dlist_head *bucket,
+		sock_lookup_tester_ft tester, const struct sk_buff *skb) {
+	ipl_t ipl;
+	struct sock *sk;
+
+	ipl = spin_lock_ipl(&sock_hash_lock);
+	{
+		dlist_foreach_entry(sk, bucket, demux_lnk) {
+			if (tester(sk, skb)) {
+				spin_unlock_ipl(&sock_hash_lock, ipl);
+				return sk;
+			}
+		}
+	}
+	spin_unlock_ipl(&sock_hash_lock, ipl);
+
+	return NULL; /* error: no such entity */
+}
+
+struct sock * sock_lookup_connected(const struct sock_proto_ops *p_ops,
+		sock_lookup_tester_ft tester, const struct sk_buff *skb,
+		const void *faddr, size_t faddr_len,
+		in_port_t lport, in_port_t fport) {
+	struct sock_demux *demux;
+
+	if ((p_ops == NULL) || (tester == NULL)) {
+		return NULL; /* error: invalid arguments */
+	}
+
+	demux = p_ops->sock_demux;
+	if (demux == NULL) {
+		return sock_lookup(NULL, p_ops, tester, skb);
+	}
+	else if (!demux->initialized || (fport == 0)) {
+		return NULL;
+	}
+
+	return sock_demux_bucket_lookup(&demux->conn[sock_demux_hash(faddr,
+				faddr_len, lport, fport) % demux->conn_size], tester, skb);
+}
+
+struct sock * sock_lookup_bound(const struct sock_proto_ops *p_ops,
+		sock_lookup_tester_ft tester, const struct sk_buff *skb,
+		in_port_t lport) {
+	struct sock_demux *demux;
+
+	if ((p_ops == NULL) || (tester == NULL)) {
+		return NULL; /* error: invalid arguments */
+	}
+
+	demux = p_ops->sock_demux;
+	if (demux == NULL) {
+		return sock_lookup(NULL, p_ops, tester, skb);
+	}
+	else if (!demux->initialized) {
+		return NULL;
+	}
+
+	return sock_demux_bucket_lookup(&demux->bound[sock_demux_port_hash(lport)
+				% demux->bound_size], tester, skb);
 }
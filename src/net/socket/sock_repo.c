@@ -9,6 +9,9 @@
 #include <util/dlist.h>
 #include <arpa/inet.h>
 #include <hal/ipl.h>
+#include <kernel/spinlock.h>
+
+extern spinlock_t sock_hash_lock;
 
 struct sock * sock_iter(const struct sock_proto_ops *p_ops) {
 	if (p_ops == NULL) {
@@ -43,19 +46,18 @@ struct sock * sock_lookup(const struct sock *sk,
 		return NULL; /* error: invalid arguments */
 	}
 
-	next_sk = sk != NULL ? sock_next(sk) : sock_iter(p_ops);
-
-	ipl = ipl_save();
+	ipl = spin_lock_ipl(&sock_hash_lock);
 	{
+		next_sk = sk != NULL ? sock_next(sk) : sock_iter(p_ops);
 		while (next_sk != NULL) {
 			if (tester(next_sk, skb)) {
-				ipl_restore(ipl);
+				spin_unlock_ipl(&sock_hash_lock, ipl);
 				return next_sk;
 			}
 			next_sk = sock_next(next_sk);
 		}
 	}
-	ipl_restore(ipl);
+	spin_unlock_ipl(&sock_hash_lock, ipl);
 
 	return NULL; /* error: no such entity */
 }
@@ -36,6 +36,8 @@
 
 #include <framework/mod/options.h>
 #define MODOPS_AMOUNT_TCP_SOCK OPTION_GET(NUMBER, amount_tcp_sock)
+#define MODOPS_DEMUX_CONN_SIZE OPTION_GET(NUMBER, demux_conn_size)
+#define MODOPS_DEMUX_BOUND_SIZE OPTION_GET(NUMBER, demux_bound_size)
 
 #include <config/embox/net/socket.h>
 #define MODOPS_CONNECT_TIMEOUT \
@@ -82,11 +84,13 @@ static int tcp_init(struct sock *sk) {
 	INIT_LIST_HEAD(&tcp_sk->conn_free);
 	tcp_sk->free_wait_queue_len = tcp_sk->free_wait_queue_max = 0;
 	tcp_sk->lock = 0;
+	spin_init(&tcp_sk->lock_spin, __SPIN_UNLOCKED);
+	tcp_sk->lock_parent = NULL;
 	/* timerclear(&sock.tcp_sk->syn_time); */
-	timerclear(&tcp_sk->ack_time);
-	timerclear(&tcp_sk->rcv_time);
 	tcp_sk->dup_ack = 0;
 	tcp_sk->rexmit_mode = 0;
+	tcp_sk->mss = 0;
+	tcp_sock_timers_init(tcp_sk);
 
 	return 0;
 }
@@ -106,6 +110,7 @@ static int tcp_close(struct sock *sk) {
 		assert(tcp_sk->state < TCP_MAX_STATE);
 		switch (tcp_sk->state) {
 		default:
+			tcp_sock_unlock(tcp_sk, TCP_SYNC_STATE);
 			return -EBADF;
 		case TCP_CLOSED:
 			tcp_sock_unlock(tcp_sk, TCP_SYNC_STATE);
@@ -588,6 +593,7 @@ static int tcp_setsockopt(struct sock *sk, int level, int optname,
 
 POOL_DEF(tcp_sock_pool, struct tcp_sock, MODOPS_AMOUNT_TCP_SOCK);
 static DLIST_DEFINE(tcp_sock_list);
+SOCK_DEMUX_DEF(tcp_sock_demux, MODOPS_DEMUX_CONN_SIZE, MODOPS_DEMUX_BOUND_SIZE);
 
 static const struct sock_proto_ops tcp_sock_ops_struct = {
 	.init       = tcp_init,
@@ -600,5 +606,6 @@ static const struct sock_proto_ops tcp_sock_ops_struct = {
 	.setsockopt = tcp_setsockopt,
 	.shutdown   = tcp_shutdown,
 	.sock_pool  = &tcp_sock_pool,
-	.sock_list  = &tcp_sock_list
+	.sock_list  = &tcp_sock_list,
+	.sock_demux = &tcp_sock_demux
 };
@@ -28,6 +28,10 @@
 
 #include <stdlib.h>
 
+#include <framework/mod/options.h>
+#define MODOPS_DEMUX_CONN_SIZE OPTION_GET(NUMBER, demux_conn_size)
+#define MODOPS_DEMUX_BOUND_SIZE OPTION_GET(NUMBER, demux_bound_size)
+
 static const struct sock_proto_ops udp_sock_ops_struct;
 const struct sock_proto_ops *const udp_sock_ops = &udp_sock_ops_struct;
 
@@ -161,6 +165,7 @@ static int udp_sendmsg(struct sock *sk, struct msghdr *msg, int flags) {
 }
 
 static DLIST_DEFINE(udp_sock_list);
+SOCK_DEMUX_DEF(udp_sock_demux, MODOPS_DEMUX_CONN_SIZE, MODOPS_DEMUX_BOUND_SIZE);
 
 static int udp_fillmsg(struct sock *sk, struct msghdr *msg,
 		struct sk_buff *skb) {
@@ -179,5 +184,6 @@ static const struct sock_proto_ops udp_sock_ops_struct = {
 	.sendmsg   = udp_sendmsg,
 	.recvmsg   = sock_dgram_recvmsg,
 	.fillmsg   = udp_fillmsg,
-	.sock_list = &udp_sock_list
+	.sock_list = &udp_sock_list,
+	.sock_demux = &udp_sock_demux
 };
@@ -0,0 +1,115 @@
+/**
+ * @file
+ * @brief Tests for queue of asynchronous block device requests
+ *
+ * @date 18.10.2026
+ */
+
+#include <errno.h>
+#include <stddef.h>
+
+#include <drivers/block_dev.h>
+#include <drivers/block_req.h>
+
+#include <embox/test.h>
+
+EMBOX_TEST_SUITE("asynchronous block device requests");
+
+TEST_SETUP(case_setup);
+TEST_TEARDOWN(case_teardown);
+
+#define TEST_BLOCK_SIZE 512
+#define TEST_INFLIGHT   2
+
+static struct block_req *started[TEST_INFLIGHT];
+static int started_cnt;
+
+/* Device is not real, requests are completed by the test */
+static int test_submit(struct block_dev *bdev, struct block_req *req) {
+	if (started_cnt == TEST_INFLIGHT) {
+		return -EBUSY;
+	}
+	started[started_cnt++] = req;
+	return 0;
+}
+
+static void test_complete(int i) {
+	struct block_req *req;
+
+	req = started[i];
+	started[i] = started[--started_cnt];
+	block_req_done(req, 0);
+}
+
+static const struct block_dev_driver test_driver = {
+	.name = "block_req_test_drv",
+	.submit = test_submit,
+};
+
+static struct block_dev *bdev;
+static char buf[4][TEST_BLOCK_SIZE];
+
+TEST_CASE("Requests for adjacent blocks are merged while device is plugged") {
+	struct block_req req[3];
+	int i;
+
+	block_req_plug(bdev);
+	for (i = 0; i < 3; i++) {
+		block_req_init(&req[i], bdev, 1, 10 + i, buf[i], TEST_BLOCK_SIZE);
+		test_assert_zero(block_req_submit(&req[i]));
+	}
+	test_assert_zero(started_cnt);
+	block_req_unplug(bdev);
+
+	test_assert_equal(started_cnt, 1);
+	test_assert_equal(started[0], &req[0]);
+	test_assert_equal(req[0].nr_segs, 3);
+
+	test_complete(0);
+	for (i = 0; i < 3; i++) {
+		test_assert(req[i].done);
+		test_assert_zero(block_req_wait(&req[i]));
+	}
+}
+
+TEST_CASE("Request waits until driver completes one in flight") {
+	struct block_req req[TEST_INFLIGHT + 1];
+	int i;
+
+	/* Blocks are not adjacent, so nothing is merged */
+	for (i = 0; i < TEST_INFLIGHT + 1; i++) {
+		block_req_init(&req[i], bdev, 0, 20 * i, buf[i], TEST_BLOCK_SIZE);
+		test_assert_zero(block_req_submit(&req[i]));
+	}
+	test_assert_equal(started_cnt, TEST_INFLIGHT);
+	test_assert_zero(req[TEST_INFLIGHT].done);
+
+	test_complete(0);
+	test_assert_equal(started_cnt, TEST_INFLIGHT);
+
+	while (started_cnt) {
+		test_complete(0);
+	}
+	for (i = 0; i < TEST_INFLIGHT + 1; i++) {
+		test_assert(req[i].done);
+	}
+}
+
+static int case_setup(void) {
+	started_cnt = 0;
+
+	bdev = block_dev_create("/dev/block_req_test", &test_driver, NULL);
+	if (!bdev) {
+		return -ENOMEM;
+	}
+	bdev->block_size = TEST_BLOCK_SIZE;
+	bdev->size = 64 * TEST_BLOCK_SIZE;
+	bdev->queue.max_segs = 4;
+
+	return 0;
+}
+
+static int case_teardown(void) {
+	block_dev_destroy(bdev->dev_module);
+	return 0;
+}
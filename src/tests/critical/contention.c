@@ -0,0 +1,128 @@
+/**
+ * @file
+ * @brief Critical sections and spinlocks under contention of several CPUs
+ *
+ * @date 17.10.2026
+ */
+
+#include <embox/test.h>
+#include <util/err.h>
+
+#include <hal/cpu.h>
+#include <kernel/cpu/bkl.h>
+#include <kernel/sched/affinity.h>
+#include <kernel/sched/sched_lock.h>
+#include <kernel/spinlock.h>
+#include <kernel/thread.h>
+
+EMBOX_TEST_SUITE("critical sections contention test");
+
+#define THREADS_PER_CPU 2
+#define ITERATIONS      10000
+#define WAIT_LIMIT      100000000
+
+static spinlock_t counter_lock = SPIN_STATIC_UNLOCKED;
+static unsigned long counter;
+
+static void *counter_run(void *arg) {
+	int i;
+
+	for (i = 0; i < ITERATIONS; i++) {
+		sched_lock();
+		{
+			spin_lock(&counter_lock);
+			counter++;
+			spin_unlock(&counter_lock);
+
+			(*(int *) arg)++;
+		}
+		sched_unlock();
+	}
+
+	return NULL;
+}
+
+TEST_CASE("Shared counter protected by spinlock is consistent") {
+	struct thread *t[NCPU * THREADS_PER_CPU];
+	int done[NCPU * THREADS_PER_CPU];
+	int i;
+
+	counter = 0;
+
+	for (i = 0; i < NCPU * THREADS_PER_CPU; i++) {
+		done[i] = 0;
+		t[i] = thread_create(THREAD_FLAG_SUSPENDED, counter_run, &done[i]);
+		test_assert_zero(err(t[i]));
+		sched_affinity_set(&t[i]->schedee.affinity, 1 << (i % NCPU));
+	}
+
+	for (i = 0; i < NCPU * THREADS_PER_CPU; i++) {
+		test_assert_zero(thread_launch(t[i]));
+	}
+
+	for (i = 0; i < NCPU * THREADS_PER_CPU; i++) {
+		test_assert_zero(thread_join(t[i], NULL));
+		test_assert_equal(done[i], ITERATIONS);
+	}
+
+	test_assert_equal(counter, NCPU * THREADS_PER_CPU * ITERATIONS);
+}
+
+#if defined(SMP) && defined(NO_BKL) && (NCPU > 1)
+
+static volatile int holder_inside;
+static volatile int other_progress;
+
+static void *holder_run(void *arg) {
+	int i;
+
+	sched_lock();
+	{
+		holder_inside = 1;
+		for (i = 0; (i < WAIT_LIMIT) && !other_progress; i++) {
+		}
+		*(int *) arg = other_progress;
+	}
+	sched_unlock();
+
+	return NULL;
+}
+
+static void *other_run(void *arg) {
+	while (!holder_inside) {
+	}
+
+	sched_lock();
+	{
+		other_progress = 1;
+	}
+	sched_unlock();
+
+	return NULL;
+}
+
+TEST_CASE("Critical section on one CPU doesn't stop another CPU") {
+	struct thread *holder, *other;
+	int saw_progress = 0;
+
+	holder_inside = 0;
+	other_progress = 0;
+
+	holder = thread_create(THREAD_FLAG_SUSPENDED, holder_run, &saw_progress);
+	test_assert_zero(err(holder));
+	sched_affinity_set(&holder->schedee.affinity, 1 << 0);
+
+	other = thread_create(THREAD_FLAG_SUSPENDED, other_run, NULL);
+	test_assert_zero(err(other));
+	sched_affinity_set(&other->schedee.affinity, 1 << 1);
+
+	test_assert_zero(thread_launch(other));
+	test_assert_zero(thread_launch(holder));
+
+	test_assert_zero(thread_join(holder, NULL));
+	test_assert_zero(thread_join(other, NULL));
+
+	test_assert_true(saw_progress);
+}
+
+#endif
@@ -0,0 +1,181 @@
+/**
+ * @file
+ * @brief Tests for page-backed tmpfs
+ *
+ * @date 18.10.2026
+ */
+
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <fs/mount.h>
+#include <mem/page.h>
+#include <embox/test.h>
+
+EMBOX_TEST_SUITE("fs/tmpfs test");
+
+TEST_SETUP(setup);
+TEST_TEARDOWN(teardown);
+
+#define TMPFS_DIR   "/tmpfs_test"
+#define TMPFS_FILE  TMPFS_DIR "/file"
+
+static char buf[2 * PAGE_SIZE()];
+
+TEST_CASE("Data written at a page boundary is read back") {
+	static const char data[] = "tmpfs";
+	int fd;
+
+	test_assert(0 <= (fd = open(TMPFS_FILE, O_CREAT | O_RDWR, 0666)));
+
+	test_assert_equal(PAGE_SIZE() - 2, lseek(fd, PAGE_SIZE() - 2, SEEK_SET));
+	test_assert_equal(sizeof(data), write(fd, data, sizeof(data)));
+
+	test_assert_zero(lseek(fd, 0, SEEK_SET));
+	memset(buf, 0xff, sizeof(buf));
+	test_assert_equal(PAGE_SIZE() - 2 + sizeof(data),
+			read(fd, buf, sizeof(buf)));
+
+	/* Skipped part is a hole */
+	test_assert_zero(buf[0]);
+	test_assert_zero(buf[PAGE_SIZE() - 3]);
+	test_assert_zero(memcmp(buf + PAGE_SIZE() - 2, data, sizeof(data)));
+
+	close(fd);
+}
+
+TEST_CASE("Truncated file reads zeroes after it grows again") {
+	struct stat st;
+	int fd;
+
+	test_assert(0 <= (fd = open(TMPFS_FILE, O_CREAT | O_RDWR, 0666)));
+
+	memset(buf, 'a', sizeof(buf));
+	test_assert_equal(sizeof(buf), write(fd, buf, sizeof(buf)));
+
+	test_assert_zero(ftruncate(fd, 10));
+	test_assert_zero(fstat(fd, &st));
+	test_assert_equal(10, st.st_size);
+
+	test_assert_zero(ftruncate(fd, sizeof(buf)));
+	test_assert_zero(lseek(fd, 0, SEEK_SET));
+	test_assert_equal(sizeof(buf), read(fd, buf, sizeof(buf)));
+	test_assert_equal('a', buf[9]);
+	test_assert_zero(buf[10]);
+	test_assert_zero(buf[PAGE_SIZE()]);
+
+	close(fd);
+}
+
+TEST_CASE("Mapping shares data with the file") {
+	char *map;
+	int fd;
+
+	test_assert(0 <= (fd = open(TMPFS_FILE, O_CREAT | O_RDWR, 0666)));
+
+	memset(buf, 'a', sizeof(buf));
+	test_assert_equal(sizeof(buf), write(fd, buf, sizeof(buf)));
+
+	map = mmap(NULL, sizeof(buf), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	test_assert(map != MAP_FAILED);
+	test_assert_equal('a', map[PAGE_SIZE()]);
+
+	map[0] = 'b';
+	map[PAGE_SIZE()] = 'c';
+
+	test_assert_zero(lseek(fd, 0, SEEK_SET));
+	test_assert_equal(sizeof(buf), read(fd, buf, sizeof(buf)));
+	test_assert_equal('b', buf[0]);
+	test_assert_equal('c', buf[PAGE_SIZE()]);
+
+	munmap(map, sizeof(buf));
+	close(fd);
+}
+
+TEST_CASE("Mapped pages aren't moved by another mapping") {
+	char *map, *map2;
+	int fd;
+
+	test_assert(0 <= (fd = open(TMPFS_FILE, O_CREAT | O_RDWR, 0666)));
+
+	/* Second page only, then both pages which aren't contiguous yet */
+	memset(buf, 'a', sizeof(buf));
+	test_assert_equal(PAGE_SIZE(), write(fd, buf, PAGE_SIZE()));
+	test_assert_equal(PAGE_SIZE(), lseek(fd, 2 * PAGE_SIZE(), SEEK_SET));
+	test_assert_equal(PAGE_SIZE(), write(fd, buf, PAGE_SIZE()));
+
+	map = mmap(NULL, PAGE_SIZE(), PROT_READ | PROT_WRITE, MAP_SHARED, fd,
+			2 * PAGE_SIZE());
+	test_assert(map != MAP_FAILED);
+	map[0] = 'b';
+
+	map2 = mmap(NULL, 3 * PAGE_SIZE(), PROT_READ | PROT_WRITE, MAP_SHARED,
+			fd, 0);
+	if (map2 != MAP_FAILED) {
+		/* Pages were already in place */
+		test_assert_equal(map, map2 + 2 * PAGE_SIZE());
+		munmap(map2, 3 * PAGE_SIZE());
+	}
+
+	/* First mapping still shares data with the file */
+	map[1] = 'c';
+	test_assert_equal(2 * PAGE_SIZE(), lseek(fd, 2 * PAGE_SIZE(), SEEK_SET));
+	test_assert_equal(2, read(fd, buf, 2));
+	test_assert_equal('b', buf[0]);
+	test_assert_equal('c', buf[1]);
+
+	munmap(map, PAGE_SIZE());
+	close(fd);
+}
+
+TEST_CASE("Pages between two mappings can be mapped") {
+	char *map, *map2, *map3;
+	int fd;
+
+	test_assert(0 <= (fd = open(TMPFS_FILE, O_CREAT | O_RDWR, 0666)));
+
+	memset(buf, 'a', PAGE_SIZE());
+	memset(buf + PAGE_SIZE(), 'b', PAGE_SIZE());
+	test_assert_equal(sizeof(buf), write(fd, buf, sizeof(buf)));
+	test_assert_equal(sizeof(buf), write(fd, buf, sizeof(buf)));
+
+	map = mmap(NULL, PAGE_SIZE(), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	test_assert(map != MAP_FAILED);
+	map2 = mmap(NULL, PAGE_SIZE(), PROT_READ | PROT_WRITE, MAP_SHARED, fd,
+			3 * PAGE_SIZE());
+	test_assert(map2 != MAP_FAILED);
+
+	map3 = mmap(NULL, 2 * PAGE_SIZE(), PROT_READ | PROT_WRITE, MAP_SHARED,
+			fd, PAGE_SIZE());
+	test_assert(map3 != MAP_FAILED);
+	test_assert_equal('b', map3[0]);
+	test_assert_equal('a', map3[PAGE_SIZE()]);
+
+	/* Part of a mapping is found in place */
+	test_assert_equal(map3 + PAGE_SIZE(),
+			mmap(NULL, PAGE_SIZE(), PROT_READ | PROT_WRITE, MAP_SHARED, fd,
+				2 * PAGE_SIZE()));
+
+	munmap(map3, 2 * PAGE_SIZE());
+	munmap(map2, PAGE_SIZE());
+	munmap(map, PAGE_SIZE());
+	close(fd);
+}
+
+static int setup(void) {
+	if (0 != mkdir(TMPFS_DIR, 0777)) {
+		return -1;
+	}
+	return mount(NULL, TMPFS_DIR, "tmpfs");
+}
+
+static int teardown(void) {
+	unlink(TMPFS_FILE);
+	if (0 != umount(TMPFS_DIR)) {
+		return -1;
+	}
+	return rmdir(TMPFS_DIR);
+}
@@ -0,0 +1,87 @@
+/**
+ * @file
+ * @brief Tests formatting of binary log records
+ *
+ * @date 18.10.2026
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <embox/test.h>
+
+#include <kernel/logging/log_record.h>
+
+EMBOX_TEST_SUITE("binary log records");
+
+#define REC_MAX 128
+#define MSG_MAX 128
+
+static char rec[REC_MAX + LOG_RECORD_PAD];
+static char msg[MSG_MAX];
+
+static size_t record_encode(size_t rec_max, const char *fmt, ...) {
+	va_list args;
+	size_t len;
+
+	memset(rec, 0, sizeof(rec));
+
+	va_start(args, fmt);
+	len = log_record_encode(rec, rec_max, fmt, args);
+	va_end(args);
+
+	return len;
+}
+
+#define test_record(rec_max, msg_max, expected, fmt, ...) \
+	do { \
+		size_t __len = record_encode(rec_max, fmt, ## __VA_ARGS__); \
+		test_assert(__len <= (rec_max)); \
+		log_record_decode(msg, msg_max, rec, __len); \
+		test_assert_str_equal((const char *) msg, expected); \
+	} while (0)
+
+TEST_CASE("Conversions are printed as snprintf prints them") {
+	char expected[MSG_MAX];
+
+	snprintf(expected, sizeof(expected), "%d %u %lx %llu %c %p %5.2f %% end",
+			-42, 42u, 0xbeefUL, 1ULL << 40, 'z', (void *) 0x1234, 3.14159);
+	test_record(REC_MAX, MSG_MAX, expected,
+			"%d %u %lx %llu %c %p %5.2f %% end",
+			-42, 42u, 0xbeefUL, 1ULL << 40, 'z', (void *) 0x1234, 3.14159);
+}
+
+TEST_CASE("Width and precision are read from arguments") {
+	test_record(REC_MAX, MSG_MAX, "[   7] [0012] [ab   ]",
+			"[%*d] [%.*d] [%-*.*s]", 4, 7, 4, 12, 5, 2, "abc");
+}
+
+TEST_CASE("String is copied to the record") {
+	char str[] = "before";
+
+	record_encode(REC_MAX, "%s!", str);
+	strcpy(str, "after");
+	log_record_decode(msg, MSG_MAX, rec, ((struct log_record_hdr *) rec)->len);
+	test_assert_str_equal(msg, "before!");
+}
+
+TEST_CASE("NULL string is printed as (null)") {
+	test_record(REC_MAX, MSG_MAX, "<(null)>", "<%s>", (char *) NULL);
+}
+
+TEST_CASE("Arguments which don't fit into the record are printed as zeroes") {
+	size_t rec_max = sizeof(struct log_record_hdr) + 6;
+
+	test_record(rec_max, MSG_MAX, "abcde 0 0", "%s %d %d",
+			"abcdefghij", 1, 2);
+}
+
+TEST_CASE("Message is cut to its buffer") {
+	test_record(REC_MAX, 8, "value 1", "value %d and more", 12345);
+}
+
+TEST_CASE("Too long conversion is printed as is, next one is right") {
+	test_record(REC_MAX, MSG_MAX,
+			"%000000000000000000000000000000000001d 7",
+			"%000000000000000000000000000000000001d %d", 5, 7);
+}
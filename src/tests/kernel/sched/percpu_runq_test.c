@@ -0,0 +1,128 @@
+/**
+ * @file
+ * @brief Per-CPU runq placement and work stealing test
+ *
+ * @date 17.10.2026
+ */
+
+#include <stdint.h>
+
+#include <embox/test.h>
+#include <util/err.h>
+
+#include <hal/clock.h>
+#include <hal/cpu.h>
+#include <kernel/thread.h>
+#include <kernel/sched/affinity.h>
+#include <kernel/time/time.h>
+
+EMBOX_TEST_SUITE("Per-CPU runq scheduling test");
+
+#define THREADS_PER_CPU 4
+
+static void *cpu_id_run(void *arg) {
+	volatile int i = 0;
+
+	while (i++ < 1000000)
+		;
+
+	*(unsigned int *) arg = cpu_get_id();
+
+	return NULL;
+}
+
+TEST_CASE("Bound thread runs on the CPU it is bound to") {
+	struct thread *t[NCPU];
+	unsigned int ran_on[NCPU];
+	int cpu;
+
+	for (cpu = 0; cpu < NCPU; cpu++) {
+		ran_on[cpu] = -1u;
+		t[cpu] = thread_create(THREAD_FLAG_SUSPENDED, cpu_id_run,
+				&ran_on[cpu]);
+		test_assert_zero(err(t[cpu]));
+		sched_affinity_set(&t[cpu]->schedee.affinity, 1 << cpu);
+	}
+
+	for (cpu = 0; cpu < NCPU; cpu++) {
+		test_assert_zero(thread_launch(t[cpu]));
+	}
+
+	for (cpu = 0; cpu < NCPU; cpu++) {
+		test_assert_zero(thread_join(t[cpu], NULL));
+#ifdef SMP
+		test_assert_equal(ran_on[cpu], cpu);
+#else
+		test_assert_not_equal(ran_on[cpu], -1u);
+#endif
+	}
+}
+
+TEST_CASE("Unbound threads all get to run") {
+	struct thread *t[NCPU * THREADS_PER_CPU];
+	unsigned int ran_on[NCPU * THREADS_PER_CPU];
+	int i;
+
+	for (i = 0; i < NCPU * THREADS_PER_CPU; i++) {
+		ran_on[i] = -1u;
+		t[i] = thread_create(0, cpu_id_run, &ran_on[i]);
+		test_assert_zero(err(t[i]));
+	}
+
+	for (i = 0; i < NCPU * THREADS_PER_CPU; i++) {
+		test_assert_zero(thread_join(t[i], NULL));
+		test_assert(ran_on[i] < NCPU);
+	}
+}
+
+#ifdef SMP
+#define STEAL_THREADS     3
+#define STEAL_TIMEOUT_MS  1000
+
+static volatile int stolen;
+
+/* Spins until any of the threads runs on a CPU other than @a arg one */
+static void *steal_run(void *arg) {
+	clock_t end = clock_sys_ticks() + ms2jiffies(STEAL_TIMEOUT_MS);
+
+	while (!stolen && ((long) (clock_sys_ticks() - end) < 0)) {
+		if (cpu_get_id() != (unsigned int) (uintptr_t) arg) {
+			stolen = 1;
+		}
+	}
+
+	return NULL;
+}
+
+TEST_CASE("Idle CPU steals threads queued on a busy one") {
+	struct thread *t[STEAL_THREADS];
+	unsigned int busy;
+	int i;
+
+	/* This CPU goes idle when we join, another one gets all threads */
+	busy = (cpu_get_id() + 1) % NCPU;
+	stolen = 0;
+
+	for (i = 0; i < STEAL_THREADS; i++) {
+		t[i] = thread_create(THREAD_FLAG_SUSPENDED, steal_run,
+				(void *) (uintptr_t) busy);
+		test_assert_zero(err(t[i]));
+		sched_affinity_set(&t[i]->schedee.affinity, 1 << busy);
+	}
+
+	for (i = 0; i < STEAL_THREADS; i++) {
+		test_assert_zero(thread_launch(t[i]));
+	}
+
+	/* Threads are on the busy CPU runq already and may be moved now */
+	for (i = 0; i < STEAL_THREADS; i++) {
+		sched_affinity_set(&t[i]->schedee.affinity, (1 << NCPU) - 1);
+	}
+
+	for (i = 0; i < STEAL_THREADS; i++) {
+		test_assert_zero(thread_join(t[i], NULL));
+	}
+
+	test_assert(stolen);
+}
+#endif /* SMP */
@@ -70,6 +70,20 @@ TEST_CASE("thread_join should retrieve the result of thread execution") {
 	test_assert_equal(ret, (void *) ~42UL);
 }
 
+TEST_CASE("Memory of joined threads should be reused by new threads") {
+	void *ret;
+	struct thread *t;
+	unsigned long i;
+
+	for (i = 0; i < 64; i++) {
+		t = thread_create(0, arg_invert_run, (void *) i);
+		test_assert_zero(err(t));
+
+		test_assert_zero(thread_join(t, &ret));
+		test_assert_equal(ret, (void *) ~i);
+	}
+}
+
 TEST_CASE("thread_launch should return 0 if the thread was created with "
 		"THREAD_FLAG_SUSPENDED flag") {
 	struct thread *t;
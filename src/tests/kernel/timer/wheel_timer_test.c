@@ -0,0 +1,119 @@
+/**
+ * @file
+ * @brief Tests timers of the timing wheel which are cascaded between wheels
+ *
+ * @details Timers here are longer than the root wheel, so they are put to
+ *          the upper wheel at start and are moved to the root one later.
+ *
+ * @date 18.10.2026
+ */
+
+#include <embox/test.h>
+
+#include <hal/clock.h>
+#include <kernel/time/timer.h>
+
+EMBOX_TEST_SUITE("timing wheel cascade tests");
+
+#define TEST_LOAD       (WHEEL_ROOT_SIZE + 44)
+/* Timers are handled by lthread, which may be a bit late */
+#define TEST_SLACK      20
+#define TEST_FIRES      3
+#define TEST_TIMERS     8
+
+struct test_timer {
+	struct sys_timer tmr;
+	volatile int fired;
+	volatile clock_t at[TEST_FIRES];
+};
+
+static struct test_timer test_timers[TEST_TIMERS + 1];
+
+static void test_timer_handler(struct sys_timer *tmr, void *param) {
+	struct test_timer *t = param;
+
+	if (t->fired < TEST_FIRES) {
+		t->at[t->fired] = clock_sys_ticks();
+	}
+	t->fired++;
+}
+
+static void test_timer_start(struct test_timer *t, unsigned int flags,
+		clock_t load) {
+	t->fired = 0;
+	test_assert_zero(timer_init_start(&t->tmr, flags, load,
+			test_timer_handler, t));
+}
+
+static void wait_until(clock_t tick) {
+	while ((long) (clock_sys_ticks() - tick) < 0) {
+	}
+}
+
+static void test_assert_fired_at(clock_t at, clock_t start, clock_t load) {
+	test_assert((long) (at - start) >= (long) load - 1);
+	test_assert((long) (at - start) <= (long) load + TEST_SLACK);
+}
+
+TEST_CASE("Timer longer than the root wheel fires in time") {
+	struct test_timer *t = &test_timers[0];
+	clock_t start;
+
+	start = clock_sys_ticks();
+	test_timer_start(t, TIMER_ONESHOT, TEST_LOAD);
+
+	wait_until(start + TEST_LOAD + TEST_SLACK);
+	timer_stop(&t->tmr);
+
+	test_assert_equal(t->fired, 1);
+	test_assert_fired_at(t->at[0], start, TEST_LOAD);
+}
+
+TEST_CASE("Timer stopped after cascade to the root wheel doesn't fire") {
+	struct test_timer *t, *last;
+	clock_t start, load;
+	int i;
+
+	/* Expiry ticks are spread over the root wheel, so all timers but one at
+	 * most are moved to the root wheel earlier than they are stopped */
+	start = clock_sys_ticks();
+	for (i = 0; i < TEST_TIMERS; i++) {
+		load = TEST_LOAD + i * (WHEEL_ROOT_SIZE / TEST_TIMERS);
+		test_timer_start(&test_timers[i], TIMER_ONESHOT, load);
+	}
+	/* Timer which is left to fire, to be sure the wheel is running */
+	last = &test_timers[TEST_TIMERS];
+	test_timer_start(last, TIMER_ONESHOT, TEST_LOAD + WHEEL_ROOT_SIZE);
+
+	for (i = 0; i < TEST_TIMERS; i++) {
+		load = TEST_LOAD + i * (WHEEL_ROOT_SIZE / TEST_TIMERS);
+		wait_until(start + load - WHEEL_ROOT_SIZE / TEST_TIMERS / 2);
+		timer_stop(&test_timers[i].tmr);
+	}
+
+	wait_until(start + TEST_LOAD + WHEEL_ROOT_SIZE + TEST_SLACK);
+	timer_stop(&last->tmr);
+
+	for (i = 0; i < TEST_TIMERS; i++) {
+		t = &test_timers[i];
+		test_assert_zero(t->fired);
+	}
+	test_assert_equal(last->fired, 1);
+}
+
+TEST_CASE("Periodic timer is re-armed from its expiry") {
+	struct test_timer *t = &test_timers[0];
+	clock_t start;
+	int i;
+
+	start = clock_sys_ticks();
+	test_timer_start(t, TIMER_PERIODIC, TEST_LOAD);
+
+	wait_until(start + TEST_FIRES * TEST_LOAD + TEST_SLACK);
+	timer_stop(&t->tmr);
+
+	test_assert(t->fired >= TEST_FIRES);
+	for (i = 0; i < TEST_FIRES; i++) {
+		test_assert_fired_at(t->at[i], start, (i + 1) * TEST_LOAD);
+	}
+}
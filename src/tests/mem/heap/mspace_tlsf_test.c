@@ -0,0 +1,86 @@
+/**
+ * @file
+ *
+ * @brief
+ *
+ * @date 18.10.2026
+ */
+#include <stdint.h>
+
+#include <embox/test.h>
+#include <mem/heap/mspace_malloc.h>
+#include <mem/page.h>
+#include <util/array.h>
+#include <util/dlist.h>
+
+EMBOX_TEST_SUITE("mspace_tlsf test");
+
+TEST_SETUP(setup);
+TEST_TEARDOWN(teardown);
+
+extern int mspace_init(struct dlist_head *mspace);
+extern int mspace_fini(struct dlist_head *mspace);
+extern size_t mspace_deep_copy_size(struct dlist_head *mspace);
+
+static struct dlist_head mspace;
+
+TEST_CASE("Check if tlsf concatenates free blocks") {
+	void *ptr[4];
+	void *big;
+	size_t size;
+	int i;
+
+	big = mspace_malloc(PAGE_SIZE(), &mspace);
+	test_assert_not_null(big);
+	size = mspace_deep_copy_size(&mspace);
+	test_assert_zero(mspace_free(big, &mspace));
+
+	for (i = 0; i < ARRAY_SIZE(ptr); i++) {
+		ptr[i] = mspace_malloc(PAGE_SIZE() / ARRAY_SIZE(ptr), &mspace);
+		test_assert_not_null(ptr[i]);
+	}
+	test_assert_zero(mspace_free(ptr[0], &mspace));
+	test_assert_zero(mspace_free(ptr[2], &mspace));
+	test_assert_zero(mspace_free(ptr[1], &mspace));
+	test_assert_zero(mspace_free(ptr[3], &mspace));
+
+	/* No new segment is needed */
+	big = mspace_malloc(PAGE_SIZE(), &mspace);
+	test_assert_not_null(big);
+	test_assert_equal(size, mspace_deep_copy_size(&mspace));
+	test_assert_zero(mspace_free(big, &mspace));
+}
+
+TEST_CASE("Allocate blocks with alignment") {
+	void *ptr;
+	size_t boundary;
+
+	for (boundary = 8; boundary <= PAGE_SIZE(); boundary <<= 1) {
+		ptr = mspace_memalign(boundary, 100, &mspace);
+		test_assert_not_null(ptr);
+		test_assert_zero((uintptr_t) ptr % boundary);
+		test_assert_zero(mspace_free(ptr, &mspace));
+	}
+}
+
+TEST_CASE("Pointer of other heap isn't freed") {
+	struct dlist_head other;
+	void *ptr;
+
+	mspace_init(&other);
+
+	ptr = mspace_malloc(32, &mspace);
+	test_assert_not_null(ptr);
+	test_assert_not_zero(mspace_free(ptr, &other));
+	test_assert_zero(mspace_free(ptr, &mspace));
+
+	mspace_fini(&other);
+}
+
+static int setup(void) {
+	return mspace_init(&mspace);
+}
+
+static int teardown(void) {
+	return mspace_fini(&mspace);
+}
@@ -0,0 +1,107 @@
+/**
+ * @file
+ * @brief Test unit for util/ohashtable.
+ *
+ * @date 17.10.2026
+ */
+
+#include <embox/test.h>
+#include <stddef.h>
+
+#include <util/ohashtable.h>
+
+EMBOX_TEST_SUITE("util/ohashtable test");
+
+#define OHT_TEST_SIZE  8
+#define OHT_TEST_ITEMS 100
+
+static int values[OHT_TEST_ITEMS];
+
+static size_t get_hash(const void *key) {
+	/* Bad hash on purpose to get long clusters */
+	return *(const int *)key / 4;
+}
+
+OHASHTABLE_DEF(oht, OHT_TEST_SIZE, int, get_hash);
+
+TEST_TEARDOWN(oht_teardown);
+
+TEST_CASE("Put and get single element") {
+	int key = 1;
+
+	test_assert_zero(ohashtable_put(&oht, &key, &values[0]));
+	test_assert_equal(ohashtable_get(&oht, &key), &values[0]);
+
+	key = 2;
+	test_assert_null(ohashtable_get(&oht, &key));
+}
+
+TEST_CASE("Put with existing key replaces value") {
+	int key = 1;
+
+	test_assert_zero(ohashtable_put(&oht, &key, &values[0]));
+	test_assert_zero(ohashtable_put(&oht, &key, &values[1]));
+	test_assert_equal(ohashtable_count(&oht), 1);
+	test_assert_equal(ohashtable_get(&oht, &key), &values[1]);
+}
+
+TEST_CASE("Table grows beyond its initial size") {
+	int i;
+
+	for (i = 0; i < OHT_TEST_ITEMS; i++) {
+		test_assert_zero(ohashtable_put(&oht, &i, &values[i]));
+		/* Elements are available while table is being migrated */
+		test_assert_equal(ohashtable_get(&oht, &i), &values[i]);
+	}
+
+	test_assert_equal(ohashtable_count(&oht), OHT_TEST_ITEMS);
+
+	for (i = 0; i < OHT_TEST_ITEMS; i++) {
+		test_assert_equal(ohashtable_get(&oht, &i), &values[i]);
+	}
+}
+
+TEST_CASE("Delete keeps other elements reachable") {
+	int i;
+
+	for (i = 0; i < OHT_TEST_ITEMS; i++) {
+		test_assert_zero(ohashtable_put(&oht, &i, &values[i]));
+	}
+
+	for (i = 0; i < OHT_TEST_ITEMS; i += 2) {
+		test_assert_equal(ohashtable_del(&oht, &i), &values[i]);
+	}
+	test_assert_equal(ohashtable_count(&oht), OHT_TEST_ITEMS / 2);
+
+	for (i = 0; i < OHT_TEST_ITEMS; i++) {
+		if (i % 2) {
+			test_assert_equal(ohashtable_get(&oht, &i), &values[i]);
+		} else {
+			test_assert_null(ohashtable_get(&oht, &i));
+		}
+	}
+}
+
+TEST_CASE("Iterate over all keys") {
+	int i, cnt, sum;
+	int *key;
+
+	for (i = 0, sum = 0; i < OHT_TEST_ITEMS; i++) {
+		test_assert_zero(ohashtable_put(&oht, &i, &values[i]));
+		sum += i;
+	}
+
+	for (key = ohashtable_get_key_first(&oht), cnt = 0;
+			key != NULL;
+			key = ohashtable_get_key_next(&oht, key), cnt++) {
+		sum -= *key;
+	}
+
+	test_assert_equal(cnt, OHT_TEST_ITEMS);
+	test_assert_zero(sum);
+}
+
+static int oht_teardown(void) {
+	ohashtable_destroy(&oht);
+	return 0;
+}
@@ -0,0 +1,355 @@
+/**
+ * @file
+ *
+ * @brief An implementation of open addressing hash table
+ *
+ * @details Entries of a probe sequence are kept sorted by their home slot
+ * (Robin Hood invariant). So an insertion shifts the rest of the cluster one
+ * slot forward, a deletion shifts it one slot backward and a lookup stops
+ * as soon as it meets an entry closer to its home than the searched key
+ * would be.
+ *
+ * @date 17.10.2026
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
+
+#include <mem/sysmalloc.h>
+#include <util/member.h>
+#include <util/ohashtable.h>
+
+#include <framework/mod/options.h>
+
+#define OHT_MIGRATE_STEP OPTION_GET(NUMBER, migrate_step)
+
+#define OHT_USED  0x80000000U
+/* Entry moved from old table to the current one. Old table is never
+ * inserted into, so such slot is skipped instead of shifting its cluster. */
+#define OHT_MOVED 0x1U
+
+static inline struct ohashtable_slot *oht_slot(struct ohashtable *ht,
+		struct ohashtable_tab *tab, unsigned int idx) {
+	return (struct ohashtable_slot *)((char *)tab->slots + idx * ht->slot_size);
+}
+
+static inline unsigned int oht_dist(struct ohashtable_tab *tab,
+		unsigned int idx, uint32_t hash) {
+	return (idx - hash) & (tab->size - 1);
+}
+
+static uint32_t oht_hash(struct ohashtable *ht, const void *key) {
+	size_t key_hash;
+	uint32_t h;
+
+	key_hash = ht->get_hash(key);
+
+	/* Mix the bits, as only the low ones select the home slot */
+	h = (uint32_t)(key_hash ^ (key_hash >> 16 >> 16));
+	h ^= h >> 16;
+	h *= 0x45d9f3bU;
+	h ^= h >> 16;
+
+	return h | OHT_USED;
+}
+
+static struct ohashtable_slot *oht_find(struct ohashtable *ht,
+		struct ohashtable_tab *tab, const void *key, uint32_t hash) {
+	struct ohashtable_slot *slot;
+	unsigned int idx, dist;
+
+	idx = hash & (tab->size - 1);
+	for (dist = 0; dist < tab->size; dist++, idx = (idx + 1) & (tab->size - 1)) {
+		slot = oht_slot(ht, tab, idx);
+
+		if (slot->hash == 0) {
+			break;
+		}
+		if (slot->hash == OHT_MOVED) {
+			continue;
+		}
+		if (oht_dist(tab, idx, slot->hash) < dist) {
+			break;
+		}
+		if ((slot->hash == hash) && !memcmp(slot->key, key, ht->key_size)) {
+			return slot;
+		}
+	}
+
+	return NULL;
+}
+
+static void oht_insert(struct ohashtable *ht, struct ohashtable_tab *tab,
+		uint32_t hash, const void *key, void *value) {
+	struct ohashtable_slot *slot;
+	unsigned int idx, free_idx, dist, mask;
+
+	assert(tab->cnt < tab->size);
+
+	mask = tab->size - 1;
+
+	/* Find the first entry that is closer to its home than the new one */
+	idx = hash & mask;
+	for (dist = 0; ; dist++, idx = (idx + 1) & mask) {
+		slot = oht_slot(ht, tab, idx);
+		if ((slot->hash == 0) || (oht_dist(tab, idx, slot->hash) < dist)) {
+			break;
+		}
+	}
+
+	/* Shift the rest of the cluster by one slot */
+	for (free_idx = idx; oht_slot(ht, tab, free_idx)->hash != 0; ) {
+		free_idx = (free_idx + 1) & mask;
+	}
+	for (; free_idx != idx; free_idx = (free_idx - 1) & mask) {
+		memcpy(oht_slot(ht, tab, free_idx),
+				oht_slot(ht, tab, (free_idx - 1) & mask), ht->slot_size);
+	}
+
+	slot->hash = hash;
+	slot->value = value;
+	memcpy(slot->key, key, ht->key_size);
+
+	tab->cnt++;
+}
+
+static void oht_remove(struct ohashtable *ht, struct ohashtable_tab *tab,
+		struct ohashtable_slot *slot) {
+	struct ohashtable_slot *next;
+	unsigned int idx, mask;
+
+	if (tab == &ht->old) {
+		slot->hash = OHT_MOVED;
+		tab->cnt--;
+		return;
+	}
+
+	mask = tab->size - 1;
+	idx = ((char *)slot - (char *)tab->slots) / ht->slot_size;
+
+	/* Shift entries that are not at their home slot one slot backward */
+	for (;;) {
+		idx = (idx + 1) & mask;
+		next = oht_slot(ht, tab, idx);
+		if ((next->hash == 0) || (oht_dist(tab, idx, next->hash) == 0)) {
+			break;
+		}
+		memcpy(slot, next, ht->slot_size);
+		slot = next;
+	}
+
+	slot->hash = 0;
+	tab->cnt--;
+}
+
+static void oht_tab_free(struct ohashtable *ht, struct ohashtable_tab *tab) {
+	if (tab->slots != ht->static_slots) {
+		sysfree(tab->slots);
+	}
+	tab->slots = NULL;
+	tab->size = 0;
+	tab->cnt = 0;
+}
+
+static void oht_migrate(struct ohashtable *ht, unsigned int step) {
+	struct ohashtable_slot *slot;
+
+	for (; (ht->old.cnt != 0) && (step != 0); ht->migrate_pos++) {
+		slot = oht_slot(ht, &ht->old, ht->migrate_pos);
+		if (slot->hash & OHT_USED) {
+			oht_insert(ht, &ht->cur, slot->hash, slot->key, slot->value);
+			slot->hash = OHT_MOVED;
+			ht->old.cnt--;
+			step--;
+		}
+	}
+
+	if ((ht->old.size != 0) && (ht->old.cnt == 0)) {
+		oht_tab_free(ht, &ht->old);
+	}
+}
+
+static void oht_grow(struct ohashtable *ht) {
+	void *slots;
+	size_t size;
+
+	if (ht->old.size != 0) {
+		return; /* previous resize is still in progress */
+	}
+
+	size = ht->cur.size * 2;
+	slots = sysmalloc(size * ht->slot_size);
+	if (slots == NULL) {
+		return; /* keep filling the current table */
+	}
+	memset(slots, 0, size * ht->slot_size);
+
+	ht->old = ht->cur;
+	ht->cur.slots = slots;
+	ht->cur.size = size;
+	ht->cur.cnt = 0;
+	ht->migrate_pos = 0;
+}
+
+static struct ohashtable_slot *oht_lookup(struct ohashtable *ht,
+		const void *key, uint32_t hash, struct ohashtable_tab **tab) {
+	struct ohashtable_slot *slot;
+
+	*tab = &ht->cur;
+	if (NULL != (slot = oht_find(ht, &ht->cur, key, hash))) {
+		return slot;
+	}
+
+	if (ht->old.cnt == 0) {
+		return NULL;
+	}
+
+	*tab = &ht->old;
+	return oht_find(ht, &ht->old, key, hash);
+}
+
+struct ohashtable *ohashtable_init(struct ohashtable *ht, void *buf,
+		unsigned int size, size_t key_size, oht_hash_ft get_hash) {
+	assert(ht);
+	assert(buf);
+	assert((size != 0) && ((size & (size - 1)) == 0));
+
+	memset(ht, 0, sizeof(*ht));
+
+	ht->key_size = key_size;
+	ht->slot_size = OHASHTABLE_SLOT_SIZE(key_size);
+	ht->get_hash = get_hash;
+	ht->static_slots = buf;
+	ht->static_size = size;
+
+	ht->cur.slots = buf;
+	ht->cur.size = size;
+	memset(buf, 0, size * ht->slot_size);
+
+	return ht;
+}
+
+void ohashtable_destroy(struct ohashtable *ht) {
+	assert(ht);
+
+	if (ht->old.size != 0) {
+		oht_tab_free(ht, &ht->old);
+	}
+	oht_tab_free(ht, &ht->cur);
+
+	ht->cur.slots = ht->static_slots;
+	ht->cur.size = ht->static_size;
+	memset(ht->cur.slots, 0, ht->cur.size * ht->slot_size);
+}
+
+int ohashtable_put(struct ohashtable *ht, const void *key, void *value) {
+	struct ohashtable_slot *slot;
+	struct ohashtable_tab *tab;
+	uint32_t hash;
+
+	assert(ht);
+
+	hash = oht_hash(ht, key);
+
+	if (NULL != (slot = oht_lookup(ht, key, hash, &tab))) {
+		slot->value = value;
+		return 0;
+	}
+
+	/* Keep load factor below 3/4 */
+	if ((ohashtable_count(ht) + 1) * 4 > ht->cur.size * 3) {
+		oht_grow(ht);
+	}
+	oht_migrate(ht, OHT_MIGRATE_STEP);
+
+	if (ht->cur.cnt + 1 >= ht->cur.size) {
+		return -ENOMEM;
+	}
+
+	oht_insert(ht, &ht->cur, hash, key, value);
+
+	return 0;
+}
+
+void *ohashtable_get(struct ohashtable *ht, const void *key) {
+	struct ohashtable_slot *slot;
+	struct ohashtable_tab *tab;
+
+	assert(ht);
+
+	slot = oht_lookup(ht, key, oht_hash(ht, key), &tab);
+
+	return slot ? slot->value : NULL;
+}
+
+void *ohashtable_del(struct ohashtable *ht, const void *key) {
+	struct ohashtable_slot *slot;
+	struct ohashtable_tab *tab;
+	void *value;
+
+	assert(ht);
+
+	slot = oht_lookup(ht, key, oht_hash(ht, key), &tab);
+	if (slot == NULL) {
+		return NULL;
+	}
+
+	value = slot->value;
+	oht_remove(ht, tab, slot);
+
+	oht_migrate(ht, OHT_MIGRATE_STEP);
+
+	return value;
+}
+
+static void *oht_key_from(struct ohashtable *ht, struct ohashtable_tab *tab,
+		unsigned int idx) {
+	struct ohashtable_slot *slot;
+
+	for (; idx < tab->size; idx++) {
+		slot = oht_slot(ht, tab, idx);
+		if (slot->hash & OHT_USED) {
+			return slot->key;
+		}
+	}
+
+	return NULL;
+}
+
+void *ohashtable_get_key_first(struct ohashtable *ht) {
+	void *key;
+
+	assert(ht);
+
+	if (ht->old.cnt && (NULL != (key = oht_key_from(ht, &ht->old, 0)))) {
+		return key;
+	}
+
+	return oht_key_from(ht, &ht->cur, 0);
+}
+
+void *ohashtable_get_key_next(struct ohashtable *ht, void *prev_key) {
+	struct ohashtable_slot *slot;
+	char *slots_end;
+	void *key;
+
+	assert(ht);
+	assert(prev_key);
+
+	slot = member_cast_out(prev_key, struct ohashtable_slot, key);
+
+	slots_end = (char *)ht->old.slots + ht->old.size * ht->slot_size;
+	if ((ht->old.size != 0) && ((char *)slot >= (char *)ht->old.slots)
+			&& ((char *)slot < slots_end)) {
+		key = oht_key_from(ht, &ht->old,
+			((char *)slot - (char *)ht->old.slots) / ht->slot_size + 1);
+		if (key != NULL) {
+			return key;
+		}
+		return oht_key_from(ht, &ht->cur, 0);
+	}
+
+	return oht_key_from(ht, &ht->cur,
+			((char *)slot - (char *)ht->cur.slots) / ht->slot_size + 1);
+}
@@ -9,6 +9,8 @@
 #ifndef UTIL_LOGGING_H_
 #define UTIL_LOGGING_H_
 
+#include <stdarg.h>
+
 /**
  * Logging level, decreasing by fatality.
  */
@@ -42,4 +44,16 @@ extern char *log_levels[];
 extern void logging_raw(struct logging *logging, int level,
 	const char* fmt, ...);
 
+/**
+ * Outputs a message which passed level filter. Implementation may print it
+ * at once or store it to be printed later.
+ */
+extern void logging_vprint(const char *fmt, va_list args);
+
+/**
+ * Prints all stored messages right now. Called on panic, so it must not
+ * sleep. Implementations which print at once don't define it.
+ */
+extern void logging_flush(void) __attribute__ ((weak));
+
 #endif /* UTIL_LOGGING_H_ */
@@ -0,0 +1,15 @@
+/**
+ * @file
+ * @brief Logging which prints messages at once
+ *
+ * @date 18.10.2026
+ */
+
+#include <stdarg.h>
+
+#include <kernel/printk.h>
+#include <util/logging.h>
+
+void logging_vprint(const char *fmt, va_list args) {
+	vprintk(fmt, args);
+}
@@ -39,6 +39,12 @@ void QEmboxCursor::emboxCursorRedraw(struct fb_info *fb, int x, int y) {
 	storeDirtyRect(fb,  __calculateCursorLocation(fb, x, y));
 	drawCursor(fb, __calculateCursorLocation(fb, x, y));
 
+	/* Show both restored and new cursor place, and anything
+	 * damaged by the caller */
+	fb_damage(fb, mouseX, mouseY, cursor_W, cursor_H);
+	fb_damage(fb, x, y, cursor_W, cursor_H);
+	fb_flush(fb);
+
 	mouseX = x;
 	mouseY = y;
 }
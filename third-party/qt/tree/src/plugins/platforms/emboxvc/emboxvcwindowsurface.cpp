@@ -387,6 +387,7 @@ void QEmboxVCWindowSurface::flush(QWidget *widget, const QRegion &region, const
     for (i = 0, shift = 0; i < mImage.height(); i++ , shift += vc->emboxVC.fb->var.xres * bpp) {
     	memcpy(begin + shift, (const void *)mImage.constScanLine(i), mImage.bytesPerLine());
     }
+    fb_damage(vc->emboxVC.fb, x, y, mImage.width(), mImage.height());
 
     /* Reset cursor on new image and redraw */
     vc->cursor->emboxCursorReset(vc->emboxVC.fb);